@@ -53,6 +53,14 @@ for f in $sources; do
     $CXX $CXXFLAGS example/$f/*.cc \
         $LDFLAGS -lSDL2 -lSDL2_image \
         -o gen/bin/example-$f
+  elif [ $f = "mzcat" ]; then
+    # example/mzcat is unusual in that it uses threads (for -jobs=N).
+    echo "Building (C)   gen/bin/example-$f"
+    $CC  $CFLAGS -pthread     example/$f/*.c  $LDFLAGS -o gen/bin/example-$f
+  elif [ $f = "zipcat" ]; then
+    # example/zipcat is unusual in that it uses threads (for -jobs=N).
+    echo "Building (C++) gen/bin/example-$f"
+    $CXX $CXXFLAGS -pthread   example/$f/*.cc $LDFLAGS -o gen/bin/example-$f
   elif [ $f = "toy-genlib" ]; then
     # example/toy-genlib is unusual in that it uses separately compiled
     # libraries (built by "wuffs genlib", e.g. by running build-all.sh) instead
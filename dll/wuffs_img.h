@@ -18,6 +18,87 @@ extern "C" {
   #define WUFFS_IMG_API
 #endif
 
+// Output pixel formats for wuffs_img_decode and wuffs_img_decode_into. The
+// decoder writes the requested layout directly (no separate conversion pass).
+// Bytes per pixel: 4 for the BGRA/RGBA formats, 3 for BGR/RGB, 1 for GRAY and
+// 8 for BGRA_NONPREMUL_16 (16 bits per channel, little-endian).
+enum wuffs_img_format {
+  WUFFS_IMG_FORMAT_BGRA_PREMUL = 0,
+  WUFFS_IMG_FORMAT_RGBA_PREMUL = 1,
+  WUFFS_IMG_FORMAT_BGRA_NONPREMUL = 2,
+  WUFFS_IMG_FORMAT_RGBA_NONPREMUL = 3,
+  WUFFS_IMG_FORMAT_BGR = 4,
+  WUFFS_IMG_FORMAT_RGB = 5,
+  WUFFS_IMG_FORMAT_GRAY = 6,
+  WUFFS_IMG_FORMAT_BGRA_NONPREMUL_16 = 7,
+};
+
+// Auto-detect decode into any wuffs_img_format (allocates a tightly packed
+// buffer; free with wuffs_img_free).
+// Returns: 0 on success; -1 on invalid arguments; -2 on decode error; -5 if
+// out of memory.
+WUFFS_IMG_API int wuffs_img_decode(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height);
+// Auto-detect decode into any wuffs_img_format, into caller memory of dst_len
+// bytes. Returns -3 if dst_len or dst_stride is too short for the image.
+WUFFS_IMG_API int wuffs_img_decode_into(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    uint8_t* dst_pixels,
+    size_t dst_len,
+    size_t dst_stride,
+    int* out_width,
+    int* out_height);
+
+// Resampling filters for wuffs_img_decode_resized.
+enum wuffs_img_filter {
+  WUFFS_IMG_FILTER_BOX = 0,
+  WUFFS_IMG_FILTER_BILINEAR = 1,
+  WUFFS_IMG_FILTER_LANCZOS3 = 2,
+};
+
+// Like wuffs_img_decode but resizes the image to dst_width x dst_height. If
+// one of those is 0, it is calculated from the other so that the aspect ratio
+// is preserved. GRAY/RGB/BGR/BGRA formats are supported (allocates; free with
+// wuffs_img_free). out_width and out_height are the resized dimensions.
+WUFFS_IMG_API int wuffs_img_decode_resized(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    int dst_width,
+    int dst_height,
+    int filter,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height);
+
+// Auto-detect decode into RGB / BGR (3 bytes per pixel) or 8-bit gray
+// (allocates; free with wuffs_img_free)
+WUFFS_IMG_API int wuffs_img_decode_rgb(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height);
+WUFFS_IMG_API int wuffs_img_decode_bgr(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height);
+WUFFS_IMG_API int wuffs_img_decode_gray(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height);
+
 // Auto-detect decode into BGRA (allocates; free with wuffs_img_free)
 WUFFS_IMG_API int wuffs_img_decode_bgra_premul(
     const uint8_t* data,
@@ -209,6 +290,15 @@ WUFFS_IMG_API int wuffs_img_probe(const uint8_t* data, size_t data_len,
                                   int* out_width, int* out_height,
                                   char* out_ext, size_t out_ext_len,
                                   char* out_error, size_t out_error_len);
+// Probe with frame count (if count_frames is non-zero, which reads the whole
+// input) and EXIF orientation (1..8, or 0 if unknown). Any enabled format.
+WUFFS_IMG_API int wuffs_img_probe_info(const uint8_t* data, size_t data_len,
+                                       int count_frames,
+                                       int* out_width, int* out_height,
+                                       uint64_t* out_num_frames,
+                                       uint32_t* out_orientation,
+                                       char* out_ext, size_t out_ext_len,
+                                       char* out_error, size_t out_error_len);
 WUFFS_IMG_API int wuffs_img_probe_jpeg(const uint8_t* data, size_t data_len,
                                        int* out_width, int* out_height);
 WUFFS_IMG_API int wuffs_img_probe_png(const uint8_t* data, size_t data_len,
@@ -8,30 +8,9 @@
 #include <windows.h>
 #endif
 
-// Ensure C linkage for exported functions when compiled as C++
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#ifdef _WIN32
-#define WUFFS_IMG_API __declspec(dllexport)
-#else
-#define WUFFS_IMG_API
-#endif
-
-// Return 0 on success; negative values indicate failure.
-WUFFS_IMG_API int wuffs_img_decode_bgra_premul(
-    const uint8_t* data,
-    size_t data_len,
-    uint8_t** out_pixels, // malloc'ed buffer the caller must free via wuffs_img_free
-    int* out_width,
-    int* out_height);
-
-WUFFS_IMG_API void wuffs_img_free(void* p);
-
-#ifdef __cplusplus
-}  // extern "C"
-#endif
+// The public declarations. Defining WUFFS_IMG_BUILD exports them on Windows.
+#define WUFFS_IMG_BUILD
+#include "wuffs_img.h"
 
 // ---------------- Implementation ----------------
 
@@ -53,88 +32,241 @@ WUFFS_IMG_API void wuffs_img_free(void* p);
 #define WUFFS_CONFIG__MODULE__ZLIB
 
 #define WUFFS_CONFIG__DST_PIXEL_FORMAT__ENABLE_ALLOWLIST
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_Y
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_BGR
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_BGRA_NONPREMUL
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_BGRA_NONPREMUL_4X16LE
 #define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_BGRA_PREMUL
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_RGB
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_RGBA_NONPREMUL
+#define WUFFS_CONFIG__DST_PIXEL_FORMAT__ALLOW_RGBA_PREMUL
 
 // Include the amalgamated Wuffs release. This file contains both C and C++
 // (wuffs_aux) code; we therefore compile this translation unit as C++.
 #include "../release/c/wuffs-unsupported-snapshot.c"
 
-extern "C" WUFFS_IMG_API int wuffs_img_decode_bgra_premul(
-    const uint8_t* data,
-    size_t data_len,
-    uint8_t** out_pixels,
-    int* out_width,
-    int* out_height) {
-  if (!data || data_len == 0 || !out_pixels || !out_width || !out_height) {
-    return -1;
+// ---------------- Output pixel format negotiation ----------------
+
+// The wuffs_img_format values (see wuffs_img.h), in order.
+static const uint32_t img_format_reprs[] = {
+    WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL,
+    WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL,
+    WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL,
+    WUFFS_BASE__PIXEL_FORMAT__RGBA_NONPREMUL,
+    WUFFS_BASE__PIXEL_FORMAT__BGR,
+    WUFFS_BASE__PIXEL_FORMAT__RGB,
+    WUFFS_BASE__PIXEL_FORMAT__Y,
+    WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE,
+};
+
+// FormatCallbacks make wuffs_aux::DecodeImage's swizzler write the requested
+// pixel format directly, so there is no second (conversion) pass. If dst is
+// non-null, the pixels are written there (the "into" variants). Otherwise the
+// default AllocPixbuf's tightly packed malloc buffer is handed to the caller.
+// A non-zero want_fourcc restricts decoding to that one file format.
+class FormatCallbacks : public wuffs_aux::DecodeImageCallbacks {
+ public:
+  FormatCallbacks(uint32_t repr, uint8_t* dst, size_t dst_len,
+                  size_t dst_stride, uint32_t want_fourcc)
+      : m_repr(repr), m_dst(dst), m_dst_len(dst_len), m_dst_stride(dst_stride),
+        m_want_fourcc(want_fourcc), m_fourcc(0) {}
+
+  wuffs_base__image_decoder::unique_ptr SelectDecoder(
+      uint32_t fourcc, wuffs_base__slice_u8 prefix_data,
+      bool prefix_closed) override {
+    if (m_want_fourcc && (fourcc != m_want_fourcc)) {
+      return wuffs_base__image_decoder::unique_ptr(nullptr);
+    }
+    m_fourcc = fourcc;
+    return wuffs_aux::DecodeImageCallbacks::SelectDecoder(fourcc, prefix_data,
+                                                          prefix_closed);
   }
 
-  *out_pixels = nullptr;
+  wuffs_base__pixel_format SelectPixfmt(
+      const wuffs_base__image_config&) override {
+    return wuffs_base__make_pixel_format(m_repr);
+  }
+
+  AllocPixbufResult AllocPixbuf(const wuffs_base__image_config& image_config,
+                                bool allow_uninitialized_memory) override {
+    if (!m_dst) {
+      return wuffs_aux::DecodeImageCallbacks::AllocPixbuf(
+          image_config, allow_uninitialized_memory);
+    }
+    uint32_t w = image_config.pixcfg.width();
+    uint32_t h = image_config.pixcfg.height();
+    size_t row = (size_t)w * (image_config.pixcfg.pixel_format().bits_per_pixel() / 8);
+    if ((row > 0) && (h > 0) &&
+        ((m_dst_stride < row) || (m_dst_len < row) ||
+         (((m_dst_len - row) / m_dst_stride) < (size_t)(h - 1)))) {
+      return AllocPixbufResult(wuffs_aux::DecodeImage_BufferIsTooShort);
+    }
+    wuffs_base__pixel_buffer pixbuf;
+    wuffs_base__status status = pixbuf.set_interleaved(
+        &image_config.pixcfg,
+        wuffs_base__make_table_u8(m_dst, row, (size_t)h, m_dst_stride),
+        wuffs_base__empty_slice_u8());
+    if (!status.is_ok()) {
+      return AllocPixbufResult(status.message());
+    }
+    return AllocPixbufResult(wuffs_aux::MemOwner(nullptr, &free), pixbuf);
+  }
+
+  uint32_t fourcc() const { return m_fourcc; }
+
+ private:
+  uint32_t m_repr;
+  uint8_t* m_dst;
+  size_t m_dst_len;
+  size_t m_dst_stride;
+  uint32_t m_want_fourcc;
+  uint32_t m_fourcc;
+};
+
+// Returns 0 on success, -1 on invalid arguments, -2 on decode error, -3 if the
+// destination buffer is too short and -5 on out of memory.
+static int decode_to_format(const uint8_t* data,
+                            size_t data_len,
+                            int format,
+                            uint8_t* dst_pixels,
+                            size_t dst_len,
+                            size_t dst_stride,
+                            uint8_t** out_pixels,
+                            int* out_width,
+                            int* out_height,
+                            uint32_t want_fourcc = 0,
+                            uint32_t* out_fourcc = nullptr,
+                            std::string* out_error = nullptr,
+                            wuffs_aux::DecodeImageArgResize resize =
+                                wuffs_aux::DecodeImageArgResize::DefaultValue()) {
+  if (!data || (data_len == 0) || !out_width || !out_height ||
+      (format < 0) ||
+      ((size_t)format >= sizeof img_format_reprs / sizeof img_format_reprs[0]) ||
+      (!dst_pixels && !out_pixels)) {
+    return -1;
+  }
+  if (out_pixels) *out_pixels = nullptr;
   *out_width = 0;
   *out_height = 0;
 
   wuffs_aux::sync_io::MemoryInput input(data, data_len);
-
-  uint64_t dia_flags = 0; // no metadata handling here
-
-  wuffs_aux::DecodeImageCallbacks callbacks;
+  FormatCallbacks callbacks(img_format_reprs[format], dst_pixels, dst_len,
+                            dst_stride, want_fourcc);
   wuffs_aux::DecodeImageResult result = wuffs_aux::DecodeImage(
-      callbacks,
-      input,
+      callbacks, input,
       wuffs_aux::DecodeImageArgQuirks(nullptr, 0),
-      wuffs_aux::DecodeImageArgFlags(dia_flags),
+      wuffs_aux::DecodeImageArgFlags(0),
       wuffs_aux::DecodeImageArgPixelBlend(WUFFS_BASE__PIXEL_BLEND__SRC),
       wuffs_aux::DecodeImageArgBackgroundColor(0),
-      wuffs_aux::DecodeImageArgMaxInclDimension(16384));
-
-  if (!result.error_message.empty()) {
-    return -2; // decode error
-  }
-  
-  // Acquire the pixel buffer before local objects go out of scope.
-  wuffs_base__pixel_buffer pixbuf = result.pixbuf;
-  (void)pixbuf;
-
-  if (!result.pixbuf.pixcfg.is_valid()) {
-    return -3; // invalid pixel buffer
+      wuffs_aux::DecodeImageArgMaxInclDimension(16384),
+      wuffs_aux::DecodeImageArgMaxInclMetadataLength::DefaultValue(), resize);
+  if (out_fourcc) *out_fourcc = callbacks.fourcc();
+  if (out_error) *out_error = result.error_message;
+  if (result.error_message == wuffs_aux::DecodeImage_BufferIsTooShort) {
+    return -3;
+  } else if (result.error_message == wuffs_aux::DecodeImage_OutOfMemory) {
+    return -5;
+  } else if (!result.error_message.empty() ||
+             !result.pixbuf.pixcfg.is_valid()) {
+    return -2;
   }
 
-  if (!result.pixbuf.pixcfg.pixel_format().is_interleaved() ||
-      (result.pixbuf.pixcfg.pixel_format().repr !=
-       WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL)) {
-    return -4; // unexpected pixel format
+  if (!dst_pixels) {
+    // Transfer ownership of the (tightly packed, malloc'ed) pixels.
+    *out_pixels = static_cast<uint8_t*>(result.pixbuf_mem_owner.release());
   }
+  *out_width = (int)result.pixbuf.pixcfg.width();
+  *out_height = (int)result.pixbuf.pixcfg.height();
+  return 0;
+}
 
-  const uint32_t width = result.pixbuf.pixcfg.width();
-  const uint32_t height = result.pixbuf.pixcfg.height();
-  wuffs_base__table_u8 plane0 = pixbuf.plane(0);
-
-  const size_t expected_stride = static_cast<size_t>(width) * 4;
-  const size_t dst_size = expected_stride * static_cast<size_t>(height);
+extern "C" WUFFS_IMG_API int wuffs_img_decode(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return decode_to_format(data, data_len, format, nullptr, 0, 0, out_pixels,
+                          out_width, out_height);
+}
 
-  uint8_t* dst = static_cast<uint8_t*>(malloc(dst_size));
-  if (!dst) {
-    return -5; // out of memory
+extern "C" WUFFS_IMG_API int wuffs_img_decode_into(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    uint8_t* dst_pixels,
+    size_t dst_len,
+    size_t dst_stride,
+    int* out_width,
+    int* out_height) {
+  if (!dst_pixels) {
+    return -1;
   }
+  return decode_to_format(data, data_len, format, dst_pixels, dst_len,
+                          dst_stride, nullptr, out_width, out_height);
+}
 
-  if (plane0.width == expected_stride) {
-    // Tight buffer; copy in one go.
-    memcpy(dst, plane0.ptr, dst_size);
-  } else {
-    // Not tight; copy row by row.
-    for (uint32_t y = 0; y < height; y++) {
-      const uint8_t* src_row = plane0.ptr + y * plane0.stride;
-      uint8_t* dst_row = dst + y * expected_stride;
-      memcpy(dst_row, src_row, expected_stride);
-    }
+extern "C" WUFFS_IMG_API int wuffs_img_decode_resized(
+    const uint8_t* data,
+    size_t data_len,
+    int format,
+    int dst_width,
+    int dst_height,
+    int filter,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  if ((dst_width < 0) || (dst_height < 0) ||
+      ((dst_width == 0) && (dst_height == 0)) ||
+      (filter < WUFFS_IMG_FILTER_BOX) || (filter > WUFFS_IMG_FILTER_LANCZOS3)) {
+    return -1;
   }
+  return decode_to_format(
+      data, data_len, format, nullptr, 0, 0, out_pixels, out_width,
+      out_height, 0, nullptr, nullptr,
+      wuffs_aux::DecodeImageArgResize((uint32_t)dst_width,
+                                      (uint32_t)dst_height, (uint32_t)filter));
+}
 
-  // Transfer ownership to caller.
-  *out_pixels = dst;
-  *out_width = static_cast<int>(width);
-  *out_height = static_cast<int>(height);
+extern "C" WUFFS_IMG_API int wuffs_img_decode_bgra_premul(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_BGRA_PREMUL,
+                          out_pixels, out_width, out_height);
+}
 
-  return 0;
+extern "C" WUFFS_IMG_API int wuffs_img_decode_rgb(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_RGB, out_pixels,
+                          out_width, out_height);
+}
+
+extern "C" WUFFS_IMG_API int wuffs_img_decode_bgr(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_BGR, out_pixels,
+                          out_width, out_height);
+}
+
+extern "C" WUFFS_IMG_API int wuffs_img_decode_gray(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_GRAY, out_pixels,
+                          out_width, out_height);
 }
 
 extern "C" WUFFS_IMG_API void wuffs_img_free(void* p) {
@@ -887,106 +1019,98 @@ static inline bool has_gif_magic(const uint8_t* p, size_t n) {
   return (n >= 6) && (!memcmp(p, "GIF87a", 6) || !memcmp(p, "GIF89a", 6));
 }
 
-extern "C" WUFFS_IMG_API int wuffs_img_probe(const uint8_t* data,
-                                              size_t data_len,
-                                              int* out_width,
-                                              int* out_height,
-                                              char* out_ext,
-                                              size_t out_ext_len,
-                                              char* out_error,
-                                              size_t out_error_len) {
+static const char* ext_for_fourcc(uint32_t fourcc) {
+  switch (fourcc) {
+    case WUFFS_BASE__FOURCC__BMP: return "bmp";
+    case WUFFS_BASE__FOURCC__GIF: return "gif";
+    case WUFFS_BASE__FOURCC__JPEG: return "jpeg";
+    case WUFFS_BASE__FOURCC__PNG: return "png";
+    case WUFFS_BASE__FOURCC__WEBP: return "webp";
+  }
+  return "";
+}
+
+// Probe via wuffs_aux::ProbeImage: sniffs the format (any enabled decoder) and
+// decodes only the image config, so only the header bytes are examined unless
+// frames are counted.
+static int probe_image(const uint8_t* data,
+                       size_t data_len,
+                       uint64_t probe_flags,
+                       int* out_width,
+                       int* out_height,
+                       uint64_t* out_num_frames,
+                       uint32_t* out_orientation,
+                       char* out_ext,
+                       size_t out_ext_len,
+                       char* out_error,
+                       size_t out_error_len) {
+  if (out_ext && out_ext_len) out_ext[0] = '\0';
+  if (out_error && out_error_len) out_error[0] = '\0';
   if (!data || (data_len == 0) || !out_width || !out_height) {
     if (out_error && out_error_len) {
       snprintf(out_error, out_error_len, "%s", "invalid arguments");
     }
     return -1;
   }
-  if (out_ext && out_ext_len) out_ext[0] = '\0';
-  if (out_error && out_error_len) out_error[0] = '\0';
-
-  // Determine likely format by magic.
-  int magic_fmt = -1; // 0=png, 1=jpeg, 2=gif
-  if (has_png_magic(data, data_len)) magic_fmt = 0;
-  else if (has_jpeg_magic(data, data_len)) magic_fmt = 1;
-  else if (has_gif_magic(data, data_len)) magic_fmt = 2;
 
-  // Try all formats in a preferred order (magic first).
-  int order[3] = {0, 1, 2};
-  if (magic_fmt == 1) { order[0] = 1; order[1] = 0; order[2] = 2; }
-  else if (magic_fmt == 2) { order[0] = 2; order[1] = 0; order[2] = 1; }
-  else { order[0] = 0; order[1] = 1; order[2] = 2; }
-
-  const char* fmt_name[3] = {"png", "jpeg", "gif"};
-  char err_png[256] = {0}, err_jpeg[256] = {0}, err_gif[256] = {0};
-  bool tried_png = false, tried_jpeg = false, tried_gif = false;
+  wuffs_aux::sync_io::MemoryInput input(data, data_len);
+  wuffs_aux::DecodeImageCallbacks callbacks;
+  wuffs_aux::ProbeImageResult result = wuffs_aux::ProbeImage(
+      callbacks, input, wuffs_aux::DecodeImageArgQuirks::DefaultValue(),
+      wuffs_aux::DecodeImageArgFlags::DefaultValue(),
+      wuffs_aux::ProbeImageArgFlags(probe_flags));
 
-  for (int i = 0; i < 3; i++) {
-    int fmt = order[i];
-    if (fmt == 0) {
-      tried_png = true;
-      wuffs_png__decoder dec = {};
-      wuffs_base__status si = wuffs_png__decoder__initialize(
-          &dec, sizeof dec, WUFFS_VERSION, WUFFS_INITIALIZE__DEFAULT_OPTIONS);
-      if (si.repr) { snprintf(err_png, sizeof err_png, "png: %s", wuffs_base__status__message(&si)); continue; }
-      wuffs_base__io_buffer src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
-      wuffs_base__image_config ic{};
-      wuffs_base__status st = wuffs_png__decoder__decode_image_config(&dec, &ic, &src);
-      if (!st.repr && wuffs_base__image_config__is_valid(&ic)) {
-        if (out_ext && out_ext_len) snprintf(out_ext, out_ext_len, "%s", "png");
-        *out_width = (int)wuffs_base__pixel_config__width(&ic.pixcfg);
-        *out_height = (int)wuffs_base__pixel_config__height(&ic.pixcfg);
-        return 0;
-      }
-      snprintf(err_png, sizeof err_png, "png: %s", wuffs_base__status__message(&st));
-    } else if (fmt == 1) {
-      tried_jpeg = true;
-      wuffs_jpeg__decoder dec = {};
-      wuffs_base__status si = wuffs_jpeg__decoder__initialize(
-          &dec, sizeof dec, WUFFS_VERSION, WUFFS_INITIALIZE__DEFAULT_OPTIONS);
-      if (si.repr) { snprintf(err_jpeg, sizeof err_jpeg, "jpeg: %s", wuffs_base__status__message(&si)); continue; }
-      wuffs_base__io_buffer src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
-      wuffs_base__image_config ic{};
-      wuffs_base__status st = wuffs_jpeg__decoder__decode_image_config(&dec, &ic, &src);
-      if (!st.repr && wuffs_base__image_config__is_valid(&ic)) {
-        if (out_ext && out_ext_len) snprintf(out_ext, out_ext_len, "%s", "jpeg");
-        *out_width = (int)wuffs_base__pixel_config__width(&ic.pixcfg);
-        *out_height = (int)wuffs_base__pixel_config__height(&ic.pixcfg);
-        return 0;
-      }
-      snprintf(err_jpeg, sizeof err_jpeg, "jpeg: %s", wuffs_base__status__message(&st));
-    } else {
-      tried_gif = true;
-      wuffs_gif__decoder dec = {};
-      wuffs_base__status si = wuffs_gif__decoder__initialize(
-          &dec, sizeof dec, WUFFS_VERSION, WUFFS_INITIALIZE__DEFAULT_OPTIONS);
-      if (si.repr) { snprintf(err_gif, sizeof err_gif, "gif: %s", wuffs_base__status__message(&si)); continue; }
-      wuffs_base__io_buffer src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
-      wuffs_base__image_config ic{};
-      wuffs_base__status st = wuffs_gif__decoder__decode_image_config(&dec, &ic, &src);
-      if (!st.repr && wuffs_base__image_config__is_valid(&ic)) {
-        if (out_ext && out_ext_len) snprintf(out_ext, out_ext_len, "%s", "gif");
-        *out_width = (int)wuffs_base__pixel_config__width(&ic.pixcfg);
-        *out_height = (int)wuffs_base__pixel_config__height(&ic.pixcfg);
-        return 0;
-      }
-      snprintf(err_gif, sizeof err_gif, "gif: %s", wuffs_base__status__message(&st));
+  if (out_ext && out_ext_len) {
+    snprintf(out_ext, out_ext_len, "%s", ext_for_fourcc(result.fourcc));
+  }
+  if (!result.error_message.empty() || !result.image_config.is_valid()) {
+    if (out_error && out_error_len) {
+      snprintf(out_error, out_error_len, "%s",
+               result.error_message.empty()
+                   ? "unsupported or corrupt image format"
+                   : result.error_message.c_str());
     }
+    return -2;
   }
+  *out_width = (int)result.image_config.pixcfg.width();
+  *out_height = (int)result.image_config.pixcfg.height();
+  if (out_num_frames) *out_num_frames = result.num_frames;
+  if (out_orientation) *out_orientation = result.orientation;
+  return 0;
+}
 
-  // Choose the most relevant error to report.
-  const char* chosen = NULL;
-  if (magic_fmt == 0 && tried_png && err_png[0]) chosen = err_png;
-  else if (magic_fmt == 1 && tried_jpeg && err_jpeg[0]) chosen = err_jpeg;
-  else if (magic_fmt == 2 && tried_gif && err_gif[0]) chosen = err_gif;
-  else if (err_jpeg[0]) chosen = err_jpeg; // Prefer jpeg if present
-  else if (err_png[0]) chosen = err_png;
-  else if (err_gif[0]) chosen = err_gif;
+extern "C" WUFFS_IMG_API int wuffs_img_probe(const uint8_t* data,
+                                              size_t data_len,
+                                              int* out_width,
+                                              int* out_height,
+                                              char* out_ext,
+                                              size_t out_ext_len,
+                                              char* out_error,
+                                              size_t out_error_len) {
+  return probe_image(data, data_len, 0, out_width, out_height, NULL, NULL,
+                     out_ext, out_ext_len, out_error, out_error_len);
+}
 
-  if (out_error && out_error_len) {
-    if (chosen) snprintf(out_error, out_error_len, "%s", chosen);
-    else snprintf(out_error, out_error_len, "%s", "unsupported or corrupt image format");
-  }
-  return -2;
+extern "C" WUFFS_IMG_API int wuffs_img_probe_info(const uint8_t* data,
+                                                   size_t data_len,
+                                                   int count_frames,
+                                                   int* out_width,
+                                                   int* out_height,
+                                                   uint64_t* out_num_frames,
+                                                   uint32_t* out_orientation,
+                                                   char* out_ext,
+                                                   size_t out_ext_len,
+                                                   char* out_error,
+                                                   size_t out_error_len) {
+  uint64_t probe_flags = wuffs_aux::ProbeImageArgFlags::REPORT_ORIENTATION;
+  if (count_frames) {
+    probe_flags |= wuffs_aux::ProbeImageArgFlags::COUNT_FRAMES;
+  }
+  if (out_num_frames) *out_num_frames = 0;
+  if (out_orientation) *out_orientation = 0;
+  return probe_image(data, data_len, probe_flags, out_width, out_height,
+                     out_num_frames, out_orientation, out_ext, out_ext_len,
+                     out_error, out_error_len);
 }
 
 // BMP decode
@@ -1054,6 +1178,33 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_bmp_bgra_into(
   return 0;
 }
 
+extern "C" WUFFS_IMG_API int wuffs_img_decode_bmp_rgba(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    int* out_width,
+    int* out_height) {
+  return decode_to_format(data, data_len, WUFFS_IMG_FORMAT_RGBA_PREMUL,
+                          nullptr, 0, 0, out_pixels, out_width, out_height,
+                          WUFFS_BASE__FOURCC__BMP);
+}
+
+extern "C" WUFFS_IMG_API int wuffs_img_decode_bmp_rgba_into(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t* dst_pixels,
+    size_t dst_stride,
+    int* out_width,
+    int* out_height) {
+  if (!dst_pixels || (dst_stride == 0)) {
+    return -1;
+  }
+  // Like the other _into functions, the caller vouches for dst's length.
+  return decode_to_format(data, data_len, WUFFS_IMG_FORMAT_RGBA_PREMUL,
+                          dst_pixels, SIZE_MAX, dst_stride, nullptr,
+                          out_width, out_height, WUFFS_BASE__FOURCC__BMP);
+}
+
 // WEBP decode (still frames)
 extern "C" WUFFS_IMG_API int wuffs_img_decode_webp_bgra(
     const uint8_t* data,
@@ -1125,58 +1276,9 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_rgba_premul(
     uint8_t** out_pixels,
     int* out_width,
     int* out_height) {
-  // Decode via wuffs_aux path to BGRA then swizzle to RGBA.
-  if (!data || data_len == 0 || !out_pixels || !out_width || !out_height) {
-    return -1;
-  }
-  *out_pixels = nullptr; *out_width = 0; *out_height = 0;
-
-  wuffs_aux::sync_io::MemoryInput input(data, data_len);
-  uint64_t dia_flags = 0;
-  wuffs_aux::DecodeImageCallbacks callbacks;
-  wuffs_aux::DecodeImageResult result = wuffs_aux::DecodeImage(
-      callbacks, input,
-      wuffs_aux::DecodeImageArgQuirks(nullptr, 0),
-      wuffs_aux::DecodeImageArgFlags(dia_flags),
-      wuffs_aux::DecodeImageArgPixelBlend(WUFFS_BASE__PIXEL_BLEND__SRC),
-      wuffs_aux::DecodeImageArgBackgroundColor(0),
-      wuffs_aux::DecodeImageArgMaxInclDimension(16384));
-  if (!result.error_message.empty()) {
-    return -2;
-  }
-  if (!result.pixbuf.pixcfg.is_valid()) {
-    return -3;
-  }
-  wuffs_base__table_u8 p = result.pixbuf.plane(0);
-  uint32_t w = result.pixbuf.pixcfg.width();
-  uint32_t h = result.pixbuf.pixcfg.height();
-  size_t src_stride = p.stride;
-  size_t dst_stride = (size_t)w * 4u;
-  size_t out_bytes = dst_stride * (size_t)h;
-  uint8_t* out = (uint8_t*)malloc(out_bytes);
-  if (!out) return -5;
-
-  // Swizzle BGRA->RGBA row by row if necessary; if already RGBA, copy as is.
-  bool is_bgra = (result.pixbuf.pixcfg.pixel_format().repr == WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL);
-  bool is_rgba = (result.pixbuf.pixcfg.pixel_format().repr == WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL);
-  for (uint32_t y = 0; y < h; y++) {
-    const uint8_t* s = p.ptr + (size_t)y * src_stride;
-    uint8_t* d = out + (size_t)y * dst_stride;
-    if (is_rgba) {
-      memcpy(d, s, dst_stride);
-    } else if (is_bgra) {
-      for (uint32_t x = 0; x < w; x++) {
-        uint8_t b = s[0], g = s[1], r = s[2], a = s[3];
-        d[0] = r; d[1] = g; d[2] = b; d[3] = a;
-        s += 4; d += 4;
-      }
-    } else {
-      free(out);
-      return -6; // unexpected format
-    }
-  }
-  *out_pixels = out; *out_width = (int)w; *out_height = (int)h;
-  return 0;
+  // The swizzler writes RGBA directly; no BGRA->RGBA pass or second buffer.
+  return wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_RGBA_PREMUL,
+                          out_pixels, out_width, out_height);
 }
 
 // JPEG RGBA allocate
@@ -1197,8 +1299,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_jpeg_rgba(
   wuffs_base__pixel_config__set(&ic.pixcfg, WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL,
                                 WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
   size_t bytes = (size_t)w * (size_t)h * 4u; uint8_t* dst = (uint8_t*)malloc(bytes); if (!dst) return -5;
-  // Rewind src
-  src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
   // Bind PB to dst and decode
   wuffs_base__pixel_buffer pb{};
   if (wuffs_base__pixel_buffer__set_interleaved(
@@ -1255,7 +1355,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_png_rgba(
   wuffs_base__pixel_config__set(&ic.pixcfg, WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL,
                                 WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
   size_t bytes = (size_t)w * (size_t)h * 4u; uint8_t* dst = (uint8_t*)malloc(bytes); if (!dst) return -5;
-  src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
   wuffs_base__pixel_buffer pb{}; if (wuffs_base__pixel_buffer__set_interleaved(
           &pb, &ic.pixcfg, wuffs_base__make_table_u8(dst, (size_t)w * 4u, (size_t)h, (size_t)w * 4u),
           wuffs_base__empty_slice_u8()).repr) { free(dst); return -6; }
@@ -1306,7 +1405,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_gif_rgba(
   wuffs_base__pixel_config__set(&ic.pixcfg, WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL,
                                 WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
   size_t bytes = (size_t)w * (size_t)h * 4u; uint8_t* dst = (uint8_t*)malloc(bytes); if (!dst) return -5;
-  src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
   wuffs_base__pixel_buffer pb{}; if (wuffs_base__pixel_buffer__set_interleaved(
           &pb, &ic.pixcfg, wuffs_base__make_table_u8(dst, (size_t)w * 4u, (size_t)h, (size_t)w * 4u),
           wuffs_base__empty_slice_u8()).repr) { free(dst); return -6; }
@@ -1403,7 +1501,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_webp_rgba(
   wuffs_base__pixel_config__set(&ic.pixcfg, WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL,
                                 WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
   size_t bytes = (size_t)w * (size_t)h * 4u; uint8_t* dst = (uint8_t*)malloc(bytes); if (!dst) return -5;
-  src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
   wuffs_base__pixel_buffer pb{}; if (wuffs_base__pixel_buffer__set_interleaved(
           &pb, &ic.pixcfg, wuffs_base__make_table_u8(dst, (size_t)w * 4u, (size_t)h, (size_t)w * 4u),
           wuffs_base__empty_slice_u8()).repr) { free(dst); return -6; }
@@ -1497,7 +1594,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_bgra_alloc(
     size_t bytes = (size_t)w * (size_t)h * 4u;
     uint8_t* dst = (uint8_t*)malloc(bytes);
     if (!dst) { set_err("jpeg: out of memory"); return -5; }
-    src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
     wuffs_base__pixel_buffer pb{};
     wuffs_base__status spb = wuffs_base__pixel_buffer__set_interleaved(
         &pb, &ic.pixcfg,
@@ -1536,7 +1632,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_bgra_alloc(
     size_t bytes = (size_t)w * (size_t)h * 4u;
     uint8_t* dst = (uint8_t*)malloc(bytes);
     if (!dst) { set_err("png: out of memory"); return -5; }
-    src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
     wuffs_base__pixel_buffer pb{};
     wuffs_base__status spb = wuffs_base__pixel_buffer__set_interleaved(
         &pb, &ic.pixcfg,
@@ -1575,7 +1670,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_bgra_alloc(
     size_t bytes = (size_t)w * (size_t)h * 4u;
     uint8_t* dst = (uint8_t*)malloc(bytes);
     if (!dst) { set_err("webp: out of memory"); return -5; }
-    src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
     wuffs_base__pixel_buffer pb{};
     wuffs_base__status spb = wuffs_base__pixel_buffer__set_interleaved(
         &pb, &ic.pixcfg,
@@ -1614,7 +1708,6 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_bgra_alloc(
     size_t bytes = (size_t)w * (size_t)h * 4u;
     uint8_t* dst = (uint8_t*)malloc(bytes);
     if (!dst) { set_err("bmp: out of memory"); return -5; }
-    src = wuffs_base__ptr_u8__reader((uint8_t*)data, data_len, true);
     wuffs_base__pixel_buffer pb{};
     wuffs_base__status spb = wuffs_base__pixel_buffer__set_interleaved(
         &pb, &ic.pixcfg,
@@ -1707,4 +1800,46 @@ extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_bgra_alloc(
     set_err("unsupported or corrupt image format");
   }
   return -2;
-}
\ No newline at end of file
+}
+
+extern "C" WUFFS_IMG_API int wuffs_img_decode_auto_rgba_alloc(
+    const uint8_t* data,
+    size_t data_len,
+    uint8_t** out_pixels,
+    size_t* out_size,
+    int* out_width,
+    int* out_height,
+    char* out_ext,
+    size_t out_ext_len,
+    char* out_error,
+    size_t out_error_len) {
+  if (out_ext && out_ext_len) out_ext[0] = '\0';
+  if (out_error && out_error_len) out_error[0] = '\0';
+  if (!out_size) {
+    return -1;
+  }
+  *out_size = 0;
+
+  // Unlike wuffs_img_decode_auto_bgra_alloc, every format goes through
+  // wuffs_aux::DecodeImage, which writes RGBA_PREMUL directly.
+  uint32_t fourcc = 0;
+  std::string error_message;
+  int r = decode_to_format(data, data_len, WUFFS_IMG_FORMAT_RGBA_PREMUL,
+                           nullptr, 0, 0, out_pixels, out_width, out_height, 0,
+                           &fourcc, &error_message);
+  if (out_ext && out_ext_len) {
+    snprintf(out_ext, out_ext_len, "%s", ext_for_fourcc(fourcc));
+  }
+  if (r == -1) {
+    error_message = "invalid arguments";
+  } else if ((r < 0) && error_message.empty()) {
+    error_message = "unsupported or corrupt image format";
+  }
+  if (out_error && out_error_len && !error_message.empty()) {
+    snprintf(out_error, out_error_len, "%s", error_message.c_str());
+  }
+  if (r == 0) {
+    *out_size = (size_t)*out_width * (size_t)*out_height * 4u;
+  }
+  return r;
+}
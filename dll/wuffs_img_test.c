@@ -0,0 +1,112 @@
+// Tests for the wuffs_img library. To build and run, from the repository's
+// root directory:
+//
+//   g++ -O2 -c dll/wuffs_img_dll.cc -o /tmp/wuffs_img_dll.o
+//   gcc -O2 dll/wuffs_img_test.c /tmp/wuffs_img_dll.o -lstdc++ -lm -o /tmp/t
+//   /tmp/t
+//
+// It reads files under test/data, relative to the current working directory.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wuffs_img.h"
+
+static int g_num_failures = 0;
+
+static uint8_t*  //
+read_file(const char* filename, size_t* out_len) {
+  FILE* f = fopen(filename, "rb");
+  if (!f) {
+    return NULL;
+  }
+  size_t cap = 65536;
+  size_t len = 0;
+  uint8_t* data = (uint8_t*)malloc(cap);
+  while (data) {
+    len += fread(data + len, 1, cap - len, f);
+    if (len < cap) {
+      break;
+    }
+    cap *= 2;
+    uint8_t* d = (uint8_t*)realloc(data, cap);
+    if (!d) {
+      free(data);
+    }
+    data = d;
+  }
+  fclose(f);
+  *out_len = len;
+  return data;
+}
+
+// test_decode_rgba_matches_bgra checks that decoding to RGBA gives the same
+// pixels as decoding to BGRA, with the red and blue channels swapped. Images
+// narrower than 32 pixels exercise the SIMD converters' scalar fallbacks.
+static void  //
+test_decode_rgba_matches_bgra(const char* filename,
+                              int want_r0,
+                              int want_b0) {
+  size_t data_len = 0;
+  uint8_t* data = read_file(filename, &data_len);
+  if (!data) {
+    printf("FAIL %s: could not read file\n", filename);
+    g_num_failures++;
+    return;
+  }
+
+  uint8_t* bgra = NULL;
+  uint8_t* rgba = NULL;
+  int bw = 0;
+  int bh = 0;
+  int rw = 0;
+  int rh = 0;
+  int bret =
+      wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_BGRA_PREMUL, &bgra, &bw,
+                       &bh);
+  int rret =
+      wuffs_img_decode(data, data_len, WUFFS_IMG_FORMAT_RGBA_PREMUL, &rgba, &rw,
+                       &rh);
+  if ((bret != 0) || (rret != 0)) {
+    printf("FAIL %s: decode: got %d, %d, want 0, 0\n", filename, bret, rret);
+    g_num_failures++;
+  } else if ((bw != rw) || (bh != rh)) {
+    printf("FAIL %s: dimensions: got %dx%d, %dx%d\n", filename, bw, bh, rw,
+           rh);
+    g_num_failures++;
+  } else if ((rgba[0] != want_r0) || (rgba[2] != want_b0)) {
+    printf("FAIL %s: pixel 0: got R=%d B=%d, want R=%d B=%d\n", filename,
+           rgba[0], rgba[2], want_r0, want_b0);
+    g_num_failures++;
+  } else {
+    size_t n = (size_t)bw * (size_t)bh;
+    size_t i = 0;
+    for (; i < n; i++) {
+      const uint8_t* b = bgra + (4 * i);
+      const uint8_t* r = rgba + (4 * i);
+      if ((b[0] != r[2]) || (b[1] != r[1]) || (b[2] != r[0]) ||
+          (b[3] != r[3])) {
+        printf("FAIL %s: pixel %zu: BGRA and RGBA differ\n", filename, i);
+        g_num_failures++;
+        break;
+      }
+    }
+  }
+
+  wuffs_img_free(bgra);
+  wuffs_img_free(rgba);
+  free(data);
+}
+
+int  //
+main(void) {
+  test_decode_rgba_matches_bgra("test/data/mona-lisa.21x32.q90.jpeg", 99, 56);
+  test_decode_rgba_matches_bgra("test/data/bricks-color.jpeg", 10, 255);
+  if (g_num_failures) {
+    printf("%d failure(s)\n", g_num_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
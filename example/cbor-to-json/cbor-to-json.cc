@@ -582,16 +582,76 @@ class Callbacks : public wuffs_aux::DecodeCborCallbacks {
   }
 
   std::string AppendByteString(std::string&& val) override {
+    TRY(BeginString(0, val.length()));
+    TRY(AppendStringSlice(
+        0, static_cast<const uint8_t*>(static_cast<const void*>(val.data())),
+        val.length()));
+    return EndString(0);
+  }
+
+  std::string AppendTextString(std::string&& val) override {
+    constexpr uint32_t flags = STRING_FLAG_TEXT;
+    TRY(BeginString(flags, val.length()));
+    TRY(AppendStringSlice(
+        flags,
+        static_cast<const uint8_t*>(static_cast<const void*>(val.data())),
+        val.length()));
+    return EndString(flags);
+  }
+
+  // Strings are converted a slice at a time, straight from the CBOR decoder's
+  // I/O buffer, instead of first being gathered into a std::string.
+
+  bool BorrowsStrings() override { return true; }
+
+  std::string BeginString(uint32_t flags, uint64_t length) override {
     TRY(WritePreambleAndUpdateContext());
-    if (g_flags.output_cbor_metadata_as_comments) {
-      TRY(write_dst("/*cbor:base64url*/\"", 19));
-    } else {
-      TRY(write_dst("\"", 1));
+    m_string_flags = flags;
+    m_base64_carry_len = 0;
+    if (!(flags & STRING_FLAG_TEXT) &&
+        g_flags.output_cbor_metadata_as_comments) {
+      return write_dst("/*cbor:base64url*/\"", 19);
+    }
+    return write_dst("\"", 1);
+  }
+
+  std::string AppendStringSlice(uint32_t flags,
+                                const uint8_t* ptr,
+                                size_t len) override {
+    if (m_string_flags & STRING_FLAG_TEXT) {
+      return WriteEscapedText(ptr, len);
     }
 
-    const uint8_t* ptr =
-        static_cast<const uint8_t*>(static_cast<const void*>(val.data()));
-    size_t len = val.length();
+    // Base-64 encode whole 3-byte groups, carrying any remainder over to the
+    // next slice (or to EndString).
+    if (m_base64_carry_len > 0) {
+      while ((m_base64_carry_len < 3) && (len > 0)) {
+        m_base64_carry[m_base64_carry_len++] = *ptr++;
+        len--;
+      }
+      if (m_base64_carry_len < 3) {
+        return "";
+      }
+      TRY(WriteBase64(&m_base64_carry[0], 3));
+      m_base64_carry_len = 0;
+    }
+    size_t n = len - (len % 3);
+    TRY(WriteBase64(ptr, n));
+    for (; n < len; n++) {
+      m_base64_carry[m_base64_carry_len++] = ptr[n];
+    }
+    return "";
+  }
+
+  std::string EndString(uint32_t flags) override {
+    if (!(flags & STRING_FLAG_TEXT)) {
+      TRY(WriteBase64(&m_base64_carry[0], m_base64_carry_len));
+      m_base64_carry_len = 0;
+    }
+    return write_dst("\"", 1);
+  }
+
+  std::string WriteBase64(const uint8_t* ptr, size_t len) {
     while (len > 0) {
       constexpr bool closed = true;
       wuffs_base__transform__output o = wuffs_base__base_64__encode(
@@ -611,16 +671,10 @@ class Callbacks : public wuffs_aux::DecodeCborCallbacks {
       }
       TRY(flush_dst());
     }
-
-    return write_dst("\"", 1);
+    return "";
   }
 
-  std::string AppendTextString(std::string&& val) override {
-    TRY(WritePreambleAndUpdateContext());
-    TRY(write_dst("\"", 1));
-    const uint8_t* ptr =
-        static_cast<const uint8_t*>(static_cast<const void*>(val.data()));
-    size_t len = val.length();
+  std::string WriteEscapedText(const uint8_t* ptr, size_t len) {
   loop:
     if (len > 0) {
       for (size_t i = 0; i < len; i++) {
@@ -636,7 +690,7 @@ class Callbacks : public wuffs_aux::DecodeCborCallbacks {
       }
       TRY(write_dst(ptr, len));
     }
-    return write_dst("\"", 1);
+    return "";
   }
 
   std::string AppendMinus1MinusX(uint64_t val) override {
@@ -730,6 +784,11 @@ class Callbacks : public wuffs_aux::DecodeCborCallbacks {
     return write_dst(
         (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__FROM_LIST) ? "]" : "}", 1);
   }
+
+ private:
+  uint32_t m_string_flags = 0;
+  uint8_t m_base64_carry[3] = {0};
+  size_t m_base64_carry_len = 0;
 };
 
 // ----
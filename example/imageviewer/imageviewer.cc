@@ -281,7 +281,7 @@ load_image(const char* filename) {
   };
 
   MyDecodeImageCallbacks callbacks;
-  wuffs_aux::sync_io::FileInput input(file);
+  wuffs_aux::sync_io::MmapFileInput input(file);
   wuffs_aux::DecodeImageResult res = wuffs_aux::DecodeImage(
       callbacks, input,
       wuffs_aux::DecodeImageArgQuirks(&wuffs_base__quirk_quality,
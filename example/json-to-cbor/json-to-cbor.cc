@@ -132,13 +132,6 @@ static const char* g_usage =
 
 // ----
 
-#ifndef DST_BUFFER_ARRAY_SIZE
-#define DST_BUFFER_ARRAY_SIZE (32 * 1024)
-#endif
-
-uint8_t g_dst_array[DST_BUFFER_ARRAY_SIZE];
-wuffs_base__io_buffer g_dst;
-
 std::vector<wuffs_aux::QuirkKeyValuePair> g_quirks;
 
 struct {
@@ -204,139 +197,8 @@ parse_flags(int argc, char** argv) {
 
 // ----
 
-std::string  //
-flush_dst() {
-  while (true) {
-    size_t n = g_dst.reader_length();
-    if (n == 0) {
-      break;
-    }
-    size_t i = fwrite(g_dst.reader_pointer(), 1, n, stdout);
-    g_dst.meta.ri += i;
-    if (i < n) {
-      return "main: error writing to stdout";
-    }
-  }
-  g_dst.compact();
-  return "";
-}
-
-std::string  //
-write_dst_slow(const void* s, size_t n) {
-  const uint8_t* p = static_cast<const uint8_t*>(s);
-  while (n > 0) {
-    size_t i = g_dst.writer_length();
-    if (i == 0) {
-      TRY(flush_dst());
-      i = g_dst.writer_length();
-      if (i == 0) {
-        return "main: g_dst buffer is full";
-      }
-    }
-
-    if (i > n) {
-      i = n;
-    }
-    memcpy(g_dst.data.ptr + g_dst.meta.wi, p, i);
-    g_dst.meta.wi += i;
-    p += i;
-    n -= i;
-  }
-  return "";
-}
-
-inline std::string  //
-write_dst(const void* s, size_t n) {
-  if (n <= (DST_BUFFER_ARRAY_SIZE - g_dst.meta.wi)) {
-    memcpy(g_dst.data.ptr + g_dst.meta.wi, s, n);
-    g_dst.meta.wi += n;
-    return "";
-  }
-  return write_dst_slow(s, n);
-}
-
-// ----
-
-class Callbacks : public wuffs_aux::DecodeJsonCallbacks {
- public:
-  Callbacks() = default;
-
-  std::string Append(uint64_t n, uint8_t base) {
-    uint8_t c[9];
-    if (n < 0x18) {
-      c[0] = base | static_cast<uint8_t>(n);
-      return write_dst(&c[0], 1);
-    } else if (n <= 0xFF) {
-      c[0] = base | 0x18;
-      c[1] = static_cast<uint8_t>(n);
-      return write_dst(&c[0], 2);
-    } else if (n <= 0xFFFF) {
-      c[0] = base | 0x19;
-      wuffs_base__poke_u16be__no_bounds_check(&c[1], static_cast<uint16_t>(n));
-      return write_dst(&c[0], 3);
-    } else if (n <= 0xFFFFFFFF) {
-      c[0] = base | 0x1A;
-      wuffs_base__poke_u32be__no_bounds_check(&c[1], static_cast<uint32_t>(n));
-      return write_dst(&c[0], 5);
-    }
-    c[0] = base | 0x1B;
-    wuffs_base__poke_u64be__no_bounds_check(&c[1], n);
-    return write_dst(&c[0], 9);
-  }
-
-  std::string AppendNull() override { return write_dst("\xF6", 1); }
-
-  std::string AppendBool(bool val) override {
-    return write_dst(val ? "\xF5" : "\xF4", 1);
-  }
-
-  std::string AppendF64(double val) override {
-    uint8_t c[9];
-    wuffs_base__lossy_value_u16 lv16 =
-        wuffs_base__ieee_754_bit_representation__from_f64_to_u16_truncate(val);
-    if (!lv16.lossy) {
-      c[0] = 0xF9;
-      wuffs_base__poke_u16be__no_bounds_check(&c[1], lv16.value);
-      return write_dst(&c[0], 3);
-    }
-    wuffs_base__lossy_value_u32 lv32 =
-        wuffs_base__ieee_754_bit_representation__from_f64_to_u32_truncate(val);
-    if (!lv32.lossy) {
-      c[0] = 0xFA;
-      wuffs_base__poke_u32be__no_bounds_check(&c[1], lv32.value);
-      return write_dst(&c[0], 5);
-    }
-    c[0] = 0xFB;
-    wuffs_base__poke_u64be__no_bounds_check(
-        &c[1], wuffs_base__ieee_754_bit_representation__from_f64_to_u64(val));
-    return write_dst(&c[0], 9);
-  }
-
-  std::string AppendI64(int64_t val) override {
-    return (val >= 0) ? Append(static_cast<uint64_t>(val), 0x00)
-                      : Append(static_cast<uint64_t>(-(val + 1)), 0x20);
-  }
-
-  std::string AppendTextString(std::string&& val) override {
-    TRY(Append(val.size(), 0x60));
-    return write_dst(val.data(), val.size());
-  }
-
-  std::string Push(uint32_t flags) override {
-    return write_dst(
-        (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) ? "\x9F" : "\xBF",
-        1);
-  }
-
-  std::string Pop(uint32_t flags) override { return write_dst("\xFF", 1); }
-};
-
-// ----
-
 std::string  //
 main1(int argc, char** argv) {
-  g_dst = wuffs_base__ptr_u8__writer(&g_dst_array[0], DST_BUFFER_ARRAY_SIZE);
-
   TRY(parse_flags(argc, argv));
 
   FILE* in = stdin;
@@ -349,10 +211,10 @@ main1(int argc, char** argv) {
     }
   }
 
-  Callbacks callbacks;
+  wuffs_aux::sync_io::FileOutput output(stdout);
   wuffs_aux::sync_io::FileInput input(in);
-  return wuffs_aux::DecodeJson(
-             callbacks, input,
+  return wuffs_aux::TranscodeJsonToCbor(
+             output, input,
              wuffs_aux::DecodeJsonArgQuirks(g_quirks.data(), g_quirks.size()))
       .error_message;
 }
@@ -386,8 +248,6 @@ compute_exit_code(std::string status_msg) {
 
 int  //
 main(int argc, char** argv) {
-  std::string z1 = main1(argc, argv);
-  std::string z2 = flush_dst();
-  int exit_code = compute_exit_code(z1.empty() ? z2 : z1);
+  int exit_code = compute_exit_code(main1(argc, argv));
   return exit_code;
 }
@@ -570,7 +570,7 @@ main1(int argc, char** argv) {
   }
 
   Callbacks callbacks;
-  wuffs_aux::sync_io::FileInput input(in);
+  wuffs_aux::sync_io::MmapFileInput input(in);
   return wuffs_aux::DecodeJson(
              callbacks, input,
              wuffs_aux::DecodeJsonArgQuirks(g_quirks.data(), g_quirks.size()),
@@ -247,6 +247,13 @@ static const char* g_usage =
     "did not find a value, or found an invalid one, this program returns a\n"
     "non-zero exit code, but may still print partial output to stdout.\n"
     "\n"
+    "The -query=STR flag can be repeated, up to 64 times, to print multiple\n"
+    "subsets of the input in a single pass. Each found value is printed on\n"
+    "its own line(s), in the order that they occur in the input, not in the\n"
+    "order of the flags. No query may be a prefix of another: \"/foo\" and\n"
+    "\"/foo/bar\" cannot be combined but \"/foo/bar\" and \"/foo/qux\" can.\n"
+    "The exit code is non-zero if any of the queries did not find a value.\n"
+    "\n"
     "The JSON specification (https://json.org/) permits implementations that\n"
     "allow duplicate keys, as this one does. This JSON Pointer implementation\n"
     "is also greedy, following the first match for each fragment without\n"
@@ -464,6 +471,10 @@ uint32_t g_bytes_per_indent_depth;
 #ifndef TOKEN_BUFFER_ARRAY_SIZE
 #define TOKEN_BUFFER_ARRAY_SIZE (4 * 1024)
 #endif
+// QUERY_ARRAY_SIZE is the maximum number of -query=STR flags.
+#ifndef QUERY_ARRAY_SIZE
+#define QUERY_ARRAY_SIZE 64
+#endif
 
 uint8_t g_dst_array[DST_BUFFER_ARRAY_SIZE];
 uint8_t g_src_array[SRC_BUFFER_ARRAY_SIZE];
@@ -479,6 +490,13 @@ size_t g_cursor_index;
 
 uint32_t g_depth;
 
+// g_printing is whether we are writing a query's result (or the entire input,
+// if there are no queries) to stdout. When it is true, g_printing_depth is the
+// g_depth at the start of that result. Output indentation and the
+// -max-output-depth flag are relative to that depth.
+bool g_printing;
+uint32_t g_printing_depth;
+
 enum class context {
   none,
   in_list_after_bracket,
@@ -489,6 +507,10 @@ enum class context {
   end_of_data,
 } g_ctx;
 
+// g_printing_ctx is the g_ctx at the start of the query result being printed.
+// It is restored once that result is complete.
+context g_printing_ctx;
+
 bool  //
 in_dict_before_key() {
   return (g_ctx == context::in_dict_after_brace) ||
@@ -595,6 +617,13 @@ class Query {
     m_array_index.value = 0;
   }
 
+  // resolve marks the query as having either matched or failed to match. A
+  // resolved query is no longer at any depth.
+  void resolve() {
+    this->reset(nullptr);
+    m_depth = 0xFFFFFFFF;
+  }
+
   void restart_fragment(bool enable) { m_frag_j = enable ? m_frag_i : nullptr; }
 
   bool is_at(uint32_t depth) { return m_depth == depth; }
@@ -757,7 +786,18 @@ class Query {
     }
     return !previous_was_tilde;
   }
-} g_query;
+
+  // is_prefix returns whether the JSON Pointer p is a prefix of (or equal to)
+  // the JSON Pointer q, in terms of whole '/'-separated fragments.
+  static bool is_prefix(const char* p, const char* q) {
+    size_t n = strlen(p);
+    return !strncmp(p, q, n) && ((q[n] == '\x00') || (q[n] == '/'));
+  }
+} g_queries[QUERY_ARRAY_SIZE];
+
+size_t g_num_queries;
+size_t g_num_unresolved_queries;
+bool g_some_query_failed;
 
 // ----
 
@@ -779,7 +819,8 @@ struct {
   uint32_t max_output_depth;
   uint32_t spaces;
 
-  char* query_c_string;
+  char* query_c_strings[QUERY_ARRAY_SIZE];
+  size_t num_query_c_strings;
 } g_flags = {0};
 
 const char*  //
@@ -877,7 +918,10 @@ parse_flags(int argc, char** argv) {
     if (!strncmp(arg, "q=", 2) || !strncmp(arg, "query=", 6)) {
       while (*arg++ != '=') {
       }
-      g_flags.query_c_string = arg;
+      if (g_flags.num_query_c_strings >= QUERY_ARRAY_SIZE) {
+        return "main: too many -query=STR flags";
+      }
+      g_flags.query_c_strings[g_flags.num_query_c_strings++] = arg;
       continue;
     }
     if (!strncmp(arg, "s=", 2) || !strncmp(arg, "spaces=", 7)) {
@@ -901,10 +945,17 @@ parse_flags(int argc, char** argv) {
     return g_usage;
   }
 
-  if (g_flags.query_c_string &&
-      !Query::validate(g_flags.query_c_string, strlen(g_flags.query_c_string),
-                       g_flags.strict_json_pointer_syntax)) {
-    return "main: bad JSON Pointer (RFC 6901) syntax for the -query=STR flag";
+  for (size_t i = 0; i < g_flags.num_query_c_strings; i++) {
+    char* q = g_flags.query_c_strings[i];
+    if (!Query::validate(q, strlen(q), g_flags.strict_json_pointer_syntax)) {
+      return "main: bad JSON Pointer (RFC 6901) syntax for the -query=STR flag";
+    }
+    for (size_t j = 0; j < i; j++) {
+      if (Query::is_prefix(q, g_flags.query_c_strings[j]) ||
+          Query::is_prefix(g_flags.query_c_strings[j], q)) {
+        return "main: -query=STR flags must not be prefixes of each other";
+      }
+    }
   }
 
   g_flags.remaining_argc = argc - c;
@@ -960,11 +1011,25 @@ initialize_globals(int argc, char** argv) {
                                               : TWO_NEW_LINES_THEN_256_SPACES;
   g_bytes_per_indent_depth = g_flags.tabs ? 1 : g_flags.spaces;
 
-  g_query.reset(g_flags.query_c_string);
-
-  // If the query is non-empty, suppress writing to stdout until we've
-  // completed the query.
-  g_suppress_write_dst = g_query.next_fragment() ? 1 : 0;
+  // A single empty query is equivalent to no query at all: the result is the
+  // entire input. Multiple queries are all non-empty, as the empty query is a
+  // prefix of every other query.
+  g_num_queries = g_flags.num_query_c_strings;
+  for (size_t i = 0; i < g_num_queries; i++) {
+    g_queries[i].reset(g_flags.query_c_strings[i]);
+    if (!g_queries[i].next_fragment()) {
+      g_num_queries = 0;
+    }
+  }
+  g_num_unresolved_queries = g_num_queries;
+  g_some_query_failed = false;
+
+  // If there are queries, suppress writing to stdout until we've completed
+  // one of them.
+  g_printing = g_num_queries == 0;
+  g_printing_depth = 0;
+  g_printing_ctx = context::none;
+  g_suppress_write_dst = g_printing ? 0 : 1;
   g_wrote_to_dst = false;
 
   TRY(g_dec.initialize(sizeof__wuffs_json__decoder(), WUFFS_VERSION, 0)
@@ -1083,7 +1148,8 @@ write_dst(const void* s, size_t n) {
   do {                                                                  \
     uint32_t adj = (g_num_input_blank_lines > 1) ? 1 : 0;               \
     g_num_input_blank_lines = 0;                                        \
-    uint32_t indent = g_depth * g_bytes_per_indent_depth;               \
+    uint32_t indent = (g_depth - g_printing_depth) *                    \
+                      g_bytes_per_indent_depth;                         \
     TRY(write_dst(g_two_new_lines_then_256_indent_bytes + 1 - adj,      \
                   1 + adj + (indent & 0xFF)));                          \
     for (indent >>= 8; indent > 0; indent--) {                          \
@@ -1111,6 +1177,22 @@ handle_unicode_code_point(uint32_t ucp) {
 
 // ----
 
+// fail_query marks the i'th query as not matching. With a single query, this
+// fails immediately. With multiple queries, the other queries' results are
+// still printed and failure is reported at the end.
+const char*  //
+fail_query(size_t i) {
+  g_queries[i].resolve();
+  g_num_unresolved_queries--;
+  g_some_query_failed = true;
+  if (g_num_unresolved_queries == 0) {
+    // Allow the final "\n" after any previous queries' results.
+    g_suppress_write_dst = 0;
+    return "main: no match for query";
+  }
+  return nullptr;
+}
+
 inline const char*  //
 handle_token(wuffs_base__token t, bool start_of_token_chain) {
   do {
@@ -1125,15 +1207,18 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
     // Handle ']' or '}'.
     if ((vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) &&
         (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__POP)) {
-      if (g_query.is_at(g_depth)) {
-        return "main: no match for query";
+      for (size_t i = 0; i < g_num_queries; i++) {
+        if (g_queries[i].is_at(g_depth)) {
+          TRY(fail_query(i));
+        }
       }
       if (g_depth <= 0) {
         return "main: internal error: inconsistent g_depth";
       }
       g_depth--;
 
-      if (g_query.matched_all() && (g_depth >= g_flags.max_output_depth)) {
+      if (g_printing &&
+          ((g_depth - g_printing_depth) >= g_flags.max_output_depth)) {
         g_suppress_write_dst--;
         // '…' is U+2026 HORIZONTAL ELLIPSIS, which is 3 UTF-8 bytes.
         TRY(write_dst((vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__FROM_LIST)
@@ -1185,41 +1270,52 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
         }
       }
 
-      bool query_matched_fragment = false;
-      if (g_query.is_at(g_depth)) {
-        switch (g_ctx) {
-          case context::in_list_after_bracket:
-          case context::in_list_after_value:
-            query_matched_fragment = g_query.tick();
-            break;
-          case context::in_dict_after_key:
-            query_matched_fragment = g_query.matched_fragment();
-            break;
-          default:
-            break;
+      for (size_t i = 0; i < g_num_queries; i++) {
+        Query* q = &g_queries[i];
+        bool query_matched_fragment = false;
+        if (q->is_at(g_depth)) {
+          switch (g_ctx) {
+            case context::in_list_after_bracket:
+            case context::in_list_after_value:
+              query_matched_fragment = q->tick();
+              break;
+            case context::in_dict_after_key:
+              query_matched_fragment = q->matched_fragment();
+              break;
+            default:
+              break;
+          }
         }
-      }
-      if (!query_matched_fragment) {
-        // No-op.
-      } else if (!g_query.next_fragment()) {
-        // There is no next fragment. We have matched the complete query, and
-        // the upcoming JSON value is the result of that query.
-        //
-        // Un-suppress writing to stdout and reset the g_ctx and g_depth as if
-        // we were about to decode a top-level value. This makes any subsequent
-        // indentation be relative to this point, and we will return g_eod
-        // after the upcoming JSON value is complete.
-        if (g_suppress_write_dst != 1) {
-          return "main: internal error: inconsistent g_suppress_write_dst";
+        if (!query_matched_fragment) {
+          // No-op.
+        } else if (!q->next_fragment()) {
+          // There is no next fragment. We have matched the complete query, and
+          // the upcoming JSON value is the result of that query.
+          //
+          // Un-suppress writing to stdout and reset the g_ctx as if we were
+          // about to decode a top-level value. Subsequent indentation is
+          // relative to g_printing_depth, and we will stop printing after
+          // the upcoming JSON value is complete.
+          if (g_suppress_write_dst != 1) {
+            return "main: internal error: inconsistent g_suppress_write_dst";
+          }
+          g_suppress_write_dst = 0;
+          if (g_wrote_to_dst) {
+            // Separate this query result from the previous one.
+            TRY(write_dst("\n", 1));
+          }
+          q->resolve();
+          g_num_unresolved_queries--;
+          g_printing = true;
+          g_printing_depth = g_depth;
+          g_printing_ctx = g_ctx;
+          g_ctx = context::none;
+        } else if ((vbc != WUFFS_BASE__TOKEN__VBC__STRUCTURE) ||
+                   !(vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH)) {
+          // The query has moved on to the next fragment but the upcoming JSON
+          // value is not a container.
+          TRY(fail_query(i));
         }
-        g_suppress_write_dst = 0;
-        g_ctx = context::none;
-        g_depth = 0;
-      } else if ((vbc != WUFFS_BASE__TOKEN__VBC__STRUCTURE) ||
-                 !(vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH)) {
-        // The query has moved on to the next fragment but the upcoming JSON
-        // value is not a container.
-        return "main: no match for query";
       }
     }
 
@@ -1227,7 +1323,8 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
     // value: string (a chain of raw or escaped parts), literal or number.
     switch (vbc) {
       case WUFFS_BASE__TOKEN__VBC__STRUCTURE:
-        if (g_query.matched_all() && (g_depth >= g_flags.max_output_depth)) {
+        if (g_printing &&
+            ((g_depth - g_printing_depth) >= g_flags.max_output_depth)) {
           g_suppress_write_dst++;
         } else {
           TRY(write_dst(
@@ -1244,13 +1341,18 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
       case WUFFS_BASE__TOKEN__VBC__STRING:
         if (start_of_token_chain) {
           TRY(write_dst("\"", 1));
-          g_query.restart_fragment(in_dict_before_key() &&
-                                   g_query.is_at(g_depth));
+          bool before_key = in_dict_before_key();
+          for (size_t i = 0; i < g_num_queries; i++) {
+            g_queries[i].restart_fragment(before_key &&
+                                          g_queries[i].is_at(g_depth));
+          }
         }
 
         if (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
           TRY(write_dst(tok.ptr, tok.len));
-          g_query.incremental_match_slice(tok.ptr, tok.len);
+          for (size_t i = 0; i < g_num_queries; i++) {
+            g_queries[i].incremental_match_slice(tok.ptr, tok.len);
+          }
         }
 
         if (t.continued()) {
@@ -1264,7 +1366,9 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
           return "main: internal error: unexpected non-continued UCP token";
         }
         TRY(handle_unicode_code_point(vbd));
-        g_query.incremental_match_code_point(vbd);
+        for (size_t i = 0; i < g_num_queries; i++) {
+          g_queries[i].incremental_match_code_point(vbd);
+        }
         return nullptr;
     }
 
@@ -1279,6 +1383,16 @@ handle_token(wuffs_base__token t, bool start_of_token_chain) {
 after_value:
   if (g_depth == 0) {
     return g_eod;
+  } else if (g_printing && (g_depth == g_printing_depth)) {
+    // We have completed a query result. Go back to suppressing writes and
+    // resume tracking the g_ctx of the enclosing container.
+    if (g_num_unresolved_queries == 0) {
+      return g_some_query_failed ? "main: no match for query" : g_eod;
+    }
+    g_printing = false;
+    g_printing_depth = 0;
+    g_suppress_write_dst = 1;
+    g_ctx = g_printing_ctx;
   }
   switch (g_ctx) {
     case context::in_list_after_bracket:
@@ -1380,8 +1494,8 @@ main1(int argc, char** argv) {
         continue;
       } else if (z != g_eod) {
         return z;
-      } else if (g_flags.query_c_string && *g_flags.query_c_string) {
-        // With a non-empty g_query, don't try to consume trailing filler or
+      } else if (g_num_queries > 0) {
+        // With non-empty g_queries, don't try to consume trailing filler or
         // confirm that we've processed all the tokens.
         return nullptr;
       }
@@ -16,10 +16,37 @@ mzcat decompresses stdin to stdout. It is similar to the standard /bin/bzcat,
 formats (listed below). On Linux, it also self-imposes a SECCOMP_MODE_STRICT
 sandbox. To run:
 
-$CC mzcat.c && ./a.out < ../../test/data/romeo.txt.bz2; rm -f a.out
+$CC -pthread mzcat.c && ./a.out < ../../test/data/romeo.txt.bz2; rm -f a.out
 
 for a C compiler $CC, such as clang or gcc.
 
+Passing -jobs=N (or -j=N, or just -j for one job per CPU) with N > 1 decodes
+bzip2 or xz input on N worker threads. Both formats are block based and each
+block can be decoded independently, once found. Outputs are written in order.
+Each worker thread is also sandboxed, communicating with the main thread only
+via pipes.
+
+For bzip2, the main thread scans for the 48-bit block magic numbers (at bit
+granularity, as blocks are not byte aligned). The final (combined) checksum is
+verified by the main thread.
+
+For xz, stdin must be a regular file holding a single xz stream, typically
+created by "xz -T0" or similar (which splits its input into multiple blocks).
+Its index (at the end of the file) gives each block's position and size.
+Otherwise, e.g. when reading from a pipe, xz input is decoded serially.
+
+Passing -range=LO..HI writes only the decoded bytes at offsets from LO
+(inclusive) to HI (exclusive). This needs the same xz input as above and only
+decodes the blocks covering that range.
+
+Passing -max-dst-length=N, -max-ratio=N or -max-transform-io-calls=N caps the
+decoded length, the ratio of decoded to encoded lengths or the number of
+transform_io calls (roughly, how many times the decoder suspends). Decoding
+fails, instead of writing more, when a limit would be exceeded. These flags
+apply to serial decoding and cannot be combined with -jobs=N or -range=LO..HI.
+The lzip, lzma and xz decoders need some slack: with -max-dst-length=N, they
+can fail (stopping short) when the decoded length is within 289 bytes of N.
+
 Supported compression formats:
 - bzip2
 - gzip
@@ -27,9 +54,13 @@ Supported compression formats:
 - lzma
 - xz
 - zlib
+- zstd
 */
 
 #include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 // Wuffs ships as a "single file C library" or "header file library" as per
@@ -68,8 +99,10 @@ Supported compression formats:
 #define WUFFS_CONFIG__MODULE__LZIP
 #define WUFFS_CONFIG__MODULE__LZMA
 #define WUFFS_CONFIG__MODULE__SHA256
+#define WUFFS_CONFIG__MODULE__XXHASH64
 #define WUFFS_CONFIG__MODULE__XZ
 #define WUFFS_CONFIG__MODULE__ZLIB
+#define WUFFS_CONFIG__MODULE__ZSTD
 
 // If building this program in an environment that doesn't easily accommodate
 // relative includes, you can use the script/inline-c-relative-includes.go
@@ -96,6 +129,23 @@ Supported compression formats:
 #define WORKBUF_ARRAY_SIZE (80 * 1024 * 1024)
 #endif
 
+// MAX_JOBS bounds the -jobs=N flag.
+#ifndef MAX_JOBS
+#define MAX_JOBS 32
+#endif
+
+// A compressed bzip2 block (for -jobs=N) is usually smaller than its 900 KB
+// maximum uncompressed size, but Huffman codes can be up to 20 bits long.
+#ifndef JOB_SRC_BUFFER_ARRAY_SIZE
+#define JOB_SRC_BUFFER_ARRAY_SIZE (4 * 1024 * 1024)
+#endif
+
+// A bzip2 block holds at most 900000 bytes before the final Run Length
+// Encoding step, which expands every 5 bytes to at most 259 bytes.
+#ifndef JOB_DST_BUFFER_ARRAY_SIZE
+#define JOB_DST_BUFFER_ARRAY_SIZE 46620000
+#endif
+
 uint8_t g_dst_buffer_array[DST_BUFFER_ARRAY_SIZE];
 uint8_t g_src_buffer_array[SRC_BUFFER_ARRAY_SIZE];
 uint8_t g_workbuf_array[WORKBUF_ARRAY_SIZE];
@@ -114,10 +164,13 @@ union {
   wuffs_lzma__decoder lzma;
   wuffs_xz__decoder xz;
   wuffs_zlib__decoder zlib;
+  wuffs_zstd__decoder zstd;
 } g_potential_decoders;
 
 wuffs_crc32__ieee_hasher g_digest_hasher;
 
+wuffs_base__io_transformer_budget g_budget = {0};
+
 // ----
 
 struct {
@@ -126,7 +179,14 @@ struct {
 
   bool fail_if_unsandboxed;
   bool ignore_checksum;
+  uint32_t jobs;
+  uint64_t max_dst_length;
+  uint64_t max_ratio;
+  uint64_t max_transform_io_calls;
   bool output_crc32_digest;
+  bool range;
+  uint64_t range_lo;
+  uint64_t range_hi;
 } g_flags = {0};
 
 const char*  //
@@ -157,14 +217,68 @@ parse_flags(int argc, char** argv) {
     } else if (!strcmp(arg, "ignore-checksum")) {
       g_flags.ignore_checksum = true;
       continue;
+    } else if (!strcmp(arg, "j")) {
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+      g_flags.jobs = (n <= 1) ? 1 : (MAX_JOBS < n) ? MAX_JOBS : (uint32_t)n;
+      continue;
+    } else if (!strncmp(arg, "j=", 2) || !strncmp(arg, "jobs=", 5)) {
+      while (*arg++ != '=') {
+      }
+      int jobs = atoi(arg);
+      if ((jobs <= 0) || (MAX_JOBS < jobs)) {
+        return "main: bad -jobs=N flag argument";
+      }
+      g_flags.jobs = (uint32_t)jobs;
+      continue;
+    } else if (!strncmp(arg, "max-dst-length=", 15)) {
+      char* end = NULL;
+      g_flags.max_dst_length = strtoull(arg + 15, &end, 10);
+      if ((end == arg + 15) || (*end != '\x00')) {
+        return "main: bad -max-dst-length=N flag argument";
+      }
+      continue;
+    } else if (!strncmp(arg, "max-ratio=", 10)) {
+      char* end = NULL;
+      g_flags.max_ratio = strtoull(arg + 10, &end, 10);
+      if ((end == arg + 10) || (*end != '\x00')) {
+        return "main: bad -max-ratio=N flag argument";
+      }
+      continue;
+    } else if (!strncmp(arg, "max-transform-io-calls=", 23)) {
+      char* end = NULL;
+      g_flags.max_transform_io_calls = strtoull(arg + 23, &end, 10);
+      if ((end == arg + 23) || (*end != '\x00')) {
+        return "main: bad -max-transform-io-calls=N flag argument";
+      }
+      continue;
     } else if (!strcmp(arg, "output-crc32-digest")) {
       g_flags.output_crc32_digest = true;
       continue;
+    } else if (!strncmp(arg, "range=", 6)) {
+      char* end = NULL;
+      g_flags.range_lo = strtoull(arg + 6, &end, 10);
+      if ((end == arg + 6) || (end[0] != '.') || (end[1] != '.')) {
+        return "main: bad -range=LO..HI flag argument";
+      }
+      arg = end + 2;
+      g_flags.range_hi = strtoull(arg, &end, 10);
+      if ((end == arg) || (*end != '\x00') ||
+          (g_flags.range_lo > g_flags.range_hi)) {
+        return "main: bad -range=LO..HI flag argument";
+      }
+      g_flags.range = true;
+      continue;
     }
 
     return "main: unrecognized flag argument";
   }
 
+  if ((g_flags.max_dst_length || g_flags.max_ratio ||
+       g_flags.max_transform_io_calls) &&
+      ((g_flags.jobs > 1) || g_flags.range)) {
+    return "main: -max-etc flags cannot be combined with -jobs or -range";
+  }
+
   g_flags.remaining_argc = argc - c;
   g_flags.remaining_argv = argv + c;
   return NULL;
@@ -192,6 +306,15 @@ initialize_io_transformer(uint8_t input_first_byte) {
               &g_potential_decoders.gzip);
       break;
 
+    case 0x28:
+      status = wuffs_zstd__decoder__initialize(
+          &g_potential_decoders.zstd, sizeof g_potential_decoders.zstd,
+          WUFFS_VERSION, WUFFS_INITIALIZE__DEFAULT_OPTIONS);
+      io_transformer =
+          wuffs_zstd__decoder__upcast_as__wuffs_base__io_transformer(
+              &g_potential_decoders.zstd);
+      break;
+
     case 0x42:
       status = wuffs_bzip2__decoder__initialize(
           &g_potential_decoders.bzip2, sizeof g_potential_decoders.bzip2,
@@ -252,17 +375,769 @@ initialize_io_transformer(uint8_t input_first_byte) {
   return NULL;
 }
 
+static void  //
+handle_output(const uint8_t* ptr, size_t len) {
+  if (g_flags.output_crc32_digest) {
+    wuffs_crc32__ieee_hasher__update(&g_digest_hasher,
+                                     wuffs_base__make_slice_u8(
+                                         (uint8_t*)(uintptr_t)ptr, len));
+  } else {
+    // TODO: handle EINTR and other write errors; see "man 2 write".
+    const int stdout_fd = 1;
+    ignore_return_value(write(stdout_fd, ptr, len));
+  }
+}
+
+// ----
+
+// A job is a worker thread (and its buffers) for -jobs=N. The main thread
+// sends a one byte request over a pipe (1 means to decode src_ptr, a
+// stand-alone g_fourcc stream, and 0 means to exit) and the worker sends a
+// one byte response when done. The worker only touches the other fields
+// between those two bytes.
+typedef struct {
+  pthread_t thread;
+  int request_fds[2];
+  int response_fds[2];
+
+  uint8_t* src_ptr;
+  size_t src_cap;
+  size_t src_len;
+  uint8_t* dst_ptr;
+  size_t dst_cap;
+  size_t dst_len;
+  uint8_t* workbuf_ptr;
+  size_t workbuf_len;
+  const char* status_msg;
+
+  union {
+    wuffs_bzip2__decoder bzip2;
+    wuffs_xz__decoder xz;
+  } decoders;
+} job;
+
+job* g_jobs[MAX_JOBS] = {0};
+uint32_t g_num_jobs = 0;
+
+static const char*  //
+read_byte(int fd, uint8_t* out) {
+  while (true) {
+    ssize_t n = read(fd, out, 1);
+    if (n == 1) {
+      return NULL;
+    } else if (n == 0) {
+      return "main: unexpected end of pipe";
+    } else if (errno != EINTR) {
+      return strerror(errno);
+    }
+  }
+}
+
+static const char*  //
+write_byte(int fd, uint8_t value) {
+  while (true) {
+    ssize_t n = write(fd, &value, 1);
+    if (n == 1) {
+      return NULL;
+    } else if (errno != EINTR) {
+      return strerror(errno);
+    }
+  }
+}
+
+static void  //
+run_job(job* j) {
+  wuffs_base__status status;
+  wuffs_base__io_transformer* io_transformer = NULL;
+  if (g_fourcc == WUFFS_BASE__FOURCC__XZ) {
+    status = wuffs_xz__decoder__initialize(
+        &j->decoders.xz, sizeof j->decoders.xz, WUFFS_VERSION,
+        WUFFS_INITIALIZE__DEFAULT_OPTIONS);
+    io_transformer = wuffs_xz__decoder__upcast_as__wuffs_base__io_transformer(
+        &j->decoders.xz);
+  } else {
+    status = wuffs_bzip2__decoder__initialize(
+        &j->decoders.bzip2, sizeof j->decoders.bzip2, WUFFS_VERSION,
+        WUFFS_INITIALIZE__DEFAULT_OPTIONS);
+    io_transformer =
+        wuffs_bzip2__decoder__upcast_as__wuffs_base__io_transformer(
+            &j->decoders.bzip2);
+  }
+  if (wuffs_base__status__is_ok(&status)) {
+    if (g_flags.ignore_checksum) {
+      wuffs_base__io_transformer__set_quirk(
+          io_transformer, WUFFS_BASE__QUIRK_IGNORE_CHECKSUM, 1);
+    }
+    wuffs_base__io_buffer dst =
+        wuffs_base__ptr_u8__writer(j->dst_ptr, j->dst_cap);
+    wuffs_base__io_buffer src =
+        wuffs_base__ptr_u8__reader(j->src_ptr, j->src_len, true);
+    status = wuffs_base__io_transformer__transform_io(
+        io_transformer, &dst, &src,
+        wuffs_base__make_slice_u8(j->workbuf_ptr, j->workbuf_len));
+    j->dst_len = dst.meta.wi;
+  }
+  // A suspension (e.g. a short write) is a failure too.
+  j->status_msg = status.repr ? wuffs_base__status__message(&status) : NULL;
+}
+
+static void*  //
+job_main(void* arg) {
+  job* j = (job*)arg;
+#if defined(WUFFS_EXAMPLE_USE_SECCOMP)
+  // SECCOMP_MODE_STRICT applies per thread.
+  prctl(PR_SET_SECCOMP, SECCOMP_MODE_STRICT);
+#endif
+
+  while (true) {
+    uint8_t request = 0;
+    if (read_byte(j->request_fds[0], &request) || (request == 0)) {
+      break;
+    }
+    run_job(j);
+    if (write_byte(j->response_fds[1], 1)) {
+      break;
+    }
+  }
+
+#if defined(WUFFS_EXAMPLE_USE_SECCOMP)
+  syscall(SYS_exit, 0);
+#endif
+  return NULL;
+}
+
+// ----
+
+// xz_block is an entry in a (single stream) xz file's index. src_pos is the
+// block's position in the file and dst_pos is the position of its decoded
+// bytes.
+typedef struct {
+  uint64_t src_pos;
+  uint64_t unpadded_size;
+  uint64_t dst_pos;
+  uint64_t dst_len;
+} xz_block;
+
+xz_block* g_xz_blocks = NULL;
+uint64_t g_xz_num_blocks = 0;
+uint64_t g_xz_block_min_incl = 0;
+uint64_t g_xz_block_max_excl = 0;
+uint8_t g_xz_stream_header[12];
+
+static uint32_t  //
+crc32_of(const uint8_t* ptr, size_t len) {
+  wuffs_crc32__ieee_hasher h;
+  if (wuffs_crc32__ieee_hasher__initialize(&h, sizeof h, WUFFS_VERSION,
+                                           WUFFS_INITIALIZE__DEFAULT_OPTIONS)
+          .repr) {
+    return 0;
+  }
+  return wuffs_crc32__ieee_hasher__update_u32(
+      &h, wuffs_base__make_slice_u8((uint8_t*)(uintptr_t)ptr, len));
+}
+
+static bool  //
+pread_fully(int fd, uint8_t* ptr, size_t len, uint64_t pos) {
+  while (len > 0) {
+    ssize_t n = pread(fd, ptr, len, (off_t)pos);
+    if (n > 0) {
+      ptr += n;
+      len -= (size_t)n;
+      pos += (uint64_t)n;
+    } else if ((n == 0) || (errno != EINTR)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// read_xz_varint reads an xz "Multibyte Integer".
+static bool  //
+read_xz_varint(const uint8_t** ptr, const uint8_t* end, uint64_t* out) {
+  uint64_t value = 0;
+  for (uint32_t shift = 0; shift < 63; shift += 7) {
+    if (*ptr >= end) {
+      return false;
+    }
+    uint8_t c = *(*ptr)++;
+    value |= ((uint64_t)(c & 0x7F)) << shift;
+    if (c < 0x80) {
+      *out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// read_xz_index sets g_xz_blocks et al if stdin is a regular file holding a
+// single xz stream (with no stream padding), otherwise it leaves them unset.
+// It also seeks stdin to the first block needed by any -range=LO..HI flag.
+//
+// Like start_jobs, it is called before the main thread is sandboxed, as
+// SECCOMP_MODE_STRICT disallows fstat, lseek and pread.
+const char*  //
+read_xz_index(void) {
+  const int stdin_fd = 0;
+  struct stat st;
+  uint8_t footer[12];
+  if ((fstat(stdin_fd, &st) != 0) || !S_ISREG(st.st_mode) ||
+      (st.st_size < 32) ||
+      !pread_fully(stdin_fd, g_xz_stream_header, 12, 0) ||
+      memcmp(g_xz_stream_header, "\xFD\x37\x7A\x58\x5A\x00", 6) ||
+      !pread_fully(stdin_fd, footer, 12, (uint64_t)st.st_size - 12) ||
+      (footer[10] != 'Y') || (footer[11] != 'Z') ||
+      memcmp(footer + 8, g_xz_stream_header + 6, 2) ||
+      (crc32_of(footer + 4, 6) != wuffs_base__peek_u32le__no_bounds_check(
+                                      footer + 0))) {
+    return NULL;
+  }
+
+  uint64_t index_len =
+      4 * (1 + (uint64_t)wuffs_base__peek_u32le__no_bounds_check(footer + 4));
+  if (index_len > ((uint64_t)st.st_size - 24)) {
+    return NULL;
+  }
+  uint64_t index_pos = (uint64_t)st.st_size - 12 - index_len;
+  uint8_t* index = (uint8_t*)malloc(index_len);
+  if (!index) {
+    return "main: out of memory";
+  } else if (!pread_fully(stdin_fd, index, index_len, index_pos) ||
+             (index[0] != 0x00) ||
+             (crc32_of(index, index_len - 4) !=
+              wuffs_base__peek_u32le__no_bounds_check(index + index_len -
+                                                      4))) {
+    free(index);
+    return NULL;
+  }
+
+  const uint8_t* p = index + 1;
+  const uint8_t* end = index + index_len - 4;
+  uint64_t num_blocks = 0;
+  if (!read_xz_varint(&p, end, &num_blocks) ||
+      (num_blocks > (index_len / 2))) {
+    free(index);
+    return NULL;
+  }
+  xz_block* blocks = (xz_block*)malloc(sizeof(xz_block) * (num_blocks + 1));
+  if (!blocks) {
+    free(index);
+    return "main: out of memory";
+  }
+  uint64_t src_pos = 12;
+  uint64_t dst_pos = 0;
+  for (uint64_t i = 0; i < num_blocks; i++) {
+    xz_block* b = &blocks[i];
+    if (!read_xz_varint(&p, end, &b->unpadded_size) ||
+        !read_xz_varint(&p, end, &b->dst_len) ||
+        (b->unpadded_size > (index_pos - src_pos))) {
+      free(blocks);
+      free(index);
+      return NULL;
+    }
+    b->src_pos = src_pos;
+    b->dst_pos = dst_pos;
+    src_pos += (b->unpadded_size + 3) & ~(uint64_t)3;
+    dst_pos += b->dst_len;
+  }
+  free(index);
+  if (src_pos != index_pos) {
+    free(blocks);
+    return NULL;
+  }
+
+  uint64_t lo = 0;
+  uint64_t hi = num_blocks;
+  if (g_flags.range) {
+    while ((lo < num_blocks) &&
+           (g_flags.range_lo >= (blocks[lo].dst_pos + blocks[lo].dst_len))) {
+      lo++;
+    }
+    hi = lo;
+    while ((hi < num_blocks) && (g_flags.range_hi > blocks[hi].dst_pos)) {
+      hi++;
+    }
+  }
+  if ((lo < num_blocks) &&
+      (lseek(stdin_fd, (off_t)blocks[lo].src_pos, SEEK_SET) < 0)) {
+    free(blocks);
+    return strerror(errno);
+  }
+  g_xz_blocks = blocks;
+  g_xz_num_blocks = num_blocks;
+  g_xz_block_min_incl = lo;
+  g_xz_block_max_excl = hi;
+  return NULL;
+}
+
+// start_jobs is called before the main thread is sandboxed, since allocating
+// memory and creating threads needs more than SECCOMP_MODE_STRICT allows.
 const char*  //
-main1(int argc, char** argv) {
-  const char* z = parse_flags(argc, argv);
+start_jobs(uint32_t num_jobs) {
+  // Without an xz index, the buffers are sized for bzip2 blocks.
+  size_t src_cap = JOB_SRC_BUFFER_ARRAY_SIZE;
+  size_t dst_cap = JOB_DST_BUFFER_ARRAY_SIZE;
+  size_t workbuf_len = 0;
+  if (g_xz_blocks) {
+    uint64_t max_src = 0;
+    uint64_t max_dst = 0;
+    for (uint64_t i = g_xz_block_min_incl; i < g_xz_block_max_excl; i++) {
+      max_src = wuffs_base__u64__max(max_src, g_xz_blocks[i].unpadded_size);
+      max_dst = wuffs_base__u64__max(max_dst, g_xz_blocks[i].dst_len);
+    }
+    // Add room for the stream header, block padding, index and footer. The
+    // LZMA decoder can also ask for dst room for a whole (up to 273 byte)
+    // match, even near the end of a block.
+    if ((max_src > (SIZE_MAX - 64)) || (max_dst > (SIZE_MAX - 4096))) {
+      return "main: unsupported xz block size";
+    }
+    src_cap = (size_t)max_src + 64;
+    dst_cap = (size_t)max_dst + 4096;
+    workbuf_len = WORKBUF_ARRAY_SIZE;
+  }
+
+  for (uint32_t i = 0; i < num_jobs; i++) {
+    job* j = (job*)malloc(sizeof(job));
+    if (!j) {
+      return "main: out of memory";
+    }
+    j->src_cap = src_cap;
+    j->dst_cap = dst_cap;
+    j->workbuf_len = workbuf_len;
+    j->src_ptr = (uint8_t*)malloc(src_cap);
+    j->dst_ptr = (uint8_t*)malloc(dst_cap ? dst_cap : 1);
+    j->workbuf_ptr = (uint8_t*)malloc(workbuf_len ? workbuf_len : 1);
+    if (!j->src_ptr || !j->dst_ptr || !j->workbuf_ptr) {
+      free(j->src_ptr);
+      free(j->dst_ptr);
+      free(j->workbuf_ptr);
+      free(j);
+      return "main: out of memory";
+    } else if (pipe(j->request_fds) || pipe(j->response_fds)) {
+      free(j->src_ptr);
+      free(j->dst_ptr);
+      free(j->workbuf_ptr);
+      free(j);
+      return strerror(errno);
+    } else if (pthread_create(&j->thread, NULL, job_main, j)) {
+      free(j->src_ptr);
+      free(j->dst_ptr);
+      free(j->workbuf_ptr);
+      free(j);
+      return "main: could not create thread";
+    }
+    g_jobs[g_num_jobs++] = j;
+  }
+  return NULL;
+}
+
+void  //
+stop_jobs(void) {
+  for (uint32_t i = 0; i < g_num_jobs; i++) {
+    write_byte(g_jobs[i]->request_fds[1], 0);
+  }
+}
+
+// ----
+
+#define BZIP2_BLOCK_MAGIC 0x314159265359
+#define BZIP2_FINAL_MAGIC 0x177245385090
+
+// g_bzip2_boundaries holds the absolute bit positions of the block (or final)
+// magic numbers found so far, starting with the oldest block not yet
+// successfully decoded. Each block (other than the final pseudo-block) ends
+// where the next one starts.
+uint64_t g_bzip2_boundaries[MAX_JOBS + 16];
+bool g_bzip2_boundary_is_final[MAX_JOBS + 16];
+uint32_t g_bzip2_num_boundaries = 0;
+uint64_t g_bzip2_scan_pos = 0;
+uint64_t g_bzip2_scan_window = 0;
+
+static uint64_t  //
+peek_bits(wuffs_base__io_buffer* src, uint64_t bit_pos, uint32_t n) {
+  uint64_t ret = 0;
+  for (; n > 0; n--, bit_pos++) {
+    uint8_t c = src->data.ptr[(bit_pos >> 3) - src->meta.pos];
+    ret = (ret << 1) | (1 & (c >> (7 - (bit_pos & 7))));
+  }
+  return ret;
+}
+
+static uint64_t  //
+append_bits(uint8_t* dst, uint64_t dst_num_bits, uint64_t value, uint32_t n) {
+  for (; n > 0; n--, dst_num_bits++) {
+    uint8_t mask = 0x80 >> (dst_num_bits & 7);
+    if (1 & (value >> (n - 1))) {
+      dst[dst_num_bits >> 3] |= mask;
+    } else {
+      dst[dst_num_bits >> 3] &= ~mask;
+    }
+  }
+  return dst_num_bits;
+}
+
+// read_more compacts src, discarding the bytes before absolute position
+// keep_pos, and then reads from stdin.
+static const char*  //
+read_more(wuffs_base__io_buffer* src, uint64_t keep_pos) {
+  src->meta.ri = keep_pos - src->meta.pos;
+  wuffs_base__io_buffer__compact(src);
+  if (src->meta.wi == src->data.len) {
+    return "main: unsupported bzip2 block size";
+  }
+  while (true) {
+    const int stdin_fd = 0;
+    ssize_t n = read(stdin_fd, src->data.ptr + src->meta.wi,
+                     src->data.len - src->meta.wi);
+    if (n >= 0) {
+      src->meta.wi += n;
+      src->meta.closed = (n == 0);
+      return NULL;
+    } else if (errno != EINTR) {
+      return strerror(errno);
+    }
+  }
+}
+
+// scan_for_bzip2_boundaries scans src's bytes, one at a time, until it finds
+// at least one block (or final) magic number. It returns whether it did.
+static bool  //
+scan_for_bzip2_boundaries(wuffs_base__io_buffer* src) {
+  bool found = false;
+  while (!found &&
+         (g_bzip2_scan_pos < (src->meta.pos + src->meta.wi)) &&
+         (g_bzip2_num_boundaries < (MAX_JOBS + 8))) {
+    g_bzip2_scan_window =
+        (g_bzip2_scan_window << 8) |
+        src->data.ptr[g_bzip2_scan_pos - src->meta.pos];
+    g_bzip2_scan_pos++;
+    for (int shift = 7; shift >= 0; shift--) {
+      uint64_t m = (g_bzip2_scan_window >> shift) & 0xFFFFFFFFFFFF;
+      if ((m != BZIP2_BLOCK_MAGIC) && (m != BZIP2_FINAL_MAGIC)) {
+        continue;
+      }
+      // The first 32 bits are the "BZh9" (or similar) header.
+      uint64_t bit_pos = (8 * g_bzip2_scan_pos) - 48 - (uint64_t)shift;
+      if (bit_pos >= 32) {
+        g_bzip2_boundaries[g_bzip2_num_boundaries] = bit_pos;
+        g_bzip2_boundary_is_final[g_bzip2_num_boundaries] =
+            (m == BZIP2_FINAL_MAGIC);
+        g_bzip2_num_boundaries++;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+static void  //
+remove_bzip2_boundary(uint32_t i) {
+  g_bzip2_num_boundaries--;
+  for (; i < g_bzip2_num_boundaries; i++) {
+    g_bzip2_boundaries[i] = g_bzip2_boundaries[i + 1];
+    g_bzip2_boundary_is_final[i] = g_bzip2_boundary_is_final[i + 1];
+  }
+}
+
+// start_bzip2_job wraps the bits of a bzip2 block in a stand-alone bzip2
+// stream (of just that block) and asks the job to decode it. Block bits are
+// not byte aligned in the original stream and so are shifted.
+static const char*  //
+start_bzip2_job(job* j,
+                wuffs_base__io_buffer* src,
+                uint8_t header_level,
+                uint64_t bit_min_incl,
+                uint64_t bit_max_excl) {
+  uint64_t num_bits = bit_max_excl - bit_min_incl;
+  if (num_bits > (8 * (j->src_cap - 16))) {
+    return "main: unsupported bzip2 block size";
+  }
+  j->src_ptr[0] = 'B';
+  j->src_ptr[1] = 'Z';
+  j->src_ptr[2] = 'h';
+  j->src_ptr[3] = header_level;
+
+  const uint8_t* s =
+      src->data.ptr + ((bit_min_incl >> 3) - src->meta.pos);
+  uint32_t shift = bit_min_incl & 7;
+  uint64_t num_bytes = (num_bits + 7) / 8;
+  uint8_t* d = j->src_ptr + 4;
+  if (shift == 0) {
+    memcpy(d, s, num_bytes);
+  } else {
+    // The next block's magic number follows, so s[i + 1] is in bounds.
+    for (uint64_t i = 0; i < num_bytes; i++) {
+      d[i] = (uint8_t)((s[i] << shift) | (s[i + 1] >> (8 - shift)));
+    }
+  }
+
+  // A single block's final (combined) checksum is its block checksum.
+  uint64_t block_checksum = peek_bits(src, bit_min_incl + 48, 32);
+  uint64_t n = 32 + num_bits;
+  n = append_bits(j->src_ptr, n, BZIP2_FINAL_MAGIC, 48);
+  n = append_bits(j->src_ptr, n, block_checksum, 32);
+  j->src_len = (size_t)((n + 7) / 8);
+  return write_byte(j->request_fds[1], 1);
+}
+
+static const char*  //
+status_message(const char* repr) {
+  wuffs_base__status status = wuffs_base__make_status(repr);
+  return wuffs_base__status__message(&status);
+}
+
+// decode_bzip2_in_parallel is like the rest of main1 (but for bzip2 input
+// and -jobs=N) in that it consumes stdin and writes to stdout. src holds the
+// start of stdin.
+//
+// A block magic number can also occur by chance within a block's compressed
+// bits. If decoding a block fails, this assumes that the next boundary was
+// such a false positive and tries again with the next two blocks merged.
+const char*  //
+decode_bzip2_in_parallel(wuffs_base__io_buffer* src) {
+  while ((src->meta.wi < 4) && !src->meta.closed) {
+    const char* z = read_more(src, 0);
+    if (z) {
+      return z;
+    }
+  }
+  if ((src->meta.wi < 4) || (src->data.ptr[0] != 'B') ||
+      (src->data.ptr[1] != 'Z') || (src->data.ptr[2] != 'h') ||
+      (src->data.ptr[3] < '1') || ('9' < src->data.ptr[3])) {
+    return status_message(wuffs_bzip2__error__bad_header);
+  }
+  uint8_t header_level = src->data.ptr[3];
+  g_fourcc = WUFFS_BASE__FOURCC__BZ2;
+
+  uint32_t final_checksum = 0;
+  uint64_t num_blocks_done = 0;
+  uint32_t num_in_flight = 0;
+  const char* first_failure = NULL;
+
+  while (true) {
+    // Give idle jobs something to do.
+    while ((num_in_flight < g_num_jobs) &&
+           ((num_in_flight + 1) < g_bzip2_num_boundaries) &&
+           !g_bzip2_boundary_is_final[num_in_flight]) {
+      const char* z = start_bzip2_job(
+          g_jobs[(num_blocks_done + num_in_flight) % g_num_jobs], src,
+          header_level, g_bzip2_boundaries[num_in_flight],
+          g_bzip2_boundaries[num_in_flight + 1]);
+      if (z) {
+        return first_failure ? first_failure : z;
+      }
+      num_in_flight++;
+    }
+
+    // Find more block boundaries, if an idle job could use one.
+    if ((num_in_flight < g_num_jobs) &&
+        (g_bzip2_num_boundaries < (num_in_flight + 2)) &&
+        ((g_bzip2_num_boundaries == 0) ||
+         !g_bzip2_boundary_is_final[g_bzip2_num_boundaries - 1]) &&
+        ((g_bzip2_scan_pos < (src->meta.pos + src->meta.wi)) ||
+         !src->meta.closed)) {
+      if (!scan_for_bzip2_boundaries(src) && !src->meta.closed) {
+        const char* z = read_more(
+            src, (g_bzip2_num_boundaries > 0) ? (g_bzip2_boundaries[0] >> 3)
+                                              : g_bzip2_scan_pos);
+        if (z) {
+          return z;
+        }
+      } else if ((num_blocks_done == 0) && (g_bzip2_num_boundaries > 0) &&
+                 (g_bzip2_boundaries[0] != 32)) {
+        return status_message(wuffs_bzip2__error__bad_block_header);
+      }
+      continue;
+    }
+
+    // Wait for the oldest in-flight job.
+    if (num_in_flight > 0) {
+      job* j = g_jobs[num_blocks_done % g_num_jobs];
+      uint8_t response = 0;
+      const char* z = read_byte(j->response_fds[0], &response);
+      if (z) {
+        return z;
+      } else if (!j->status_msg) {
+        handle_output(j->dst_ptr, j->dst_len);
+        final_checksum = ((final_checksum << 1) | (final_checksum >> 31)) ^
+                         (uint32_t)peek_bits(src, g_bzip2_boundaries[0] + 48,
+                                             32);
+        remove_bzip2_boundary(0);
+        num_blocks_done++;
+        num_in_flight--;
+        first_failure = NULL;
+        continue;
+      }
+
+      if (!first_failure) {
+        first_failure = j->status_msg;
+      }
+      for (uint32_t i = 1; i < num_in_flight; i++) {
+        z = read_byte(
+            g_jobs[(num_blocks_done + i) % g_num_jobs]->response_fds[0],
+            &response);
+        if (z) {
+          return z;
+        }
+      }
+      num_in_flight = 0;
+      remove_bzip2_boundary(1);
+      continue;
+    }
+
+    // All blocks are done. Check the final checksum.
+    if ((g_bzip2_num_boundaries > 0) && g_bzip2_boundary_is_final[0]) {
+      uint64_t end_pos = (g_bzip2_boundaries[0] + 48 + 32 + 7) / 8;
+      while (((src->meta.pos + src->meta.wi) < end_pos) && !src->meta.closed) {
+        const char* z = read_more(src, g_bzip2_boundaries[0] >> 3);
+        if (z) {
+          return z;
+        }
+      }
+      if ((src->meta.pos + src->meta.wi) < end_pos) {
+        return status_message(wuffs_bzip2__error__truncated_input);
+      } else if (!g_flags.ignore_checksum &&
+                 (final_checksum !=
+                  peek_bits(src, g_bzip2_boundaries[0] + 48, 32))) {
+        return status_message(wuffs_bzip2__error__bad_checksum);
+      }
+      return NULL;
+    }
+    return first_failure ? first_failure
+                         : status_message(wuffs_bzip2__error__truncated_input);
+  }
+}
+
+// ----
+
+// read_fully reads exactly len bytes from stdin.
+static const char*  //
+read_fully(uint8_t* ptr, size_t len) {
+  while (len > 0) {
+    const int stdin_fd = 0;
+    ssize_t n = read(stdin_fd, ptr, len);
+    if (n > 0) {
+      ptr += n;
+      len -= (size_t)n;
+    } else if (n == 0) {
+      return status_message(wuffs_xz__error__truncated_input);
+    } else if (errno != EINTR) {
+      return strerror(errno);
+    }
+  }
+  return NULL;
+}
+
+// start_xz_job reads an xz block from stdin and wraps it in a stand-alone xz
+// stream (of just that block, with a one-record index) and asks the job to
+// decode it.
+static const char*  //
+start_xz_job(job* j, const xz_block* b) {
+  uint8_t* p = j->src_ptr;
+  memcpy(p, g_xz_stream_header, 12);
+  p += 12;
+  size_t padded_size = (size_t)((b->unpadded_size + 3) & ~(uint64_t)3);
+  const char* z = read_fully(p, padded_size);
   if (z) {
     return z;
-  } else if (g_flags.remaining_argc > 0) {
+  }
+  p += padded_size;
+
+  uint8_t* index = p;
+  *p++ = 0x00;  // Index Indicator.
+  *p++ = 0x01;  // Number of Records.
+  uint64_t values[2] = {b->unpadded_size, b->dst_len};
+  for (int i = 0; i < 2; i++) {
+    uint64_t v = values[i];
+    for (; v >= 0x80; v >>= 7) {
+      *p++ = (uint8_t)(v | 0x80);
+    }
+    *p++ = (uint8_t)v;
+  }
+  while ((p - index) & 3) {
+    *p++ = 0x00;
+  }
+  size_t index_len = (size_t)(p - index) + 4;
+  wuffs_base__poke_u32le__no_bounds_check(p, crc32_of(index, index_len - 4));
+  p += 4;
+
+  wuffs_base__poke_u32le__no_bounds_check(p + 4,
+                                          (uint32_t)((index_len / 4) - 1));
+  p[8] = g_xz_stream_header[6];
+  p[9] = g_xz_stream_header[7];
+  p[10] = 'Y';
+  p[11] = 'Z';
+  wuffs_base__poke_u32le__no_bounds_check(p, crc32_of(p + 4, 6));
+  p += 12;
+
+  j->src_len = (size_t)(p - j->src_ptr);
+  return write_byte(j->request_fds[1], 1);
+}
+
+// decode_xz_in_parallel is like the rest of main1 (but for xz input, with
+// an index, and -jobs=N or -range=LO..HI) in that it consumes stdin and
+// writes to stdout. read_xz_index has already seeked stdin to the first
+// block needed.
+const char*  //
+decode_xz_in_parallel(void) {
+  g_fourcc = WUFFS_BASE__FOURCC__XZ;
+  uint64_t lo = g_flags.range ? g_flags.range_lo : 0;
+  uint64_t hi = g_flags.range ? g_flags.range_hi : UINT64_MAX;
+  uint64_t num_started = g_xz_block_min_incl;
+  for (uint64_t i = g_xz_block_min_incl; i < g_xz_block_max_excl; i++) {
+    while ((num_started < g_xz_block_max_excl) &&
+           ((num_started - i) < g_num_jobs)) {
+      const char* z = start_xz_job(g_jobs[num_started % g_num_jobs],
+                                   &g_xz_blocks[num_started]);
+      if (z) {
+        return z;
+      }
+      num_started++;
+    }
+
+    job* j = g_jobs[i % g_num_jobs];
+    uint8_t response = 0;
+    const char* z = read_byte(j->response_fds[0], &response);
+    if (z) {
+      return z;
+    } else if (j->status_msg) {
+      return j->status_msg;
+    }
+    const xz_block* b = &g_xz_blocks[i];
+    if (j->dst_len != b->dst_len) {
+      return status_message(wuffs_xz__error__bad_index);
+    }
+    uint64_t min_incl = wuffs_base__u64__max(lo, b->dst_pos) - b->dst_pos;
+    uint64_t max_excl =
+        wuffs_base__u64__min(hi, b->dst_pos + b->dst_len) - b->dst_pos;
+    if (min_incl < max_excl) {
+      handle_output(j->dst_ptr + min_incl, (size_t)(max_excl - min_incl));
+    }
+  }
+  return NULL;
+}
+
+const char*  //
+main1(int argc, char** argv) {
+  if (g_flags.remaining_argc > 0) {
     return "main: bad argument: use \"program < input\", not \"program input\"";
   } else if (g_flags.fail_if_unsandboxed && !g_sandboxed) {
     return "main: unsandboxed";
   }
 
+  if (g_xz_blocks && (g_num_jobs > 0)) {
+    if (g_flags.output_crc32_digest) {
+      wuffs_base__status status = wuffs_crc32__ieee_hasher__initialize(
+          &g_digest_hasher, sizeof g_digest_hasher, WUFFS_VERSION,
+          WUFFS_INITIALIZE__DEFAULT_OPTIONS);
+      if (status.repr) {
+        return wuffs_base__status__message(&status);
+      }
+    }
+    return decode_xz_in_parallel();
+  } else if (g_flags.range) {
+    return "main: -range=LO..HI needs a regular file, single stream xz input";
+  }
+
   wuffs_base__io_buffer dst;
   dst.data.ptr = g_dst_buffer_array;
   dst.data.len = DST_BUFFER_ARRAY_SIZE;
@@ -279,6 +1154,10 @@ main1(int argc, char** argv) {
   src.meta.pos = 0;
   src.meta.closed = false;
 
+  g_budget = wuffs_base__make_io_transformer_budget(
+      g_flags.max_dst_length, g_flags.max_ratio,
+      g_flags.max_transform_io_calls);
+
   while (true) {
     const int stdin_fd = 0;
     ssize_t n =
@@ -310,24 +1189,21 @@ main1(int argc, char** argv) {
           return wuffs_base__status__message(&status);
         }
       }
+      if ((g_num_jobs > 1) && (src.data.ptr[src.meta.ri] == 0x42)) {
+        return decode_bzip2_in_parallel(&src);
+      }
     }
 
     while (true) {
-      wuffs_base__status status = wuffs_base__io_transformer__transform_io(
-          g_io_transformer, &dst, &src,
-          wuffs_base__make_slice_u8(&g_workbuf_array[0],
-                                    sizeof(g_workbuf_array)));
+      wuffs_base__status status =
+          wuffs_base__io_transformer_budget__transform_io(
+              &g_budget, g_io_transformer, &dst, &src,
+              wuffs_base__make_slice_u8(&g_workbuf_array[0],
+                                        sizeof(g_workbuf_array)));
 
       if (dst.meta.ri < dst.meta.wi) {
-        if (g_flags.output_crc32_digest) {
-          wuffs_crc32__ieee_hasher__update(
-              &g_digest_hasher, wuffs_base__io_buffer__reader_slice(&dst));
-        } else {
-          // TODO: handle EINTR and other write errors; see "man 2 write".
-          const int stdout_fd = 1;
-          ignore_return_value(write(stdout_fd, g_dst_buffer_array + dst.meta.ri,
-                                    dst.meta.wi - dst.meta.ri));
-        }
+        handle_output(g_dst_buffer_array + dst.meta.ri,
+                      dst.meta.wi - dst.meta.ri);
         dst.meta.ri = dst.meta.wi;
         wuffs_base__optional_u63 hrl =
             wuffs_base__io_transformer__dst_history_retain_length(
@@ -396,12 +1272,25 @@ print_crc32_digest(bool bad) {
 
 int  //
 main(int argc, char** argv) {
+  const char* z = parse_flags(argc, argv);
+  if (!z && ((g_flags.jobs > 1) || g_flags.range)) {
+    z = read_xz_index();
+  }
+  if (!z) {
+    if (g_flags.jobs > 1) {
+      z = start_jobs(g_flags.jobs);
+    } else if (g_flags.range && g_xz_blocks) {
+      z = start_jobs(1);
+    }
+  }
+
 #if defined(WUFFS_EXAMPLE_USE_SECCOMP)
   prctl(PR_SET_SECCOMP, SECCOMP_MODE_STRICT);
   g_sandboxed = true;
 #endif
 
-  int exit_code = compute_exit_code(main1(argc, argv));
+  int exit_code = compute_exit_code(z ? z : main1(argc, argv));
+  stop_jobs();
   if (g_flags.output_crc32_digest) {
     print_crc32_digest(exit_code != 0);
   }
@@ -0,0 +1,390 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+/*
+zipcat writes the uncompressed contents of a Zip archive's members to stdout,
+similar to "unzip -p". It can also list the members or test (decompress and
+verify the CRC-32 checksums of) them. To run:
+
+$CXX -pthread zipcat.cc && ./a.out ../../test/data/archive.zip romeo.txt; \
+    rm -f a.out
+
+for a C++ compiler $CXX, such as clang++ or g++.
+
+The archive is mmap'ed, if possible, and its central directory parsed once, by
+a wuffs_aux::ZipArchive. Passing -jobs=N (or -j=N) with N > 1 extracts
+members on N worker threads, each with its own wuffs_aux::ZipExtractor, all
+sharing that one (read-only) ZipArchive. Outputs are written in order.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__STATIC_FUNCTIONS macro is optional, but when
+// combined with WUFFS_IMPLEMENTATION, it demonstrates making all of Wuffs'
+// functions have static storage.
+//
+// This can help the compiler ignore or discard unused code, which can produce
+// faster compiles and smaller binaries. Other motivations are discussed in the
+// "ALLOW STATIC IMPLEMENTATION" section of
+// https://raw.githubusercontent.com/nothings/stb/master/docs/stb_howto.txt
+#define WUFFS_CONFIG__STATIC_FUNCTIONS
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__ZIP
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__CRC32
+#define WUFFS_CONFIG__MODULE__DEFLATE
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C++ file.
+#include "../../release/c/wuffs-unsupported-snapshot.c"
+
+#define TRY(error_msg)         \
+  do {                         \
+    std::string z = error_msg; \
+    if (!z.empty()) {          \
+      return z;                \
+    }                          \
+  } while (false)
+
+static const char* g_usage =
+    "Usage: zipcat -flags archive.zip [member names]\n"
+    "\n"
+    "Flags:\n"
+    "    -j=NUM  -jobs=NUM\n"
+    "    -l      -list\n"
+    "    -t      -test\n"
+    "\n"
+    "With no member names, zipcat writes every (non-directory) member.\n"
+    "\n"
+    "----\n"
+    "\n"
+    "zipcat writes the uncompressed contents of a Zip archive's members to\n"
+    "stdout, similar to \"unzip -p\". The -list flag instead prints each\n"
+    "member's uncompressed size and name. The -test flag instead\n"
+    "decompresses each member (verifying its checksum) and discards it.\n"
+    "\n"
+    "The -jobs=NUM flag (default 1) sets the number of worker threads.\n"
+    "Members are extracted in parallel but written in order.\n";
+
+// MAX_JOBS bounds the -jobs=N flag.
+#define MAX_JOBS 256
+
+// MAX_IN_MEMORY_MEMBER_SIZE bounds the uncompressed size of a member when
+// -jobs=N (with N > 1) extracts it to memory, before writing it to stdout.
+#define MAX_IN_MEMORY_MEMBER_SIZE 0x40000000
+
+struct {
+  int remaining_argc;
+  char** remaining_argv;
+
+  bool list;
+  bool test;
+
+  uint32_t jobs;
+} g_flags = {0};
+
+std::string  //
+parse_flags(int argc, char** argv) {
+  g_flags.jobs = 1;
+
+  int c = (argc > 0) ? 1 : 0;  // Skip argv[0], the program name.
+  for (; c < argc; c++) {
+    char* arg = argv[c];
+    if (*arg++ != '-') {
+      break;
+    }
+
+    // A double-dash "--foo" is equivalent to a single-dash "-foo". As special
+    // cases, a bare "-" is not a flag (some programs may interpret it as
+    // stdin) and a bare "--" means to stop parsing flags.
+    if (*arg == '\x00') {
+      break;
+    } else if (*arg == '-') {
+      arg++;
+      if (*arg == '\x00') {
+        c++;
+        break;
+      }
+    }
+
+    if (!strncmp(arg, "j=", 2) || !strncmp(arg, "jobs=", 5)) {
+      while (*arg++ != '=') {
+      }
+      int jobs = atoi(arg);
+      if ((jobs <= 0) || (MAX_JOBS < jobs)) {
+        return "main: bad -jobs=N flag argument";
+      }
+      g_flags.jobs = (uint32_t)jobs;
+      continue;
+    }
+    if (!strcmp(arg, "l") || !strcmp(arg, "list")) {
+      g_flags.list = true;
+      continue;
+    }
+    if (!strcmp(arg, "t") || !strcmp(arg, "test")) {
+      g_flags.test = true;
+      continue;
+    }
+
+    return g_usage;
+  }
+
+  g_flags.remaining_argc = argc - c;
+  g_flags.remaining_argv = argv + c;
+  return "";
+}
+
+// ----
+
+// DiscardOutput is a wuffs_aux::sync_io::Output that drops everything, for
+// the -test flag.
+class DiscardOutput : public wuffs_aux::sync_io::Output {
+ public:
+  virtual std::string CopyOut(wuffs_aux::IOBuffer* src) {
+    src->meta.ri = src->meta.wi;
+    src->compact();
+    return "";
+  }
+};
+
+// Job holds one member's extraction result, for -jobs=N. The member's bytes
+// are extracted (by a worker thread) to memory and then written (by the main
+// thread) to stdout.
+struct Job {
+  std::unique_ptr<uint8_t[]> data;
+  size_t length = 0;
+  std::string error_message;
+  bool done = false;
+};
+
+struct {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::atomic<size_t> next_to_claim;
+  size_t next_to_write;
+  std::vector<Job> jobs;
+} g_parallel;
+
+std::string  //
+extract_to_memory(wuffs_aux::ZipExtractor& extractor,
+                  const wuffs_aux::ZipArchive& archive,
+                  size_t index,
+                  Job& job) {
+  if (g_flags.test) {
+    DiscardOutput output;
+    return extractor.ExtractMember(output, archive, index);
+  }
+  uint64_t n = archive.Members()[index].uncompressed_size;
+  if (n > MAX_IN_MEMORY_MEMBER_SIZE) {
+    return "main: member is too large for -jobs=N";
+  }
+  job.data.reset(new uint8_t[n ? n : 1]);
+  wuffs_aux::sync_io::MemoryOutput output(job.data.get(), n);
+  TRY(extractor.ExtractMember(output, archive, index));
+  job.length = n;
+  return "";
+}
+
+void  //
+worker(const wuffs_aux::ZipArchive& archive,
+       const std::vector<size_t>& indexes) {
+  wuffs_aux::ZipExtractor extractor;
+  while (true) {
+    size_t i = g_parallel.next_to_claim++;
+    if (i >= indexes.size()) {
+      return;
+    }
+
+    // Don't get too far ahead of the main thread, so that we don't hold
+    // too many extracted members in memory at once.
+    {
+      std::unique_lock<std::mutex> lock(g_parallel.mutex);
+      g_parallel.cond.wait(lock, [i] {
+        return i < (g_parallel.next_to_write + (2 * g_flags.jobs));
+      });
+    }
+
+    Job job;
+    job.error_message =
+        extract_to_memory(extractor, archive, indexes[i], job);
+    job.done = true;
+
+    std::lock_guard<std::mutex> lock(g_parallel.mutex);
+    g_parallel.jobs[i] = std::move(job);
+    g_parallel.cond.notify_all();
+  }
+}
+
+std::string  //
+extract_parallel(const wuffs_aux::ZipArchive& archive,
+                 const std::vector<size_t>& indexes) {
+  g_parallel.next_to_claim = 0;
+  g_parallel.next_to_write = 0;
+  g_parallel.jobs.resize(indexes.size());
+
+  std::vector<std::thread> threads;
+  for (uint32_t j = 0; j < g_flags.jobs; j++) {
+    threads.emplace_back(worker, std::cref(archive), std::cref(indexes));
+  }
+
+  std::string ret;
+  for (size_t i = 0; i < indexes.size(); i++) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(g_parallel.mutex);
+      g_parallel.cond.wait(lock, [i] { return g_parallel.jobs[i].done; });
+      job = std::move(g_parallel.jobs[i]);
+      g_parallel.next_to_write = i + 1;
+      g_parallel.cond.notify_all();
+    }
+    if (ret.empty()) {
+      ret = job.error_message;
+      if (ret.empty() && (job.length > 0) &&
+          (fwrite(job.data.get(), 1, job.length, stdout) != job.length)) {
+        ret = "main: error writing stdout";
+      }
+    }
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+  return ret;
+}
+
+std::string  //
+extract_serial(const wuffs_aux::ZipArchive& archive,
+               const std::vector<size_t>& indexes) {
+  wuffs_aux::ZipExtractor extractor;
+  DiscardOutput discard_output;
+  wuffs_aux::sync_io::FileOutput file_output(stdout);
+  wuffs_aux::sync_io::Output& output =
+      g_flags.test ? static_cast<wuffs_aux::sync_io::Output&>(discard_output)
+                   : static_cast<wuffs_aux::sync_io::Output&>(file_output);
+  for (size_t index : indexes) {
+    TRY(extractor.ExtractMember(output, archive, index));
+  }
+  return "";
+}
+
+// ----
+
+std::string  //
+main1(int argc, char** argv) {
+  TRY(parse_flags(argc, argv));
+  if (g_flags.remaining_argc < 1) {
+    return g_usage;
+  }
+
+  FILE* in = fopen(g_flags.remaining_argv[0], "rb");
+  if (!in) {
+    return "main: cannot read input file";
+  }
+  wuffs_aux::sync_io::MmapFileInput input(in);
+  wuffs_aux::ZipArchive archive;
+  std::string ret = archive.Open(input);
+  if (!ret.empty()) {
+    fclose(in);
+    return ret;
+  }
+
+  std::vector<size_t> indexes;
+  if (g_flags.remaining_argc == 1) {
+    for (size_t i = 0; i < archive.Members().size(); i++) {
+      if (!archive.Members()[i].IsDirectory()) {
+        indexes.push_back(i);
+      }
+    }
+  } else {
+    for (int a = 1; a < g_flags.remaining_argc; a++) {
+      size_t i = archive.FindMember(g_flags.remaining_argv[a]);
+      if (i == SIZE_MAX) {
+        fclose(in);
+        return std::string("main: no such member: ") +
+               g_flags.remaining_argv[a];
+      }
+      indexes.push_back(i);
+    }
+  }
+
+  if (g_flags.list) {
+    for (size_t index : indexes) {
+      const wuffs_aux::ZipMember& m = archive.Members()[index];
+      printf("%12llu  %s\n", (unsigned long long)m.uncompressed_size,
+             m.name.c_str());
+    }
+  } else if (g_flags.jobs > 1) {
+    ret = extract_parallel(archive, indexes);
+  } else {
+    ret = extract_serial(archive, indexes);
+  }
+
+  fclose(in);
+  return ret;
+}
+
+// ----
+
+int  //
+compute_exit_code(std::string status_msg) {
+  if (status_msg.empty()) {
+    return 0;
+  }
+  fprintf(stderr, "%s\n", status_msg.c_str());
+  // Return an exit code of 1 for regular (foreseen) errors, e.g. badly
+  // formatted or unsupported input.
+  //
+  // Return an exit code of 2 for internal (exceptional) errors, e.g. defensive
+  // run-time checks found that an internal invariant did not hold.
+  //
+  // Automated testing, including badly formatted inputs, can therefore
+  // discriminate between expected failure (exit code 1) and unexpected failure
+  // (other non-zero exit codes). Specifically, exit code 2 for internal
+  // invariant violation, exit code 139 (which is 128 + SIGSEGV on x86_64
+  // linux) for a segmentation fault (e.g. null pointer dereference).
+  return (status_msg.find("internal error:") != std::string::npos) ? 2 : 1;
+}
+
+int  //
+main(int argc, char** argv) {
+  std::string z = main1(argc, argv);
+  int exit_code = compute_exit_code(z);
+  fflush(stdout);
+  return exit_code;
+}
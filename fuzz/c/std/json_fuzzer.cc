@@ -59,8 +59,10 @@ It should print "PASS", amongst other information, and exit(0).
 // code simply isn't compiled.
 #define WUFFS_CONFIG__MODULES
 #define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__CBOR
 #define WUFFS_CONFIG__MODULE__AUX__JSON
 #define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__CBOR
 #define WUFFS_CONFIG__MODULE__JSON
 
 // If building this program in an environment that doesn't easily accommodate
@@ -476,6 +478,51 @@ class Callbacks : public wuffs_aux::DecodeJsonCallbacks {
   int64_t m_depth;
 };
 
+class StringOutput : public wuffs_aux::sync_io::Output {
+ public:
+  std::string CopyOut(wuffs_aux::IOBuffer* src) override {
+    m_str.append(reinterpret_cast<const char*>(src->reader_pointer()),
+                 src->reader_length());
+    src->meta.ri = src->meta.wi;
+    src->compact();
+    return "";
+  }
+
+  std::string m_str;
+};
+
+void  //
+fuzz_transcode(const uint8_t* in_ptr,
+               size_t in_len,
+               std::vector<wuffs_aux::QuirkKeyValuePair>& quirks) {
+  StringOutput cbor;
+  wuffs_aux::sync_io::MemoryInput json_input(in_ptr, in_len);
+  wuffs_aux::DecodeJsonResult json_result = wuffs_aux::TranscodeJsonToCbor(
+      cbor, json_input,
+      wuffs_aux::DecodeJsonArgQuirks(quirks.data(), quirks.size()));
+  if (!json_result.error_message.empty()) {
+    if (json_result.error_message.find("internal error:") !=
+        std::string::npos) {
+      fprintf(stderr, "internal errors shouldn't occur: \"%s\"\n",
+              json_result.error_message.c_str());
+      intentional_segfault();
+    }
+    return;
+  }
+
+  // Valid JSON transcodes to valid CBOR, which transcodes back to JSON.
+  StringOutput json;
+  wuffs_aux::sync_io::MemoryInput cbor_input(cbor.m_str.data(),
+                                             cbor.m_str.size());
+  wuffs_aux::DecodeCborResult cbor_result =
+      wuffs_aux::TranscodeCborToJson(json, cbor_input);
+  if (!cbor_result.error_message.empty()) {
+    fprintf(stderr, "JSON to CBOR to JSON round trip failed: \"%s\"\n",
+            cbor_result.error_message.c_str());
+    intentional_segfault();
+  }
+}
+
 void  //
 fuzz_cpp(const uint8_t* in_ptr, size_t in_len, uint64_t hash) {
   static const char* json_pointers[16] = {
@@ -513,6 +560,8 @@ fuzz_cpp(const uint8_t* in_ptr, size_t in_len, uint64_t hash) {
       callbacks, input,
       wuffs_aux::DecodeJsonArgQuirks(quirks.data(), quirks.size()),
       wuffs_aux::DecodeJsonArgJsonPointer(json_pointer));
+
+  fuzz_transcode(in_ptr, in_len, quirks);
 }
 #endif  // defined(__cplusplus)
 
@@ -15,6 +15,12 @@
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__BASE)
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define WUFFS_AUX__SYNC_IO__HAVE_MMAP
+#endif
+
 namespace wuffs_aux {
 
 namespace sync_io {
@@ -118,6 +124,89 @@ FileInput::CopyIn(IOBuffer* dst) {
 
 // --------
 
+MmapFileInput::MmapFileInput(FILE* f)
+    : m_f(f),
+      m_io(wuffs_base__empty_io_buffer()),
+      m_map_ptr(nullptr),
+      m_map_len(0) {
+#if defined(WUFFS_AUX__SYNC_IO__HAVE_MMAP)
+  if (!f) {
+    return;
+  }
+  int fd = fileno(f);
+  struct stat st;
+  if ((fd < 0) || (fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) ||
+      (st.st_size <= 0) || ((uint64_t)SIZE_MAX < (uint64_t)st.st_size)) {
+    return;
+  }
+  // ftello accounts for any bytes that stdio has already buffered.
+  off_t pos = ftello(f);
+  if ((pos < 0) || (st.st_size <= pos)) {
+    return;
+  }
+  size_t len = (size_t)st.st_size;
+  void* ptr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (ptr == MAP_FAILED) {
+    return;
+  }
+  // The advice is only a hint. Ignore any failure.
+  madvise(ptr, len, MADV_SEQUENTIAL);
+  m_map_ptr = ptr;
+  m_map_len = len;
+  m_io = wuffs_base__ptr_u8__reader(static_cast<uint8_t*>(ptr) + pos,
+                                    len - (size_t)pos, true);
+#endif
+}
+
+MmapFileInput::~MmapFileInput() {
+#if defined(WUFFS_AUX__SYNC_IO__HAVE_MMAP)
+  if (m_map_ptr) {
+    munmap(m_map_ptr, m_map_len);
+  }
+#endif
+}
+
+IOBuffer*  //
+MmapFileInput::BringsItsOwnIOBuffer() {
+  return m_map_ptr ? &m_io : nullptr;
+}
+
+std::string  //
+MmapFileInput::CopyIn(IOBuffer* dst) {
+  if (!dst) {
+    return "wuffs_aux::sync_io::MmapFileInput: nullptr IOBuffer";
+  } else if (dst->meta.closed) {
+    return "wuffs_aux::sync_io::MmapFileInput: end of file";
+  } else if (m_map_ptr) {
+    if (wuffs_base__slice_u8__overlaps(dst->data, m_io.data)) {
+      // Treat m_io's data as immutable, so don't compact dst or otherwise
+      // write to it.
+      return "wuffs_aux::sync_io::MmapFileInput: overlapping buffers";
+    }
+    dst->compact();
+    size_t nd = dst->writer_length();
+    size_t ns = m_io.reader_length();
+    size_t n = (nd < ns) ? nd : ns;
+    memcpy(dst->writer_pointer(), m_io.reader_pointer(), n);
+    m_io.meta.ri += n;
+    dst->meta.wi += n;
+    dst->meta.closed = m_io.reader_length() == 0;
+  } else if (!m_f) {
+    return "wuffs_aux::sync_io::MmapFileInput: nullptr file";
+  } else {
+    dst->compact();
+    size_t n = fread(dst->writer_pointer(), 1, dst->writer_length(), m_f);
+    dst->meta.wi += n;
+    dst->meta.closed = feof(m_f);
+    if (ferror(m_f)) {
+      return "wuffs_aux::sync_io::MmapFileInput: error reading file";
+    }
+  }
+  return "";
+}
+
+// --------
+
 MemoryInput::MemoryInput(const char* ptr, size_t len)
     : m_io(wuffs_base__ptr_u8__reader(
           static_cast<uint8_t*>(static_cast<void*>(const_cast<char*>(ptr))),
@@ -157,8 +246,142 @@ MemoryInput::CopyIn(IOBuffer* dst) {
 
 // --------
 
+Output::~Output() {}
+
+IOBuffer*  //
+Output::BringsItsOwnIOBuffer() {
+  return nullptr;
+}
+
+// --------
+
+FileOutput::FileOutput(FILE* f) : m_f(f) {}
+
+std::string  //
+FileOutput::CopyOut(IOBuffer* src) {
+  if (!m_f) {
+    return "wuffs_aux::sync_io::FileOutput: nullptr file";
+  } else if (!src) {
+    return "wuffs_aux::sync_io::FileOutput: nullptr IOBuffer";
+  }
+  size_t n = fwrite(src->reader_pointer(), 1, src->reader_length(), m_f);
+  src->meta.ri += n;
+  if (src->reader_length() > 0) {
+    return "wuffs_aux::sync_io::FileOutput: error writing file";
+  }
+  src->compact();
+  return "";
+}
+
+// --------
+
+MemoryOutput::MemoryOutput(char* ptr, size_t len)
+    : m_io(wuffs_base__ptr_u8__writer(
+          static_cast<uint8_t*>(static_cast<void*>(ptr)),
+          len)) {}
+
+MemoryOutput::MemoryOutput(uint8_t* ptr, size_t len)
+    : m_io(wuffs_base__ptr_u8__writer(ptr, len)) {}
+
+IOBuffer*  //
+MemoryOutput::BringsItsOwnIOBuffer() {
+  return &m_io;
+}
+
+std::string  //
+MemoryOutput::CopyOut(IOBuffer* src) {
+  if (!src) {
+    return "wuffs_aux::sync_io::MemoryOutput: nullptr IOBuffer";
+  } else if (src == &m_io) {
+    // The bytes are already in place. They stay in m_io's reader side, so
+    // that the caller can find them after encoding.
+    return "";
+  } else if (wuffs_base__slice_u8__overlaps(src->data, m_io.data)) {
+    return "wuffs_aux::sync_io::MemoryOutput: overlapping buffers";
+  } else if (src->reader_length() > m_io.writer_length()) {
+    return "wuffs_aux::sync_io::MemoryOutput: buffer is full";
+  }
+  size_t n = src->reader_length();
+  memcpy(m_io.writer_pointer(), src->reader_pointer(), n);
+  m_io.meta.wi += n;
+  src->meta.ri += n;
+  src->compact();
+  return "";
+}
+
+// --------
+
 }  // namespace sync_io
 
+namespace async_io {
+
+const char NeedMoreInput[] =  //
+    "wuffs_aux::async_io: need more input";
+const char AlreadyDone[] =  //
+    "wuffs_aux::async_io: already done";
+
+Input::Input(size_t buffer_length)
+    : m_array(new uint8_t[buffer_length]),
+      m_io(wuffs_base__ptr_u8__writer(m_array.get(), buffer_length)),
+      m_arrived(false) {}
+
+IOBuffer*  //
+Input::BringsItsOwnIOBuffer() {
+  return &m_io;
+}
+
+std::string  //
+Input::CopyIn(IOBuffer* dst) {
+  if (dst != &m_io) {
+    return "wuffs_aux::async_io::Input: unsupported IOBuffer";
+  } else if (m_arrived) {
+    // The bytes are already in place.
+    m_arrived = false;
+    return "";
+  } else if (m_io.meta.closed) {
+    return "wuffs_aux::async_io::Input: end of file";
+  }
+  return NeedMoreInput;
+}
+
+wuffs_base__slice_u8  //
+Input::WriterSlice() {
+  if (m_io.meta.closed) {
+    return wuffs_base__empty_slice_u8();
+  }
+  m_io.compact();
+  return m_io.writer_slice();
+}
+
+void  //
+Input::Commit(size_t n) {
+  if (m_io.meta.closed) {
+    return;
+  }
+  size_t w = m_io.writer_length();
+  m_io.meta.wi += (n < w) ? n : w;
+  m_arrived = m_arrived || (n > 0);
+}
+
+size_t  //
+Input::Write(const void* ptr, size_t len) {
+  wuffs_base__slice_u8 dst = WriterSlice();
+  size_t n = (len < dst.len) ? len : dst.len;
+  if (n > 0) {
+    memcpy(dst.ptr, ptr, n);
+    Commit(n);
+  }
+  return n;
+}
+
+void  //
+Input::Close() {
+  m_arrived = m_arrived || !m_io.meta.closed;
+  m_io.meta.closed = true;
+}
+
+}  // namespace async_io
+
 namespace private_impl {
 
 struct ErrorMessages {
@@ -206,98 +429,135 @@ AdvanceIOBufferTo(const ErrorMessages& error_messages,
   return "";
 }
 
+// HandleMetadataState is the part of HandleMetadata's state that has to
+// survive HandleMetadata returning async_io::NeedMoreInput, so that the next
+// call can resume where the previous one left off.
+struct HandleMetadataState {
+  HandleMetadataState()
+      : resuming(false),
+        minfo(wuffs_base__empty_more_information()),
+        status(wuffs_base__make_status(nullptr)),
+        range(wuffs_base__empty_range_ie_u64()) {}
+
+  bool resuming;
+  wuffs_base__more_information minfo;
+  wuffs_base__status status;
+  // range is the rest of a METADATA_RAW_PASSTHROUGH range, not yet copied.
+  wuffs_base__range_ie_u64 range;
+};
+
 std::string  //
-HandleMetadata(
+HandleMetadataLoop(
     const ErrorMessages& error_messages,
     sync_io::Input& input,
     wuffs_base__io_buffer& io_buf,
     sync_io::DynIOBuffer& raw,
+    HandleMetadataState& state,
     wuffs_base__status (*tell_me_more_func)(void*,
                                             wuffs_base__io_buffer*,
                                             wuffs_base__more_information*,
                                             wuffs_base__io_buffer*),
-    void* tell_me_more_receiver,
-    std::string (*handle_metadata_func)(void*,
-                                        const wuffs_base__more_information*,
-                                        wuffs_base__slice_u8),
-    void* handle_metadata_receiver) {
-  wuffs_base__more_information minfo = wuffs_base__empty_more_information();
-  // Reset raw but keep its backing array (the raw.m_buf.data slice).
-  raw.m_buf.meta = wuffs_base__empty_io_buffer_meta();
-
+    void* tell_me_more_receiver) {
   while (true) {
-    minfo = wuffs_base__empty_more_information();
-    wuffs_base__status status = (*tell_me_more_func)(
-        tell_me_more_receiver, &raw.m_buf, &minfo, &io_buf);
-    switch (minfo.flavor) {
-      case 0:
-      case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_RAW_TRANSFORM:
-      case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_PARSED:
-        break;
-
-      case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_RAW_PASSTHROUGH: {
-        wuffs_base__range_ie_u64 r = minfo.metadata_raw_passthrough__range();
-        if (r.is_empty()) {
+    if (state.range.is_empty()) {
+      bool resumed = (state.status.repr == wuffs_base__suspension__short_read);
+      wuffs_base__more_information minfo =
+          wuffs_base__empty_more_information();
+      state.status = (*tell_me_more_func)(tell_me_more_receiver, &raw.m_buf,
+                                          &minfo, &io_buf);
+      if (!resumed || (minfo.flavor != 0)) {
+        // A tell_me_more call that resumes after a short read might not
+        // repeat the minfo that it set before suspending.
+        state.minfo = minfo;
+      }
+      switch (minfo.flavor) {
+        case 0:
+        case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_RAW_TRANSFORM:
+        case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_PARSED:
           break;
-        }
-        uint64_t num_to_copy = r.length();
-        if (num_to_copy > (raw.m_max_incl - raw.m_buf.meta.wi)) {
-          return error_messages.resolve(
-              error_messages.max_incl_metadata_length_exceeded);
-        } else if (num_to_copy > (raw.m_buf.data.len - raw.m_buf.meta.wi)) {
-          switch (raw.grow(num_to_copy + raw.m_buf.meta.wi)) {
-            case sync_io::DynIOBuffer::GrowResult::OK:
-              break;
-            case sync_io::DynIOBuffer::GrowResult::FailedMaxInclExceeded:
-              return error_messages.resolve(
-                  error_messages.max_incl_metadata_length_exceeded);
-            case sync_io::DynIOBuffer::GrowResult::FailedOutOfMemory:
-              return error_messages.resolve(error_messages.out_of_memory);
-          }
-        }
-
-        if (io_buf.reader_position() > r.min_incl) {
-          return error_messages.resolve(error_messages.unsupported_metadata);
-        } else {
-          std::string error_message =
-              AdvanceIOBufferTo(error_messages, input, io_buf, r.min_incl);
-          if (!error_message.empty()) {
-            return error_message;
-          }
-        }
 
-        while (true) {
-          uint64_t n =
-              wuffs_base__u64__min(num_to_copy, io_buf.reader_length());
-          memcpy(raw.m_buf.writer_pointer(), io_buf.reader_pointer(), n);
-          raw.m_buf.meta.wi += n;
-          io_buf.meta.ri += n;
-          num_to_copy -= n;
-          if (num_to_copy == 0) {
+        case WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_RAW_PASSTHROUGH: {
+          wuffs_base__range_ie_u64 r = minfo.metadata_raw_passthrough__range();
+          if (r.is_empty()) {
             break;
-          } else if (io_buf.meta.closed) {
+          }
+          uint64_t num_to_copy = r.length();
+          if (num_to_copy > (raw.m_max_incl - raw.m_buf.meta.wi)) {
             return error_messages.resolve(
-                error_messages.unexpected_end_of_file);
-          } else if (!input.BringsItsOwnIOBuffer()) {
-            io_buf.compact();
+                error_messages.max_incl_metadata_length_exceeded);
+          } else if (num_to_copy > (raw.m_buf.data.len - raw.m_buf.meta.wi)) {
+            switch (raw.grow(num_to_copy + raw.m_buf.meta.wi)) {
+              case sync_io::DynIOBuffer::GrowResult::OK:
+                break;
+              case sync_io::DynIOBuffer::GrowResult::FailedMaxInclExceeded:
+                return error_messages.resolve(
+                    error_messages.max_incl_metadata_length_exceeded);
+              case sync_io::DynIOBuffer::GrowResult::FailedOutOfMemory:
+                return error_messages.resolve(error_messages.out_of_memory);
+            }
           }
-          std::string error_message = input.CopyIn(&io_buf);
-          if (!error_message.empty()) {
-            return error_message;
+
+          if (io_buf.reader_position() > r.min_incl) {
+            return error_messages.resolve(error_messages.unsupported_metadata);
           }
+          state.range = r;
+          break;
         }
-        break;
+
+        default:
+          return error_messages.resolve(error_messages.unsupported_metadata);
+      }
+    }
+
+    // Copy the METADATA_RAW_PASSTHROUGH range, if any. Both AdvanceIOBufferTo
+    // and this loop only work with absolute positions (state.range), so that
+    // they can be resumed after input.CopyIn returns async_io::NeedMoreInput.
+    if (!state.range.is_empty()) {
+      std::string error_message = AdvanceIOBufferTo(
+          error_messages, input, io_buf, state.range.min_incl);
+      if (!error_message.empty()) {
+        return error_message;
       }
 
-      default:
-        return error_messages.resolve(error_messages.unsupported_metadata);
+      while (true) {
+        uint64_t n =
+            wuffs_base__u64__min(state.range.length(), io_buf.reader_length());
+        memcpy(raw.m_buf.writer_pointer(), io_buf.reader_pointer(), n);
+        raw.m_buf.meta.wi += n;
+        io_buf.meta.ri += n;
+        state.range.min_incl += n;
+        if (state.range.is_empty()) {
+          break;
+        } else if (io_buf.meta.closed) {
+          return error_messages.resolve(error_messages.unexpected_end_of_file);
+        } else if (!input.BringsItsOwnIOBuffer()) {
+          io_buf.compact();
+        }
+        error_message = input.CopyIn(&io_buf);
+        if (!error_message.empty()) {
+          return error_message;
+        }
+      }
     }
 
-    if (status.repr == nullptr) {
+    if (state.status.repr == nullptr) {
       break;
-    } else if (status.repr != wuffs_base__suspension__even_more_information) {
-      if (status.repr != wuffs_base__suspension__short_write) {
-        return status.message();
+    } else if (state.status.repr == wuffs_base__suspension__short_read) {
+      // Transforming (e.g. decompressing) metadata can need more source
+      // bytes than were buffered when the metadata was reported.
+      if (io_buf.meta.closed) {
+        return error_messages.resolve(error_messages.unexpected_end_of_file);
+      } else if (!input.BringsItsOwnIOBuffer()) {
+        io_buf.compact();
+      }
+      std::string error_message = input.CopyIn(&io_buf);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    } else if (state.status.repr !=
+               wuffs_base__suspension__even_more_information) {
+      if (state.status.repr != wuffs_base__suspension__short_write) {
+        return state.status.message();
       }
       switch (raw.grow(wuffs_base__u64__sat_add(raw.m_buf.data.len, 1))) {
         case sync_io::DynIOBuffer::GrowResult::OK:
@@ -310,14 +570,76 @@ HandleMetadata(
       }
     }
   }
+  return "";
+}
 
-  return (*handle_metadata_func)(handle_metadata_receiver, &minfo,
+std::string  //
+HandleMetadata(
+    const ErrorMessages& error_messages,
+    sync_io::Input& input,
+    wuffs_base__io_buffer& io_buf,
+    sync_io::DynIOBuffer& raw,
+    HandleMetadataState& state,
+    wuffs_base__status (*tell_me_more_func)(void*,
+                                            wuffs_base__io_buffer*,
+                                            wuffs_base__more_information*,
+                                            wuffs_base__io_buffer*),
+    void* tell_me_more_receiver,
+    std::string (*handle_metadata_func)(void*,
+                                        const wuffs_base__more_information*,
+                                        wuffs_base__slice_u8),
+    void* handle_metadata_receiver) {
+  if (!state.resuming) {
+    // Reset raw but keep its backing array (the raw.m_buf.data slice).
+    raw.m_buf.meta = wuffs_base__empty_io_buffer_meta();
+    state.status = wuffs_base__make_status(nullptr);
+    state.range = wuffs_base__empty_range_ie_u64();
+  }
+
+  std::string error_message =
+      HandleMetadataLoop(error_messages, input, io_buf, raw, state,
+                         tell_me_more_func, tell_me_more_receiver);
+  state.resuming = (error_message == async_io::NeedMoreInput);
+  if (!error_message.empty()) {
+    return error_message;
+  }
+  return (*handle_metadata_func)(handle_metadata_receiver, &state.minfo,
                                  raw.m_buf.reader_slice());
 }
 
+std::string  //
+WriteToOutput(sync_io::Output& output,
+              IOBuffer& io_buf,
+              const uint8_t* ptr,
+              size_t len) {
+  while (len > 0) {
+    size_t n = io_buf.writer_length();
+    if (n == 0) {
+      std::string error_message = output.CopyOut(&io_buf);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+      n = io_buf.writer_length();
+      if (n == 0) {
+        return "wuffs_aux::private_impl: output buffer is full";
+      }
+    }
+    if (n > len) {
+      n = len;
+    }
+    memcpy(io_buf.writer_pointer(), ptr, n);
+    io_buf.meta.wi += n;
+    ptr += n;
+    len -= n;
+  }
+  return "";
+}
+
 }  // namespace private_impl
 
 }  // namespace wuffs_aux
 
+#undef WUFFS_AUX__SYNC_IO__HAVE_MMAP
+
 #endif  // !defined(WUFFS_CONFIG__MODULES) ||
         // defined(WUFFS_CONFIG__MODULE__AUX__BASE)
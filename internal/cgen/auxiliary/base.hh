@@ -121,6 +121,40 @@ class FileInput : public Input {
 
 // --------
 
+// MmapFileInput is an Input that reads from a file source, like FileInput,
+// but if that file is a regular file then it is memory-mapped (read-only) and
+// BringsItsOwnIOBuffer returns a closed IOBuffer over the rest of the file,
+// from its current position, like MemoryInput. Decoders then read the file's
+// bytes in place instead of copying them, a buffer-full at a time, through a
+// (smaller) intermediate buffer.
+//
+// Otherwise (e.g. for pipes, or when mmap is unavailable or fails), it falls
+// back to reading the file like FileInput.
+//
+// It does not take responsibility for closing the file when done, but it does
+// unmap it. It does not advance the file's position. The file should not be
+// truncated while mapped, as reading past its new end can crash the process.
+class MmapFileInput : public Input {
+ public:
+  MmapFileInput(FILE* f);
+  ~MmapFileInput() override;
+
+  virtual IOBuffer* BringsItsOwnIOBuffer();
+  virtual std::string CopyIn(IOBuffer* dst);
+
+ private:
+  FILE* m_f;
+  IOBuffer m_io;
+  void* m_map_ptr;
+  size_t m_map_len;
+
+  // Delete the copy and assign constructors.
+  MmapFileInput(const MmapFileInput&) = delete;
+  MmapFileInput& operator=(const MmapFileInput&) = delete;
+};
+
+// --------
+
 // MemoryInput is an Input that reads from an in-memory source.
 //
 // It does not take responsibility for freeing the memory when done.
@@ -142,6 +176,133 @@ class MemoryInput : public Input {
 
 // --------
 
+// Output is the write-side counterpart of Input. Encoders write to an
+// IOBuffer's writer side and periodically call CopyOut to drain its reader
+// side.
+//
+// If BringsItsOwnIOBuffer returns non-nullptr then encoders write directly
+// into that IOBuffer and do not compact it.
+class Output {
+ public:
+  virtual ~Output();
+
+  virtual IOBuffer* BringsItsOwnIOBuffer();
+
+  // CopyOut consumes src's reader side (the bytes written but not yet copied
+  // out), typically compacting src to make room in its writer side. If src is
+  // this Output's own IOBuffer, the bytes may instead stay where they are.
+  virtual std::string CopyOut(IOBuffer* src) = 0;
+};
+
+// --------
+
+// FileOutput is an Output that writes to a file sink.
+//
+// It does not take responsibility for flushing or closing the file when done.
+class FileOutput : public Output {
+ public:
+  FileOutput(FILE* f);
+
+  virtual std::string CopyOut(IOBuffer* src);
+
+ private:
+  FILE* m_f;
+
+  // Delete the copy and assign constructors.
+  FileOutput(const FileOutput&) = delete;
+  FileOutput& operator=(const FileOutput&) = delete;
+};
+
+// --------
+
+// MemoryOutput is an Output that writes to an in-memory sink: a fixed size
+// byte array that is owned by the caller. After encoding, the bytes written
+// are the BringsItsOwnIOBuffer()->reader_slice().
+//
+// It does not take responsibility for freeing the memory when done.
+class MemoryOutput : public Output {
+ public:
+  MemoryOutput(char* ptr, size_t len);
+  MemoryOutput(uint8_t* ptr, size_t len);
+
+  virtual IOBuffer* BringsItsOwnIOBuffer();
+  virtual std::string CopyOut(IOBuffer* src);
+
+ private:
+  IOBuffer m_io;
+
+  // Delete the copy and assign constructors.
+  MemoryOutput(const MemoryOutput&) = delete;
+  MemoryOutput& operator=(const MemoryOutput&) = delete;
+};
+
+// --------
+
 }  // namespace sync_io
 
+namespace async_io {
+
+// NeedMoreInput is the error message that Input::CopyIn returns when no bytes
+// have arrived, and the Input has not been closed, since the previous CopyIn
+// call. The DecodeFooAsync classes treat it as a suspension, not a failure:
+// their Resume method returns it and can be called again later, after more
+// bytes have arrived.
+extern const char NeedMoreInput[];
+
+// AlreadyDone is the error message that a DecodeFooAsync class's Resume
+// method returns after it has already returned a final (not NeedMoreInput)
+// result.
+extern const char AlreadyDone[];
+
+// Input is a sync_io::Input whose bytes are pushed to it (e.g. by an epoll or
+// io_uring event loop, as bytes arrive over the network) instead of pulled by
+// the decoder. Pass it to a DecodeFooAsync class, such as DecodeJsonAsync.
+// Decoding can then be suspended and resumed without blocking a thread.
+//
+// Between DecodeFooAsync::Resume calls, the caller writes bytes either via
+// Write or by writing to WriterSlice and then calling Commit. It calls Close
+// after the final byte. It should not write while a Resume call is running.
+//
+// It brings its own IOBuffer, which it compacts (in WriterSlice) to make
+// room for new bytes. The buffer_length is fixed: it bounds how much input can
+// be buffered but not yet consumed by the decoder.
+class Input : public sync_io::Input {
+ public:
+  explicit Input(size_t buffer_length = 32768);
+
+  virtual IOBuffer* BringsItsOwnIOBuffer();
+  virtual std::string CopyIn(IOBuffer* dst);
+
+  // WriterSlice returns the buffer's writable (empty) part, after compacting
+  // the buffer. It is empty if the buffer is full or closed.
+  wuffs_base__slice_u8 WriterSlice();
+
+  // Commit records that n bytes were written to the start of WriterSlice(). n
+  // is clamped to the length of that slice.
+  void Commit(size_t n);
+
+  // Write copies as many of the len bytes as fit into the buffer. It returns
+  // how many bytes were copied, which can be fewer than len if the buffer is
+  // full (the decoder has not consumed enough of what was already written).
+  size_t Write(const void* ptr, size_t len);
+
+  // Close records that no more bytes will arrive, e.g. because the peer has
+  // closed its connection.
+  void Close();
+
+ private:
+  std::unique_ptr<uint8_t[]> m_array;
+  IOBuffer m_io;
+
+  // m_arrived is whether bytes have arrived, or Close was called, since the
+  // previous CopyIn call.
+  bool m_arrived;
+
+  // Delete the copy and assign constructors.
+  Input(const Input&) = delete;
+  Input& operator=(const Input&) = delete;
+};
+
+}  // namespace async_io
+
 }  // namespace wuffs_aux
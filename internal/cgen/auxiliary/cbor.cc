@@ -23,6 +23,28 @@ DecodeCborResult::DecodeCborResult(std::string&& error_message0,
 
 DecodeCborCallbacks::~DecodeCborCallbacks() {}
 
+bool  //
+DecodeCborCallbacks::BorrowsStrings() {
+  return false;
+}
+
+std::string  //
+DecodeCborCallbacks::BeginString(uint32_t flags, uint64_t length) {
+  return "";
+}
+
+std::string  //
+DecodeCborCallbacks::AppendStringSlice(uint32_t flags,
+                                       const uint8_t* ptr,
+                                       size_t len) {
+  return "";
+}
+
+std::string  //
+DecodeCborCallbacks::EndString(uint32_t flags) {
+  return "";
+}
+
 void  //
 DecodeCborCallbacks::Done(DecodeCborResult& result,
                           sync_io::Input& input,
@@ -37,332 +59,1023 @@ DecodeCborArgQuirks::DefaultValue() {
   return DecodeCborArgQuirks(nullptr, 0);
 }
 
-DecodeCborResult  //
-DecodeCbor(DecodeCborCallbacks& callbacks,
-           sync_io::Input& input,
-           DecodeCborArgQuirks quirks) {
-  // Prepare the wuffs_base__io_buffer and the resultant error_message.
-  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
-  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
-  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
-  if (!io_buf) {
-    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
-    fallback_io_buf = wuffs_base__ptr_u8__writer(fallback_io_array.get(), 4096);
-    io_buf = &fallback_io_buf;
-  }
-  // cursor_index is discussed at
+DecodeCborArgStringBuffer::DecodeCborArgStringBuffer(std::string* repr0)
+    : repr(repr0) {}
+
+DecodeCborArgStringBuffer  //
+DecodeCborArgStringBuffer::DefaultValue() {
+  return DecodeCborArgStringBuffer(nullptr);
+}
+
+namespace {
+
+// DecodeCbor_DefiniteLength returns the length encoded in a definite-length
+// CBOR string's head: its initial byte and any trailing length bytes.
+uint64_t  //
+DecodeCbor_DefiniteLength(const uint8_t* ptr, uint64_t len) {
+  switch (len) {
+    case 1:
+      return ptr[0] & 0x1F;
+    case 2:
+      return ptr[1];
+    case 3:
+      return wuffs_base__peek_u16be__no_bounds_check(ptr + 1);
+    case 5:
+      return wuffs_base__peek_u32be__no_bounds_check(ptr + 1);
+    case 9:
+      return wuffs_base__peek_u64be__no_bounds_check(ptr + 1);
+  }
+  return 0;
+}
+
+}  // namespace
+
+namespace private_impl {
+
+// DecodeCborState holds the state of DecodeCbor and DecodeCborAsync. Keeping
+// it out of local variables lets decoding be suspended, when the input needs
+// more bytes, and resumed later without re-reading or re-decoding anything.
+class DecodeCborState {
+ public:
+  DecodeCborState(DecodeCborCallbacks& callbacks,
+                  sync_io::Input& input,
+                  DecodeCborArgQuirks quirks,
+                  DecodeCborArgStringBuffer string_buffer);
+
+  // Resume decodes until it is finished, successfully or not, and returns
+  // true. It instead returns false if the input's CopyIn returned
+  // async_io::NeedMoreInput, in which case Resume can be called again later.
+  bool Resume();
+
+  // Finish calls the callbacks' Done method and returns the result.
+  DecodeCborResult Finish();
+
+  uint64_t CursorPosition() const;
+
+ private:
+  DecodeCborCallbacks& m_callbacks;
+  sync_io::Input& m_input;
+
+  wuffs_base__io_buffer* m_io_buf;
+  wuffs_base__io_buffer m_fallback_io_buf;
+  std::unique_ptr<uint8_t[]> m_fallback_io_array;
+  // m_cursor_index is discussed at
   // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
-  size_t cursor_index = 0;
-  std::string ret_error_message;
-  std::string io_error_message;
-
-  do {
-    // Prepare the low-level CBOR decoder.
-    wuffs_cbor__decoder::unique_ptr dec = wuffs_cbor__decoder::alloc();
-    if (!dec) {
-      ret_error_message = "wuffs_aux::DecodeCbor: out of memory";
-      goto done;
-    }
-    for (size_t i = 0; i < quirks.len; i++) {
-      dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
-    }
+  size_t m_cursor_index;
+  std::string m_ret_error_message;
+  std::string m_io_error_message;
+  bool m_suspended;
 
-    // Prepare the wuffs_base__tok_buffer. 256 tokens is 2KiB.
-    wuffs_base__token tok_array[256];
-    wuffs_base__token_buffer tok_buf =
-        wuffs_base__slice_token__writer(wuffs_base__make_slice_token(
-            &tok_array[0], (sizeof(tok_array) / sizeof(tok_array[0]))));
-    wuffs_base__status tok_status = wuffs_base__make_status(nullptr);
-
-    // Prepare other state.
-    int32_t depth = 0;
-    std::string str;
-    int64_t extension_category = 0;
-    uint64_t extension_detail = 0;
-
-    // Valid token's VBCs range in 0 ..= 15. Values over that are for tokens
-    // from outside of the base package, such as the CBOR package.
-    constexpr int64_t EXT_CAT__CBOR_TAG = 16;
-
-    // Loop, doing these two things:
-    //  1. Get the next token.
-    //  2. Process that token.
-    while (true) {
-      // 1. Get the next token.
-
-      while (tok_buf.meta.ri >= tok_buf.meta.wi) {
-        if (tok_status.repr == nullptr) {
-          // No-op.
-        } else if (tok_status.repr == wuffs_base__suspension__short_write) {
-          tok_buf.compact();
-        } else if (tok_status.repr == wuffs_base__suspension__short_read) {
-          // Read from input to io_buf.
-          if (!io_error_message.empty()) {
-            ret_error_message = std::move(io_error_message);
-            goto done;
-          } else if (cursor_index != io_buf->meta.ri) {
-            ret_error_message =
-                "wuffs_aux::DecodeCbor: internal error: bad cursor_index";
-            goto done;
-          } else if (io_buf->meta.closed) {
-            ret_error_message =
-                "wuffs_aux::DecodeCbor: internal error: io_buf is closed";
-            goto done;
-          }
-          io_buf->compact();
-          if (io_buf->meta.wi >= io_buf->data.len) {
-            ret_error_message =
+  wuffs_cbor__decoder::unique_ptr m_dec;
+  // 256 tokens is 2KiB.
+  wuffs_base__token m_tok_array[256];
+  wuffs_base__token_buffer m_tok_buf;
+  wuffs_base__status m_tok_status;
+
+  int32_t m_depth;
+  std::string m_local_str;
+  std::string* m_str;
+  bool m_borrows_strings;
+  bool m_in_string;
+  uint32_t m_string_flags;
+  uint32_t m_slice_flags;
+  int64_t m_extension_category;
+  uint64_t m_extension_detail;
+
+  // Delete the copy and assign constructors.
+  DecodeCborState(const DecodeCborState&) = delete;
+  DecodeCborState& operator=(const DecodeCborState&) = delete;
+};
+
+DecodeCborState::DecodeCborState(DecodeCborCallbacks& callbacks,
+                                 sync_io::Input& input,
+                                 DecodeCborArgQuirks quirks,
+                                 DecodeCborArgStringBuffer string_buffer)
+    : m_callbacks(callbacks),
+      m_input(input),
+      m_io_buf(input.BringsItsOwnIOBuffer()),
+      m_fallback_io_buf(wuffs_base__empty_io_buffer()),
+      m_fallback_io_array(nullptr),
+      m_cursor_index(0),
+      m_suspended(false),
+      m_dec(nullptr),
+      m_tok_buf(wuffs_base__slice_token__writer(wuffs_base__make_slice_token(
+          &m_tok_array[0],
+          (sizeof(m_tok_array) / sizeof(m_tok_array[0]))))),
+      m_tok_status(wuffs_base__make_status(nullptr)),
+      m_depth(0),
+      m_str(string_buffer.repr ? string_buffer.repr : &m_local_str),
+      m_borrows_strings(false),
+      m_in_string(false),
+      m_string_flags(0),
+      m_slice_flags(0),
+      m_extension_category(0),
+      m_extension_detail(0) {
+  // Prepare the wuffs_base__io_buffer.
+  if (!m_io_buf) {
+    m_fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    m_fallback_io_buf =
+        wuffs_base__ptr_u8__writer(m_fallback_io_array.get(), 4096);
+    m_io_buf = &m_fallback_io_buf;
+  }
+
+  // Prepare the low-level CBOR decoder.
+  m_dec = wuffs_cbor__decoder::alloc();
+  if (!m_dec) {
+    m_ret_error_message = "wuffs_aux::DecodeCbor: out of memory";
+    return;
+  }
+  for (size_t i = 0; i < quirks.len; i++) {
+    m_dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
+  }
+
+  // Prepare other state.
+  m_str->clear();
+  m_borrows_strings = callbacks.BorrowsStrings();
+}
+
+bool  //
+DecodeCborState::Resume() {
+  if (!m_ret_error_message.empty()) {
+    // The constructor failed.
+    return true;
+  }
+
+  // Valid token's VBCs range in 0 ..= 15. Values over that are for tokens
+  // from outside of the base package, such as the CBOR package.
+  constexpr int64_t EXT_CAT__CBOR_TAG = 16;
+
+  // Loop, doing these two things:
+  //  1. Get the next token.
+  //  2. Process that token.
+  while (true) {
+    // 1. Get the next token.
+
+    while (m_tok_buf.meta.ri >= m_tok_buf.meta.wi) {
+      if (m_tok_status.repr == nullptr) {
+        // No-op.
+      } else if (m_tok_status.repr == wuffs_base__suspension__short_write) {
+        m_tok_buf.compact();
+      } else if (m_tok_status.repr == wuffs_base__suspension__short_read) {
+        // Read from input to io_buf.
+        if (m_suspended) {
+          // Retry the CopyIn that returned async_io::NeedMoreInput. In the
+          // meantime, the input may have compacted io_buf.
+          m_suspended = false;
+        } else if (!m_io_error_message.empty()) {
+          m_ret_error_message = std::move(m_io_error_message);
+          goto done;
+        } else if (m_cursor_index != m_io_buf->meta.ri) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeCbor: internal error: bad cursor_index";
+          goto done;
+        } else if (m_io_buf->meta.closed) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeCbor: internal error: io_buf is closed";
+          goto done;
+        } else {
+          m_io_buf->compact();
+          if (m_io_buf->meta.wi >= m_io_buf->data.len) {
+            m_ret_error_message =
                 "wuffs_aux::DecodeCbor: internal error: io_buf is full";
             goto done;
           }
-          cursor_index = io_buf->meta.ri;
-          io_error_message = input.CopyIn(io_buf);
-        } else {
-          ret_error_message = tok_status.message();
-          goto done;
-        }
-
-        if (WUFFS_CBOR__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
-          ret_error_message =
-              "wuffs_aux::DecodeCbor: internal error: bad WORKBUF_LEN";
-          goto done;
         }
-        wuffs_base__slice_u8 work_buf = wuffs_base__empty_slice_u8();
-        tok_status = dec->decode_tokens(&tok_buf, io_buf, work_buf);
-        if ((tok_buf.meta.ri > tok_buf.meta.wi) ||
-            (tok_buf.meta.wi > tok_buf.data.len) ||
-            (io_buf->meta.ri > io_buf->meta.wi) ||
-            (io_buf->meta.wi > io_buf->data.len)) {
-          ret_error_message =
-              "wuffs_aux::DecodeCbor: internal error: bad buffer indexes";
-          goto done;
+        m_cursor_index = m_io_buf->meta.ri;
+        m_io_error_message = m_input.CopyIn(m_io_buf);
+        if (m_io_error_message == async_io::NeedMoreInput) {
+          m_suspended = true;
+          return false;
         }
+      } else {
+        m_ret_error_message = m_tok_status.message();
+        goto done;
       }
 
-      wuffs_base__token token = tok_buf.data.ptr[tok_buf.meta.ri++];
-      uint64_t token_len = token.length();
-      if ((io_buf->meta.ri < cursor_index) ||
-          ((io_buf->meta.ri - cursor_index) < token_len)) {
-        ret_error_message =
-            "wuffs_aux::DecodeCbor: internal error: bad token indexes";
+      if (WUFFS_CBOR__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
+        m_ret_error_message =
+            "wuffs_aux::DecodeCbor: internal error: bad WORKBUF_LEN";
         goto done;
       }
-      uint8_t* token_ptr = io_buf->data.ptr + cursor_index;
-      cursor_index += static_cast<size_t>(token_len);
-
-      // 2. Process that token.
-
-      uint64_t vbd = token.value_base_detail();
-
-      if (extension_category != 0) {
-        int64_t ext = token.value_extension();
-        if ((ext >= 0) && !token.continued()) {
-          extension_detail = (extension_detail
-                              << WUFFS_BASE__TOKEN__VALUE_EXTENSION__NUM_BITS) |
-                             static_cast<uint64_t>(ext);
-          switch (extension_category) {
-            case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED:
-              extension_category = 0;
-              ret_error_message =
-                  callbacks.AppendI64(static_cast<int64_t>(extension_detail));
-              goto parsed_a_value;
-            case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED:
-              extension_category = 0;
-              ret_error_message = callbacks.AppendU64(extension_detail);
-              goto parsed_a_value;
-            case EXT_CAT__CBOR_TAG:
-              extension_category = 0;
-              ret_error_message = callbacks.AppendCborTag(extension_detail);
-              if (!ret_error_message.empty()) {
-                goto done;
-              }
-              continue;
-          }
-        }
-        ret_error_message =
-            "wuffs_aux::DecodeCbor: internal error: bad extended token";
+      wuffs_base__slice_u8 work_buf = wuffs_base__empty_slice_u8();
+      m_tok_status = m_dec->decode_tokens(&m_tok_buf, m_io_buf, work_buf);
+      if ((m_tok_buf.meta.ri > m_tok_buf.meta.wi) ||
+          (m_tok_buf.meta.wi > m_tok_buf.data.len) ||
+          (m_io_buf->meta.ri > m_io_buf->meta.wi) ||
+          (m_io_buf->meta.wi > m_io_buf->data.len)) {
+        m_ret_error_message =
+            "wuffs_aux::DecodeCbor: internal error: bad buffer indexes";
         goto done;
       }
+    }
 
-      switch (token.value_base_category()) {
-        case WUFFS_BASE__TOKEN__VBC__FILLER:
-          continue;
+    wuffs_base__token token = m_tok_buf.data.ptr[m_tok_buf.meta.ri++];
+    uint64_t token_len = token.length();
+    if ((m_io_buf->meta.ri < m_cursor_index) ||
+        ((m_io_buf->meta.ri - m_cursor_index) < token_len)) {
+      m_ret_error_message =
+          "wuffs_aux::DecodeCbor: internal error: bad token indexes";
+      goto done;
+    }
+    uint8_t* token_ptr = m_io_buf->data.ptr + m_cursor_index;
+    m_cursor_index += static_cast<size_t>(token_len);
 
-        case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
-          if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
-            ret_error_message = callbacks.Push(static_cast<uint32_t>(vbd));
-            if (!ret_error_message.empty()) {
-              goto done;
-            }
-            depth++;
-            if (depth > (int32_t)WUFFS_CBOR__DECODER_DEPTH_MAX_INCL) {
-              ret_error_message =
-                  "wuffs_aux::DecodeCbor: internal error: bad depth";
+    // 2. Process that token.
+
+    uint64_t vbd = token.value_base_detail();
+
+    if (m_extension_category != 0) {
+      int64_t ext = token.value_extension();
+      if ((ext >= 0) && !token.continued()) {
+        m_extension_detail =
+            (m_extension_detail
+             << WUFFS_BASE__TOKEN__VALUE_EXTENSION__NUM_BITS) |
+            static_cast<uint64_t>(ext);
+        switch (m_extension_category) {
+          case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED:
+            m_extension_category = 0;
+            m_ret_error_message =
+                m_callbacks.AppendI64(static_cast<int64_t>(m_extension_detail));
+            goto parsed_a_value;
+          case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED:
+            m_extension_category = 0;
+            m_ret_error_message = m_callbacks.AppendU64(m_extension_detail);
+            goto parsed_a_value;
+          case EXT_CAT__CBOR_TAG:
+            m_extension_category = 0;
+            m_ret_error_message = m_callbacks.AppendCborTag(m_extension_detail);
+            if (!m_ret_error_message.empty()) {
               goto done;
             }
             continue;
+        }
+      }
+      m_ret_error_message =
+          "wuffs_aux::DecodeCbor: internal error: bad extended token";
+      goto done;
+    }
+
+    switch (token.value_base_category()) {
+      case WUFFS_BASE__TOKEN__VBC__FILLER:
+        continue;
+
+      case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
+          m_ret_error_message = m_callbacks.Push(static_cast<uint32_t>(vbd));
+          if (!m_ret_error_message.empty()) {
+            goto done;
           }
-          ret_error_message = callbacks.Pop(static_cast<uint32_t>(vbd));
-          depth--;
-          if (depth < 0) {
-            ret_error_message =
+          m_depth++;
+          if (m_depth > (int32_t)WUFFS_CBOR__DECODER_DEPTH_MAX_INCL) {
+            m_ret_error_message =
                 "wuffs_aux::DecodeCbor: internal error: bad depth";
             goto done;
           }
-          goto parsed_a_value;
+          continue;
         }
+        m_ret_error_message = m_callbacks.Pop(static_cast<uint32_t>(vbd));
+        m_depth--;
+        if (m_depth < 0) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeCbor: internal error: bad depth";
+          goto done;
+        }
+        goto parsed_a_value;
+      }
 
-        case WUFFS_BASE__TOKEN__VBC__STRING: {
-          if (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP) {
+      case WUFFS_BASE__TOKEN__VBC__STRING: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP) {
+          if (token_len == 0) {
             // No-op.
-          } else if (vbd &
-                     WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
+          } else if (!m_in_string) {
+            // The head of a definite-length or indefinite-length string.
+            m_in_string = true;
+            m_string_flags =
+                (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CHAIN_MUST_BE_UTF_8)
+                    ? DecodeCborCallbacks::STRING_FLAG_TEXT
+                    : 0;
+            uint64_t length = 0;
+            if ((token_ptr[0] & 0x1F) == 0x1F) {
+              m_string_flags |=
+                  DecodeCborCallbacks::STRING_FLAG_INDEFINITE_LENGTH;
+            } else {
+              length = DecodeCbor_DefiniteLength(token_ptr, token_len);
+            }
+            if (m_borrows_strings) {
+              m_ret_error_message =
+                  m_callbacks.BeginString(m_string_flags, length);
+              if (!m_ret_error_message.empty()) {
+                goto done;
+              }
+            } else if (length > 0) {
+              // Don't trust the CBOR length further than the input we know
+              // about (if that's all there is) or a 16 MiB sanity limit.
+              uint64_t n = m_io_buf->meta.closed
+                               ? (m_io_buf->meta.wi - m_cursor_index)
+                               : 0x1000000;
+              m_str->reserve(
+                  static_cast<size_t>(wuffs_base__u64__min(length, n)));
+            }
+          } else if (token.continued()) {
+            // The head of an indefinite-length string's chunk.
+            m_slice_flags = DecodeCborCallbacks::STRING_FLAG_CHUNK_BEGIN;
+          }
+        } else if (vbd &
+                   WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
+          if (m_borrows_strings) {
+            m_ret_error_message = m_callbacks.AppendStringSlice(
+                m_slice_flags, token_ptr, static_cast<size_t>(token_len));
+            m_slice_flags = 0;
+            if (!m_ret_error_message.empty()) {
+              goto done;
+            }
+          } else {
             const char* ptr =  // Convert from (uint8_t*).
                 static_cast<const char*>(static_cast<void*>(token_ptr));
-            str.append(ptr, static_cast<size_t>(token_len));
-          } else {
-            goto fail;
+            m_str->append(ptr, static_cast<size_t>(token_len));
           }
-          if (token.continued()) {
-            continue;
-          }
-          ret_error_message =
-              (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CHAIN_MUST_BE_UTF_8)
-                  ? callbacks.AppendTextString(std::move(str))
-                  : callbacks.AppendByteString(std::move(str));
-          str.clear();
-          goto parsed_a_value;
+        } else {
+          goto fail;
+        }
+        if (token.continued()) {
+          continue;
+        }
+        m_in_string = false;
+        m_slice_flags = 0;
+        if (m_borrows_strings) {
+          m_ret_error_message = m_callbacks.EndString(m_string_flags);
+        } else {
+          m_ret_error_message =
+              (m_string_flags & DecodeCborCallbacks::STRING_FLAG_TEXT)
+                  ? m_callbacks.AppendTextString(std::move(*m_str))
+                  : m_callbacks.AppendByteString(std::move(*m_str));
+          m_str->clear();
         }
+        goto parsed_a_value;
+      }
 
-        case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
-          uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
-          size_t n = wuffs_base__utf_8__encode(
-              wuffs_base__make_slice_u8(
-                  &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
-              static_cast<uint32_t>(vbd));
+      case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
+        uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
+        size_t n = wuffs_base__utf_8__encode(
+            wuffs_base__make_slice_u8(
+                &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
+            static_cast<uint32_t>(vbd));
+        if (m_borrows_strings) {
+          m_ret_error_message =
+              m_callbacks.AppendStringSlice(m_slice_flags, &u[0], n);
+          m_slice_flags = 0;
+          if (!m_ret_error_message.empty()) {
+            goto done;
+          }
+        } else {
           const char* ptr =  // Convert from (uint8_t*).
               static_cast<const char*>(static_cast<void*>(&u[0]));
-          str.append(ptr, n);
-          if (token.continued()) {
-            continue;
-          }
-          goto fail;
+          m_str->append(ptr, n);
         }
-
-        case WUFFS_BASE__TOKEN__VBC__LITERAL: {
-          if (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL) {
-            ret_error_message = callbacks.AppendNull();
-          } else if (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__UNDEFINED) {
-            ret_error_message = callbacks.AppendUndefined();
-          } else {
-            ret_error_message = callbacks.AppendBool(
-                vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
-          }
-          goto parsed_a_value;
+        if (token.continued()) {
+          continue;
         }
+        goto fail;
+      }
 
-        case WUFFS_BASE__TOKEN__VBC__NUMBER: {
-          const uint64_t cfp_fbbe_fifb =
-              WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_FLOATING_POINT |
-              WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_BINARY_BIG_ENDIAN |
-              WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_IGNORE_FIRST_BYTE;
-          if ((vbd & cfp_fbbe_fifb) == cfp_fbbe_fifb) {
-            double f;
-            switch (token_len) {
-              case 3:
-                f = wuffs_base__ieee_754_bit_representation__from_u16_to_f64(
-                    wuffs_base__peek_u16be__no_bounds_check(token_ptr + 1));
-                break;
-              case 5:
-                f = wuffs_base__ieee_754_bit_representation__from_u32_to_f64(
-                    wuffs_base__peek_u32be__no_bounds_check(token_ptr + 1));
-                break;
-              case 9:
-                f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
-                    wuffs_base__peek_u64be__no_bounds_check(token_ptr + 1));
-                break;
-              default:
-                goto fail;
-            }
-            ret_error_message = callbacks.AppendF64(f);
-            goto parsed_a_value;
-          }
-          goto fail;
+      case WUFFS_BASE__TOKEN__VBC__LITERAL: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL) {
+          m_ret_error_message = m_callbacks.AppendNull();
+        } else if (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__UNDEFINED) {
+          m_ret_error_message = m_callbacks.AppendUndefined();
+        } else {
+          m_ret_error_message = m_callbacks.AppendBool(
+              vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
         }
+        goto parsed_a_value;
+      }
 
-        case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED: {
-          if (token.continued()) {
-            extension_category = WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED;
-            extension_detail =
-                static_cast<uint64_t>(token.value_base_detail__sign_extended());
-            continue;
+      case WUFFS_BASE__TOKEN__VBC__NUMBER: {
+        const uint64_t cfp_fbbe_fifb =
+            WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_FLOATING_POINT |
+            WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_BINARY_BIG_ENDIAN |
+            WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_IGNORE_FIRST_BYTE;
+        if ((vbd & cfp_fbbe_fifb) == cfp_fbbe_fifb) {
+          double f;
+          switch (token_len) {
+            case 3:
+              f = wuffs_base__ieee_754_bit_representation__from_u16_to_f64(
+                  wuffs_base__peek_u16be__no_bounds_check(token_ptr + 1));
+              break;
+            case 5:
+              f = wuffs_base__ieee_754_bit_representation__from_u32_to_f64(
+                  wuffs_base__peek_u32be__no_bounds_check(token_ptr + 1));
+              break;
+            case 9:
+              f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                  wuffs_base__peek_u64be__no_bounds_check(token_ptr + 1));
+              break;
+            default:
+              goto fail;
           }
-          ret_error_message =
-              callbacks.AppendI64(token.value_base_detail__sign_extended());
+          m_ret_error_message = m_callbacks.AppendF64(f);
           goto parsed_a_value;
         }
+        goto fail;
+      }
 
-        case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED: {
-          if (token.continued()) {
-            extension_category =
-                WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED;
-            extension_detail = vbd;
-            continue;
-          }
-          ret_error_message = callbacks.AppendU64(vbd);
-          goto parsed_a_value;
+      case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED: {
+        if (token.continued()) {
+          m_extension_category = WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED;
+          m_extension_detail =
+              static_cast<uint64_t>(token.value_base_detail__sign_extended());
+          continue;
         }
+        m_ret_error_message =
+            m_callbacks.AppendI64(token.value_base_detail__sign_extended());
+        goto parsed_a_value;
       }
 
-      if (token.value_major() == WUFFS_CBOR__TOKEN_VALUE_MAJOR) {
-        uint64_t value_minor = token.value_minor();
-        if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__MINUS_1_MINUS_X) {
-          if (token_len == 9) {
-            ret_error_message = callbacks.AppendMinus1MinusX(
-                wuffs_base__peek_u64be__no_bounds_check(token_ptr + 1));
-            goto parsed_a_value;
-          }
-        } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__SIMPLE_VALUE) {
-          ret_error_message =
-              callbacks.AppendCborSimpleValue(static_cast<uint8_t>(
-                  value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK));
+      case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED: {
+        if (token.continued()) {
+          m_extension_category =
+              WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED;
+          m_extension_detail = vbd;
+          continue;
+        }
+        m_ret_error_message = m_callbacks.AppendU64(vbd);
+        goto parsed_a_value;
+      }
+    }
+
+    if (token.value_major() == WUFFS_CBOR__TOKEN_VALUE_MAJOR) {
+      uint64_t value_minor = token.value_minor();
+      if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__MINUS_1_MINUS_X) {
+        if (token_len == 9) {
+          m_ret_error_message = m_callbacks.AppendMinus1MinusX(
+              wuffs_base__peek_u64be__no_bounds_check(token_ptr + 1));
           goto parsed_a_value;
-        } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__TAG) {
-          if (token.continued()) {
-            extension_category = EXT_CAT__CBOR_TAG;
-            extension_detail =
-                value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK;
-            continue;
-          }
-          ret_error_message = callbacks.AppendCborTag(
-              value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK);
-          if (!ret_error_message.empty()) {
-            goto done;
-          }
+        }
+      } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__SIMPLE_VALUE) {
+        m_ret_error_message =
+            m_callbacks.AppendCborSimpleValue(static_cast<uint8_t>(
+                value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK));
+        goto parsed_a_value;
+      } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__TAG) {
+        if (token.continued()) {
+          m_extension_category = EXT_CAT__CBOR_TAG;
+          m_extension_detail =
+              value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK;
           continue;
         }
+        m_ret_error_message = m_callbacks.AppendCborTag(
+            value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK);
+        if (!m_ret_error_message.empty()) {
+          goto done;
+        }
+        continue;
       }
+    }
 
-    fail:
-      ret_error_message =
-          "wuffs_aux::DecodeCbor: internal error: unexpected token";
-      goto done;
+  fail:
+    m_ret_error_message =
+        "wuffs_aux::DecodeCbor: internal error: unexpected token";
+    goto done;
 
-    parsed_a_value:
-      if (!ret_error_message.empty() || (depth == 0)) {
-        goto done;
-      }
+  parsed_a_value:
+    if (!m_ret_error_message.empty() || (m_depth == 0)) {
+      goto done;
     }
-  } while (false);
+  }
 
 done:
-  DecodeCborResult result(
-      std::move(ret_error_message),
-      wuffs_base__u64__sat_add(io_buf->meta.pos, cursor_index));
-  callbacks.Done(result, input, *io_buf);
+  return true;
+}
+
+DecodeCborResult  //
+DecodeCborState::Finish() {
+  DecodeCborResult result(m_suspended ? std::string(async_io::NeedMoreInput)
+                                      : std::move(m_ret_error_message),
+                          CursorPosition());
+  m_callbacks.Done(result, m_input, *m_io_buf);
   return result;
 }
 
+uint64_t  //
+DecodeCborState::CursorPosition() const {
+  return wuffs_base__u64__sat_add(m_io_buf->meta.pos, m_cursor_index);
+}
+
+}  // namespace private_impl
+
+DecodeCborResult  //
+DecodeCbor(DecodeCborCallbacks& callbacks,
+           sync_io::Input& input,
+           DecodeCborArgQuirks quirks,
+           DecodeCborArgStringBuffer string_buffer) {
+  private_impl::DecodeCborState state(callbacks, input, quirks, string_buffer);
+  state.Resume();
+  return state.Finish();
+}
+
+DecodeCborAsync::DecodeCborAsync(DecodeCborCallbacks& callbacks,
+                                 async_io::Input& input,
+                                 DecodeCborArgQuirks quirks,
+                                 DecodeCborArgStringBuffer string_buffer)
+    : m_state(new private_impl::DecodeCborState(callbacks,
+                                                input,
+                                                quirks,
+                                                string_buffer)),
+      m_done(false) {}
+
+DecodeCborAsync::~DecodeCborAsync() {}
+
+DecodeCborResult  //
+DecodeCborAsync::Resume() {
+  if (m_done) {
+    return DecodeCborResult(async_io::AlreadyDone, m_state->CursorPosition());
+  } else if (!m_state->Resume()) {
+    return DecodeCborResult(async_io::NeedMoreInput,
+                            m_state->CursorPosition());
+  }
+  m_done = true;
+  return m_state->Finish();
+}
+
+// --------
+
+CborWriterArgBuffer::CborWriterArgBuffer(wuffs_base__slice_u8 repr0)
+    : repr(repr0) {}
+
+CborWriterArgBuffer  //
+CborWriterArgBuffer::DefaultValue() {
+  return CborWriterArgBuffer(wuffs_base__empty_slice_u8());
+}
+
+CborWriterArgFlags::CborWriterArgFlags(uint64_t repr0) : repr(repr0) {}
+
+CborWriterArgFlags  //
+CborWriterArgFlags::DefaultValue() {
+  return CborWriterArgFlags(0);
+}
+
+#define WUFFS_AUX__CBOR_WRITER__TRY(error_msg) \
+  do {                                         \
+    std::string z = error_msg;                 \
+    if (!z.empty()) {                          \
+      m_error_message = std::move(z);          \
+      return m_error_message;                  \
+    }                                          \
+  } while (false)
+
+CborWriter::CborWriter(sync_io::Output& output,
+                       CborWriterArgBuffer buffer,
+                       CborWriterArgFlags flags)
+    : m_levels(new Level[WUFFS_CBOR__DECODER_DEPTH_MAX_INCL]),
+      m_output(output),
+      m_own_io_buf(wuffs_base__empty_io_buffer()),
+      m_io_buf(output.BringsItsOwnIOBuffer()),
+      m_mem_owner(nullptr, &free),
+      m_flags(flags.repr),
+      m_depth(0),
+      m_tagged(false),
+      m_string_flags(0),
+      m_string_remaining(0),
+      m_in_string(false),
+      m_key_depth(0) {
+  if (m_io_buf) {
+    // No-op.
+  } else if (buffer.repr.len > 0) {
+    m_own_io_buf = wuffs_base__ptr_u8__writer(buffer.repr.ptr, buffer.repr.len);
+    m_io_buf = &m_own_io_buf;
+  } else {
+    constexpr size_t n = 32768;
+    void* ptr = malloc(n);
+    if (!ptr) {
+      m_error_message = "wuffs_aux::CborWriter: out of memory";
+      m_io_buf = &m_own_io_buf;
+    } else {
+      m_mem_owner.reset(ptr);
+      m_own_io_buf = wuffs_base__ptr_u8__writer((uint8_t*)ptr, n);
+      m_io_buf = &m_own_io_buf;
+    }
+  }
+}
+
+CborWriter::~CborWriter() {}
+
+std::string  //
+CborWriter::Write(const void* ptr, size_t len) {
+  if (m_key_depth > 0) {
+    m_key.append(static_cast<const char*>(ptr), len);
+  }
+  if (len <= m_io_buf->writer_length()) {
+    memcpy(m_io_buf->writer_pointer(), ptr, len);
+    m_io_buf->meta.wi += len;
+    return "";
+  }
+  return private_impl::WriteToOutput(m_output, *m_io_buf,
+                                     static_cast<const uint8_t*>(ptr), len);
+}
+
+// WriteHead writes a CBOR data item's head: its major type (the high 3 bits of
+// base) and its argument n, in the shortest form.
+std::string  //
+CborWriter::WriteHead(uint8_t base, uint64_t n) {
+  uint8_t c[9];
+  if (n < 0x18) {
+    c[0] = base | static_cast<uint8_t>(n);
+    return Write(&c[0], 1);
+  } else if (n <= 0xFF) {
+    c[0] = base | 0x18;
+    c[1] = static_cast<uint8_t>(n);
+    return Write(&c[0], 2);
+  } else if (n <= 0xFFFF) {
+    c[0] = base | 0x19;
+    wuffs_base__poke_u16be__no_bounds_check(&c[1], static_cast<uint16_t>(n));
+    return Write(&c[0], 3);
+  } else if (n <= 0xFFFFFFFF) {
+    c[0] = base | 0x1A;
+    wuffs_base__poke_u32be__no_bounds_check(&c[1], static_cast<uint32_t>(n));
+    return Write(&c[0], 5);
+  }
+  c[0] = base | 0x1B;
+  wuffs_base__poke_u64be__no_bounds_check(&c[1], n);
+  return Write(&c[0], 9);
+}
+
+// BeginItem is called before writing every item (and every tag). It checks
+// the enclosing container's item count and, for map keys with the CANONICAL
+// flag, starts capturing the key's encoding.
+std::string  //
+CborWriter::BeginItem(bool is_dict) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  } else if (m_in_string) {
+    return "wuffs_aux::CborWriter: unfinished string";
+  } else if (m_depth == 0) {
+    return "";
+  }
+  Level& l = m_levels[m_depth - 1];
+  if (l.count >= l.limit) {
+    return "wuffs_aux::CborWriter: too many items";
+  }
+  if (m_flags & CborWriterArgFlags::CANONICAL) {
+    bool is_key = l.is_dict && !(l.count & 1);
+    if (is_dict && (is_key || (m_key_depth > 0))) {
+      return "wuffs_aux::CborWriter: canonical map keys cannot contain maps";
+    } else if (is_key && (m_key_depth == 0)) {
+      m_key_depth = m_depth;
+      m_key.clear();
+    }
+  }
+  return "";
+}
+
+// EndItem is called after writing every item, including Pop's containers.
+std::string  //
+CborWriter::EndItem() {
+  m_tagged = false;
+  if (m_depth == 0) {
+    return "";
+  }
+  Level& l = m_levels[m_depth - 1];
+  if (m_key_depth == m_depth) {
+    m_key_depth = 0;
+    // Any deeper maps have been popped, so this map's previous key is at the
+    // top of the m_prev_keys stack.
+    const char* prev_ptr = m_prev_keys.data() + l.prev_key_offset;
+    size_t prev_len = m_prev_keys.size() - l.prev_key_offset;
+    if (l.count > 0) {
+      size_t n = (prev_len < m_key.size()) ? prev_len : m_key.size();
+      int c = memcmp(prev_ptr, m_key.data(), n);
+      if ((c > 0) || ((c == 0) && (prev_len >= m_key.size()))) {
+        return "wuffs_aux::CborWriter: map keys are not in canonical order";
+      }
+    }
+    m_prev_keys.resize(l.prev_key_offset);
+    m_prev_keys.append(m_key);
+  }
+  l.count++;
+  return "";
+}
+
+std::string  //
+CborWriter::PushLevel(bool is_dict, uint8_t head, uint64_t limit) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(is_dict));
+  if (m_depth >= WUFFS_CBOR__DECODER_DEPTH_MAX_INCL) {
+    m_error_message = "wuffs_aux::CborWriter: too deep";
+    return m_error_message;
+  }
+  if (limit == UINT64_MAX) {
+    WUFFS_AUX__CBOR_WRITER__TRY(Write(&head, 1));
+  } else {
+    WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(head, is_dict ? (limit / 2) : limit));
+  }
+  Level& l = m_levels[m_depth++];
+  l.count = 0;
+  l.limit = limit;
+  l.prev_key_offset = m_prev_keys.size();
+  l.is_dict = is_dict;
+  m_tagged = false;
+  return "";
+}
+
+std::string  //
+CborWriter::AppendNull() {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(Write("\xF6", 1));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendUndefined() {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(Write("\xF7", 1));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendBool(bool val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(Write(val ? "\xF5" : "\xF4", 1));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendF64(double val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  // Use the shortest of float16, float32 and float64 that preserves the
+  // value. RFC 8949 Section 4.2.2 suggests a single canonical NaN.
+  uint8_t c[9];
+  size_t n = 9;
+  wuffs_base__lossy_value_u16 lv16 =
+      wuffs_base__ieee_754_bit_representation__from_f64_to_u16_truncate(val);
+  if ((val != val) && (m_flags & CborWriterArgFlags::CANONICAL)) {
+    c[0] = 0xF9;
+    c[1] = 0x7E;
+    c[2] = 0x00;
+    n = 3;
+  } else if (!lv16.lossy) {
+    c[0] = 0xF9;
+    wuffs_base__poke_u16be__no_bounds_check(&c[1], lv16.value);
+    n = 3;
+  } else {
+    wuffs_base__lossy_value_u32 lv32 =
+        wuffs_base__ieee_754_bit_representation__from_f64_to_u32_truncate(val);
+    if (!lv32.lossy) {
+      c[0] = 0xFA;
+      wuffs_base__poke_u32be__no_bounds_check(&c[1], lv32.value);
+      n = 5;
+    } else {
+      c[0] = 0xFB;
+      wuffs_base__poke_u64be__no_bounds_check(
+          &c[1], wuffs_base__ieee_754_bit_representation__from_f64_to_u64(val));
+    }
+  }
+  WUFFS_AUX__CBOR_WRITER__TRY(Write(&c[0], n));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendI64(int64_t val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(
+      (val >= 0) ? WriteHead(0x00, static_cast<uint64_t>(val))
+                 : WriteHead(0x20, static_cast<uint64_t>(-(val + 1))));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendU64(uint64_t val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(0x00, val));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendByteString(std::string&& val) {
+  return AppendByteString(
+      static_cast<const uint8_t*>(static_cast<const void*>(val.data())),
+      val.size());
+}
+
+std::string  //
+CborWriter::AppendByteString(const uint8_t* ptr, size_t len) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(0x40, len));
+  WUFFS_AUX__CBOR_WRITER__TRY(Write(ptr, len));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendTextString(std::string&& val) {
+  return AppendTextString(val.data(), val.size());
+}
+
+std::string  //
+CborWriter::AppendTextString(const char* ptr, size_t len) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(0x60, len));
+  WUFFS_AUX__CBOR_WRITER__TRY(Write(ptr, len));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendMinus1MinusX(uint64_t val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(0x20, val));
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendCborSimpleValue(uint8_t val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  if (val < 0x18) {
+    uint8_t c = 0xE0 | val;
+    WUFFS_AUX__CBOR_WRITER__TRY(Write(&c, 1));
+  } else if (val < 0x20) {
+    m_error_message = "wuffs_aux::CborWriter: invalid simple value";
+    return m_error_message;
+  } else {
+    uint8_t c[2] = {0xF8, val};
+    WUFFS_AUX__CBOR_WRITER__TRY(Write(&c[0], 2));
+  }
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::AppendCborTag(uint64_t val) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(0xC0, val));
+  m_tagged = true;
+  return "";
+}
+
+bool  //
+CborWriter::BorrowsStrings() {
+  return true;
+}
+
+std::string  //
+CborWriter::BeginString(uint32_t flags, uint64_t length) {
+  WUFFS_AUX__CBOR_WRITER__TRY(BeginItem(false));
+  uint8_t base = (flags & STRING_FLAG_TEXT) ? 0x60 : 0x40;
+  if (!(flags & STRING_FLAG_INDEFINITE_LENGTH)) {
+    WUFFS_AUX__CBOR_WRITER__TRY(WriteHead(base, length));
+    m_string_remaining = length;
+  } else if (m_flags & CborWriterArgFlags::CANONICAL) {
+    m_error_message =
+        "wuffs_aux::CborWriter: indefinite length isn't canonical";
+    return m_error_message;
+  } else {
+    uint8_t c = base | 0x1F;
+    WUFFS_AUX__CBOR_WRITER__TRY(Write(&c, 1));
+  }
+  m_string_flags = flags;
+  m_in_string = true;
+  return "";
+}
+
+std::string  //
+CborWriter::AppendStringSlice(uint32_t flags,
+                              const uint8_t* ptr,
+                              size_t len) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  } else if (!m_in_string) {
+    m_error_message = "wuffs_aux::CborWriter: no unfinished string";
+    return m_error_message;
+  }
+  if (m_string_flags & STRING_FLAG_INDEFINITE_LENGTH) {
+    if (len == 0) {
+      return "";
+    }
+    WUFFS_AUX__CBOR_WRITER__TRY(
+        WriteHead((m_string_flags & STRING_FLAG_TEXT) ? 0x60 : 0x40, len));
+  } else if (len > m_string_remaining) {
+    m_error_message = "wuffs_aux::CborWriter: string is longer than its length";
+    return m_error_message;
+  } else {
+    m_string_remaining -= len;
+  }
+  WUFFS_AUX__CBOR_WRITER__TRY(Write(ptr, len));
+  return "";
+}
+
+std::string  //
+CborWriter::EndString(uint32_t flags) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  } else if (!m_in_string) {
+    m_error_message = "wuffs_aux::CborWriter: no unfinished string";
+    return m_error_message;
+  }
+  if (m_string_flags & STRING_FLAG_INDEFINITE_LENGTH) {
+    WUFFS_AUX__CBOR_WRITER__TRY(Write("\xFF", 1));
+  } else if (m_string_remaining > 0) {
+    m_error_message =
+        "wuffs_aux::CborWriter: string is shorter than its length";
+    return m_error_message;
+  }
+  m_in_string = false;
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::PushList(uint64_t num_elements) {
+  if (num_elements == UINT64_MAX) {
+    m_error_message = "wuffs_aux::CborWriter: too many items";
+    return m_error_message;
+  }
+  return PushLevel(false, 0x80, num_elements);
+}
+
+std::string  //
+CborWriter::PushDict(uint64_t num_pairs) {
+  if (num_pairs > (UINT64_MAX / 2)) {
+    m_error_message = "wuffs_aux::CborWriter: too many items";
+    return m_error_message;
+  }
+  return PushLevel(true, 0xA0, 2 * num_pairs);
+}
+
+std::string  //
+CborWriter::Push(uint32_t flags) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  bool to_dict;
+  if (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) {
+    to_dict = false;
+  } else if (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_DICT) {
+    to_dict = true;
+  } else {
+    m_error_message = "wuffs_aux::CborWriter: invalid Push flags";
+    return m_error_message;
+  }
+  if (m_flags & CborWriterArgFlags::CANONICAL) {
+    m_error_message =
+        "wuffs_aux::CborWriter: indefinite length isn't canonical";
+    return m_error_message;
+  }
+  return PushLevel(to_dict, to_dict ? 0xBF : 0x9F, UINT64_MAX);
+}
+
+std::string  //
+CborWriter::Pop(uint32_t flags) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  } else if (m_in_string) {
+    m_error_message = "wuffs_aux::CborWriter: unfinished string";
+    return m_error_message;
+  } else if (m_depth == 0) {
+    m_error_message = "wuffs_aux::CborWriter: unbalanced Pop";
+    return m_error_message;
+  } else if (m_tagged) {
+    m_error_message = "wuffs_aux::CborWriter: missing tagged item";
+    return m_error_message;
+  }
+
+  Level& l = m_levels[m_depth - 1];
+  if (l.limit == UINT64_MAX) {
+    if (l.is_dict && (l.count & 1)) {
+      m_error_message = "wuffs_aux::CborWriter: missing map value";
+      return m_error_message;
+    }
+    WUFFS_AUX__CBOR_WRITER__TRY(Write("\xFF", 1));
+  } else if (l.count != l.limit) {
+    m_error_message = "wuffs_aux::CborWriter: too few items";
+    return m_error_message;
+  }
+  m_prev_keys.resize(l.prev_key_offset);
+  m_depth--;
+  WUFFS_AUX__CBOR_WRITER__TRY(EndItem());
+  return "";
+}
+
+std::string  //
+CborWriter::Flush() {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__CBOR_WRITER__TRY(m_output.CopyOut(m_io_buf));
+  return "";
+}
+
+uint32_t  //
+CborWriter::Depth() const {
+  return m_depth;
+}
+
+#undef WUFFS_AUX__CBOR_WRITER__TRY
+
 }  // namespace wuffs_aux
 
 #endif  // !defined(WUFFS_CONFIG__MODULES) ||
@@ -37,6 +37,42 @@ class DecodeCborCallbacks {
   virtual std::string AppendCborSimpleValue(uint8_t val) = 0;
   virtual std::string AppendCborTag(uint64_t val) = 0;
 
+  // BorrowsStrings, BeginString, AppendStringSlice and EndString are an
+  // alternative to AppendByteString and AppendTextString that avoids copying
+  // string contents into a std::string. If BorrowsStrings returns true then
+  // DecodeCbor calls those three methods (in that order) for each byte string
+  // or text string, and never calls AppendByteString or AppendTextString.
+  //
+  // A single CBOR string may be passed as zero, one or more slices. The ptr
+  // and len arguments to AppendStringSlice borrow from DecodeCbor's I/O
+  // buffer (or, rarely, from a temporary) and are only valid for the duration
+  // of that call. Slices never split a text string's UTF-8 code point.
+  //
+  // BeginString's length is the string's total length in bytes, for
+  // definite-length strings, or zero for indefinite-length strings. An
+  // AppendStringSlice call with the STRING_FLAG_CHUNK_BEGIN bit set begins
+  // each chunk of an indefinite-length string.
+  //
+  // EndString completes the leaf node, like AppendByteString or
+  // AppendTextString would have. Its flags equal BeginString's flags.
+  //
+  // The default BorrowsStrings implementation returns false. The default
+  // BeginString, AppendStringSlice and EndString implementations are no-ops.
+
+  // The string is a text (UTF-8) string, not a byte string.
+  static constexpr uint32_t STRING_FLAG_TEXT = 0x0001;
+  // The string has indefinite length, made up of zero or more chunks.
+  static constexpr uint32_t STRING_FLAG_INDEFINITE_LENGTH = 0x0002;
+  // The slice is the first slice of a chunk of an indefinite-length string.
+  static constexpr uint32_t STRING_FLAG_CHUNK_BEGIN = 0x0004;
+
+  virtual bool BorrowsStrings();
+  virtual std::string BeginString(uint32_t flags, uint64_t length);
+  virtual std::string AppendStringSlice(uint32_t flags,
+                                        const uint8_t* ptr,
+                                        size_t len);
+  virtual std::string EndString(uint32_t flags);
+
   // Push and Pop are called for container nodes: CBOR arrays (lists) and CBOR
   // maps (dictionaries).
   //
@@ -85,6 +121,30 @@ struct DecodeCborArgQuirks {
   const size_t len;
 };
 
+// DecodeCborArgStringBuffer wraps an optional argument to DecodeCbor.
+//
+// A non-nullptr repr is a caller-owned buffer that DecodeCbor accumulates
+// each byte string or text string into, instead of a DecodeCbor-owned
+// std::string. It is cleared (but its capacity is retained) before each
+// string, and passed (as a std::string&&) to AppendByteString or
+// AppendTextString. Those callbacks may take ownership of its contents by
+// moving from it or leave it be, so that its capacity can be re-used by the
+// next string (or the next DecodeCbor call) without re-allocating.
+//
+// Whether or not repr is nullptr, DecodeCbor reserves a definite-length
+// string's full length up front (subject to some sanity limits), so that
+// large strings are not copied again as the buffer grows.
+//
+// This argument is ignored if the callbacks' BorrowsStrings returns true.
+struct DecodeCborArgStringBuffer {
+  explicit DecodeCborArgStringBuffer(std::string* repr0);
+
+  // DefaultValue returns nullptr.
+  static DecodeCborArgStringBuffer DefaultValue();
+
+  std::string* repr;
+};
+
 // DecodeCbor calls callbacks based on the CBOR-formatted data in input.
 //
 // On success, the returned error_message is empty and cursor_position counts
@@ -94,6 +154,206 @@ struct DecodeCborArgQuirks {
 DecodeCborResult  //
 DecodeCbor(DecodeCborCallbacks& callbacks,
            sync_io::Input& input,
-           DecodeCborArgQuirks quirks = DecodeCborArgQuirks::DefaultValue());
+           DecodeCborArgQuirks quirks = DecodeCborArgQuirks::DefaultValue(),
+           DecodeCborArgStringBuffer string_buffer =
+               DecodeCborArgStringBuffer::DefaultValue());
+
+namespace private_impl {
+class DecodeCborState;
+}  // namespace private_impl
+
+// DecodeCborAsync is like DecodeCbor but it does not block waiting for input.
+// Instead, each Resume call decodes as much as it can of the bytes that have
+// arrived so far and, if it needs more, returns a result whose error_message
+// is async_io::NeedMoreInput. Call Resume again after writing more bytes to
+// the input (or closing it). Callbacks are never called twice for the same
+// CBOR item: decoding picks up where it left off.
+//
+// Once Resume returns any other result (a final one, after which callbacks'
+// Done method has been called), subsequent Resume calls return
+// async_io::AlreadyDone.
+//
+// The callbacks, input and string_buffer (if non-nullptr) must outlive the
+// DecodeCborAsync. The quirks are applied by the constructor and need not.
+class DecodeCborAsync {
+ public:
+  DecodeCborAsync(DecodeCborCallbacks& callbacks,
+                  async_io::Input& input,
+                  DecodeCborArgQuirks quirks =
+                      DecodeCborArgQuirks::DefaultValue(),
+                  DecodeCborArgStringBuffer string_buffer =
+                      DecodeCborArgStringBuffer::DefaultValue());
+  ~DecodeCborAsync();
+
+  DecodeCborResult Resume();
+
+ private:
+  std::unique_ptr<private_impl::DecodeCborState> m_state;
+  bool m_done;
+
+  // Delete the copy and assign constructors.
+  DecodeCborAsync(const DecodeCborAsync&) = delete;
+  DecodeCborAsync& operator=(const DecodeCborAsync&) = delete;
+};
+
+// --------
+
+// CborWriterArgBuffer wraps an optional argument to CborWriter.
+struct CborWriterArgBuffer {
+  explicit CborWriterArgBuffer(wuffs_base__slice_u8 repr0);
+
+  // DefaultValue returns an empty slice.
+  static CborWriterArgBuffer DefaultValue();
+
+  wuffs_base__slice_u8 repr;
+};
+
+// CborWriterArgFlags wraps an optional argument to CborWriter.
+struct CborWriterArgFlags {
+  explicit CborWriterArgFlags(uint64_t repr0);
+
+  // DefaultValue returns 0.
+  static CborWriterArgFlags DefaultValue();
+
+  // CANONICAL means to enforce RFC 8949 Section 4.2.1 "Core Deterministic
+  // Encoding Requirements". CborWriter always uses the shortest form for
+  // integers, lengths and (value-preserving) floating point numbers. With
+  // this flag, it also:
+  //  - rejects indefinite-length items: the Push method and BeginString
+  //    with the STRING_FLAG_INDEFINITE_LENGTH bit set.
+  //  - rejects map keys that are not in strictly increasing bytewise
+  //    lexicographic order of their encodings (including duplicates).
+  //  - rejects map keys that contain maps, as it only tracks the order of
+  //    one map key at a time.
+  //  - writes every NaN as the half-precision 0xF9 0x7E 0x00.
+  //
+  // Sorting map keys would require buffering the map, so that is left to
+  // the caller. CborWriter only checks the order. For the same reason, this
+  // flag cannot be used when CborWriter is a DecodeCbor callback (see the
+  // CborWriter comment).
+  static constexpr uint64_t CANONICAL = 0x0001;
+
+  uint64_t repr;
+};
+
+// CborWriter writes CBOR-formatted data to output. It is a
+// DecodeCborCallbacks, so that passing one to DecodeCbor re-encodes CBOR, but
+// it can also be driven directly. When re-encoding, numbers are written in
+// their shortest form and strings keep their definite or indefinite length
+// (and chunks), but arrays and maps are always written with indefinite
+// length, as DecodeCbor reports them via Push without their element count.
+// This means that a CborWriter with the CANONICAL flag cannot be passed to
+// DecodeCbor, unless the input has no arrays or maps.
+//
+// Arrays (lists) and maps (dictionaries) are written with definite length by
+// PushList and PushDict, whose arguments are the number of elements and the
+// number of key-value pairs. They are written with indefinite length by Push,
+// whose flags should contain WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST or
+// WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_DICT. Either way, Pop closes the
+// innermost container and its flags are ignored. Within a map, every
+// even-numbered item is a key. AppendCborTag applies to the next item.
+//
+// Large strings can be written without first gathering them into one
+// contiguous buffer: BeginString, any number of AppendStringSlice calls and
+// then EndString. A definite-length string's slices' lengths must sum to
+// BeginString's length. Each slice of an indefinite-length string is written
+// as one chunk. No other methods may be called in between. CborWriter
+// BorrowsStrings, so DecodeCbor also passes strings that way.
+//
+// buffer is the intermediate buffer that is drained to output when full. If
+// empty, the CborWriter allocates its own. buffer is ignored if output
+// BringsItsOwnIOBuffer, as CborWriter then writes directly to output's buffer.
+// Other than that buffer (and, with the CANONICAL flag, some std::string
+// capacity for map keys), writing does not allocate memory.
+//
+// Multiple top-level items are written back to back, as a CBOR Sequence (RFC
+// 8742). Call Flush after the final AppendXxx, EndString or Pop call. Error
+// messages are sticky: once one call fails, all subsequent calls will fail.
+class CborWriter : public DecodeCborCallbacks {
+ public:
+  explicit CborWriter(
+      sync_io::Output& output,
+      CborWriterArgBuffer buffer = CborWriterArgBuffer::DefaultValue(),
+      CborWriterArgFlags flags = CborWriterArgFlags::DefaultValue());
+  ~CborWriter() override;
+
+  std::string AppendNull() override;
+  std::string AppendUndefined() override;
+  std::string AppendBool(bool val) override;
+  std::string AppendF64(double val) override;
+  std::string AppendI64(int64_t val) override;
+  std::string AppendU64(uint64_t val) override;
+  std::string AppendByteString(std::string&& val) override;
+  std::string AppendByteString(const uint8_t* ptr, size_t len);
+  std::string AppendTextString(std::string&& val) override;
+  std::string AppendTextString(const char* ptr, size_t len);
+  std::string AppendMinus1MinusX(uint64_t val) override;
+  std::string AppendCborSimpleValue(uint8_t val) override;
+  std::string AppendCborTag(uint64_t val) override;
+
+  bool BorrowsStrings() override;
+  std::string BeginString(uint32_t flags, uint64_t length) override;
+  std::string AppendStringSlice(uint32_t flags,
+                                const uint8_t* ptr,
+                                size_t len) override;
+  std::string EndString(uint32_t flags) override;
+
+  std::string PushList(uint64_t num_elements);
+  std::string PushDict(uint64_t num_pairs);
+  std::string Push(uint32_t flags) override;
+  std::string Pop(uint32_t flags) override;
+
+  // Flush copies out any buffered bytes.
+  std::string Flush();
+
+  // Depth returns the number of unclosed containers.
+  uint32_t Depth() const;
+
+ private:
+  struct Level {
+    // count is the number of items (keys and values) written so far. limit is
+    // the definite number of items, or UINT64_MAX for indefinite length.
+    uint64_t count;
+    uint64_t limit;
+    // prev_key_offset is where, in m_prev_keys, this map's previous key
+    // starts. It is only used with the CANONICAL flag.
+    size_t prev_key_offset;
+    bool is_dict;
+  };
+
+  std::string BeginItem(bool is_dict);
+  std::string EndItem();
+  std::string PushLevel(bool is_dict, uint8_t head, uint64_t limit);
+  std::string WriteHead(uint8_t base, uint64_t n);
+  std::string Write(const void* ptr, size_t len);
+
+  std::unique_ptr<Level[]> m_levels;
+
+  sync_io::Output& m_output;
+  IOBuffer m_own_io_buf;
+  IOBuffer* m_io_buf;
+  MemOwner m_mem_owner;
+
+  uint64_t m_flags;
+  uint32_t m_depth;
+  bool m_tagged;
+
+  uint32_t m_string_flags;
+  uint64_t m_string_remaining;
+  bool m_in_string;
+
+  // m_key_depth is non-zero while capturing (into m_key) the encoding of a
+  // map key at that depth, with the CANONICAL flag. m_prev_keys is a stack of
+  // previous keys, one for each open map.
+  uint32_t m_key_depth;
+  std::string m_key;
+  std::string m_prev_keys;
+
+  std::string m_error_message;
+
+  // Delete the copy and assign constructors.
+  CborWriter(const CborWriter&) = delete;
+  CborWriter& operator=(const CborWriter&) = delete;
+};
 
 }  // namespace wuffs_aux
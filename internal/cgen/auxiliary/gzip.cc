@@ -0,0 +1,663 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Gzip
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__GZIP)
+
+#include <algorithm>
+#include <utility>
+
+namespace wuffs_aux {
+
+// The index design follows zlib's examples/zran.c: record each checkpoint's
+// bit position in the compressed file and the 32 KiB of decompressed history
+// that DEFLATE back-references can reach. The std/deflate decoder's
+// QUIRK_NOTE_BLOCK_BOUNDARIES and QUIRK_SKIP_LEADING_BITS do the rest.
+
+namespace {
+
+const char GzipIndex_BadChecksum[] =  //
+    "wuffs_aux::GzipIndex: bad checksum";
+const char GzipIndex_BadGzipHeader[] =  //
+    "wuffs_aux::GzipIndex: bad gzip header";
+const char GzipIndex_BadIndex[] =  //
+    "wuffs_aux::GzipIndex: bad index";
+const char GzipIndex_GzipHeaderIsTooLong[] =  //
+    "wuffs_aux::GzipIndex: gzip header is too long";
+const char GzipIndex_OutOfMemory[] =  //
+    "wuffs_aux::GzipIndex: out of memory";
+const char GzipIndex_TrailingGarbage[] =  //
+    "wuffs_aux::GzipIndex: trailing garbage";
+const char GzipIndex_TruncatedInput[] =  //
+    "wuffs_aux::GzipIndex: truncated input";
+
+const char GzipReader_BadGzipHeader[] =  //
+    "wuffs_aux::GzipReader: bad gzip header";
+const char GzipReader_IndexDoesNotMatchFile[] =  //
+    "wuffs_aux::GzipReader: index does not match file";
+const char GzipReader_OutOfMemory[] =  //
+    "wuffs_aux::GzipReader: out of memory";
+const char GzipReader_TrailingGarbage[] =  //
+    "wuffs_aux::GzipReader: trailing garbage";
+const char GzipReader_TruncatedInput[] =  //
+    "wuffs_aux::GzipReader: truncated input";
+
+constexpr size_t GzipWindowLength = 32768;
+constexpr size_t GzipIOArrayLength = 65536;
+
+constexpr uint32_t GzipIndexMagic = 0x497A4757;  // "WGzI" little-endian.
+constexpr uint32_t GzipIndexVersion = 1;
+constexpr size_t GzipIndexHeaderLength = 32;
+constexpr size_t GzipIndexCheckpointHeaderLength = 18;
+
+// GzipHeaderLength returns the length of the gzip member header (RFC 1952
+// section 2.3) at the start of p, 0 if its n bytes are not enough to tell or
+// SIZE_MAX if it is invalid.
+size_t  //
+GzipHeaderLength(const uint8_t* p, size_t n) {
+  if (n < 10) {
+    return 0;
+  } else if ((p[0] != 0x1F) || (p[1] != 0x8B) || (p[2] != 0x08) ||
+             ((p[3] & 0xE0) != 0)) {
+    return SIZE_MAX;
+  }
+  uint8_t flags = p[3];
+  size_t i = 10;
+
+  if (flags & 0x04) {  // FEXTRA.
+    if ((n - i) < 2) {
+      return 0;
+    }
+    size_t xlen = wuffs_base__peek_u16le__no_bounds_check(p + i);
+    i += 2;
+    if ((n - i) < xlen) {
+      return 0;
+    }
+    i += xlen;
+  }
+
+  static const uint8_t nul_terminated_flags[2] = {
+      0x08,  // FNAME.
+      0x10,  // FCOMMENT.
+  };
+  for (uint8_t f : nul_terminated_flags) {
+    if (flags & f) {
+      const void* nul = memchr(p + i, 0, n - i);
+      if (!nul) {
+        return 0;
+      }
+      i = static_cast<size_t>(static_cast<const uint8_t*>(nul) - p) + 1;
+    }
+  }
+
+  if (flags & 0x02) {  // FHCRC.
+    if ((n - i) < 2) {
+      return 0;
+    }
+    i += 2;
+  }
+  return i;
+}
+
+}  // namespace
+
+GzipCheckpoint::GzipCheckpoint()
+    : d_offset(0), c_offset(0), c_bit_offset(0), window() {}
+
+GzipIndex::GzipIndex()
+    : m_compressed_size(0), m_decompressed_size(0), m_checkpoints() {}
+
+std::string  //
+GzipIndex::Build(sync_io::Input& input, uint64_t span) {
+  m_compressed_size = 0;
+  m_decompressed_size = 0;
+  m_checkpoints.clear();
+
+  wuffs_deflate__decoder::unique_ptr decoder = wuffs_deflate__decoder::alloc();
+  if (!decoder) {
+    return GzipIndex_OutOfMemory;
+  }
+  wuffs_crc32__ieee_hasher hasher;
+
+  IOBuffer* src = input.BringsItsOwnIOBuffer();
+  IOBuffer fallback_src = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_src_array(nullptr);
+  if (!src) {
+    fallback_src_array.reset(new (std::nothrow) uint8_t[GzipIOArrayLength]);
+    if (!fallback_src_array) {
+      return GzipIndex_OutOfMemory;
+    }
+    fallback_src =
+        wuffs_base__ptr_u8__writer(fallback_src_array.get(), GzipIOArrayLength);
+    src = &fallback_src;
+  }
+
+  // dst holds the last (up to) 32 KiB of the current member's decompressed
+  // contents, before its reader position, plus room for more.
+  std::unique_ptr<uint8_t[]> dst_array(new (std::nothrow)
+                                           uint8_t[3 * GzipWindowLength]);
+  if (!dst_array) {
+    return GzipIndex_OutOfMemory;
+  }
+  IOBuffer dst = wuffs_base__ptr_u8__writer(dst_array.get(),
+                                            3 * GzipWindowLength);
+
+  uint8_t workbuf_array[WUFFS_DEFLATE__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE];
+  wuffs_base__slice_u8 workbuf =
+      wuffs_base__make_slice_u8(&workbuf_array[0], sizeof(workbuf_array));
+
+  // fill reads from input until src holds at least n bytes or input ends.
+  auto fill = [&](size_t n) -> std::string {
+    while ((src->reader_length() < n) && !src->meta.closed) {
+      src->compact();
+      if (src->writer_length() == 0) {
+        return GzipIndex_GzipHeaderIsTooLong;
+      }
+      std::string error_message = input.CopyIn(src);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    }
+    return "";
+  };
+
+  std::vector<GzipCheckpoint> checkpoints;
+  uint64_t d_offset = 0;
+
+  // maybe_add_checkpoint adds a checkpoint at the current d_offset and at
+  // the given compressed bit position, if it is far enough past the previous
+  // checkpoint.
+  auto maybe_add_checkpoint = [&](uint64_t c_bit_position,
+                                  uint64_t member_d_offset) {
+    if (!checkpoints.empty() &&
+        ((d_offset <= checkpoints.back().d_offset) ||
+         ((d_offset - checkpoints.back().d_offset) < span))) {
+      return;
+    }
+    size_t window_length = static_cast<size_t>(
+        std::min<uint64_t>(GzipWindowLength, d_offset - member_d_offset));
+    checkpoints.emplace_back();
+    GzipCheckpoint& c = checkpoints.back();
+    c.d_offset = d_offset;
+    c.c_offset = c_bit_position >> 3;
+    c.c_bit_offset = static_cast<uint8_t>(c_bit_position & 7);
+    c.window.assign(dst.writer_pointer() - window_length,
+                    dst.writer_pointer());
+  };
+
+  for (bool first_member = true;; first_member = false) {
+    std::string error_message = fill(1);
+    if (!error_message.empty()) {
+      return error_message;
+    } else if (src->reader_length() == 0) {
+      if (first_member) {
+        return GzipIndex_TruncatedInput;
+      }
+      break;
+    }
+
+    // After the first member, like gzip(1), allow NUL padding (such as from
+    // a tape archive's block size) up to the end of the file. Anything else
+    // that isn't the start of another member is an error.
+    if (!first_member && (src->reader_pointer()[0] != 0x1F)) {
+      while (true) {
+        const uint8_t* p = src->reader_pointer();
+        const uint8_t* q = p + src->reader_length();
+        for (; (p < q) && (*p == 0x00); p++) {
+        }
+        src->meta.ri += static_cast<size_t>(p - src->reader_pointer());
+        if (src->reader_length() > 0) {
+          return GzipIndex_TrailingGarbage;
+        } else if (src->meta.closed) {
+          break;
+        }
+        error_message = fill(1);
+        if (!error_message.empty()) {
+          return error_message;
+        }
+      }
+      break;
+    }
+
+    // Skip the member's header.
+    while (true) {
+      size_t n = GzipHeaderLength(src->reader_pointer(), src->reader_length());
+      if (n == SIZE_MAX) {
+        return GzipIndex_BadGzipHeader;
+      } else if (n > 0) {
+        src->meta.ri += n;
+        break;
+      } else if (src->meta.closed) {
+        return GzipIndex_TruncatedInput;
+      }
+      error_message = fill(src->reader_length() + 1);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    }
+
+    // Decompress the member's DEFLATE data, noting block boundaries.
+    uint64_t member_d_offset = d_offset;
+    dst.meta.ri = 0;
+    dst.meta.wi = 0;
+    dst.meta.pos = 0;
+    maybe_add_checkpoint(8 * src->reader_position(), member_d_offset);
+
+    wuffs_base__status status = decoder->initialize(
+        sizeof__wuffs_deflate__decoder(), WUFFS_VERSION,
+        WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+    if (status.is_ok()) {
+      status =
+          decoder->set_quirk(WUFFS_DEFLATE__QUIRK_NOTE_BLOCK_BOUNDARIES, 1);
+    }
+    if (status.is_ok()) {
+      status = hasher.initialize(
+          sizeof hasher, WUFFS_VERSION,
+          WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+    }
+    if (!status.is_ok()) {
+      return status.message();
+    }
+    uint32_t checksum = 0;
+
+    while (true) {
+      status = decoder->transform_io(&dst, src, workbuf);
+      checksum = hasher.update_u32(dst.reader_slice());
+      d_offset += dst.reader_length();
+      dst.meta.ri = dst.meta.wi;
+
+      if (status.repr == nullptr) {
+        break;
+      } else if (status.repr == wuffs_deflate__note__block_boundary) {
+        maybe_add_checkpoint(
+            (8 * src->reader_position()) - decoder->num_buffered_bits(),
+            member_d_offset);
+      } else if (status.repr == wuffs_base__suspension__short_read) {
+        // Once src is closed, the decoder returns "#truncated input".
+        error_message = fill(src->reader_length() + 1);
+        if (!error_message.empty()) {
+          return error_message;
+        }
+      } else if (status.repr == wuffs_base__suspension__short_write) {
+        dst.compact_retaining(GzipWindowLength);
+      } else {
+        return status.message();
+      }
+    }
+
+    // Check the member's footer: its CRC-32 checksum and ISIZE.
+    error_message = fill(8);
+    if (!error_message.empty()) {
+      return error_message;
+    } else if (src->reader_length() < 8) {
+      return GzipIndex_TruncatedInput;
+    } else if ((checksum != wuffs_base__peek_u32le__no_bounds_check(
+                                src->reader_pointer() + 0)) ||
+               (static_cast<uint32_t>(d_offset - member_d_offset) !=
+                wuffs_base__peek_u32le__no_bounds_check(
+                    src->reader_pointer() + 4))) {
+      return GzipIndex_BadChecksum;
+    }
+    src->meta.ri += 8;
+  }
+
+  m_compressed_size = src->reader_position();
+  m_decompressed_size = d_offset;
+  m_checkpoints = std::move(checkpoints);
+  return "";
+}
+
+std::string  //
+GzipIndex::Load(const uint8_t* ptr, size_t len) {
+  m_compressed_size = 0;
+  m_decompressed_size = 0;
+  m_checkpoints.clear();
+  if (!ptr && (len > 0)) {
+    return "wuffs_aux::GzipIndex: nullptr data";
+  } else if ((len < (GzipIndexHeaderLength + 4)) ||
+             (wuffs_base__peek_u32le__no_bounds_check(ptr) !=
+              GzipIndexMagic)) {
+    return GzipIndex_BadIndex;
+  } else if (wuffs_base__peek_u32le__no_bounds_check(ptr + 4) !=
+             GzipIndexVersion) {
+    return "wuffs_aux::GzipIndex: unsupported index version";
+  }
+
+  wuffs_crc32__ieee_hasher hasher;
+  wuffs_base__status status =
+      hasher.initialize(sizeof hasher, WUFFS_VERSION,
+                        WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  if (!status.is_ok()) {
+    return status.message();
+  }
+  size_t end = len - 4;
+  if (hasher.update_u32(wuffs_base__make_slice_u8(const_cast<uint8_t*>(ptr),
+                                                  end)) !=
+      wuffs_base__peek_u32le__no_bounds_check(ptr + end)) {
+    return GzipIndex_BadChecksum;
+  }
+
+  uint64_t compressed_size = wuffs_base__peek_u64le__no_bounds_check(ptr + 8);
+  uint64_t decompressed_size =
+      wuffs_base__peek_u64le__no_bounds_check(ptr + 16);
+  uint64_t num_checkpoints = wuffs_base__peek_u64le__no_bounds_check(ptr + 24);
+  if (num_checkpoints >
+      ((end - GzipIndexHeaderLength) / GzipIndexCheckpointHeaderLength)) {
+    return GzipIndex_BadIndex;
+  }
+
+  std::vector<GzipCheckpoint> checkpoints(
+      static_cast<size_t>(num_checkpoints));
+  size_t i = GzipIndexHeaderLength;
+  uint64_t prev_c_bit_position = 0;
+  for (GzipCheckpoint& c : checkpoints) {
+    if ((end - i) < GzipIndexCheckpointHeaderLength) {
+      return GzipIndex_BadIndex;
+    }
+    c.d_offset = wuffs_base__peek_u64le__no_bounds_check(ptr + i + 0);
+    uint64_t c_bit_position =
+        wuffs_base__peek_u64le__no_bounds_check(ptr + i + 8);
+    size_t window_length =
+        wuffs_base__peek_u16le__no_bounds_check(ptr + i + 16);
+    i += GzipIndexCheckpointHeaderLength;
+    c.c_offset = c_bit_position >> 3;
+    c.c_bit_offset = static_cast<uint8_t>(c_bit_position & 7);
+
+    // The first checkpoint is at the start. Later ones strictly increase, in
+    // both the decompressed and compressed offsets.
+    if (&c == &checkpoints.front()) {
+      if (c.d_offset != 0) {
+        return GzipIndex_BadIndex;
+      }
+    } else if ((c.d_offset <= (&c - 1)->d_offset) ||
+               (c_bit_position <= prev_c_bit_position)) {
+      return GzipIndex_BadIndex;
+    }
+    prev_c_bit_position = c_bit_position;
+    if ((c.d_offset > decompressed_size) ||
+        (c.c_offset >= compressed_size) ||
+        (window_length > GzipWindowLength) || (window_length > c.d_offset) ||
+        ((end - i) < window_length)) {
+      return GzipIndex_BadIndex;
+    }
+    c.window.assign(ptr + i, ptr + i + window_length);
+    i += window_length;
+  }
+  if (i != end) {
+    return GzipIndex_BadIndex;
+  }
+
+  m_compressed_size = compressed_size;
+  m_decompressed_size = decompressed_size;
+  m_checkpoints = std::move(checkpoints);
+  return "";
+}
+
+std::string  //
+GzipIndex::Save(sync_io::Output& output) const {
+  IOBuffer* dst = output.BringsItsOwnIOBuffer();
+  IOBuffer fallback_dst = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_dst_array(nullptr);
+  if (!dst) {
+    fallback_dst_array.reset(new (std::nothrow) uint8_t[GzipIOArrayLength]);
+    if (!fallback_dst_array) {
+      return GzipIndex_OutOfMemory;
+    }
+    fallback_dst =
+        wuffs_base__ptr_u8__writer(fallback_dst_array.get(), GzipIOArrayLength);
+    dst = &fallback_dst;
+  }
+
+  wuffs_crc32__ieee_hasher hasher;
+  wuffs_base__status status =
+      hasher.initialize(sizeof hasher, WUFFS_VERSION,
+                        WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  if (!status.is_ok()) {
+    return status.message();
+  }
+  uint32_t checksum = 0;
+  auto write = [&](const uint8_t* ptr, size_t len) -> std::string {
+    checksum = hasher.update_u32(
+        wuffs_base__make_slice_u8(const_cast<uint8_t*>(ptr), len));
+    return private_impl::WriteToOutput(output, *dst, ptr, len);
+  };
+
+  uint8_t header[GzipIndexHeaderLength];
+  wuffs_base__poke_u32le__no_bounds_check(header + 0, GzipIndexMagic);
+  wuffs_base__poke_u32le__no_bounds_check(header + 4, GzipIndexVersion);
+  wuffs_base__poke_u64le__no_bounds_check(header + 8, m_compressed_size);
+  wuffs_base__poke_u64le__no_bounds_check(header + 16, m_decompressed_size);
+  wuffs_base__poke_u64le__no_bounds_check(header + 24, m_checkpoints.size());
+  std::string error_message = write(header, sizeof header);
+
+  for (const GzipCheckpoint& c : m_checkpoints) {
+    if (!error_message.empty()) {
+      return error_message;
+    }
+    uint8_t c_header[GzipIndexCheckpointHeaderLength];
+    wuffs_base__poke_u64le__no_bounds_check(c_header + 0, c.d_offset);
+    wuffs_base__poke_u64le__no_bounds_check(
+        c_header + 8, (c.c_offset << 3) | (c.c_bit_offset & 7));
+    wuffs_base__poke_u16le__no_bounds_check(
+        c_header + 16, static_cast<uint16_t>(c.window.size()));
+    error_message = write(c_header, sizeof c_header);
+    if (error_message.empty() && !c.window.empty()) {
+      error_message = write(c.window.data(), c.window.size());
+    }
+  }
+  if (!error_message.empty()) {
+    return error_message;
+  }
+
+  uint8_t footer[4];
+  wuffs_base__poke_u32le__no_bounds_check(footer, checksum);
+  error_message = private_impl::WriteToOutput(output, *dst, footer, 4);
+  if (!error_message.empty()) {
+    return error_message;
+  }
+  return output.CopyOut(dst);
+}
+
+uint64_t  //
+GzipIndex::CompressedSize() const {
+  return m_compressed_size;
+}
+
+uint64_t  //
+GzipIndex::DecompressedSize() const {
+  return m_decompressed_size;
+}
+
+const std::vector<GzipCheckpoint>&  //
+GzipIndex::Checkpoints() const {
+  return m_checkpoints;
+}
+
+size_t  //
+GzipIndex::FindCheckpoint(uint64_t offset) const {
+  auto iter = std::upper_bound(
+      m_checkpoints.begin(), m_checkpoints.end(), offset,
+      [](uint64_t o, const GzipCheckpoint& c) { return o < c.d_offset; });
+  if (iter == m_checkpoints.begin()) {
+    return SIZE_MAX;
+  }
+  return static_cast<size_t>(iter - m_checkpoints.begin()) - 1;
+}
+
+GzipReadAtResult::GzipReadAtResult(std::string&& error_message0,
+                                   size_t num_bytes0)
+    : error_message(std::move(error_message0)), num_bytes(num_bytes0) {}
+
+GzipReader::GzipReader(const GzipIndex& index, const uint8_t* ptr, size_t len)
+    : m_index(index),
+      m_ptr(ptr),
+      m_len(len),
+      m_decoder(nullptr),
+      m_io_array(nullptr),
+      m_src(wuffs_base__ptr_u8__reader(const_cast<uint8_t*>(ptr), len, true)),
+      m_d_offset(0),
+      m_d_offset0(0),
+      m_decoder_is_live(false) {}
+
+GzipReadAtResult  //
+GzipReader::ReadAt(uint8_t* dst, size_t len, uint64_t offset) {
+  uint64_t d_size = m_index.DecompressedSize();
+  if ((len == 0) || (offset >= d_size)) {
+    return GzipReadAtResult("", 0);
+  } else if (!dst) {
+    return GzipReadAtResult("wuffs_aux::GzipReader: nullptr dst", 0);
+  } else if (!m_ptr || (m_len != m_index.CompressedSize())) {
+    return GzipReadAtResult(GzipReader_IndexDoesNotMatchFile, 0);
+  }
+  uint64_t end = offset + std::min<uint64_t>(len, d_size - offset);
+
+  // Carry on from where the previous read stopped, unless that is after
+  // offset or before the nearest checkpoint.
+  size_t ci = m_index.FindCheckpoint(offset);
+  if (ci == SIZE_MAX) {
+    return GzipReadAtResult(GzipReader_IndexDoesNotMatchFile, 0);
+  } else if (!m_decoder_is_live || (m_d_offset > offset) ||
+             (m_d_offset < m_index.Checkpoints()[ci].d_offset)) {
+    std::string error_message = Resume(ci);
+    if (!error_message.empty()) {
+      return GzipReadAtResult(std::move(error_message), 0);
+    }
+  }
+
+  if (!m_io_array) {
+    m_io_array.reset(new (std::nothrow) uint8_t[GzipIOArrayLength]);
+    if (!m_io_array) {
+      return GzipReadAtResult(GzipReader_OutOfMemory, 0);
+    }
+  }
+  uint8_t workbuf_array[WUFFS_DEFLATE__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE];
+  wuffs_base__slice_u8 workbuf =
+      wuffs_base__make_slice_u8(&workbuf_array[0], sizeof(workbuf_array));
+
+  while (m_d_offset < end) {
+    if (!m_decoder_is_live) {
+      return GzipReadAtResult(GzipReader_TruncatedInput, 0);
+    }
+
+    // Discard what's before offset, via m_io_array, and then decompress
+    // straight into dst.
+    IOBuffer io = wuffs_base__empty_io_buffer();
+    if (m_d_offset < offset) {
+      io = wuffs_base__ptr_u8__writer(
+          m_io_array.get(), static_cast<size_t>(std::min<uint64_t>(
+                                GzipIOArrayLength, offset - m_d_offset)));
+    } else {
+      io = wuffs_base__ptr_u8__writer(dst + (m_d_offset - offset),
+                                      static_cast<size_t>(end - m_d_offset));
+    }
+    // The decoder relates dst's position to how much it has decoded, so that
+    // it does not mistake earlier bytes in dst for its history.
+    io.meta.pos = m_d_offset - m_d_offset0;
+
+    wuffs_base__status status = m_decoder->transform_io(&io, &m_src, workbuf);
+    m_d_offset += io.meta.wi;
+    if (status.repr == nullptr) {
+      std::string error_message = StartMember();
+      if (!error_message.empty()) {
+        m_decoder_is_live = false;
+        return GzipReadAtResult(std::move(error_message), 0);
+      }
+    } else if (status.repr != wuffs_base__suspension__short_write) {
+      m_decoder_is_live = false;
+      return GzipReadAtResult(status.message(), 0);
+    }
+  }
+
+  return GzipReadAtResult("", static_cast<size_t>(end - offset));
+}
+
+std::string  //
+GzipReader::Resume(size_t checkpoint_index) {
+  m_decoder_is_live = false;
+  const GzipCheckpoint& c = m_index.Checkpoints()[checkpoint_index];
+  if (c.c_offset >= m_len) {
+    return GzipReader_IndexDoesNotMatchFile;
+  }
+
+  wuffs_base__status status = wuffs_base__make_status(nullptr);
+  if (!m_decoder) {
+    m_decoder = wuffs_deflate__decoder::alloc_as__wuffs_base__io_transformer();
+    if (!m_decoder) {
+      return GzipReader_OutOfMemory;
+    }
+  } else {
+    status = wuffs_deflate__decoder__initialize(
+        reinterpret_cast<wuffs_deflate__decoder*>(m_decoder.get()),
+        sizeof__wuffs_deflate__decoder(), WUFFS_VERSION,
+        WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  }
+  if (status.is_ok() && (c.c_bit_offset > 0)) {
+    status = m_decoder->set_quirk(WUFFS_DEFLATE__QUIRK_SKIP_LEADING_BITS,
+                                  c.c_bit_offset);
+  }
+  if (!status.is_ok()) {
+    return status.message();
+  }
+  wuffs_deflate__decoder__add_history(
+      reinterpret_cast<wuffs_deflate__decoder*>(m_decoder.get()),
+      wuffs_base__make_slice_u8(const_cast<uint8_t*>(c.window.data()),
+                                c.window.size()));
+
+  m_src.meta.ri = static_cast<size_t>(c.c_offset);
+  m_d_offset = c.d_offset;
+  m_d_offset0 = c.d_offset;
+  m_decoder_is_live = true;
+  return "";
+}
+
+std::string  //
+GzipReader::StartMember() {
+  // Skip the previous member's footer and, unless at the end of the file,
+  // the next member's header.
+  m_decoder_is_live = false;
+  if (m_src.reader_length() < 8) {
+    return GzipReader_TruncatedInput;
+  }
+  m_src.meta.ri += 8;
+  if (m_src.reader_length() == 0) {
+    return "";
+  } else if (m_src.reader_pointer()[0] != 0x1F) {
+    // As per GzipIndex::Build, allow NUL padding up to the end of the file.
+    const uint8_t* p = m_src.reader_pointer();
+    const uint8_t* q = p + m_src.reader_length();
+    for (; (p < q) && (*p == 0x00); p++) {
+    }
+    return (p < q) ? GzipReader_TrailingGarbage : "";
+  }
+  size_t n = GzipHeaderLength(m_src.reader_pointer(), m_src.reader_length());
+  if (n == 0) {
+    return GzipReader_TruncatedInput;
+  } else if (n == SIZE_MAX) {
+    return GzipReader_BadGzipHeader;
+  }
+  m_src.meta.ri += n;
+
+  wuffs_base__status status = wuffs_deflate__decoder__initialize(
+      reinterpret_cast<wuffs_deflate__decoder*>(m_decoder.get()),
+      sizeof__wuffs_deflate__decoder(), WUFFS_VERSION,
+      WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  if (!status.is_ok()) {
+    return status.message();
+  }
+  m_d_offset0 = m_d_offset;
+  m_decoder_is_live = true;
+  return "";
+}
+
+}  // namespace wuffs_aux
+
+#endif  // !defined(WUFFS_CONFIG__MODULES) ||
+        // defined(WUFFS_CONFIG__MODULE__AUX__GZIP)
@@ -0,0 +1,154 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Gzip
+
+#include <vector>
+
+namespace wuffs_aux {
+
+// GzipCheckpoint is a place, other than the start of a gzip file, that a
+// GzipReader can start decompressing from. It is the start of a DEFLATE block
+// (or of a gzip member), which need not be byte-aligned.
+struct GzipCheckpoint {
+  GzipCheckpoint();
+
+  // d_offset is the checkpoint's offset in the decompressed contents.
+  uint64_t d_offset;
+
+  // c_offset is the offset of the compressed file's byte that holds the
+  // checkpoint's first bit. c_bit_offset (in the range 0 ..= 7) is how many
+  // of that byte's low bits belong to the previous block.
+  uint64_t c_offset;
+  uint8_t c_bit_offset;
+
+  // window holds the (up to 32 KiB of) decompressed contents immediately
+  // before d_offset, within the same gzip member. DEFLATE back-references
+  // after the checkpoint can refer to it.
+  std::vector<uint8_t> window;
+};
+
+// GzipIndex is a zran-style index for random access into a gzip file: a list
+// of checkpoints, roughly evenly spaced in the decompressed contents.
+//
+// Its serialized form (see Save and Load) is little-endian:
+//  - 4 bytes magic "WGzI" and 4 bytes version (1).
+//  - 8 bytes CompressedSize, 8 bytes DecompressedSize and 8 bytes number of
+//    checkpoints.
+//  - Each checkpoint: 8 bytes d_offset, 8 bytes ((c_offset << 3) |
+//    c_bit_offset), 2 bytes window length (up to 32768) and then the window.
+//  - 4 bytes CRC-32 checksum of everything before it.
+//
+// The windows dominate its size: up to 32 KiB per checkpoint. They are not
+// compressed, so an index is a little larger than (32 KiB / span) times the
+// decompressed size.
+class GzipIndex {
+ public:
+  static constexpr uint64_t DEFAULT_SPAN = 4194304;
+
+  GzipIndex();
+
+  // Build decompresses the whole of input, a gzip file (possibly with
+  // multiple members), verifying each member's checksum. It records a
+  // checkpoint at the start and then at the first block (or member) boundary
+  // that is at least span decompressed bytes after the previous checkpoint.
+  // It returns an empty string on success.
+  //
+  // Like gzip(1), it ignores NUL bytes (zero padding) after the last member,
+  // up to the end of input. CompressedSize still counts them. Any other bytes
+  // after the last member give a "trailing garbage" error.
+  //
+  // A smaller span means faster random access but a larger index.
+  std::string Build(sync_io::Input& input, uint64_t span = DEFAULT_SPAN);
+
+  // Load replaces the index with one serialized by Save, validating it. It
+  // returns an empty string on success.
+  std::string Load(const uint8_t* ptr, size_t len);
+
+  // Save writes the serialized index to output. It returns an empty string on
+  // success.
+  std::string Save(sync_io::Output& output) const;
+
+  // CompressedSize and DecompressedSize return the gzip file's sizes.
+  uint64_t CompressedSize() const;
+  uint64_t DecompressedSize() const;
+
+  // Checkpoints returns the checkpoints, sorted by (strictly increasing)
+  // d_offset. The first one's d_offset is zero.
+  const std::vector<GzipCheckpoint>& Checkpoints() const;
+
+  // FindCheckpoint returns the index of the last checkpoint whose d_offset is
+  // at or before the decompressed offset, or SIZE_MAX if there are no
+  // checkpoints. It is a binary search.
+  size_t FindCheckpoint(uint64_t offset) const;
+
+ private:
+  uint64_t m_compressed_size;
+  uint64_t m_decompressed_size;
+  std::vector<GzipCheckpoint> m_checkpoints;
+
+  // Delete the copy and assign constructors.
+  GzipIndex(const GzipIndex&) = delete;
+  GzipIndex& operator=(const GzipIndex&) = delete;
+};
+
+struct GzipReadAtResult {
+  GzipReadAtResult(std::string&& error_message0, size_t num_bytes0);
+
+  std::string error_message;
+  size_t num_bytes;
+};
+
+// GzipReader serves random access reads of a gzip file's decompressed
+// contents. Each read resumes decompressing from the nearest checkpoint at or
+// before the read's offset (or carries on from where the previous read
+// stopped, if that is nearer), so that it costs O(span + len) instead of
+// O(offset + len).
+//
+// Unlike GzipIndex::Build, it cannot verify the gzip checksums, as it does not
+// decompress whole members.
+//
+// A GzipReader is not thread-safe. Use one reader per thread. The GzipIndex
+// and the gzip file's bytes must outlive the GzipReader.
+class GzipReader {
+ public:
+  // ptr and len are the whole gzip file's bytes, such as from a
+  // sync_io::MmapFileInput. They are borrowed, not copied.
+  GzipReader(const GzipIndex& index, const uint8_t* ptr, size_t len);
+
+  // ReadAt copies up to len decompressed bytes, starting at the decompressed
+  // offset, to dst. Like pread, it returns fewer than len bytes (possibly
+  // zero) only when reaching the end of the decompressed contents.
+  GzipReadAtResult ReadAt(uint8_t* dst, size_t len, uint64_t offset);
+
+ private:
+  std::string Resume(size_t checkpoint_index);
+  std::string StartMember();
+
+  const GzipIndex& m_index;
+  const uint8_t* m_ptr;
+  size_t m_len;
+
+  wuffs_base__io_transformer::unique_ptr m_decoder;
+  std::unique_ptr<uint8_t[]> m_io_array;
+
+  // m_src's reader position and m_d_offset are where m_decoder is up to, if
+  // m_decoder_is_live. m_decoder started (or resumed) at m_d_offset0.
+  IOBuffer m_src;
+  uint64_t m_d_offset;
+  uint64_t m_d_offset0;
+  bool m_decoder_is_live;
+
+  // Delete the copy and assign constructors.
+  GzipReader(const GzipReader&) = delete;
+  GzipReader& operator=(const GzipReader&) = delete;
+};
+
+}  // namespace wuffs_aux
@@ -12,7 +12,9 @@
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__IMAGE)
 
+#include <cmath>
 #include <utility>
+#include <vector>
 
 namespace wuffs_aux {
 
@@ -52,82 +54,184 @@ DecodeImageCallbacks::AllocWorkbufResult::AllocWorkbufResult(
       workbuf(wuffs_base__empty_slice_u8()),
       error_message(std::move(error_message0)) {}
 
-wuffs_base__image_decoder::unique_ptr  //
-DecodeImageCallbacks::SelectDecoder(uint32_t fourcc,
-                                    wuffs_base__slice_u8 prefix_data,
-                                    bool prefix_closed) {
-  switch (fourcc) {
+namespace {
+
+// DecodeImageInitialize initializes an image_decoder of the concrete type T.
+template <typename T, size_t (*SIZEOF)()>
+wuffs_base__status  //
+DecodeImageInitialize(wuffs_base__image_decoder* image_decoder,
+                      uint32_t options) {
+  return reinterpret_cast<T*>(image_decoder)
+      ->initialize((*SIZEOF)(), WUFFS_VERSION, options);
+}
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__PNG)
+wuffs_base__status  //
+DecodeImageSetPngQuirks(wuffs_base__image_decoder* image_decoder) {
+  // Favor faster decodes over rejecting invalid checksums.
+  return image_decoder->set_quirk(WUFFS_BASE__QUIRK_IGNORE_CHECKSUM, 1);
+}
+#endif
+
+// DecodeImageDecoder is an image decoder that the default
+// DecodeImageCallbacks::SelectDecoder can return: how to allocate a new one,
+// how to re-initialize an existing one (for DecodeImageContext) and, if
+// non-null, the default quirks to set after either.
+struct DecodeImageDecoder {
+  uint32_t fourcc;
+  wuffs_base__image_decoder::unique_ptr (*alloc)();
+  wuffs_base__status (*initialize)(wuffs_base__image_decoder* image_decoder,
+                                   uint32_t options);
+  wuffs_base__status (*set_quirks)(wuffs_base__image_decoder* image_decoder);
+};
+
+// DecodeImageDecoders is terminated by an entry with a zero fourcc.
+const DecodeImageDecoder DecodeImageDecoders[] = {
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__BMP)
-    case WUFFS_BASE__FOURCC__BMP:
-      return wuffs_bmp__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__BMP,
+        wuffs_bmp__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_bmp__decoder, sizeof__wuffs_bmp__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__ETC2)
-    case WUFFS_BASE__FOURCC__ETC2:
-      return wuffs_etc2__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__ETC2,
+        wuffs_etc2__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_etc2__decoder, sizeof__wuffs_etc2__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__GIF)
-    case WUFFS_BASE__FOURCC__GIF:
-      return wuffs_gif__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__GIF,
+        wuffs_gif__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_gif__decoder, sizeof__wuffs_gif__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__HANDSUM)
-    case WUFFS_BASE__FOURCC__HNSM:
-      return wuffs_handsum__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__HNSM,
+        wuffs_handsum__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_handsum__decoder, sizeof__wuffs_handsum__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__JPEG)
-    case WUFFS_BASE__FOURCC__JPEG:
-      return wuffs_jpeg__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__JPEG,
+        wuffs_jpeg__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_jpeg__decoder, sizeof__wuffs_jpeg__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__NIE)
-    case WUFFS_BASE__FOURCC__NIE:
-      return wuffs_nie__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__NIE,
+        wuffs_nie__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_nie__decoder, sizeof__wuffs_nie__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__NETPBM)
-    case WUFFS_BASE__FOURCC__NPBM:
-      return wuffs_netpbm__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__NPBM,
+        wuffs_netpbm__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_netpbm__decoder, sizeof__wuffs_netpbm__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__PNG)
-    case WUFFS_BASE__FOURCC__PNG: {
-      auto dec = wuffs_png__decoder::alloc_as__wuffs_base__image_decoder();
-      // Favor faster decodes over rejecting invalid checksums.
-      dec->set_quirk(WUFFS_BASE__QUIRK_IGNORE_CHECKSUM, 1);
-      return dec;
-    }
+    {
+        WUFFS_BASE__FOURCC__PNG,
+        wuffs_png__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_png__decoder, sizeof__wuffs_png__decoder>,
+        DecodeImageSetPngQuirks,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__QOI)
-    case WUFFS_BASE__FOURCC__QOI:
-      return wuffs_qoi__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__QOI,
+        wuffs_qoi__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_qoi__decoder, sizeof__wuffs_qoi__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__TARGA)
-    case WUFFS_BASE__FOURCC__TGA:
-      return wuffs_targa__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__TGA,
+        wuffs_targa__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_targa__decoder, sizeof__wuffs_targa__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__THUMBHASH)
-    case WUFFS_BASE__FOURCC__TH:
-      return wuffs_thumbhash__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__TH,
+        wuffs_thumbhash__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_thumbhash__decoder, sizeof__wuffs_thumbhash__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__WBMP)
-    case WUFFS_BASE__FOURCC__WBMP:
-      return wuffs_wbmp__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__WBMP,
+        wuffs_wbmp__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_wbmp__decoder, sizeof__wuffs_wbmp__decoder>,
+        nullptr,
+    },
 #endif
 
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__WEBP)
-    case WUFFS_BASE__FOURCC__WEBP:
-      return wuffs_webp__decoder::alloc_as__wuffs_base__image_decoder();
+    {
+        WUFFS_BASE__FOURCC__WEBP,
+        wuffs_webp__decoder::alloc_as__wuffs_base__image_decoder,
+        DecodeImageInitialize<wuffs_webp__decoder, sizeof__wuffs_webp__decoder>,
+        nullptr,
+    },
 #endif
+
+    {0, nullptr, nullptr, nullptr},
+};
+
+const DecodeImageDecoder*  //
+DecodeImageFindDecoder(uint32_t fourcc) {
+  for (const DecodeImageDecoder* d = &DecodeImageDecoders[0]; d->fourcc; d++) {
+    if (d->fourcc == fourcc) {
+      return d;
+    }
   }
+  return nullptr;
+}
 
-  return wuffs_base__image_decoder::unique_ptr(nullptr);
+}  // namespace
+
+wuffs_base__image_decoder::unique_ptr  //
+DecodeImageCallbacks::SelectDecoder(uint32_t fourcc,
+                                    wuffs_base__slice_u8 prefix_data,
+                                    bool prefix_closed) {
+  const DecodeImageDecoder* d = DecodeImageFindDecoder(fourcc);
+  if (!d) {
+    return wuffs_base__image_decoder::unique_ptr(nullptr);
+  }
+  wuffs_base__image_decoder::unique_ptr image_decoder = (*d->alloc)();
+  if (image_decoder && d->set_quirks) {
+    (*d->set_quirks)(image_decoder.get());
+  }
+  return image_decoder;
 }
 
 std::string  //
@@ -189,6 +293,12 @@ DecodeImageCallbacks::AllocWorkbuf(wuffs_base__range_ii_u64 len_range,
       wuffs_base__make_slice_u8((uint8_t*)ptr, (size_t)len));
 }
 
+std::string  //
+DecodeImageCallbacks::HandleProgress(const wuffs_base__pixel_buffer& pixbuf,
+                                     wuffs_base__rect_ie_u32 dirty_rect) {
+  return "";
+}
+
 void  //
 DecodeImageCallbacks::Done(
     DecodeImageResult& result,
@@ -196,6 +306,16 @@ DecodeImageCallbacks::Done(
     IOBuffer& buffer,
     wuffs_base__image_decoder::unique_ptr image_decoder) {}
 
+DecodeImageFramesCallbacks::~DecodeImageFramesCallbacks() {}
+
+std::string  //
+DecodeImageFramesCallbacks::HandleFrame(
+    const wuffs_base__frame_config& frame_config,
+    wuffs_base__rect_ie_u32 dirty_rect,
+    const wuffs_base__pixel_buffer& canvas) {
+  return "";
+}
+
 const char DecodeImage_BufferIsTooShort[] =  //
     "wuffs_aux::DecodeImage: buffer is too short";
 const char DecodeImage_MaxInclDimensionExceeded[] =  //
@@ -268,6 +388,34 @@ DecodeImageArgMaxInclMetadataLength::DefaultValue() {
   return DecodeImageArgMaxInclMetadataLength(16777215);
 }
 
+DecodeImageArgResize::DecodeImageArgResize(uint32_t width0,
+                                           uint32_t height0,
+                                           uint32_t filter0)
+    : width(width0), height(height0), filter(filter0) {}
+
+DecodeImageArgResize  //
+DecodeImageArgResize::DefaultValue() {
+  return DecodeImageArgResize(0, 0, DecodeImageArgResize::FILTER_BILINEAR);
+}
+
+ProbeImageResult::ProbeImageResult(uint32_t fourcc0,
+                                   wuffs_base__image_config image_config0,
+                                   uint64_t num_frames0,
+                                   uint32_t orientation0,
+                                   std::string&& error_message0)
+    : fourcc(fourcc0),
+      image_config(image_config0),
+      num_frames(num_frames0),
+      orientation(orientation0),
+      error_message(std::move(error_message0)) {}
+
+ProbeImageArgFlags::ProbeImageArgFlags(uint64_t repr0) : repr(repr0) {}
+
+ProbeImageArgFlags  //
+ProbeImageArgFlags::DefaultValue() {
+  return ProbeImageArgFlags(0);
+}
+
 // --------
 
 namespace {
@@ -297,323 +445,2159 @@ DIHM0(void* self,
       static_cast<wuffs_base__image_decoder*>(self), a_dst, a_minfo, a_src);
 }
 
-std::string  //
-DIHM1(void* self,
-      const wuffs_base__more_information* minfo,
-      wuffs_base__slice_u8 raw) {
-  return static_cast<DecodeImageCallbacks*>(self)->HandleMetadata(*minfo, raw);
+// ParseExifOrientation returns the Orientation tag's value, in the range [1
+// ..= 8], from EXIF metadata: a TIFF header and its first IFD (Image File
+// Directory), optionally preceded by JPEG's "Exif\0\0" APP1 prefix. It
+// returns zero if there is no such (valid) tag.
+uint32_t  //
+ParseExifOrientation(wuffs_base__slice_u8 exif) {
+  const uint8_t* p = exif.ptr;
+  size_t n = exif.len;
+  if ((n >= 6) && (memcmp(p, "Exif\0\0", 6) == 0)) {
+    p += 6;
+    n -= 6;
+  }
+  if (n < 8) {
+    return 0;
+  }
+  bool be;
+  if ((p[0] == 'I') && (p[1] == 'I') && (p[2] == 0x2A) && (p[3] == 0x00)) {
+    be = false;
+  } else if ((p[0] == 'M') && (p[1] == 'M') && (p[2] == 0x00) &&
+             (p[3] == 0x2A)) {
+    be = true;
+  } else {
+    return 0;
+  }
+
+  uint64_t ifd = be ? wuffs_base__peek_u32be__no_bounds_check(p + 4)
+                    : wuffs_base__peek_u32le__no_bounds_check(p + 4);
+  if ((ifd > n) || ((n - ifd) < 2)) {
+    return 0;
+  }
+  uint64_t num_entries =
+      be ? wuffs_base__peek_u16be__no_bounds_check(p + ifd)
+         : wuffs_base__peek_u16le__no_bounds_check(p + ifd);
+  if (num_entries > ((n - ifd - 2) / 12)) {
+    num_entries = (n - ifd - 2) / 12;
+  }
+
+  for (const uint8_t* e = p + ifd + 2; num_entries > 0; num_entries--) {
+    uint16_t tag = be ? wuffs_base__peek_u16be__no_bounds_check(e + 0)
+                      : wuffs_base__peek_u16le__no_bounds_check(e + 0);
+    if (tag != 0x0112) {
+      e += 12;
+      continue;
+    }
+    // The Orientation tag's type must be 3 (SHORT) and its count must be 1.
+    uint16_t type = be ? wuffs_base__peek_u16be__no_bounds_check(e + 2)
+                       : wuffs_base__peek_u16le__no_bounds_check(e + 2);
+    uint32_t count = be ? wuffs_base__peek_u32be__no_bounds_check(e + 4)
+                        : wuffs_base__peek_u32le__no_bounds_check(e + 4);
+    if ((type != 3) || (count != 1)) {
+      return 0;
+    }
+    uint16_t value = be ? wuffs_base__peek_u16be__no_bounds_check(e + 8)
+                        : wuffs_base__peek_u16le__no_bounds_check(e + 8);
+    return ((1 <= value) && (value <= 8)) ? value : 0;
+  }
+  return 0;
 }
 
-std::string  //
-DecodeImageHandleMetadata(wuffs_base__image_decoder::unique_ptr& image_decoder,
-                          DecodeImageCallbacks& callbacks,
-                          sync_io::Input& input,
-                          wuffs_base__io_buffer& io_buf,
-                          sync_io::DynIOBuffer& raw_metadata_buf) {
-  return private_impl::HandleMetadata(DecodeImageErrorMessages, input, io_buf,
-                                      raw_metadata_buf, DIHM0,
-                                      static_cast<void*>(image_decoder.get()),
-                                      DIHM1, static_cast<void*>(&callbacks));
+// DecodeImageContextReinitialize re-initializes an idle image decoder, one
+// that was returned by the default DecodeImageCallbacks::SelectDecoder for that
+// fourcc, so that it can decode another image. It returns whether it succeeded.
+// It fails for FourCC values that the default SelectDecoder does not accept.
+bool  //
+DecodeImageContextReinitialize(uint32_t fourcc,
+                               wuffs_base__image_decoder* image_decoder) {
+  const DecodeImageDecoder* d = DecodeImageFindDecoder(fourcc);
+  if (!d) {
+    return false;
+  }
+  // Wuffs' decoders do not need their internal buffers (which can be tens of
+  // kilobytes) to be zeroed, only the rest of their state.
+  wuffs_base__status status = (*d->initialize)(
+      image_decoder, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  if ((status.repr == nullptr) && d->set_quirks) {
+    status = (*d->set_quirks)(image_decoder);
+  }
+  return status.repr == nullptr;
 }
 
-DecodeImageResult  //
-DecodeImage0(wuffs_base__image_decoder::unique_ptr& image_decoder,
-             DecodeImageCallbacks& callbacks,
-             sync_io::Input& input,
-             wuffs_base__io_buffer& io_buf,
-             const QuirkKeyValuePair* quirks_ptr,
-             const size_t quirks_len,
-             uint64_t flags,
-             wuffs_base__pixel_blend pixel_blend,
-             wuffs_base__color_u32_argb_premul background_color,
-             uint32_t max_incl_dimension,
-             uint64_t max_incl_metadata_length) {
+// DecodeImageFramesCopyRect copies the pixels within r, which must be inside
+// the pixbuf bounds, from pixbuf to the tightly packed backup (if save is
+// true) or vice versa.
+void  //
+DecodeImageFramesCopyRect(wuffs_base__pixel_buffer& pixbuf,
+                          wuffs_base__rect_ie_u32 r,
+                          uint8_t* backup,
+                          bool save) {
+  wuffs_base__table_u8 tab = pixbuf.plane(0);
+  size_t bytes_per_pixel = pixbuf.pixcfg.pixel_format().bits_per_pixel() / 8;
+  size_t row_len = r.width() * bytes_per_pixel;
+  for (uint32_t y = r.min_incl_y; y < r.max_excl_y; y++) {
+    uint8_t* p = tab.ptr + (y * tab.stride) + (r.min_incl_x * bytes_per_pixel);
+    if (save) {
+      memcpy(backup, p, row_len);
+    } else {
+      memcpy(p, backup, row_len);
+    }
+    backup += row_len;
+  }
+}
+
+// PixbufsOverlap returns whether a's and b's first planes share any memory,
+// e.g. if callbacks.AllocPixbuf returned the same (fixed) buffer twice.
+bool  //
+PixbufsOverlap(wuffs_base__pixel_buffer& a, wuffs_base__pixel_buffer& b) {
+  wuffs_base__table_u8 ta = a.plane(0);
+  wuffs_base__table_u8 tb = b.plane(0);
+  if ((ta.width == 0) || (ta.height == 0) || (tb.width == 0) ||
+      (tb.height == 0)) {
+    return false;
+  }
+  uintptr_t a0 = reinterpret_cast<uintptr_t>(ta.ptr);
+  uintptr_t a1 = a0 + ((ta.height - 1) * ta.stride) + ta.width;
+  uintptr_t b0 = reinterpret_cast<uintptr_t>(tb.ptr);
+  uintptr_t b1 = b0 + ((tb.height - 1) * tb.stride) + tb.width;
+  return (a0 < b1) && (b0 < a1);
+}
+
+// ResampleWeights holds a separable resampling filter's weights along one
+// axis: dst pixel i is the sum, over j in [0, counts[i]), of weights[(i *
+// max_count) + j] times src pixel (starts[i] + j).
+struct ResampleWeights {
+  std::vector<uint32_t> starts;
+  std::vector<uint32_t> counts;
+  std::vector<float> weights;
+  size_t max_count;
+};
+
+float  //
+ResampleFilter(uint32_t filter, float x) {
+  x = std::fabs(x);
+  switch (filter) {
+    case DecodeImageArgResize::FILTER_BOX:
+      return (x <= 0.5f) ? 1.0f : 0.0f;
+    case DecodeImageArgResize::FILTER_LANCZOS3: {
+      if (x < 1e-6f) {
+        return 1.0f;
+      } else if (x >= 3.0f) {
+        return 0.0f;
+      }
+      static constexpr float pi = 3.14159265358979323846f;
+      float px = pi * x;
+      return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+    }
+  }
+  return (x < 1.0f) ? (1.0f - x) : 0.0f;
+}
+
+ResampleWeights  //
+ResampleMakeWeights(uint32_t filter, uint32_t src_len, uint32_t dst_len) {
+  float radius = (filter == DecodeImageArgResize::FILTER_BOX)        ? 0.5f
+                 : (filter == DecodeImageArgResize::FILTER_LANCZOS3) ? 3.0f
+                                                                     : 1.0f;
+  // When downscaling, widen the filter so that every src pixel contributes.
+  float scale = (float)src_len / (float)dst_len;
+  float fscale = (scale > 1.0f) ? scale : 1.0f;
+  float support = radius * fscale;
+
+  ResampleWeights rw;
+  rw.max_count = (size_t)std::ceil(2.0f * support) + 2;
+  rw.starts.resize(dst_len);
+  rw.counts.resize(dst_len);
+  rw.weights.assign(dst_len * rw.max_count, 0.0f);
+  for (uint32_t i = 0; i < dst_len; i++) {
+    float center = ((float)i + 0.5f) * scale - 0.5f;
+    int64_t lo = (int64_t)std::ceil(center - support);
+    int64_t hi = (int64_t)std::floor(center + support);
+    if ((hi - lo + 1) > (int64_t)rw.max_count) {
+      hi = lo + (int64_t)rw.max_count - 1;
+    }
+    // Clamp to the src edges. Taps beyond them re-use the edge pixels.
+    int64_t start = (lo < 0) ? 0 : lo;
+    int64_t end = (hi >= (int64_t)src_len) ? ((int64_t)src_len - 1) : hi;
+    if (start > end) {
+      start = end = (int64_t)std::floor(center + 0.5f);
+      start = end = (start < 0) ? 0
+                    : (start >= (int64_t)src_len) ? ((int64_t)src_len - 1)
+                                                  : start;
+    }
+    float* w = &rw.weights[i * rw.max_count];
+    float sum = 0.0f;
+    for (int64_t j = lo; j <= hi; j++) {
+      int64_t k = (j < start) ? start : (j > end) ? end : j;
+      float v = ResampleFilter(filter, ((float)j - center) / fscale);
+      w[k - start] += v;
+      sum += v;
+    }
+    if (sum == 0.0f) {
+      w[0] = 1.0f;
+      sum = 1.0f;
+    }
+    for (int64_t j = start; j <= end; j++) {
+      w[j - start] /= sum;
+    }
+    rw.starts[i] = (uint32_t)start;
+    rw.counts[i] = (uint32_t)(end - start + 1);
+  }
+  return rw;
+}
+
+// Resample resizes src into dst, which must have the same pixel format: an
+// interleaved one with 8 or 16 (little-endian) bits per channel. It makes
+// one (streaming) pass over src's rows, in order, resampling each of them
+// horizontally into a ring buffer of dst-width rows, from which each dst row
+// is resampled vertically. The inner loops are simple enough for compilers
+// to vectorize.
+void  //
+Resample(wuffs_base__pixel_buffer& dst,
+         wuffs_base__pixel_buffer& src,
+         uint32_t filter) {
+  wuffs_base__pixel_format pf = src.pixcfg.pixel_format();
+  size_t channel_bytes =
+      (pf.repr == WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE) ? 2 : 1;
+  size_t num_channels = (pf.bits_per_pixel() / 8) / channel_bytes;
+  float max_value = (channel_bytes == 2) ? 65535.0f : 255.0f;
+  // Non-premultiplied alpha is weighted, by premultiplying in the horizontal
+  // pass and un-premultiplying the final result.
+  bool nonpremul =
+      (num_channels == 4) &&
+      (pf.transparency() ==
+       WUFFS_BASE__PIXEL_ALPHA_TRANSPARENCY__NONPREMULTIPLIED_ALPHA);
+
+  uint32_t sw = src.pixcfg.width();
+  uint32_t sh = src.pixcfg.height();
+  uint32_t dw = dst.pixcfg.width();
+  uint32_t dh = dst.pixcfg.height();
+  ResampleWeights xw = ResampleMakeWeights(filter, sw, dw);
+  ResampleWeights yw = ResampleMakeWeights(filter, sh, dh);
+  wuffs_base__table_u8 stab = src.plane(0);
+  wuffs_base__table_u8 dtab = dst.plane(0);
+
+  size_t row_len = (size_t)dw * num_channels;
+  size_t ring_len = yw.max_count;
+  std::vector<float> ring(ring_len * row_len);
+  std::vector<float> srow((size_t)sw * num_channels);
+  std::vector<float> acc(row_len);
+  uint32_t next_src_y = 0;
+
+  for (uint32_t dy = 0; dy < dh; dy++) {
+    uint32_t y0 = yw.starts[dy];
+    uint32_t n = yw.counts[dy];
+
+    // Horizontally resample any src rows that are newly needed.
+    for (; next_src_y < (y0 + n); next_src_y++) {
+      const uint8_t* s = stab.ptr + ((size_t)next_src_y * stab.stride);
+      size_t num_values = (size_t)sw * num_channels;
+      if (channel_bytes == 2) {
+        for (size_t i = 0; i < num_values; i++) {
+          srow[i] = (float)wuffs_base__peek_u16le__no_bounds_check(s + 2 * i);
+        }
+      } else {
+        for (size_t i = 0; i < num_values; i++) {
+          srow[i] = (float)s[i];
+        }
+      }
+      if (nonpremul) {
+        for (size_t i = 0; i < num_values; i += 4) {
+          float a = srow[i + 3] / max_value;
+          srow[i + 0] *= a;
+          srow[i + 1] *= a;
+          srow[i + 2] *= a;
+        }
+      }
+
+      float* r = &ring[(next_src_y % ring_len) * row_len];
+      for (uint32_t dx = 0; dx < dw; dx++) {
+        const float* w = &xw.weights[dx * xw.max_count];
+        const float* p = &srow[(size_t)xw.starts[dx] * num_channels];
+        float* q = r + ((size_t)dx * num_channels);
+        for (size_t c = 0; c < num_channels; c++) {
+          q[c] = 0.0f;
+        }
+        for (uint32_t j = 0; j < xw.counts[dx]; j++) {
+          for (size_t c = 0; c < num_channels; c++) {
+            q[c] += w[j] * p[c];
+          }
+          p += num_channels;
+        }
+      }
+    }
+
+    // Vertically resample those rows into the dst row.
+    const float* w = &yw.weights[dy * yw.max_count];
+    for (size_t i = 0; i < row_len; i++) {
+      acc[i] = 0.0f;
+    }
+    for (uint32_t j = 0; j < n; j++) {
+      const float* r = &ring[((y0 + j) % ring_len) * row_len];
+      float wj = w[j];
+      for (size_t i = 0; i < row_len; i++) {
+        acc[i] += wj * r[i];
+      }
+    }
+    if (nonpremul) {
+      for (size_t i = 0; i < row_len; i += 4) {
+        float a = acc[i + 3];
+        float k = (a > 0.0f) ? (max_value / a) : 0.0f;
+        acc[i + 0] *= k;
+        acc[i + 1] *= k;
+        acc[i + 2] *= k;
+      }
+    }
+
+    uint8_t* d = dtab.ptr + ((size_t)dy * dtab.stride);
+    for (size_t i = 0; i < row_len; i++) {
+      float v = acc[i] + 0.5f;
+      v = (v < 0.0f) ? 0.0f : (v > max_value) ? max_value : v;
+      if (channel_bytes == 2) {
+        wuffs_base__poke_u16le__no_bounds_check(d + 2 * i, (uint16_t)v);
+      } else {
+        d[i] = (uint8_t)v;
+      }
+    }
+  }
+}
+
+// OrientInPlace applies an EXIF orientation in [2 ..= 4]: a horizontal flip,
+// a rotation by 180 degrees or a vertical flip.
+void  //
+OrientInPlace(wuffs_base__table_u8 t,
+              size_t bytes_per_pixel,
+              uint32_t orientation) {
+  if ((t.width == 0) || (t.height == 0)) {
+    return;
+  } else if (orientation != 4) {
+    for (size_t y = 0; y < t.height; y++) {
+      uint8_t* p = t.ptr + (y * t.stride);
+      uint8_t* q = p + t.width - bytes_per_pixel;
+      for (; p < q; p += bytes_per_pixel, q -= bytes_per_pixel) {
+        for (size_t i = 0; i < bytes_per_pixel; i++) {
+          uint8_t c = p[i];
+          p[i] = q[i];
+          q[i] = c;
+        }
+      }
+    }
+  }
+  if (orientation != 2) {
+    for (size_t y = 0, z = t.height - 1; y < z; y++, z--) {
+      uint8_t* p = t.ptr + (y * t.stride);
+      uint8_t* q = t.ptr + (z * t.stride);
+      for (size_t i = 0; i < t.width; i++) {
+        uint8_t c = p[i];
+        p[i] = q[i];
+        q[i] = c;
+      }
+    }
+  }
+}
+
+// OrientTiled applies an EXIF orientation in [5 ..= 8], copying src to dst
+// (whose width and height are src's height and width). Writing dst rows means
+// reading src columns, so it works in square tiles, small enough that each
+// tile's src rows stay in the CPU cache, instead of whole rows.
+template <size_t BYTES_PER_PIXEL>
+void  //
+OrientTiled(wuffs_base__table_u8 dst,
+            wuffs_base__table_u8 src,
+            uint32_t orientation) {
+  static constexpr size_t tile_size = 32;
+  size_t src_w = src.width / BYTES_PER_PIXEL;
+  size_t src_h = src.height;
+  size_t dst_w = src_h;
+  size_t dst_h = src_w;
+  // Orientation 5 is a transpose (dst(x, y) = src(y, x)). The others also
+  // reverse the src x and/or y coordinate.
+  bool reverse_x = (orientation == 7) || (orientation == 8);
+  bool reverse_y = (orientation == 6) || (orientation == 7);
+
+  for (size_t dy0 = 0; dy0 < dst_h; dy0 += tile_size) {
+    size_t dy1 = ((dst_h - dy0) > tile_size) ? (dy0 + tile_size) : dst_h;
+    for (size_t dx0 = 0; dx0 < dst_w; dx0 += tile_size) {
+      size_t dx1 = ((dst_w - dx0) > tile_size) ? (dx0 + tile_size) : dst_w;
+      for (size_t dy = dy0; dy < dy1; dy++) {
+        uint8_t* d = dst.ptr + (dy * dst.stride) + (dx0 * BYTES_PER_PIXEL);
+        size_t sx = reverse_x ? (src_w - 1 - dy) : dy;
+        const uint8_t* s = src.ptr + (sx * BYTES_PER_PIXEL);
+        for (size_t dx = dx0; dx < dx1; dx++) {
+          size_t sy = reverse_y ? (src_h - 1 - dx) : dx;
+          memcpy(d, s + (sy * src.stride), BYTES_PER_PIXEL);
+          d += BYTES_PER_PIXEL;
+        }
+      }
+    }
+  }
+}
+
+// ToneCurve is a color channel's TRC (Tone Reproduction Curve), mapping
+// encoded values in [0, 1] to linear light. If table is empty, it is an ICC
+// parametricCurveType function of (g, a, b, c, d, e, f): Y = (aX + b)**g + e
+// if X >= d, otherwise Y = cX + f. Otherwise, it is sampled at table.size()
+// evenly spaced points and linearly interpolated.
+struct ToneCurve {
+  float params[7];
+  std::vector<float> table;
+
+  static ToneCurve Gamma(float g) {
+    return ToneCurve{{g, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}, {}};
+  }
+
+  static ToneCurve Srgb() {
+    return ToneCurve{{2.4f, 1.0f / 1.055f, 0.055f / 1.055f, 1.0f / 12.92f,
+                      0.04045f, 0.0f, 0.0f},
+                     {}};
+  }
+
+  float Eval(float x) const {
+    if (!table.empty()) {
+      float pos = x * (float)(table.size() - 1);
+      if (!(pos > 0.0f)) {
+        return table.front();
+      } else if (pos >= (float)(table.size() - 1)) {
+        return table.back();
+      }
+      size_t i = (size_t)pos;
+      float frac = pos - (float)i;
+      return table[i] + (frac * (table[i + 1] - table[i]));
+    } else if (x >= params[4]) {
+      float base = (params[1] * x) + params[2];
+      return ((base > 0.0f) ? std::pow(base, params[0]) : 0.0f) + params[5];
+    }
+    return (params[3] * x) + params[6];
+  }
+};
+
+// ColorTransform converts from a source color space to sRGB: the source's
+// tone curves (to linear light) and then a 3x3 row-major matrix (from linear
+// source RGB to linear sRGB). sRGB's inverse tone curve is implied.
+struct ColorTransform {
+  ToneCurve curves[3];
+  float matrix[9];
+};
+
+void  //
+Mat3Mul(float* dst, const float* a, const float* b) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      dst[(3 * i) + j] = (a[(3 * i) + 0] * b[0 + j]) +
+                         (a[(3 * i) + 1] * b[3 + j]) +
+                         (a[(3 * i) + 2] * b[6 + j]);
+    }
+  }
+}
+
+bool  //
+Mat3Invert(float* dst, const float* m) {
+  float c0 = (m[4] * m[8]) - (m[5] * m[7]);
+  float c1 = (m[5] * m[6]) - (m[3] * m[8]);
+  float c2 = (m[3] * m[7]) - (m[4] * m[6]);
+  float det = (m[0] * c0) + (m[1] * c1) + (m[2] * c2);
+  if (!(std::fabs(det) > 1e-9f)) {
+    return false;
+  }
+  float k = 1.0f / det;
+  dst[0] = k * c0;
+  dst[1] = k * ((m[2] * m[7]) - (m[1] * m[8]));
+  dst[2] = k * ((m[1] * m[5]) - (m[2] * m[4]));
+  dst[3] = k * c1;
+  dst[4] = k * ((m[0] * m[8]) - (m[2] * m[6]));
+  dst[5] = k * ((m[2] * m[3]) - (m[0] * m[5]));
+  dst[6] = k * c2;
+  dst[7] = k * ((m[1] * m[6]) - (m[0] * m[7]));
+  dst[8] = k * ((m[0] * m[4]) - (m[1] * m[3]));
+  return true;
+}
+
+// SetColorTransformMatrix sets ct.matrix from rgb_to_xyz_d50, which converts
+// linear source RGB to the (D50 white point) XYZ used by ICC profiles.
+bool  //
+SetColorTransformMatrix(ColorTransform& ct, const float* rgb_to_xyz_d50) {
+  // sRGB's primaries, chromatically adapted (Bradford) to D50, as per the
+  // rXYZ, gXYZ and bXYZ tags of the ICC's sRGB profile.
+  static const float srgb_to_xyz_d50[9] = {
+      0.4360747f, 0.3850649f, 0.1430804f,  //
+      0.2225045f, 0.7168786f, 0.0606169f,  //
+      0.0139322f, 0.0971045f, 0.7141733f,  //
+  };
+  float xyz_d50_to_srgb[9];
+  return Mat3Invert(xyz_d50_to_srgb, srgb_to_xyz_d50) &&
+         (Mat3Mul(ct.matrix, xyz_d50_to_srgb, rgb_to_xyz_d50), true);
+}
+
+// MakeColorTransformFromChrm uses PNG-style cHRM chromaticities (white, red,
+// green and blue x and y, scaled by 100000) and a gAMA value (also scaled
+// by 100000, zero meaning sRGB's tone curve).
+bool  //
+MakeColorTransformFromChrm(ColorTransform& ct,
+                           const int32_t* chrm,
+                           uint32_t gama) {
+  float v[8];
+  for (int i = 0; i < 8; i++) {
+    v[i] = (float)chrm[i] / 100000.0f;
+  }
+  if (!(v[1] > 0.0f) || !(v[3] > 0.0f) || !(v[5] > 0.0f) || !(v[7] > 0.0f)) {
+    return false;
+  }
+
+  // Each primary's XYZ, up to a scale factor s. Solve for the s such that
+  // RGB (1, 1, 1) maps to the white point.
+  float primaries[9] = {
+      v[2] / v[3], v[4] / v[5], v[6] / v[7],  //
+      1.0f,        1.0f,        1.0f,         //
+      (1.0f - v[2] - v[3]) / v[3],            //
+      (1.0f - v[4] - v[5]) / v[5],            //
+      (1.0f - v[6] - v[7]) / v[7],            //
+  };
+  float white[3] = {v[0] / v[1], 1.0f, (1.0f - v[0] - v[1]) / v[1]};
+  float inv[9];
+  if (!Mat3Invert(inv, primaries)) {
+    return false;
+  }
+  float rgb_to_xyz[9];
+  for (int i = 0; i < 3; i++) {
+    float s = (inv[(3 * i) + 0] * white[0]) + (inv[(3 * i) + 1] * white[1]) +
+              (inv[(3 * i) + 2] * white[2]);
+    rgb_to_xyz[0 + i] = primaries[0 + i] * s;
+    rgb_to_xyz[3 + i] = primaries[3 + i] * s;
+    rgb_to_xyz[6 + i] = primaries[6 + i] * s;
+  }
+
+  // Adapt from the white point to D50, via the Bradford cone response.
+  static const float bradford[9] = {
+      +0.8951f, +0.2664f, -0.1614f,  //
+      -0.7502f, +1.7135f, +0.0367f,  //
+      +0.0389f, -0.0685f, +1.0296f,  //
+  };
+  static const float d50[3] = {0.9642f, 1.0000f, 0.8249f};
+  float inv_bradford[9];
+  if (!Mat3Invert(inv_bradford, bradford)) {
+    return false;
+  }
+  float scale[9] = {0};
+  for (int i = 0; i < 3; i++) {
+    float src = (bradford[(3 * i) + 0] * white[0]) +
+                (bradford[(3 * i) + 1] * white[1]) +
+                (bradford[(3 * i) + 2] * white[2]);
+    float dst = (bradford[(3 * i) + 0] * d50[0]) +
+                (bradford[(3 * i) + 1] * d50[1]) +
+                (bradford[(3 * i) + 2] * d50[2]);
+    if (!(std::fabs(src) > 1e-9f)) {
+      return false;
+    }
+    scale[(3 * i) + i] = dst / src;
+  }
+  float tmp[9];
+  float adapt[9];
+  float rgb_to_xyz_d50[9];
+  Mat3Mul(tmp, scale, bradford);
+  Mat3Mul(adapt, inv_bradford, tmp);
+  Mat3Mul(rgb_to_xyz_d50, adapt, rgb_to_xyz);
+
+  ToneCurve curve = (gama > 0) ? ToneCurve::Gamma(100000.0f / (float)gama)
+                               : ToneCurve::Srgb();
+  ct.curves[0] = curve;
+  ct.curves[1] = curve;
+  ct.curves[2] = curve;
+  return SetColorTransformMatrix(ct, rgb_to_xyz_d50);
+}
+
+// FindIccTag returns the (offset, size) of the ICC profile's tag with the
+// given signature, or (0, 0) if there is no such tag.
+std::pair<uint32_t, uint32_t>  //
+FindIccTag(wuffs_base__slice_u8 icc, uint32_t signature) {
+  uint64_t num_tags = wuffs_base__peek_u32be__no_bounds_check(icc.ptr + 128);
+  if (num_tags > ((icc.len - 132) / 12)) {
+    num_tags = (icc.len - 132) / 12;
+  }
+  for (const uint8_t* p = icc.ptr + 132; num_tags > 0; num_tags--, p += 12) {
+    if (wuffs_base__peek_u32be__no_bounds_check(p + 0) != signature) {
+      continue;
+    }
+    uint32_t offset = wuffs_base__peek_u32be__no_bounds_check(p + 4);
+    uint32_t size = wuffs_base__peek_u32be__no_bounds_check(p + 8);
+    if ((offset <= icc.len) && (size <= (icc.len - offset))) {
+      return std::make_pair(offset, size);
+    }
+    break;
+  }
+  return std::make_pair(0u, 0u);
+}
+
+bool  //
+ParseIccXyzTag(float* xyz, wuffs_base__slice_u8 icc, uint32_t signature) {
+  std::pair<uint32_t, uint32_t> tag = FindIccTag(icc, signature);
+  const uint8_t* p = icc.ptr + tag.first;
+  if ((tag.second < 20) ||
+      (wuffs_base__peek_u32be__no_bounds_check(p) != 0x58595A20)) {  // "XYZ ".
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    xyz[i] = (float)((int32_t)wuffs_base__peek_u32be__no_bounds_check(
+                 p + 8 + (4 * i))) /
+             65536.0f;
+  }
+  return true;
+}
+
+bool  //
+ParseIccCurveTag(ToneCurve& curve,
+                 wuffs_base__slice_u8 icc,
+                 uint32_t signature) {
+  std::pair<uint32_t, uint32_t> tag = FindIccTag(icc, signature);
+  const uint8_t* p = icc.ptr + tag.first;
+  if (tag.second < 12) {
+    return false;
+  }
+  uint32_t type = wuffs_base__peek_u32be__no_bounds_check(p);
+
+  if (type == 0x63757276) {  // "curv".
+    uint32_t count = wuffs_base__peek_u32be__no_bounds_check(p + 8);
+    if (count > ((tag.second - 12) / 2)) {
+      return false;
+    } else if (count == 0) {
+      curve = ToneCurve::Gamma(1.0f);
+    } else if (count == 1) {
+      uint16_t g = wuffs_base__peek_u16be__no_bounds_check(p + 12);
+      curve = ToneCurve::Gamma((float)g / 256.0f);
+    } else {
+      curve = ToneCurve::Gamma(1.0f);
+      curve.table.resize(count);
+      for (uint32_t i = 0; i < count; i++) {
+        curve.table[i] =
+            (float)wuffs_base__peek_u16be__no_bounds_check(p + 12 + (2 * i)) /
+            65535.0f;
+      }
+    }
+    return true;
+
+  } else if (type == 0x70617261) {  // "para".
+    static const uint32_t num_params[5] = {1, 3, 4, 5, 7};
+    uint16_t function_type = wuffs_base__peek_u16be__no_bounds_check(p + 8);
+    if ((function_type > 4) ||
+        (num_params[function_type] > ((tag.second - 12) / 4))) {
+      return false;
+    }
+    float v[7] = {0};
+    for (uint32_t i = 0; i < num_params[function_type]; i++) {
+      v[i] = (float)((int32_t)wuffs_base__peek_u32be__no_bounds_check(
+                 p + 12 + (4 * i))) /
+             65536.0f;
+    }
+    bool a_is_zero = (v[1] == 0.0f);
+    switch (function_type) {
+      case 0:  // Y = X**g.
+        curve = ToneCurve::Gamma(v[0]);
+        break;
+      case 1:  // Y = (aX + b)**g if X >= -b/a, otherwise 0.
+        curve = ToneCurve{
+            {v[0], v[1], v[2], 0.0f, a_is_zero ? 0.0f : (-v[2] / v[1]), 0.0f,
+             0.0f},
+            {}};
+        break;
+      case 2:  // Y = (aX + b)**g + c if X >= -b/a, otherwise c.
+        curve = ToneCurve{
+            {v[0], v[1], v[2], 0.0f, a_is_zero ? 0.0f : (-v[2] / v[1]), v[3],
+             v[3]},
+            {}};
+        break;
+      case 3:  // Y = (aX + b)**g if X >= d, otherwise cX.
+        curve = ToneCurve{{v[0], v[1], v[2], v[3], v[4], 0.0f, 0.0f}, {}};
+        break;
+      case 4:  // Y = (aX + b)**g + e if X >= d, otherwise cX + f.
+        curve = ToneCurve{{v[0], v[1], v[2], v[3], v[4], v[5], v[6]}, {}};
+        break;
+    }
+    return std::isfinite(curve.params[4]);
+  }
+  return false;
+}
+
+// MakeColorTransformFromIcc supports matrix/TRC ICC profiles (versions 2
+// and 4), either RGB (with rXYZ, gXYZ, bXYZ, rTRC, gTRC and bTRC tags) or
+// gray (with a kTRC tag). It returns false for other profiles, such as
+// LUT-based or CMYK ones.
+bool  //
+MakeColorTransformFromIcc(ColorTransform& ct, wuffs_base__slice_u8 icc) {
+  if (icc.len < 132) {
+    return false;
+  }
+  uint32_t size = wuffs_base__peek_u32be__no_bounds_check(icc.ptr + 0);
+  if ((size < 132) || (size > icc.len)) {
+    return false;
+  }
+  icc.len = size;
+  uint32_t color_space = wuffs_base__peek_u32be__no_bounds_check(icc.ptr + 16);
+  uint32_t pcs = wuffs_base__peek_u32be__no_bounds_check(icc.ptr + 20);
+  if (pcs != 0x58595A20) {  // "XYZ ".
+    return false;
+  }
+
+  if (color_space == 0x47524159) {  // "GRAY".
+    static const float identity[9] = {
+        1.0f, 0.0f, 0.0f,  //
+        0.0f, 1.0f, 0.0f,  //
+        0.0f, 0.0f, 1.0f,  //
+    };
+    if (!ParseIccCurveTag(ct.curves[0], icc, 0x6B545243)) {  // "kTRC".
+      return false;
+    }
+    ct.curves[1] = ct.curves[0];
+    ct.curves[2] = ct.curves[0];
+    memcpy(ct.matrix, identity, sizeof identity);
+    return true;
+
+  } else if (color_space != 0x52474220) {  // "RGB ".
+    return false;
+  }
+
+  float r[3];
+  float g[3];
+  float b[3];
+  if (!ParseIccXyzTag(r, icc, 0x7258595A) ||                 // "rXYZ".
+      !ParseIccXyzTag(g, icc, 0x6758595A) ||                 // "gXYZ".
+      !ParseIccXyzTag(b, icc, 0x6258595A) ||                 // "bXYZ".
+      !ParseIccCurveTag(ct.curves[0], icc, 0x72545243) ||    // "rTRC".
+      !ParseIccCurveTag(ct.curves[1], icc, 0x67545243) ||    // "gTRC".
+      !ParseIccCurveTag(ct.curves[2], icc, 0x62545243)) {    // "bTRC".
+    return false;
+  }
+  float rgb_to_xyz_d50[9] = {
+      r[0], g[0], b[0],  //
+      r[1], g[1], b[1],  //
+      r[2], g[2], b[2],  //
+  };
+  return SetColorTransformMatrix(ct, rgb_to_xyz_d50);
+}
+
+// ColorTransformIsNoOp returns whether ct is (close enough to) converting
+// from sRGB to sRGB, which is true for the common case of an embedded sRGB
+// ICC profile.
+bool  //
+ColorTransformIsNoOp(const ColorTransform& ct) {
+  for (int i = 0; i < 9; i++) {
+    float want = ((i % 4) == 0) ? 1.0f : 0.0f;
+    if (!(std::fabs(ct.matrix[i] - want) < 0.002f)) {
+      return false;
+    }
+  }
+  ToneCurve srgb = ToneCurve::Srgb();
+  for (int c = 0; c < 3; c++) {
+    for (int i = 0; i <= 255; i++) {
+      float x = (float)i / 255.0f;
+      float have = ct.curves[c].Eval(x);
+      float want = srgb.Eval(x);
+      // Compare in the encoded (perceptual) domain.
+      if (!(std::fabs(std::pow(std::fmax(have, 0.0f), 1.0f / 2.4f) -
+                      std::pow(want, 1.0f / 2.4f)) < (0.5f / 255.0f))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// ApplyColorTransform converts t's pixels, in place. Each pixel has
+// num_channels interleaved channels, each 1 byte or 2 (little-endian) bytes,
+// with red, green and blue at the given indexes and alpha (if num_channels
+// is 4) last. Premultiplied alpha is divided out and back in.
+//
+// The source tone curves are sampled once per possible channel value and
+// sRGB's inverse tone curve at 16384 points, so that each pixel costs three
+// table lookups, a 3x3 matrix multiply and three more table lookups.
+void  //
+ApplyColorTransform(wuffs_base__table_u8 t,
+                    const ColorTransform& ct,
+                    size_t channel_bytes,
+                    size_t num_channels,
+                    size_t r_index,
+                    size_t g_index,
+                    size_t b_index,
+                    bool premul) {
+  uint32_t max_value = (channel_bytes == 2) ? 65535 : 255;
+  std::vector<float> to_linear[3];
+  for (int c = 0; c < 3; c++) {
+    to_linear[c].resize(max_value + 1);
+    for (uint32_t i = 0; i <= max_value; i++) {
+      to_linear[c][i] = ct.curves[c].Eval((float)i / (float)max_value);
+    }
+  }
+  static constexpr uint32_t from_linear_len = 16384;
+  std::vector<uint16_t> from_linear(from_linear_len);
+  ToneCurve srgb = ToneCurve::Srgb();
+  for (uint32_t i = 0; i < from_linear_len; i++) {
+    float y = (float)i / (float)(from_linear_len - 1);
+    // Invert sRGB's tone curve.
+    float x = (y <= (srgb.params[4] * srgb.params[3]))
+                  ? (y / srgb.params[3])
+                  : ((std::pow(y, 1.0f / srgb.params[0]) - srgb.params[2]) /
+                     srgb.params[1]);
+    x = (x < 0.0f) ? 0.0f : (x > 1.0f) ? 1.0f : x;
+    from_linear[i] = (uint16_t)((x * (float)max_value) + 0.5f);
+  }
+  const float* m = ct.matrix;
+  float scale = (float)(from_linear_len - 1);
+
+  size_t pixel_bytes = channel_bytes * num_channels;
+  size_t width = t.width / pixel_bytes;
+  for (size_t y = 0; y < t.height; y++) {
+    uint8_t* p = t.ptr + (y * t.stride);
+    for (size_t x = 0; x < width; x++, p += pixel_bytes) {
+      uint32_t v[4];
+      for (size_t c = 0; c < num_channels; c++) {
+        v[c] = (channel_bytes == 2)
+                   ? wuffs_base__peek_u16le__no_bounds_check(p + (2 * c))
+                   : p[c];
+      }
+      uint32_t alpha = (num_channels == 4) ? v[3] : max_value;
+      if (premul && (alpha < max_value)) {
+        if (alpha == 0) {
+          continue;
+        }
+        for (size_t c = 0; c < 3; c++) {
+          uint32_t u = ((v[c] * max_value) + (alpha / 2)) / alpha;
+          v[c] = (u < max_value) ? u : max_value;
+        }
+      }
+
+      float r = to_linear[0][v[r_index]];
+      float g = to_linear[1][v[g_index]];
+      float b = to_linear[2][v[b_index]];
+      float out[3] = {
+          (m[0] * r) + (m[1] * g) + (m[2] * b),
+          (m[3] * r) + (m[4] * g) + (m[5] * b),
+          (m[6] * r) + (m[7] * g) + (m[8] * b),
+      };
+      uint32_t w[3];
+      for (int c = 0; c < 3; c++) {
+        float f = (out[c] * scale) + 0.5f;
+        f = (f > 0.0f) ? ((f < scale) ? f : scale) : 0.0f;
+        w[c] = from_linear[(uint32_t)f];
+        if (premul && (alpha < max_value)) {
+          w[c] = ((w[c] * alpha) + (max_value / 2)) / max_value;
+        }
+      }
+
+      v[r_index] = w[0];
+      v[g_index] = w[1];
+      v[b_index] = w[2];
+      for (size_t c = 0; c < num_channels; c++) {
+        if (channel_bytes == 2) {
+          wuffs_base__poke_u16le__no_bounds_check(p + (2 * c),
+                                                  (uint16_t)v[c]);
+        } else {
+          p[c] = (uint8_t)v[c];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+namespace private_impl {
+
+class DecodeImageState {
+ public:
+  DecodeImageState(DecodeImageCallbacks& callbacks,
+                   DecodeImageFramesCallbacks* frames_callbacks,
+                   DecodeImageContext* context,
+                   sync_io::Input& input,
+                   const QuirkKeyValuePair* quirks_ptr,
+                   const size_t quirks_len,
+                   uint64_t flags,
+                   wuffs_base__pixel_blend pixel_blend,
+                   wuffs_base__color_u32_argb_premul background_color,
+                   uint32_t max_incl_dimension,
+                   uint64_t max_incl_metadata_length,
+                   DecodeImageArgResize resize =
+                       DecodeImageArgResize::DefaultValue(),
+                   bool probe = false,
+                   uint64_t probe_flags = 0);
+
+  // Resume decodes until it is finished, successfully or not, and returns
+  // true. It instead returns false if the input's CopyIn returned
+  // async_io::NeedMoreInput, in which case Resume can be called again later.
+  bool Resume();
+
+  // Finish calls the callbacks' Done method and returns the result.
+  DecodeImageResult Finish();
+
+  // FinishProbe is like Finish but for ProbeImage. The DecodeImageResult
+  // passed to the callbacks' Done method never has a valid pixbuf.
+  ProbeImageResult FinishProbe();
+
+ private:
+  // Phase is how far Resume has got. Each phase that reads input can be
+  // re-entered after a suspension, re-calling the same image_decoder method
+  // (which is itself a coroutine).
+  enum Phase {
+    PHASE_SNIFF,
+    PHASE_REDIRECT,
+    PHASE_SELECT_DECODER,
+    PHASE_IMAGE_CONFIG,
+    PHASE_ALLOC,
+    PHASE_FRAME_CONFIG,
+    PHASE_FRAME,
+    PHASE_METADATA_AFTER_THE_FRAME,
+    PHASE_FRAMES_FRAME_CONFIG,
+    PHASE_FRAMES_PREPARE_CANVAS,
+    PHASE_FRAMES_FRAME,
+    PHASE_PROBE_FRAME_CONFIG,
+  };
+
+  // Finished records the result and returns true. The result includes the
+  // pixel buffer if return_pixbuf is true.
+  bool Finished(std::string&& error_message, bool return_pixbuf);
+
+  // Suspend records that the input's CopyIn returned async_io::NeedMoreInput
+  // and returns false.
+  bool Suspend();
+
+  // Resize replaces the pixel buffer with one resampled to m_resize's size.
+  std::string Resize();
+
+  // ApplyOrientation rotates and/or flips the pixel buffer per m_orientation.
+  std::string ApplyOrientation();
+
+  // ConvertToSrgb converts the pixel buffer's colors, per the color space
+  // metadata, to sRGB.
+  void ConvertToSrgb();
+
+  // HandleProgress calls the callbacks' HandleProgress method, if more input
+  // was consumed since the previous call.
+  std::string HandleProgress(wuffs_base__rect_ie_u32 dirty_rect);
+
+  // HandleMetadata handles a wuffs_base__note__metadata_reported status. It
+  // resumes the previous call if that returned async_io::NeedMoreInput.
+  std::string HandleMetadata();
+
+  // DIHM1 is HandleMetadata's private_impl::HandleMetadata callback, passing
+  // each metadata chunk on to the callbacks' HandleMetadata method. When
+  // probing for the EXIF orientation, it parses EXIF metadata first.
+  static std::string DIHM1(void* self,
+                           const wuffs_base__more_information* minfo,
+                           wuffs_base__slice_u8 raw);
+
+  DecodeImageCallbacks& m_callbacks;
+  DecodeImageFramesCallbacks* m_frames_callbacks;
+  sync_io::Input& m_input;
+  std::vector<QuirkKeyValuePair> m_quirks;
+  uint64_t m_flags;
+  wuffs_base__pixel_blend m_pixel_blend;
+  wuffs_base__color_u32_argb_premul m_background_color;
+  uint32_t m_max_incl_dimension;
+  DecodeImageArgResize m_resize;
+
+  wuffs_base__io_buffer* m_io_buf;
+  wuffs_base__io_buffer m_fallback_io_buf;
+  std::unique_ptr<uint8_t[]> m_fallback_io_array;
+
+  Phase m_phase;
+  std::string m_ret_error_message;
+  bool m_ret_pixbuf;
+  bool m_suspended;
+
+  wuffs_base__image_decoder::unique_ptr m_image_decoder;
+  wuffs_base__image_config m_image_config;
+  sync_io::DynIOBuffer m_raw_metadata_buf;
+  HandleMetadataState m_metadata_state;
+  bool m_in_metadata;
+  uint64_t m_start_pos;
+  bool m_interested_in_metadata_after_the_frame;
+  bool m_redirected;
+  int32_t m_fourcc;
+  uint64_t m_redirect_pos;
+
+  MemOwner m_pixbuf_mem_owner;
+  wuffs_base__pixel_buffer m_pixel_buffer;
+  MemOwner m_workbuf_mem_owner;
+  wuffs_base__slice_u8 m_workbuf;
+  wuffs_base__frame_config m_frame_config;
+  std::string m_message;
+  // m_progress_pos is the reader position at the previous HandleProgress
+  // call, so that it is not called again until more input is consumed.
+  uint64_t m_progress_pos;
+
+  // These fields are only used by DecodeImageFrames.
+  bool m_valid_background_color;
+  wuffs_base__rect_ie_u32 m_canvas_bounds;
+  size_t m_bytes_per_pixel;
+  // m_backup_mem_owner holds the canvas pixels under a RESTORE_PREVIOUS
+  // frame.
+  MemOwner m_backup_mem_owner;
+  size_t m_backup_len;
+  wuffs_base__animation_disposal m_prev_disposal;
+  wuffs_base__rect_ie_u32 m_prev_bounds;
+  wuffs_base__rect_ie_u32 m_bounds;
+  wuffs_base__rect_ie_u32 m_dirty_rect;
+  wuffs_base__pixel_blend m_frame_pixel_blend;
+  uint64_t m_num_frames;
+
+  // These fields are only used by ProbeImage, which also uses m_num_frames.
+  bool m_probe;
+  uint64_t m_probe_flags;
+
+  // m_orientation is the EXIF Orientation tag's value, or zero if unknown.
+  uint32_t m_orientation;
+
+  // These fields hold the color space metadata, for CONVERT_TO_SRGB.
+  bool m_has_srgb;
+  bool m_has_chrm;
+  uint32_t m_gama;
+  int32_t m_chrm[8];
+  std::vector<uint8_t> m_iccp;
+
+  // Delete the copy and assign constructors.
+  DecodeImageState(const DecodeImageState&) = delete;
+  DecodeImageState& operator=(const DecodeImageState&) = delete;
+};
+
+DecodeImageState::DecodeImageState(
+    DecodeImageCallbacks& callbacks,
+    DecodeImageFramesCallbacks* frames_callbacks,
+    DecodeImageContext* context,
+    sync_io::Input& input,
+    const QuirkKeyValuePair* quirks_ptr,
+    const size_t quirks_len,
+    uint64_t flags,
+    wuffs_base__pixel_blend pixel_blend,
+    wuffs_base__color_u32_argb_premul background_color,
+    uint32_t max_incl_dimension,
+    uint64_t max_incl_metadata_length,
+    DecodeImageArgResize resize,
+    bool probe,
+    uint64_t probe_flags)
+    : m_callbacks(callbacks),
+      m_frames_callbacks(frames_callbacks),
+      m_input(input),
+      m_quirks(quirks_ptr, quirks_ptr + quirks_len),
+      m_flags(flags),
+      m_pixel_blend(pixel_blend),
+      m_background_color(background_color),
+      m_max_incl_dimension(max_incl_dimension),
+      m_resize(resize),
+      m_io_buf(input.BringsItsOwnIOBuffer()),
+      m_fallback_io_buf(wuffs_base__empty_io_buffer()),
+      m_fallback_io_array(nullptr),
+      m_phase(PHASE_SNIFF),
+      m_ret_pixbuf(false),
+      m_suspended(false),
+      m_image_decoder(nullptr),
+      m_image_config(wuffs_base__null_image_config()),
+      m_raw_metadata_buf(max_incl_metadata_length),
+      m_in_metadata(false),
+      m_start_pos(0),
+      m_interested_in_metadata_after_the_frame(false),
+      m_redirected(false),
+      m_fourcc(0),
+      m_redirect_pos(0),
+      m_pixbuf_mem_owner(nullptr, &free),
+      m_pixel_buffer(wuffs_base__null_pixel_buffer()),
+      m_workbuf_mem_owner(nullptr, &free),
+      m_workbuf(wuffs_base__empty_slice_u8()),
+      m_frame_config(wuffs_base__null_frame_config()),
+      m_progress_pos(0),
+      m_valid_background_color(
+          wuffs_base__color_u32_argb_premul__is_valid(background_color)),
+      m_canvas_bounds(wuffs_base__empty_rect_ie_u32()),
+      m_bytes_per_pixel(0),
+      m_backup_mem_owner(nullptr, &free),
+      m_backup_len(0),
+      m_prev_disposal(WUFFS_BASE__ANIMATION_DISPOSAL__NONE),
+      m_prev_bounds(wuffs_base__empty_rect_ie_u32()),
+      m_bounds(wuffs_base__empty_rect_ie_u32()),
+      m_dirty_rect(wuffs_base__empty_rect_ie_u32()),
+      m_frame_pixel_blend(WUFFS_BASE__PIXEL_BLEND__SRC),
+      m_num_frames(0),
+      m_probe(probe),
+      m_probe_flags(probe_flags),
+      m_orientation(0),
+      m_has_srgb(false),
+      m_has_chrm(false),
+      m_gama(0),
+      m_chrm() {
+  if (m_io_buf) {
+    // No-op.
+  } else if (context) {
+    m_fallback_io_buf = context->FallbackIOBuffer();
+    m_io_buf = &m_fallback_io_buf;
+  } else {
+    // Probing typically needs only the first few hundred bytes, so read less
+    // (e.g. from a FileInput) than when decoding the pixels.
+    size_t len = probe ? 4096 : 32768;
+    m_fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[len]);
+    m_fallback_io_buf =
+        wuffs_base__ptr_u8__writer(m_fallback_io_array.get(), len);
+    m_io_buf = &m_fallback_io_buf;
+  }
+  m_start_pos = m_io_buf->reader_position();
+
   // Check args.
   switch (pixel_blend) {
     case WUFFS_BASE__PIXEL_BLEND__SRC:
     case WUFFS_BASE__PIXEL_BLEND__SRC_OVER:
       break;
     default:
-      return DecodeImageResult(DecodeImage_UnsupportedPixelBlend);
-  }
-
-  wuffs_base__image_config image_config = wuffs_base__null_image_config();
-  sync_io::DynIOBuffer raw_metadata_buf(max_incl_metadata_length);
-  uint64_t start_pos = io_buf.reader_position();
-  bool interested_in_metadata_after_the_frame = false;
-  bool redirected = false;
-  int32_t fourcc = 0;
-redirect:
-  do {
-    // Determine the image format.
-    if (!redirected) {
-      while (true) {
-        fourcc = wuffs_base__magic_number_guess_fourcc(io_buf.reader_slice(),
-                                                       io_buf.meta.closed);
-        if (fourcc > 0) {
-          break;
-        } else if ((fourcc == 0) && (io_buf.reader_length() >= 64)) {
-          // Having (fourcc == 0) means that Wuffs' built in MIME sniffer
-          // didn't recognize the image format. Nonetheless, custom callbacks
-          // may still be able to do their own MIME sniffing, for exotic image
-          // types. We try to give them at least 64 bytes of prefix data when
-          // one-shot-calling callbacks.SelectDecoder. There is no mechanism
-          // for the callbacks to request a longer prefix.
-          break;
-        } else if (io_buf.meta.closed || (io_buf.writer_length() == 0)) {
-          fourcc = 0;
-          break;
+      m_ret_error_message = DecodeImage_UnsupportedPixelBlend;
+      break;
+  }
+}
+
+bool  //
+DecodeImageState::Finished(std::string&& error_message, bool return_pixbuf) {
+  m_ret_error_message = std::move(error_message);
+  m_ret_pixbuf = return_pixbuf;
+  return true;
+}
+
+bool  //
+DecodeImageState::Suspend() {
+  m_suspended = true;
+  return false;
+}
+
+std::string  //
+DecodeImageState::HandleMetadata() {
+  std::string error_message = private_impl::HandleMetadata(
+      DecodeImageErrorMessages, m_input, *m_io_buf, m_raw_metadata_buf,
+      m_metadata_state, DIHM0, static_cast<void*>(m_image_decoder.get()),
+      DIHM1, static_cast<void*>(this));
+  m_in_metadata = (error_message == async_io::NeedMoreInput);
+  return error_message;
+}
+
+std::string  //
+DecodeImageState::DIHM1(void* self,
+                        const wuffs_base__more_information* minfo,
+                        wuffs_base__slice_u8 raw) {
+  DecodeImageState* state = static_cast<DecodeImageState*>(self);
+  bool parsed = minfo->flavor ==
+                WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_PARSED;
+  uint64_t report_flag = 0;
+  switch (minfo->metadata__fourcc()) {
+    case WUFFS_BASE__FOURCC__EXIF:
+      report_flag = DecodeImageArgFlags::REPORT_METADATA_EXIF;
+      if ((state->m_probe_flags & ProbeImageArgFlags::REPORT_ORIENTATION) ||
+          (state->m_flags & DecodeImageArgFlags::APPLY_ORIENTATION)) {
+        if ((state->m_orientation == 0) &&
+            (minfo->flavor ==
+             WUFFS_BASE__MORE_INFORMATION__FLAVOR__METADATA_RAW_PASSTHROUGH)) {
+          state->m_orientation = ParseExifOrientation(raw);
         }
-        std::string error_message = input.CopyIn(&io_buf);
-        if (!error_message.empty()) {
-          return DecodeImageResult(std::move(error_message));
+      }
+      break;
+    case WUFFS_BASE__FOURCC__CHRM:
+      report_flag = DecodeImageArgFlags::REPORT_METADATA_CHRM;
+      if ((state->m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) && parsed) {
+        state->m_has_chrm = true;
+        for (uint32_t i = 0; i < 8; i++) {
+          state->m_chrm[i] = minfo->metadata_parsed__chrm(i);
         }
       }
-    } else {
-      wuffs_base__io_buffer empty = wuffs_base__empty_io_buffer();
-      wuffs_base__more_information minfo = wuffs_base__empty_more_information();
-      wuffs_base__status tmm_status =
-          image_decoder->tell_me_more(&empty, &minfo, &io_buf);
-      if (tmm_status.repr != nullptr) {
-        return DecodeImageResult(tmm_status.message());
+      break;
+    case WUFFS_BASE__FOURCC__GAMA:
+      report_flag = DecodeImageArgFlags::REPORT_METADATA_GAMA;
+      if ((state->m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) && parsed) {
+        state->m_gama = minfo->metadata_parsed__gama();
       }
-      if (minfo.flavor != WUFFS_BASE__MORE_INFORMATION__FLAVOR__IO_REDIRECT) {
-        return DecodeImageResult(DecodeImage_UnsupportedImageFormat);
+      break;
+    case WUFFS_BASE__FOURCC__ICCP:
+      report_flag = DecodeImageArgFlags::REPORT_METADATA_ICCP;
+      // A JPEG's ICC profile can be split over multiple APP2 segments, each
+      // reported separately. Concatenate them.
+      if (state->m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) {
+        state->m_iccp.insert(state->m_iccp.end(), raw.ptr, raw.ptr + raw.len);
       }
-      uint64_t pos = minfo.io_redirect__range().min_incl;
-      if (pos <= start_pos) {
-        // Redirects must go forward.
-        return DecodeImageResult(DecodeImage_UnsupportedImageFormat);
+      break;
+    case WUFFS_BASE__FOURCC__SRGB:
+      report_flag = DecodeImageArgFlags::REPORT_METADATA_SRGB;
+      if ((state->m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) && parsed) {
+        state->m_has_srgb = true;
       }
-      std::string error_message =
-          DecodeImageAdvanceIOBufferTo(input, io_buf, pos);
-      if (!error_message.empty()) {
-        return DecodeImageResult(std::move(error_message));
+      break;
+  }
+  // Metadata that was only requested internally (e.g. for APPLY_ORIENTATION
+  // or CONVERT_TO_SRGB) is not passed on to the callbacks.
+  if ((report_flag != 0) && !(state->m_flags & report_flag)) {
+    return "";
+  }
+  return state->m_callbacks.HandleMetadata(*minfo, raw);
+}
+
+std::string  //
+DecodeImageState::HandleProgress(wuffs_base__rect_ie_u32 dirty_rect) {
+  uint64_t pos = m_io_buf->reader_position();
+  if (pos == m_progress_pos) {
+    return "";
+  }
+  m_progress_pos = pos;
+  return m_callbacks.HandleProgress(m_pixel_buffer, dirty_rect);
+}
+
+bool  //
+DecodeImageState::Resume() {
+  if (!m_ret_error_message.empty()) {
+    // The constructor failed.
+    return true;
+  }
+  m_suspended = false;
+
+  if (m_in_metadata) {
+    std::string error_message = HandleMetadata();
+    if (m_in_metadata) {
+      return Suspend();
+    } else if (!error_message.empty()) {
+      // m_num_frames is only ever positive when decoding multiple frames (or
+      // when probing, which ignores the pixbuf).
+      return Finished(std::move(error_message), m_num_frames > 0);
+    }
+  }
+
+  while (true) {
+    switch (m_phase) {
+      case PHASE_SNIFF: {
+        // Determine the image format.
+        while (true) {
+          m_fourcc = wuffs_base__magic_number_guess_fourcc(
+              m_io_buf->reader_slice(), m_io_buf->meta.closed);
+          if (m_fourcc > 0) {
+            break;
+          } else if ((m_fourcc == 0) && (m_io_buf->reader_length() >= 64)) {
+            // Having (fourcc == 0) means that Wuffs' built in MIME sniffer
+            // didn't recognize the image format. Nonetheless, custom
+            // callbacks may still be able to do their own MIME sniffing, for
+            // exotic image types. We try to give them at least 64 bytes of
+            // prefix data when one-shot-calling callbacks.SelectDecoder.
+            // There is no mechanism for the callbacks to request a longer
+            // prefix.
+            break;
+          } else if (m_io_buf->meta.closed ||
+                     (m_io_buf->writer_length() == 0)) {
+            m_fourcc = 0;
+            break;
+          }
+          std::string error_message = m_input.CopyIn(m_io_buf);
+          if (error_message == async_io::NeedMoreInput) {
+            return Suspend();
+          } else if (!error_message.empty()) {
+            return Finished(std::move(error_message), false);
+          }
+        }
+        m_phase = PHASE_SELECT_DECODER;
+        break;
       }
-      fourcc = (int32_t)(minfo.io_redirect__fourcc());
-      if (fourcc == 0) {
-        return DecodeImageResult(DecodeImage_UnsupportedImageFormat);
+
+      case PHASE_REDIRECT: {
+        std::string error_message =
+            DecodeImageAdvanceIOBufferTo(m_input, *m_io_buf, m_redirect_pos);
+        if (error_message == async_io::NeedMoreInput) {
+          return Suspend();
+        } else if (!error_message.empty()) {
+          return Finished(std::move(error_message), false);
+        } else if (m_fourcc == 0) {
+          return Finished(DecodeImage_UnsupportedImageFormat, false);
+        }
+        m_image_decoder.reset();
+        m_phase = PHASE_SELECT_DECODER;
+        break;
       }
-      image_decoder.reset();
-    }
 
-    // Select the image decoder.
-    image_decoder = callbacks.SelectDecoder(
-        (uint32_t)fourcc, io_buf.reader_slice(), io_buf.meta.closed);
-    if (!image_decoder) {
-      return DecodeImageResult(DecodeImage_UnsupportedImageFormat);
-    }
+      case PHASE_SELECT_DECODER: {
+        // Select the image decoder.
+        m_image_decoder = m_callbacks.SelectDecoder(
+            (uint32_t)m_fourcc, m_io_buf->reader_slice(),
+            m_io_buf->meta.closed);
+        if (!m_image_decoder) {
+          return Finished(DecodeImage_UnsupportedImageFormat, false);
+        }
 
-    // Apply quirks.
-    for (size_t i = 0; i < quirks_len; i++) {
-      image_decoder->set_quirk(quirks_ptr[i].first, quirks_ptr[i].second);
-    }
+        // Apply quirks.
+        for (size_t i = 0; i < m_quirks.size(); i++) {
+          m_image_decoder->set_quirk(m_quirks[i].first, m_quirks[i].second);
+        }
+
+        // Apply flags.
+        if (m_flags != 0) {
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_CHRM) {
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__CHRM,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_EXIF) {
+            m_interested_in_metadata_after_the_frame = true;
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__EXIF,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_GAMA) {
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__GAMA,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_ICCP) {
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__ICCP,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_KVP) {
+            m_interested_in_metadata_after_the_frame = true;
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__KVP,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_SRGB) {
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__SRGB,
+                                                 true);
+          }
+          if (m_flags & DecodeImageArgFlags::REPORT_METADATA_XMP) {
+            m_interested_in_metadata_after_the_frame = true;
+            m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__XMP,
+                                                 true);
+          }
+        }
+        if ((m_probe_flags & ProbeImageArgFlags::REPORT_ORIENTATION) ||
+            (m_flags & DecodeImageArgFlags::APPLY_ORIENTATION)) {
+          m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__EXIF, true);
+        }
+        if (m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) {
+          m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__CHRM, true);
+          m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__GAMA, true);
+          m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__ICCP, true);
+          m_image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__SRGB, true);
+        }
+        m_phase = PHASE_IMAGE_CONFIG;
+        break;
+      }
 
-    // Apply flags.
-    if (flags != 0) {
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_CHRM) {
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__CHRM, true);
+      case PHASE_IMAGE_CONFIG: {
+        // Decode the image config.
+        while (true) {
+          wuffs_base__status id_dic_status =
+              m_image_decoder->decode_image_config(&m_image_config, m_io_buf);
+          if (id_dic_status.repr == nullptr) {
+            break;
+          } else if (id_dic_status.repr == wuffs_base__note__i_o_redirect) {
+            if (m_redirected) {
+              return Finished(DecodeImage_UnsupportedImageFormat, false);
+            }
+            m_redirected = true;
+            wuffs_base__io_buffer empty = wuffs_base__empty_io_buffer();
+            wuffs_base__more_information minfo =
+                wuffs_base__empty_more_information();
+            wuffs_base__status tmm_status =
+                m_image_decoder->tell_me_more(&empty, &minfo, m_io_buf);
+            if (tmm_status.repr != nullptr) {
+              return Finished(tmm_status.message(), false);
+            }
+            if (minfo.flavor !=
+                WUFFS_BASE__MORE_INFORMATION__FLAVOR__IO_REDIRECT) {
+              return Finished(DecodeImage_UnsupportedImageFormat, false);
+            }
+            m_redirect_pos = minfo.io_redirect__range().min_incl;
+            if (m_redirect_pos <= m_start_pos) {
+              // Redirects must go forward.
+              return Finished(DecodeImage_UnsupportedImageFormat, false);
+            }
+            m_fourcc = (int32_t)(minfo.io_redirect__fourcc());
+            m_phase = PHASE_REDIRECT;
+            break;
+          } else if (id_dic_status.repr ==
+                     wuffs_base__note__metadata_reported) {
+            std::string error_message = HandleMetadata();
+            if (m_in_metadata) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          } else if (id_dic_status.repr !=
+                     wuffs_base__suspension__short_read) {
+            return Finished(id_dic_status.message(), false);
+          } else if (m_io_buf->meta.closed) {
+            return Finished(DecodeImage_UnexpectedEndOfFile, false);
+          } else {
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          }
+        }
+        if (m_phase != PHASE_IMAGE_CONFIG) {
+          break;
+        } else if (!m_probe) {
+          m_phase = PHASE_ALLOC;
+        } else if (m_probe_flags & ProbeImageArgFlags::COUNT_FRAMES) {
+          m_phase = PHASE_PROBE_FRAME_CONFIG;
+        } else {
+          return Finished("", false);
+        }
+        break;
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_EXIF) {
-        interested_in_metadata_after_the_frame = true;
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__EXIF, true);
+
+      case PHASE_ALLOC: {
+        if (!m_interested_in_metadata_after_the_frame &&
+            !m_frames_callbacks) {
+          m_raw_metadata_buf.drop();
+        }
+
+        // Select the pixel format.
+        uint32_t w = m_image_config.pixcfg.width();
+        uint32_t h = m_image_config.pixcfg.height();
+        if ((w > m_max_incl_dimension) || (h > m_max_incl_dimension)) {
+          return Finished(DecodeImage_MaxInclDimensionExceeded, false);
+        }
+        wuffs_base__pixel_format pixel_format =
+            m_callbacks.SelectPixfmt(m_image_config);
+        if (pixel_format.repr != m_image_config.pixcfg.pixel_format().repr) {
+          switch (pixel_format.repr) {
+            case WUFFS_BASE__PIXEL_FORMAT__Y:
+            case WUFFS_BASE__PIXEL_FORMAT__BGR_565:
+            case WUFFS_BASE__PIXEL_FORMAT__BGR:
+            case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL:
+            case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE:
+            case WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL:
+            case WUFFS_BASE__PIXEL_FORMAT__RGB:
+            case WUFFS_BASE__PIXEL_FORMAT__RGBA_NONPREMUL:
+            case WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL:
+              break;
+            default:
+              return Finished(DecodeImage_UnsupportedPixelFormat, false);
+          }
+          m_image_config.pixcfg.set(pixel_format.repr,
+                                    WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
+        }
+        if (m_frames_callbacks) {
+          // Compositing frames needs one palette and direct access to the
+          // pixels.
+          wuffs_base__pixel_format pf = m_image_config.pixcfg.pixel_format();
+          if (pf.is_indexed() || !pf.is_interleaved() ||
+              ((pf.bits_per_pixel() & 7) != 0)) {
+            return Finished(DecodeImage_UnsupportedPixelFormat, false);
+          }
+        } else if ((m_resize.width > 0) || (m_resize.height > 0)) {
+          // Resampling needs 8 or 16 bits per channel.
+          wuffs_base__pixel_format pf = m_image_config.pixcfg.pixel_format();
+          if (pf.is_indexed() || !pf.is_interleaved() ||
+              ((pf.bits_per_pixel() & 7) != 0) ||
+              (pf.repr == WUFFS_BASE__PIXEL_FORMAT__BGR_565)) {
+            return Finished(DecodeImage_UnsupportedPixelFormat, false);
+          }
+        }
+
+        // Allocate the pixel buffer. DecodeImageFrames always fills it.
+        DecodeImageCallbacks::AllocPixbufResult alloc_pixbuf_result =
+            m_callbacks.AllocPixbuf(
+                m_image_config, m_valid_background_color || m_frames_callbacks);
+        if (!alloc_pixbuf_result.error_message.empty()) {
+          return Finished(std::move(alloc_pixbuf_result.error_message), false);
+        }
+        m_pixbuf_mem_owner = std::move(alloc_pixbuf_result.mem_owner);
+        m_pixel_buffer = alloc_pixbuf_result.pixbuf;
+        if (m_frames_callbacks) {
+          // No-op. PHASE_FRAMES_PREPARE_CANVAS fills it.
+        } else if (m_valid_background_color) {
+          wuffs_base__status pb_scufr_status =
+              m_pixel_buffer.set_color_u32_fill_rect(
+                  m_pixel_buffer.pixcfg.bounds(), m_background_color);
+          if (pb_scufr_status.repr != nullptr) {
+            return Finished(pb_scufr_status.message(), false);
+          }
+        }
+
+        // Allocate the work buffer. Wuffs' decoders conventionally assume
+        // that this can be uninitialized memory.
+        wuffs_base__range_ii_u64 workbuf_len = m_image_decoder->workbuf_len();
+        DecodeImageCallbacks::AllocWorkbufResult alloc_workbuf_result =
+            m_callbacks.AllocWorkbuf(workbuf_len, true);
+        if (!alloc_workbuf_result.error_message.empty()) {
+          return Finished(std::move(alloc_workbuf_result.error_message),
+                          false);
+        } else if (alloc_workbuf_result.workbuf.len < workbuf_len.min_incl) {
+          return Finished(DecodeImage_BufferIsTooShort, false);
+        }
+        m_workbuf_mem_owner = std::move(alloc_workbuf_result.mem_owner);
+        m_workbuf = alloc_workbuf_result.workbuf;
+
+        if (m_frames_callbacks) {
+          m_canvas_bounds = m_pixel_buffer.pixcfg.bounds();
+          m_bytes_per_pixel =
+              m_pixel_buffer.pixcfg.pixel_format().bits_per_pixel() / 8;
+          m_phase = PHASE_FRAMES_FRAME_CONFIG;
+        } else {
+          m_phase = PHASE_FRAME_CONFIG;
+        }
+        break;
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_GAMA) {
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__GAMA, true);
+
+      case PHASE_FRAME_CONFIG: {
+        // Decode the frame config.
+        while (true) {
+          wuffs_base__status id_dfc_status =
+              m_image_decoder->decode_frame_config(&m_frame_config, m_io_buf);
+          if (id_dfc_status.repr == nullptr) {
+            break;
+          } else if (id_dfc_status.repr ==
+                     wuffs_base__note__metadata_reported) {
+            std::string error_message = HandleMetadata();
+            if (m_in_metadata) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          } else if (id_dfc_status.repr !=
+                     wuffs_base__suspension__short_read) {
+            return Finished(id_dfc_status.message(), false);
+          } else if (m_io_buf->meta.closed) {
+            return Finished(DecodeImage_UnexpectedEndOfFile, false);
+          } else {
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          }
+        }
+
+        if ((m_pixel_blend == WUFFS_BASE__PIXEL_BLEND__SRC_OVER) &&
+            m_frame_config.overwrite_instead_of_blend()) {
+          m_pixel_blend = WUFFS_BASE__PIXEL_BLEND__SRC;
+        }
+        m_progress_pos = m_io_buf->reader_position();
+        m_phase = PHASE_FRAME;
+        break;
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_ICCP) {
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__ICCP, true);
+
+      case PHASE_FRAME: {
+        // Decode the frame (the pixels).
+        //
+        // From here on, always returns the pixel_buffer. If we get this far,
+        // we can still display a partial image, even if we encounter an
+        // error.
+        while (true) {
+          wuffs_base__status id_df_status = m_image_decoder->decode_frame(
+              &m_pixel_buffer, m_io_buf, m_pixel_blend, m_workbuf, nullptr);
+          if (id_df_status.repr == nullptr) {
+            break;
+          } else if (id_df_status.repr != wuffs_base__suspension__short_read) {
+            m_message = id_df_status.message();
+            break;
+          } else if (m_io_buf->meta.closed) {
+            m_message = DecodeImage_UnexpectedEndOfFile;
+            break;
+          } else {
+            std::string hp_message =
+                HandleProgress(m_image_decoder->frame_dirty_rect());
+            if (!hp_message.empty()) {
+              return Finished(std::move(hp_message), true);
+            }
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              m_message = std::move(error_message);
+              break;
+            }
+          }
+        }
+
+        if (!m_interested_in_metadata_after_the_frame) {
+          return Finished(std::move(m_message), true);
+        }
+        m_phase = PHASE_METADATA_AFTER_THE_FRAME;
+        break;
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_KVP) {
-        interested_in_metadata_after_the_frame = true;
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__KVP, true);
+
+      case PHASE_METADATA_AFTER_THE_FRAME: {
+        // Decode any metadata after the frame.
+        while (true) {
+          wuffs_base__status id_dfc_status =
+              m_image_decoder->decode_frame_config(NULL, m_io_buf);
+          if (id_dfc_status.repr == wuffs_base__note__end_of_data) {
+            break;
+          } else if (id_dfc_status.repr == nullptr) {
+            continue;
+          } else if (id_dfc_status.repr ==
+                     wuffs_base__note__metadata_reported) {
+            std::string error_message = HandleMetadata();
+            if (m_in_metadata) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          } else if (id_dfc_status.repr !=
+                     wuffs_base__suspension__short_read) {
+            return Finished(id_dfc_status.message(), false);
+          } else if (m_io_buf->meta.closed) {
+            return Finished(DecodeImage_UnexpectedEndOfFile, false);
+          } else {
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          }
+        }
+        return Finished(std::move(m_message), true);
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_SRGB) {
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__SRGB, true);
+
+      case PHASE_FRAMES_FRAME_CONFIG: {
+        // Decode the frame config. From here on, the pixel buffer is returned
+        // if (and only if) at least one frame was decoded.
+        while (true) {
+          wuffs_base__status id_dfc_status =
+              m_image_decoder->decode_frame_config(&m_frame_config, m_io_buf);
+          if (id_dfc_status.repr == nullptr) {
+            break;
+          } else if (id_dfc_status.repr == wuffs_base__note__end_of_data) {
+            return Finished("", m_num_frames > 0);
+          } else if (id_dfc_status.repr ==
+                     wuffs_base__note__metadata_reported) {
+            std::string error_message = HandleMetadata();
+            if (m_in_metadata) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), m_num_frames > 0);
+            }
+          } else if (id_dfc_status.repr !=
+                     wuffs_base__suspension__short_read) {
+            return Finished(id_dfc_status.message(), m_num_frames > 0);
+          } else if (m_io_buf->meta.closed) {
+            return Finished(DecodeImage_UnexpectedEndOfFile, m_num_frames > 0);
+          } else {
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), m_num_frames > 0);
+            }
+          }
+        }
+        m_phase = PHASE_FRAMES_PREPARE_CANVAS;
+        break;
       }
-      if (flags & DecodeImageArgFlags::REPORT_METADATA_XMP) {
-        interested_in_metadata_after_the_frame = true;
-        image_decoder->set_report_metadata(WUFFS_BASE__FOURCC__XMP, true);
+
+      case PHASE_FRAMES_PREPARE_CANVAS: {
+        // Prepare the canvas: fill it for the first frame, otherwise apply
+        // the previous frame's disposal.
+        m_dirty_rect = wuffs_base__empty_rect_ie_u32();
+        if (m_num_frames == 0) {
+          if (!m_valid_background_color) {
+            m_background_color = m_frame_config.background_color();
+          }
+          m_dirty_rect = m_canvas_bounds;
+          wuffs_base__status pb_scufr_status =
+              m_pixel_buffer.set_color_u32_fill_rect(m_canvas_bounds,
+                                                     m_background_color);
+          if (pb_scufr_status.repr != nullptr) {
+            return Finished(pb_scufr_status.message(), m_num_frames > 0);
+          }
+        } else if (m_prev_disposal ==
+                   WUFFS_BASE__ANIMATION_DISPOSAL__RESTORE_BACKGROUND) {
+          m_dirty_rect = m_prev_bounds;
+          wuffs_base__status pb_scufr_status =
+              m_pixel_buffer.set_color_u32_fill_rect(m_prev_bounds,
+                                                     m_background_color);
+          if (pb_scufr_status.repr != nullptr) {
+            return Finished(pb_scufr_status.message(), m_num_frames > 0);
+          }
+        } else if (m_prev_disposal ==
+                   WUFFS_BASE__ANIMATION_DISPOSAL__RESTORE_PREVIOUS) {
+          m_dirty_rect = m_prev_bounds;
+          DecodeImageFramesCopyRect(
+              m_pixel_buffer, m_prev_bounds,
+              static_cast<uint8_t*>(m_backup_mem_owner.get()), false);
+        }
+
+        m_bounds = m_frame_config.bounds().intersect(m_canvas_bounds);
+        if (m_frame_config.disposal() ==
+            WUFFS_BASE__ANIMATION_DISPOSAL__RESTORE_PREVIOUS) {
+          size_t n =
+              (size_t)m_bounds.width() * m_bounds.height() * m_bytes_per_pixel;
+          if (m_backup_len < n) {
+            m_backup_mem_owner.reset(malloc(n));
+            m_backup_len = m_backup_mem_owner ? n : 0;
+            if (!m_backup_mem_owner) {
+              return Finished(DecodeImage_OutOfMemory, m_num_frames > 0);
+            }
+          }
+          DecodeImageFramesCopyRect(
+              m_pixel_buffer, m_bounds,
+              static_cast<uint8_t*>(m_backup_mem_owner.get()), true);
+        }
+
+        m_frame_pixel_blend = m_frame_config.overwrite_instead_of_blend()
+                                  ? WUFFS_BASE__PIXEL_BLEND__SRC
+                                  : WUFFS_BASE__PIXEL_BLEND__SRC_OVER;
+        m_progress_pos = m_io_buf->reader_position();
+        m_phase = PHASE_FRAMES_FRAME;
+        break;
       }
-    }
 
-    // Decode the image config.
-    while (true) {
-      wuffs_base__status id_dic_status =
-          image_decoder->decode_image_config(&image_config, &io_buf);
-      if (id_dic_status.repr == nullptr) {
+      case PHASE_FRAMES_FRAME: {
+        // Decode the frame (the pixels). Like DecodeImage, a partially
+        // decoded frame is still passed on (to HandleFrame) and returned.
+        while (true) {
+          wuffs_base__status id_df_status = m_image_decoder->decode_frame(
+              &m_pixel_buffer, m_io_buf, m_frame_pixel_blend, m_workbuf,
+              nullptr);
+          if (id_df_status.repr == nullptr) {
+            break;
+          } else if (id_df_status.repr != wuffs_base__suspension__short_read) {
+            m_message = id_df_status.message();
+            break;
+          } else if (m_io_buf->meta.closed) {
+            m_message = DecodeImage_UnexpectedEndOfFile;
+            break;
+          } else {
+            std::string hp_message = HandleProgress(
+                m_dirty_rect.unite(m_image_decoder->frame_dirty_rect()));
+            if (!hp_message.empty()) {
+              return Finished(std::move(hp_message), true);
+            }
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              m_message = std::move(error_message);
+              break;
+            }
+          }
+        }
+        m_num_frames++;
+
+        m_dirty_rect = m_dirty_rect.unite(m_image_decoder->frame_dirty_rect());
+        std::string hf_message = m_frames_callbacks->HandleFrame(
+            m_frame_config, m_dirty_rect, m_pixel_buffer);
+        if (!m_message.empty()) {
+          return Finished(std::move(m_message), true);
+        } else if (!hf_message.empty()) {
+          return Finished(std::move(hf_message), true);
+        }
+        m_prev_disposal = m_frame_config.disposal();
+        m_prev_bounds = m_bounds;
+        m_frame_config = wuffs_base__null_frame_config();
+        m_phase = PHASE_FRAMES_FRAME_CONFIG;
         break;
-      } else if (id_dic_status.repr == wuffs_base__note__i_o_redirect) {
-        if (redirected) {
-          return DecodeImageResult(DecodeImage_UnsupportedImageFormat);
-        }
-        redirected = true;
-        goto redirect;
-      } else if (id_dic_status.repr == wuffs_base__note__metadata_reported) {
-        std::string error_message = DecodeImageHandleMetadata(
-            image_decoder, callbacks, input, io_buf, raw_metadata_buf);
-        if (!error_message.empty()) {
-          return DecodeImageResult(std::move(error_message));
-        }
-      } else if (id_dic_status.repr != wuffs_base__suspension__short_read) {
-        return DecodeImageResult(id_dic_status.message());
-      } else if (io_buf.meta.closed) {
-        return DecodeImageResult(DecodeImage_UnexpectedEndOfFile);
-      } else {
-        std::string error_message = input.CopyIn(&io_buf);
-        if (!error_message.empty()) {
-          return DecodeImageResult(std::move(error_message));
+      }
+
+      case PHASE_PROBE_FRAME_CONFIG: {
+        // Count the frames. Calling decode_frame_config again, without
+        // calling decode_frame in between, skips over the frame's pixels.
+        while (true) {
+          wuffs_base__status id_dfc_status =
+              m_image_decoder->decode_frame_config(nullptr, m_io_buf);
+          if (id_dfc_status.repr == nullptr) {
+            m_num_frames++;
+          } else if (id_dfc_status.repr == wuffs_base__note__end_of_data) {
+            return Finished("", false);
+          } else if (id_dfc_status.repr ==
+                     wuffs_base__note__metadata_reported) {
+            std::string error_message = HandleMetadata();
+            if (m_in_metadata) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          } else if (id_dfc_status.repr !=
+                     wuffs_base__suspension__short_read) {
+            return Finished(id_dfc_status.message(), false);
+          } else if (m_io_buf->meta.closed) {
+            return Finished(DecodeImage_UnexpectedEndOfFile, false);
+          } else {
+            std::string error_message = m_input.CopyIn(m_io_buf);
+            if (error_message == async_io::NeedMoreInput) {
+              return Suspend();
+            } else if (!error_message.empty()) {
+              return Finished(std::move(error_message), false);
+            }
+          }
         }
       }
     }
-  } while (false);
-  if (!interested_in_metadata_after_the_frame) {
-    raw_metadata_buf.drop();
   }
+}
 
-  // Select the pixel format.
-  uint32_t w = image_config.pixcfg.width();
-  uint32_t h = image_config.pixcfg.height();
-  if ((w > max_incl_dimension) || (h > max_incl_dimension)) {
-    return DecodeImageResult(DecodeImage_MaxInclDimensionExceeded);
-  }
-  wuffs_base__pixel_format pixel_format = callbacks.SelectPixfmt(image_config);
-  if (pixel_format.repr != image_config.pixcfg.pixel_format().repr) {
-    switch (pixel_format.repr) {
-      case WUFFS_BASE__PIXEL_FORMAT__Y:
-      case WUFFS_BASE__PIXEL_FORMAT__BGR_565:
-      case WUFFS_BASE__PIXEL_FORMAT__BGR:
-      case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL:
-      case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE:
-      case WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL:
-      case WUFFS_BASE__PIXEL_FORMAT__RGB:
-      case WUFFS_BASE__PIXEL_FORMAT__RGBA_NONPREMUL:
-      case WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL:
-        break;
-      default:
-        return DecodeImageResult(DecodeImage_UnsupportedPixelFormat);
-    }
-    image_config.pixcfg.set(pixel_format.repr,
-                            WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, w, h);
+std::string  //
+DecodeImageState::Resize() {
+  uint32_t sw = m_pixel_buffer.pixcfg.width();
+  uint32_t sh = m_pixel_buffer.pixcfg.height();
+  uint64_t dw = m_resize.width;
+  uint64_t dh = m_resize.height;
+  if ((m_flags & DecodeImageArgFlags::APPLY_ORIENTATION) &&
+      (m_orientation >= 5)) {
+    // The requested size is after rotating by 90 or 270 degrees.
+    std::swap(dw, dh);
+  }
+  if ((sw == 0) || (sh == 0) || ((dw == 0) && (dh == 0))) {
+    return "";
+  } else if (dw == 0) {
+    dw = ((dh * sw) + (sh / 2)) / sh;
+  } else if (dh == 0) {
+    dh = ((dw * sh) + (sw / 2)) / sw;
+  }
+  dw = (dw > 0) ? dw : 1;
+  dh = (dh > 0) ? dh : 1;
+  if ((dw > m_max_incl_dimension) || (dh > m_max_incl_dimension)) {
+    return DecodeImage_MaxInclDimensionExceeded;
+  } else if ((dw == sw) && (dh == sh)) {
+    return "";
   }
 
-  // Allocate the pixel buffer.
-  bool valid_background_color =
-      wuffs_base__color_u32_argb_premul__is_valid(background_color);
+  wuffs_base__image_config image_config = m_image_config;
+  image_config.pixcfg.set(m_pixel_buffer.pixcfg.pixel_format().repr,
+                          WUFFS_BASE__PIXEL_SUBSAMPLING__NONE, (uint32_t)dw,
+                          (uint32_t)dh);
   DecodeImageCallbacks::AllocPixbufResult alloc_pixbuf_result =
-      callbacks.AllocPixbuf(image_config, valid_background_color);
+      m_callbacks.AllocPixbuf(image_config, true);
   if (!alloc_pixbuf_result.error_message.empty()) {
-    return DecodeImageResult(std::move(alloc_pixbuf_result.error_message));
-  }
-  wuffs_base__pixel_buffer pixel_buffer = alloc_pixbuf_result.pixbuf;
-  if (valid_background_color) {
-    wuffs_base__status pb_scufr_status = pixel_buffer.set_color_u32_fill_rect(
-        pixel_buffer.pixcfg.bounds(), background_color);
-    if (pb_scufr_status.repr != nullptr) {
-      return DecodeImageResult(pb_scufr_status.message());
-    }
+    return std::move(alloc_pixbuf_result.error_message);
+  } else if ((alloc_pixbuf_result.pixbuf.pixcfg.width() != dw) ||
+             (alloc_pixbuf_result.pixbuf.pixcfg.height() != dh)) {
+    return DecodeImage_UnsupportedPixelConfiguration;
+  } else if (PixbufsOverlap(alloc_pixbuf_result.pixbuf, m_pixel_buffer)) {
+    return DecodeImage_UnsupportedPixelConfiguration;
   }
+  Resample(alloc_pixbuf_result.pixbuf, m_pixel_buffer, m_resize.filter);
+  m_pixbuf_mem_owner = std::move(alloc_pixbuf_result.mem_owner);
+  m_pixel_buffer = alloc_pixbuf_result.pixbuf;
+  return "";
+}
 
-  // Allocate the work buffer. Wuffs' decoders conventionally assume that this
-  // can be uninitialized memory.
-  wuffs_base__range_ii_u64 workbuf_len = image_decoder->workbuf_len();
-  DecodeImageCallbacks::AllocWorkbufResult alloc_workbuf_result =
-      callbacks.AllocWorkbuf(workbuf_len, true);
-  if (!alloc_workbuf_result.error_message.empty()) {
-    return DecodeImageResult(std::move(alloc_workbuf_result.error_message));
-  } else if (alloc_workbuf_result.workbuf.len < workbuf_len.min_incl) {
-    return DecodeImageResult(DecodeImage_BufferIsTooShort);
+std::string  //
+DecodeImageState::ApplyOrientation() {
+  if (!(m_flags & DecodeImageArgFlags::APPLY_ORIENTATION) ||
+      (m_orientation <= 1)) {
+    return "";
+  }
+  wuffs_base__pixel_format pf = m_pixel_buffer.pixcfg.pixel_format();
+  if (!pf.is_interleaved() || ((pf.bits_per_pixel() & 7) != 0)) {
+    return DecodeImage_UnsupportedPixelFormat;
+  }
+  size_t bytes_per_pixel = pf.bits_per_pixel() / 8;
+  wuffs_base__table_u8 src = m_pixel_buffer.plane(0);
+  if (m_orientation <= 4) {
+    OrientInPlace(src, bytes_per_pixel, m_orientation);
+    return "";
   }
 
-  // Decode the frame config.
-  wuffs_base__frame_config frame_config = wuffs_base__null_frame_config();
-  while (true) {
-    wuffs_base__status id_dfc_status =
-        image_decoder->decode_frame_config(&frame_config, &io_buf);
-    if (id_dfc_status.repr == nullptr) {
+  wuffs_base__image_config image_config = m_image_config;
+  image_config.pixcfg.set(pf.repr, WUFFS_BASE__PIXEL_SUBSAMPLING__NONE,
+                          m_pixel_buffer.pixcfg.height(),
+                          m_pixel_buffer.pixcfg.width());
+  DecodeImageCallbacks::AllocPixbufResult alloc_pixbuf_result =
+      m_callbacks.AllocPixbuf(image_config, true);
+  if (!alloc_pixbuf_result.error_message.empty()) {
+    return std::move(alloc_pixbuf_result.error_message);
+  } else if ((alloc_pixbuf_result.pixbuf.pixcfg.width() !=
+              image_config.pixcfg.width()) ||
+             (alloc_pixbuf_result.pixbuf.pixcfg.height() !=
+              image_config.pixcfg.height())) {
+    return DecodeImage_UnsupportedPixelConfiguration;
+  } else if (PixbufsOverlap(alloc_pixbuf_result.pixbuf, m_pixel_buffer)) {
+    return DecodeImage_UnsupportedPixelConfiguration;
+  }
+  wuffs_base__table_u8 dst = alloc_pixbuf_result.pixbuf.plane(0);
+  switch (bytes_per_pixel) {
+    case 1:
+      OrientTiled<1>(dst, src, m_orientation);
       break;
-    } else if (id_dfc_status.repr == wuffs_base__note__metadata_reported) {
-      std::string error_message = DecodeImageHandleMetadata(
-          image_decoder, callbacks, input, io_buf, raw_metadata_buf);
-      if (!error_message.empty()) {
-        return DecodeImageResult(std::move(error_message));
-      }
-    } else if (id_dfc_status.repr != wuffs_base__suspension__short_read) {
-      return DecodeImageResult(id_dfc_status.message());
-    } else if (io_buf.meta.closed) {
-      return DecodeImageResult(DecodeImage_UnexpectedEndOfFile);
-    } else {
-      std::string error_message = input.CopyIn(&io_buf);
-      if (!error_message.empty()) {
-        return DecodeImageResult(std::move(error_message));
-      }
+    case 2:
+      OrientTiled<2>(dst, src, m_orientation);
+      break;
+    case 3:
+      OrientTiled<3>(dst, src, m_orientation);
+      break;
+    case 4:
+      OrientTiled<4>(dst, src, m_orientation);
+      break;
+    case 8:
+      OrientTiled<8>(dst, src, m_orientation);
+      break;
+    default:
+      return DecodeImage_UnsupportedPixelFormat;
+  }
+  if (pf.is_indexed()) {
+    wuffs_base__slice_u8 dst_palette = alloc_pixbuf_result.pixbuf.palette();
+    wuffs_base__slice_u8 src_palette = m_pixel_buffer.palette();
+    if (dst_palette.len == src_palette.len) {
+      memcpy(dst_palette.ptr, src_palette.ptr, src_palette.len);
     }
   }
+  m_pixbuf_mem_owner = std::move(alloc_pixbuf_result.mem_owner);
+  m_pixel_buffer = alloc_pixbuf_result.pixbuf;
+  return "";
+}
 
-  // Decode the frame (the pixels).
-  //
-  // From here on, always returns the pixel_buffer. If we get this far, we can
-  // still display a partial image, even if we encounter an error.
-  std::string message("");
-  if ((pixel_blend == WUFFS_BASE__PIXEL_BLEND__SRC_OVER) &&
-      frame_config.overwrite_instead_of_blend()) {
-    pixel_blend = WUFFS_BASE__PIXEL_BLEND__SRC;
+void  //
+DecodeImageState::ConvertToSrgb() {
+  if (!(m_flags & DecodeImageArgFlags::CONVERT_TO_SRGB) || m_has_srgb) {
+    return;
   }
-  while (true) {
-    wuffs_base__status id_df_status =
-        image_decoder->decode_frame(&pixel_buffer, &io_buf, pixel_blend,
-                                    alloc_workbuf_result.workbuf, nullptr);
-    if (id_df_status.repr == nullptr) {
+  ColorTransform ct;
+  if (!m_iccp.empty()) {
+    if (!MakeColorTransformFromIcc(
+            ct, wuffs_base__make_slice_u8(m_iccp.data(), m_iccp.size()))) {
+      return;
+    }
+  } else if (m_has_chrm) {
+    if (!MakeColorTransformFromChrm(ct, m_chrm, m_gama)) {
+      return;
+    }
+  } else if (m_gama > 0) {
+    static const float identity[9] = {
+        1.0f, 0.0f, 0.0f,  //
+        0.0f, 1.0f, 0.0f,  //
+        0.0f, 0.0f, 1.0f,  //
+    };
+    // A gAMA of 1/2.2 is conventionally treated as sRGB.
+    if ((m_gama >= 45000) && (m_gama <= 46000)) {
+      return;
+    }
+    ToneCurve curve = ToneCurve::Gamma(100000.0f / (float)m_gama);
+    ct.curves[0] = curve;
+    ct.curves[1] = curve;
+    ct.curves[2] = curve;
+    memcpy(ct.matrix, identity, sizeof identity);
+  } else {
+    return;
+  }
+  if (ColorTransformIsNoOp(ct)) {
+    return;
+  }
+
+  wuffs_base__table_u8 t = m_pixel_buffer.plane(0);
+  switch (m_pixel_buffer.pixcfg.pixel_format().repr) {
+    case WUFFS_BASE__PIXEL_FORMAT__Y:
+      // Only a gray (single tone curve, identity matrix) transform keeps
+      // gray pixels gray.
+      if ((ct.matrix[1] == 0.0f) && (ct.matrix[3] == 0.0f)) {
+        ApplyColorTransform(t, ct, 1, 1, 0, 0, 0, false);
+      }
       break;
-    } else if (id_df_status.repr != wuffs_base__suspension__short_read) {
-      message = id_df_status.message();
+    case WUFFS_BASE__PIXEL_FORMAT__BGR:
+      ApplyColorTransform(t, ct, 1, 3, 2, 1, 0, false);
       break;
-    } else if (io_buf.meta.closed) {
-      message = DecodeImage_UnexpectedEndOfFile;
+    case WUFFS_BASE__PIXEL_FORMAT__RGB:
+      ApplyColorTransform(t, ct, 1, 3, 0, 1, 2, false);
       break;
-    } else {
-      std::string error_message = input.CopyIn(&io_buf);
-      if (!error_message.empty()) {
-        message = std::move(error_message);
-        break;
+    case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL:
+    case WUFFS_BASE__PIXEL_FORMAT__BGRA_BINARY:
+    case WUFFS_BASE__PIXEL_FORMAT__BGRX:
+      ApplyColorTransform(t, ct, 1, 4, 2, 1, 0, false);
+      break;
+    case WUFFS_BASE__PIXEL_FORMAT__BGRA_PREMUL:
+      ApplyColorTransform(t, ct, 1, 4, 2, 1, 0, true);
+      break;
+    case WUFFS_BASE__PIXEL_FORMAT__RGBA_NONPREMUL:
+    case WUFFS_BASE__PIXEL_FORMAT__RGBA_BINARY:
+    case WUFFS_BASE__PIXEL_FORMAT__RGBX:
+      ApplyColorTransform(t, ct, 1, 4, 0, 1, 2, false);
+      break;
+    case WUFFS_BASE__PIXEL_FORMAT__RGBA_PREMUL:
+      ApplyColorTransform(t, ct, 1, 4, 0, 1, 2, true);
+      break;
+    case WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE:
+      ApplyColorTransform(t, ct, 2, 4, 2, 1, 0, false);
+      break;
+    case WUFFS_BASE__PIXEL_FORMAT__INDEXED__BGRA_NONPREMUL:
+    case WUFFS_BASE__PIXEL_FORMAT__INDEXED__BGRA_BINARY: {
+      // Convert the palette, not the pixels.
+      wuffs_base__slice_u8 palette = m_pixel_buffer.palette();
+      if (palette.len == 1024) {
+        ApplyColorTransform(wuffs_base__make_table_u8(palette.ptr, 1024, 1,
+                                                      1024),
+                            ct, 1, 4, 2, 1, 0, false);
       }
+      break;
     }
   }
+}
 
-  // Decode any metadata after the frame.
-  if (interested_in_metadata_after_the_frame) {
-    while (true) {
-      wuffs_base__status id_dfc_status =
-          image_decoder->decode_frame_config(NULL, &io_buf);
-      if (id_dfc_status.repr == wuffs_base__note__end_of_data) {
-        break;
-      } else if (id_dfc_status.repr == nullptr) {
-        continue;
-      } else if (id_dfc_status.repr == wuffs_base__note__metadata_reported) {
-        std::string error_message = DecodeImageHandleMetadata(
-            image_decoder, callbacks, input, io_buf, raw_metadata_buf);
-        if (!error_message.empty()) {
-          return DecodeImageResult(std::move(error_message));
-        }
-      } else if (id_dfc_status.repr != wuffs_base__suspension__short_read) {
-        return DecodeImageResult(id_dfc_status.message());
-      } else if (io_buf.meta.closed) {
-        return DecodeImageResult(DecodeImage_UnexpectedEndOfFile);
-      } else {
-        std::string error_message = input.CopyIn(&io_buf);
-        if (!error_message.empty()) {
-          return DecodeImageResult(std::move(error_message));
-        }
-      }
+DecodeImageResult  //
+DecodeImageState::Finish() {
+  std::string ret_error_message =
+      m_suspended ? std::string(async_io::NeedMoreInput)
+                  : std::move(m_ret_error_message);
+  if (m_ret_pixbuf && !m_frames_callbacks) {
+    // Resizing first means fewer pixels to color-convert, for the common
+    // case of shrinking an image.
+    std::string message = Resize();
+    if (message.empty()) {
+      ConvertToSrgb();
+      message = ApplyOrientation();
+    }
+    if (!message.empty()) {
+      ret_error_message = std::move(message);
+      m_ret_pixbuf = false;
     }
   }
+  DecodeImageResult result =
+      m_ret_pixbuf ? DecodeImageResult(std::move(m_pixbuf_mem_owner),
+                                       m_pixel_buffer,
+                                       std::move(ret_error_message))
+                   : DecodeImageResult(std::move(ret_error_message));
+  m_callbacks.Done(result, m_input, *m_io_buf, std::move(m_image_decoder));
+  return result;
+}
 
-  return DecodeImageResult(std::move(alloc_pixbuf_result.mem_owner),
-                           pixel_buffer, std::move(message));
+ProbeImageResult  //
+DecodeImageState::FinishProbe() {
+  std::string ret_error_message =
+      m_suspended ? std::string(async_io::NeedMoreInput)
+                  : std::move(m_ret_error_message);
+  ProbeImageResult result((m_fourcc > 0) ? ((uint32_t)m_fourcc) : 0,
+                          m_image_config, m_num_frames, m_orientation,
+                          std::move(ret_error_message));
+  DecodeImageResult done_result = DecodeImageResult(
+      std::string(result.error_message));
+  m_callbacks.Done(done_result, m_input, *m_io_buf,
+                   std::move(m_image_decoder));
+  return result;
+}
+
+}  // namespace private_impl
+
+namespace {
+
+DecodeImageResult  //
+DecodeImage1(DecodeImageCallbacks& callbacks,
+             DecodeImageFramesCallbacks* frames_callbacks,
+             DecodeImageContext* context,
+             sync_io::Input& input,
+             const QuirkKeyValuePair* quirks_ptr,
+             const size_t quirks_len,
+             uint64_t flags,
+             wuffs_base__pixel_blend pixel_blend,
+             wuffs_base__color_u32_argb_premul background_color,
+             uint32_t max_incl_dimension,
+             uint64_t max_incl_metadata_length,
+             DecodeImageArgResize resize) {
+  private_impl::DecodeImageState state(
+      callbacks, frames_callbacks, context, input, quirks_ptr, quirks_len,
+      flags, pixel_blend, background_color, max_incl_dimension,
+      max_incl_metadata_length, resize);
+  state.Resume();
+  return state.Finish();
 }
 
 }  // namespace
 
+DecodeImageContext::DecodeImageContext()
+    : m_num_decoders(0),
+      m_selected_fourcc(0),
+      m_selected_decoder(nullptr),
+      m_workbuf_mem_owner(nullptr, &free),
+      m_workbuf_len(0),
+      m_io_array(nullptr) {}
+
+DecodeImageContext::~DecodeImageContext() {}
+
+wuffs_base__image_decoder::unique_ptr  //
+DecodeImageContext::SelectDecoder(uint32_t fourcc,
+                                  wuffs_base__slice_u8 prefix_data,
+                                  bool prefix_closed) {
+  m_selected_fourcc = 0;
+  m_selected_decoder = nullptr;
+
+  for (size_t i = 0; i < m_num_decoders; i++) {
+    if (m_decoders[i].fourcc != fourcc) {
+      continue;
+    }
+    wuffs_base__image_decoder::unique_ptr image_decoder =
+        std::move(m_decoders[i].decoder);
+    m_num_decoders--;
+    if (i < m_num_decoders) {
+      m_decoders[i].fourcc = m_decoders[m_num_decoders].fourcc;
+      m_decoders[i].decoder = std::move(m_decoders[m_num_decoders].decoder);
+    }
+    if (DecodeImageContextReinitialize(fourcc, image_decoder.get())) {
+      m_selected_fourcc = fourcc;
+      m_selected_decoder = image_decoder.get();
+      return image_decoder;
+    }
+    break;
+  }
+
+  wuffs_base__image_decoder::unique_ptr image_decoder =
+      DecodeImageCallbacks::SelectDecoder(fourcc, prefix_data, prefix_closed);
+  if (image_decoder) {
+    m_selected_fourcc = fourcc;
+    m_selected_decoder = image_decoder.get();
+  }
+  return image_decoder;
+}
+
+DecodeImageCallbacks::AllocWorkbufResult  //
+DecodeImageContext::AllocWorkbuf(wuffs_base__range_ii_u64 len_range,
+                                 bool allow_uninitialized_memory) {
+  if (len_range.min_incl == 0) {
+    return AllocWorkbufResult("");
+  } else if (SIZE_MAX < len_range.min_incl) {
+    return AllocWorkbufResult(DecodeImage_OutOfMemory);
+  }
+
+  if (m_workbuf_len < len_range.min_incl) {
+    m_workbuf_mem_owner.reset();
+    m_workbuf_len = 0;
+    uint64_t len = len_range.max_incl;
+    void* ptr = (len <= SIZE_MAX) ? malloc((size_t)len) : nullptr;
+    if (!ptr) {
+      len = len_range.min_incl;
+      ptr = malloc((size_t)len);
+      if (!ptr) {
+        return AllocWorkbufResult(DecodeImage_OutOfMemory);
+      }
+    }
+    m_workbuf_mem_owner.reset(ptr);
+    m_workbuf_len = (size_t)len;
+  }
+
+  size_t len = m_workbuf_len;
+  if (len_range.max_incl < len) {
+    len = (size_t)len_range.max_incl;
+  }
+  uint8_t* ptr = static_cast<uint8_t*>(m_workbuf_mem_owner.get());
+  if (!allow_uninitialized_memory) {
+    memset(ptr, 0, len);
+  }
+  return AllocWorkbufResult(MemOwner(nullptr, &free),
+                            wuffs_base__make_slice_u8(ptr, len));
+}
+
+void  //
+DecodeImageContext::Done(DecodeImageResult& result,
+                         sync_io::Input& input,
+                         IOBuffer& buffer,
+                         wuffs_base__image_decoder::unique_ptr image_decoder) {
+  if (!image_decoder || (image_decoder.get() != m_selected_decoder)) {
+    return;
+  }
+  uint32_t fourcc = m_selected_fourcc;
+  m_selected_fourcc = 0;
+  m_selected_decoder = nullptr;
+  if (m_num_decoders >= MAX_NUM_DECODERS) {
+    return;
+  }
+  for (size_t i = 0; i < m_num_decoders; i++) {
+    if (m_decoders[i].fourcc == fourcc) {
+      return;
+    }
+  }
+  m_decoders[m_num_decoders].fourcc = fourcc;
+  m_decoders[m_num_decoders].decoder = std::move(image_decoder);
+  m_num_decoders++;
+}
+
+wuffs_base__io_buffer  //
+DecodeImageContext::FallbackIOBuffer() {
+  if (!m_io_array) {
+    m_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[32768]);
+  }
+  return wuffs_base__ptr_u8__writer(m_io_array.get(), 32768);
+}
+
 DecodeImageResult  //
 DecodeImage(DecodeImageCallbacks& callbacks,
             sync_io::Input& input,
@@ -622,24 +2606,149 @@ DecodeImage(DecodeImageCallbacks& callbacks,
             DecodeImageArgPixelBlend pixel_blend,
             DecodeImageArgBackgroundColor background_color,
             DecodeImageArgMaxInclDimension max_incl_dimension,
-            DecodeImageArgMaxInclMetadataLength max_incl_metadata_length) {
-  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
-  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
-  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
-  if (!io_buf) {
-    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[32768]);
-    fallback_io_buf =
-        wuffs_base__ptr_u8__writer(fallback_io_array.get(), 32768);
-    io_buf = &fallback_io_buf;
-  }
-
-  wuffs_base__image_decoder::unique_ptr image_decoder(nullptr);
-  DecodeImageResult result = DecodeImage0(
-      image_decoder, callbacks, input, *io_buf, quirks.ptr, quirks.len,
-      flags.repr, pixel_blend.repr, background_color.repr,
-      max_incl_dimension.repr, max_incl_metadata_length.repr);
-  callbacks.Done(result, input, *io_buf, std::move(image_decoder));
-  return result;
+            DecodeImageArgMaxInclMetadataLength max_incl_metadata_length,
+            DecodeImageArgResize resize) {
+  return DecodeImage1(callbacks, nullptr, nullptr, input, quirks.ptr,
+                      quirks.len, flags.repr, pixel_blend.repr,
+                      background_color.repr, max_incl_dimension.repr,
+                      max_incl_metadata_length.repr, resize);
+}
+
+DecodeImageResult  //
+DecodeImageFrames(
+    DecodeImageFramesCallbacks& callbacks,
+    sync_io::Input& input,
+    DecodeImageArgQuirks quirks,
+    DecodeImageArgFlags flags,
+    DecodeImageArgBackgroundColor background_color,
+    DecodeImageArgMaxInclDimension max_incl_dimension,
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length) {
+  return DecodeImage1(callbacks, &callbacks, nullptr, input, quirks.ptr,
+                      quirks.len, flags.repr, WUFFS_BASE__PIXEL_BLEND__SRC_OVER,
+                      background_color.repr, max_incl_dimension.repr,
+                      max_incl_metadata_length.repr,
+                      DecodeImageArgResize::DefaultValue());
+}
+
+DecodeImageResult  //
+DecodeImage(DecodeImageContext& context,
+            sync_io::Input& input,
+            DecodeImageArgQuirks quirks,
+            DecodeImageArgFlags flags,
+            DecodeImageArgPixelBlend pixel_blend,
+            DecodeImageArgBackgroundColor background_color,
+            DecodeImageArgMaxInclDimension max_incl_dimension,
+            DecodeImageArgMaxInclMetadataLength max_incl_metadata_length,
+            DecodeImageArgResize resize) {
+  return DecodeImage1(context, nullptr, &context, input, quirks.ptr,
+                      quirks.len, flags.repr, pixel_blend.repr,
+                      background_color.repr, max_incl_dimension.repr,
+                      max_incl_metadata_length.repr, resize);
+}
+
+DecodeImageResult  //
+DecodeImageFrames(
+    DecodeImageContext& context,
+    sync_io::Input& input,
+    DecodeImageArgQuirks quirks,
+    DecodeImageArgFlags flags,
+    DecodeImageArgBackgroundColor background_color,
+    DecodeImageArgMaxInclDimension max_incl_dimension,
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length) {
+  return DecodeImage1(context, &context, &context, input, quirks.ptr,
+                      quirks.len, flags.repr, WUFFS_BASE__PIXEL_BLEND__SRC_OVER,
+                      background_color.repr, max_incl_dimension.repr,
+                      max_incl_metadata_length.repr,
+                      DecodeImageArgResize::DefaultValue());
+}
+
+ProbeImageResult  //
+ProbeImage(DecodeImageCallbacks& callbacks,
+           sync_io::Input& input,
+           DecodeImageArgQuirks quirks,
+           DecodeImageArgFlags flags,
+           ProbeImageArgFlags probe_flags,
+           DecodeImageArgMaxInclMetadataLength max_incl_metadata_length) {
+  private_impl::DecodeImageState state(
+      callbacks, nullptr, nullptr, input, quirks.ptr, quirks.len, flags.repr,
+      WUFFS_BASE__PIXEL_BLEND__SRC, 1, 0xFFFFFFFF,
+      max_incl_metadata_length.repr, DecodeImageArgResize::DefaultValue(), true,
+      probe_flags.repr);
+  state.Resume();
+  return state.FinishProbe();
+}
+
+DecodeImageAsync::DecodeImageAsync(
+    DecodeImageCallbacks& callbacks,
+    async_io::Input& input,
+    DecodeImageArgQuirks quirks,
+    DecodeImageArgFlags flags,
+    DecodeImageArgPixelBlend pixel_blend,
+    DecodeImageArgBackgroundColor background_color,
+    DecodeImageArgMaxInclDimension max_incl_dimension,
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length,
+    DecodeImageArgResize resize)
+    : m_state(new private_impl::DecodeImageState(
+          callbacks,
+          nullptr,
+          nullptr,
+          input,
+          quirks.ptr,
+          quirks.len,
+          flags.repr,
+          pixel_blend.repr,
+          background_color.repr,
+          max_incl_dimension.repr,
+          max_incl_metadata_length.repr,
+          resize)),
+      m_done(false) {}
+
+DecodeImageAsync::~DecodeImageAsync() {}
+
+DecodeImageResult  //
+DecodeImageAsync::Resume() {
+  if (m_done) {
+    return DecodeImageResult(async_io::AlreadyDone);
+  } else if (!m_state->Resume()) {
+    return DecodeImageResult(async_io::NeedMoreInput);
+  }
+  m_done = true;
+  return m_state->Finish();
+}
+
+DecodeImageFramesAsync::DecodeImageFramesAsync(
+    DecodeImageFramesCallbacks& callbacks,
+    async_io::Input& input,
+    DecodeImageArgQuirks quirks,
+    DecodeImageArgFlags flags,
+    DecodeImageArgBackgroundColor background_color,
+    DecodeImageArgMaxInclDimension max_incl_dimension,
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length)
+    : m_state(new private_impl::DecodeImageState(
+          callbacks,
+          &callbacks,
+          nullptr,
+          input,
+          quirks.ptr,
+          quirks.len,
+          flags.repr,
+          WUFFS_BASE__PIXEL_BLEND__SRC_OVER,
+          background_color.repr,
+          max_incl_dimension.repr,
+          max_incl_metadata_length.repr)),
+      m_done(false) {}
+
+DecodeImageFramesAsync::~DecodeImageFramesAsync() {}
+
+DecodeImageResult  //
+DecodeImageFramesAsync::Resume() {
+  if (m_done) {
+    return DecodeImageResult(async_io::AlreadyDone);
+  } else if (!m_state->Resume()) {
+    return DecodeImageResult(async_io::NeedMoreInput);
+  }
+  m_done = true;
+  return m_state->Finish();
 }
 
 }  // namespace wuffs_aux
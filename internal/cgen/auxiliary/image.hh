@@ -30,7 +30,8 @@ struct DecodeImageResult {
 //  3. SelectPixfmt
 //  4. AllocPixbuf
 //  5. AllocWorkbuf
-//  6. Done
+//  6. HandleProgress
+//  7. Done
 //
 // It may return early - the third callback might not be invoked if the second
 // one fails - but the final callback (Done) is always invoked.
@@ -168,6 +169,29 @@ class DecodeImageCallbacks {
   AllocWorkbuf(wuffs_base__range_ii_u64 len_range,
                bool allow_uninitialized_memory);
 
+  // HandleProgress is called while decoding the frame (the pixels), each time
+  // the decoder has consumed more input and then needs more still. It lets
+  // callers show or forward a partially decoded image before DecodeImage
+  // returns, which matters for large images arriving over slow connections.
+  //
+  // dirty_rect bounds the pixels that may have changed so far. Whether pixbuf
+  // holds any partially decoded pixels depends on the decoder. GIF writes
+  // each row as it is decoded (and its dirty_rect grows row by row).
+  // Interlaced PNG writes the whole frame after each interlace pass and
+  // progressive JPEG after each scan. Other decoders, including
+  // non-interlaced PNG and baseline JPEG, only write pixbuf when the frame is
+  // complete (or decoding fails), so for them HandleProgress only reports
+  // that more input was consumed.
+  //
+  // It returns an error message, or an empty string to continue decoding. A
+  // non-empty message stops decoding and DecodeImage returns that message
+  // (and the partially decoded pixbuf).
+  //
+  // The default HandleProgress implementation is a no-op.
+  virtual std::string  //
+  HandleProgress(const wuffs_base__pixel_buffer& pixbuf,
+                 wuffs_base__rect_ie_u32 dirty_rect);
+
   // Done is always the last Callback method called by DecodeImage, whether or
   // not parsing the input encountered an error. Even when successful, trailing
   // data may remain in input and buffer.
@@ -188,6 +212,120 @@ class DecodeImageCallbacks {
        wuffs_base__image_decoder::unique_ptr image_decoder);
 };
 
+// DecodeImageFramesCallbacks are the callbacks given to DecodeImageFrames.
+// They extend DecodeImageCallbacks with HandleFrame, which is called once per
+// animation frame, after AllocWorkbuf and before Done.
+class DecodeImageFramesCallbacks : public DecodeImageCallbacks {
+ public:
+  ~DecodeImageFramesCallbacks() override;
+
+  // HandleFrame is called after each frame has been decoded and composited
+  // onto the canvas (the pixel buffer returned by AllocPixbuf).
+  //
+  // frame_config holds the frame's index, bounds, duration (in flicks),
+  // disposal and whether it was blended (SRC_OVER) or not (SRC). Its
+  // disposal is applied by DecodeImageFrames just before the next frame.
+  //
+  // dirty_rect is the part of the canvas that may have changed since the
+  // previous HandleFrame call: the union of the decoder's frame_dirty_rect
+  // and, if the previous frame's disposal was not NONE, that frame's bounds.
+  // For the first frame, it is the whole canvas.
+  //
+  // The canvas pixels should not be modified and the canvas should not be
+  // retained beyond the HandleFrame call, other than through the returned
+  // DecodeImageResult after the final frame.
+  //
+  // It returns an error message, or an empty string on success. A non-empty
+  // message stops decoding and DecodeImageFrames returns that message (and
+  // the canvas), so callers can stop early with a sentinel message of their
+  // own choosing.
+  //
+  // The default HandleFrame implementation is a no-op.
+  virtual std::string  //
+  HandleFrame(const wuffs_base__frame_config& frame_config,
+              wuffs_base__rect_ie_u32 dirty_rect,
+              const wuffs_base__pixel_buffer& canvas);
+};
+
+// DecodeImageContext is a DecodeImageFramesCallbacks that keeps resources
+// alive between DecodeImage (or DecodeImageFrames) calls, instead of
+// allocating and freeing them for every image: one image decoder per FourCC,
+// a work buffer and an I/O buffer. Re-using a context can avoid several
+// allocator round trips per image, which matters when decoding many (small)
+// images, such as in a thumbnailing server.
+//
+// Pass it to the DecodeImage or DecodeImageFrames overloads that take a
+// DecodeImageContext, which also use its I/O buffer (if the input does not
+// bring its own). Like any other callbacks, its methods can be overridden.
+// Overrides of SelectDecoder, AllocWorkbuf or Done that want to keep the
+// pooling should call the DecodeImageContext implementation.
+//
+// The pixel buffer is not pooled, since the DecodeImageResult owns it.
+//
+// A DecodeImageContext is not thread-safe. It can be re-used by sequential
+// calls but not by concurrent ones. Use one context per thread.
+class DecodeImageContext : public DecodeImageFramesCallbacks {
+ public:
+  DecodeImageContext();
+  ~DecodeImageContext() override;
+
+  // SelectDecoder re-uses a pooled image decoder for fourcc, if there is one,
+  // after re-initializing it. Re-initialization resets the decoder's state
+  // (including any set_quirk calls) without zeroing its internal buffers,
+  // which can be large. Otherwise, it returns what the default
+  // DecodeImageCallbacks::SelectDecoder implementation returns.
+  wuffs_base__image_decoder::unique_ptr  //
+  SelectDecoder(uint32_t fourcc,
+                wuffs_base__slice_u8 prefix_data,
+                bool prefix_closed) override;
+
+  // AllocWorkbuf returns the pooled work buffer if it is at least
+  // len_range.min_incl bytes long. Otherwise, it replaces the pooled work
+  // buffer with one that is len_range.max_incl bytes long (or, if that fails,
+  // len_range.min_incl bytes long). The pooled work buffer remains owned by
+  // the DecodeImageContext.
+  AllocWorkbufResult  //
+  AllocWorkbuf(wuffs_base__range_ii_u64 len_range,
+               bool allow_uninitialized_memory) override;
+
+  // Done returns image_decoder to the pool, if SelectDecoder provided it.
+  void  //
+  Done(DecodeImageResult& result,
+       sync_io::Input& input,
+       IOBuffer& buffer,
+       wuffs_base__image_decoder::unique_ptr image_decoder) override;
+
+  // FallbackIOBuffer returns an empty I/O buffer whose backing array is owned
+  // by the DecodeImageContext, for inputs that do not bring their own.
+  wuffs_base__io_buffer  //
+  FallbackIOBuffer();
+
+ private:
+  struct PooledDecoder {
+    uint32_t fourcc;
+    wuffs_base__image_decoder::unique_ptr decoder;
+  };
+
+  // Delete the copy and assign constructors.
+  DecodeImageContext(const DecodeImageContext&) = delete;
+  DecodeImageContext& operator=(const DecodeImageContext&) = delete;
+
+  // m_decoders holds m_num_decoders idle decoders, at most one per FourCC.
+  static constexpr size_t MAX_NUM_DECODERS = 16;
+  PooledDecoder m_decoders[MAX_NUM_DECODERS];
+  size_t m_num_decoders;
+
+  // m_selected_etc is the decoder (and its FourCC) most recently returned by
+  // SelectDecoder, if it can be pooled.
+  uint32_t m_selected_fourcc;
+  wuffs_base__image_decoder* m_selected_decoder;
+
+  MemOwner m_workbuf_mem_owner;
+  size_t m_workbuf_len;
+
+  std::unique_ptr<uint8_t[]> m_io_array;
+};
+
 extern const char DecodeImage_BufferIsTooShort[];
 extern const char DecodeImage_MaxInclDimensionExceeded[];
 extern const char DecodeImage_MaxInclMetadataLengthExceeded[];
@@ -256,6 +394,22 @@ struct DecodeImageArgFlags {
   // Extensible Metadata Platform.
   static constexpr uint64_t REPORT_METADATA_XMP = 0x0400;
 
+  // Apply the EXIF Orientation tag (if any), so that the returned pixbuf is
+  // already rotated and/or flipped for display. The EXIF metadata is parsed
+  // internally. It is only passed on to callbacks.HandleMetadata if
+  // REPORT_METADATA_EXIF is also set. This flag has no effect on
+  // DecodeImageFrames.
+  static constexpr uint64_t APPLY_ORIENTATION = 0x0800;
+
+  // Convert the pixels' colors to sRGB, per the image's color space metadata:
+  // an ICC profile (PNG's iCCP chunk or JPEG's APP2 segments) or else gamma
+  // and chromaticities (PNG's gAMA and cHRM chunks). Images without such metadata, or whose metadata
+  // is sRGB or equivalent, are left unchanged. The metadata is parsed
+  // internally. It is only passed on to callbacks.HandleMetadata if the
+  // corresponding REPORT_METADATA_ETC bit is also set. This flag has no
+  // effect on DecodeImageFrames.
+  static constexpr uint64_t CONVERT_TO_SRGB = 0x1000;
+
   uint64_t repr;
 };
 
@@ -301,16 +455,36 @@ struct DecodeImageArgMaxInclMetadataLength {
   uint64_t repr;
 };
 
+// DecodeImageArgResize wraps an optional argument to DecodeImage.
+struct DecodeImageArgResize {
+  explicit DecodeImageArgResize(uint32_t width0,
+                                uint32_t height0,
+                                uint32_t filter0);
+
+  // DefaultValue returns a zero width and height, meaning no resizing.
+  static DecodeImageArgResize DefaultValue();
+
+  // Box (area averaging when downscaling, nearest neighbor when upscaling).
+  static constexpr uint32_t FILTER_BOX = 0;
+  // Bilinear (a triangle filter, widened when downscaling).
+  static constexpr uint32_t FILTER_BILINEAR = 1;
+  // Lanczos with 3 lobes.
+  static constexpr uint32_t FILTER_LANCZOS3 = 2;
+
+  uint32_t width;
+  uint32_t height;
+  uint32_t filter;
+};
+
 // DecodeImage decodes the image data in input. A variety of image file formats
 // can be decoded, depending on what callbacks.SelectDecoder returns.
 //
 // For animated formats, only the first frame is returned, since the API is
 // simpler for synchronous I/O and having DecodeImage only return when
 // completely done, but rendering animation often involves handling other
-// events in between animation frames. To decode multiple frames of animated
-// images, or for asynchronous I/O (e.g. when decoding an image streamed over
-// the network), use Wuffs' lower level C API instead of its higher level,
-// simplified C++ API (the wuffs_aux API).
+// events in between animation frames. To decode every frame of animated
+// images, use DecodeImageFrames. For asynchronous I/O (e.g. when decoding an
+// image streamed over the network), use DecodeImageAsync.
 //
 // The DecodeImageResult's fields depend on whether decoding succeeded:
 //  - On total success, the error_message is empty and pixbuf.pixcfg.is_valid()
@@ -345,6 +519,43 @@ struct DecodeImageArgMaxInclMetadataLength {
 // Decoding fails (with DecodeImage_MaxInclDimensionExceeded) if the image's
 // width or height is greater than max_incl_dimension or if any opted-in (via
 // flags bits) metadata is longer than max_incl_metadata_length.
+//
+// If resize's width or height is non-zero then the decoded image is resampled
+// to that size, using a separable resize.filter, and the returned pixbuf is
+// that smaller (or larger) image. If only one of them is zero, it is computed
+// to preserve the aspect ratio. The image is still decoded at full size
+// first: the resize is a second step, not a reduced-size decode.
+// callbacks.AllocPixbuf is called a second time, for the resized pixel
+// buffer, and the full size one is freed before DecodeImage returns. The two
+// buffers must not overlap (e.g. an AllocPixbuf override that always returns
+// the same fixed buffer), otherwise DecodeImage fails with
+// DecodeImage_UnsupportedPixelConfiguration. Resampling streams through the
+// full size image, row by row, keeping only as many resampled rows as the
+// filter needs. The pixel
+// format (as chosen by callbacks.SelectPixfmt) must not be indexed or
+// BGR_565. Non-premultiplied alpha is weighted, so that fully transparent
+// pixels' colors do not bleed into their neighbors.
+//
+// If the APPLY_ORIENTATION flags bit is set and the image's EXIF metadata
+// (e.g. a JPEG's APP1 segment or a PNG's eXIf chunk) has an Orientation tag
+// other than 1, the pixels are rotated and/or flipped after decoding (and
+// after resizing, whose width and height are then in the rotated frame of
+// reference). Flips are done in place. The rotations by 90 or 270 degrees
+// (Orientation values 5 ..= 8) swap the width and height and so call
+// callbacks.AllocPixbuf a second time (which, as for resizing, must not
+// overlap the first pixel buffer), copying the pixels in cache-sized tiles. callbacks.HandleProgress's dirty_rect is always in the decoder's
+// (unrotated) frame of reference. The pixel format must be interleaved and
+// have a whole number of bytes per pixel.
+//
+// If the CONVERT_TO_SRGB flags bit is set, the pixels are color-converted
+// after decoding (and after resizing). This is a second pass over the pixel
+// buffer, separate from the decoder's own pixel format conversion, so it is
+// not visible to callbacks.HandleProgress. The conversion is a per-channel
+// table lookup (the source tone curves), a 3x3 matrix multiply and another
+// table lookup (sRGB's inverse tone curve). Only matrix/TRC ICC profiles are
+// supported, and other profiles are ignored. Indexed pixel formats convert
+// the palette. Pixel formats other than the BGR, RGB, BGRA and RGBA
+// families (and Y, for gray ICC profiles) are left unchanged.
 DecodeImageResult  //
 DecodeImage(DecodeImageCallbacks& callbacks,
             sync_io::Input& input,
@@ -357,6 +568,223 @@ DecodeImage(DecodeImageCallbacks& callbacks,
             DecodeImageArgMaxInclDimension max_incl_dimension =
                 DecodeImageArgMaxInclDimension::DefaultValue(),
             DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
-                DecodeImageArgMaxInclMetadataLength::DefaultValue());
+                DecodeImageArgMaxInclMetadataLength::DefaultValue(),
+            DecodeImageArgResize resize =
+                DecodeImageArgResize::DefaultValue());
+
+// DecodeImageFrames is like DecodeImage but decodes every frame of an animated
+// image (or the only frame of a still image), calling callbacks.HandleFrame
+// after each one. Any callbacks.HandleProgress calls, during each frame, pass
+// the same (accumulating) dirty_rect that HandleFrame will get.
+//
+// The frames are composited, in order, onto a single canvas: the pixel buffer
+// returned by callbacks.AllocPixbuf. Each frame is blended with SRC_OVER,
+// unless its frame_config says to overwrite_instead_of_blend, in which case
+// it uses SRC. Frame disposal (RESTORE_BACKGROUND or RESTORE_PREVIOUS) is
+// applied to the canvas before the next frame is decoded. The decoder, work
+// buffer, pixel buffer and I/O buffer are re-used across frames, so memory use
+// does not grow with the number of frames. The only other allocation is for
+// RESTORE_PREVIOUS frames, which need a copy of the canvas pixels under the
+// frame's bounds (not the whole canvas). That copy is re-used too.
+//
+// The canvas is first filled with the background_color, if it is valid, or
+// with the first frame_config's background_color otherwise. The same color is
+// used for RESTORE_BACKGROUND disposal.
+//
+// callbacks.SelectPixfmt must return an interleaved, non-indexed pixel format.
+// For example, it cannot return GIF's natural (indexed) pixel format, since
+// different frames can use different palettes.
+//
+// The returned DecodeImageResult's fields have the same meaning as for
+// DecodeImage. On success, pixbuf holds the canvas after the final frame.
+DecodeImageResult  //
+DecodeImageFrames(
+    DecodeImageFramesCallbacks& callbacks,
+    sync_io::Input& input,
+    DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+    DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+    DecodeImageArgBackgroundColor background_color =
+        DecodeImageArgBackgroundColor::DefaultValue(),
+    DecodeImageArgMaxInclDimension max_incl_dimension =
+        DecodeImageArgMaxInclDimension::DefaultValue(),
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+        DecodeImageArgMaxInclMetadataLength::DefaultValue());
+
+// These overloads of DecodeImage and DecodeImageFrames are like the ones that
+// take plain callbacks, but they also re-use the context's pooled resources.
+// See the DecodeImageContext comment for more details.
+DecodeImageResult  //
+DecodeImage(DecodeImageContext& context,
+            sync_io::Input& input,
+            DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+            DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+            DecodeImageArgPixelBlend pixel_blend =
+                DecodeImageArgPixelBlend::DefaultValue(),
+            DecodeImageArgBackgroundColor background_color =
+                DecodeImageArgBackgroundColor::DefaultValue(),
+            DecodeImageArgMaxInclDimension max_incl_dimension =
+                DecodeImageArgMaxInclDimension::DefaultValue(),
+            DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+                DecodeImageArgMaxInclMetadataLength::DefaultValue(),
+            DecodeImageArgResize resize =
+                DecodeImageArgResize::DefaultValue());
+
+DecodeImageResult  //
+DecodeImageFrames(
+    DecodeImageContext& context,
+    sync_io::Input& input,
+    DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+    DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+    DecodeImageArgBackgroundColor background_color =
+        DecodeImageArgBackgroundColor::DefaultValue(),
+    DecodeImageArgMaxInclDimension max_incl_dimension =
+        DecodeImageArgMaxInclDimension::DefaultValue(),
+    DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+        DecodeImageArgMaxInclMetadataLength::DefaultValue());
+
+// ProbeImageResult is the result of ProbeImage.
+struct ProbeImageResult {
+  ProbeImageResult(uint32_t fourcc0,
+                   wuffs_base__image_config image_config0,
+                   uint64_t num_frames0,
+                   uint32_t orientation0,
+                   std::string&& error_message0);
+
+  // fourcc is the image file format, such as WUFFS_BASE__FOURCC__PNG, or zero
+  // if it was not recognized. For redirected formats (e.g. a nominal BMP file
+  // that actually contains a PNG), it is the inner format.
+  uint32_t fourcc;
+  wuffs_base__image_config image_config;
+  // num_frames is the number of frames (1 for still images), counted if
+  // ProbeImageArgFlags::COUNT_FRAMES was set. Otherwise, it is zero. On
+  // failure, it is the number of frames counted before the error.
+  uint64_t num_frames;
+  // orientation is the EXIF Orientation tag's value, in the range [1 ..= 8],
+  // if ProbeImageArgFlags::REPORT_ORIENTATION was set and it was found.
+  // Otherwise, it is zero.
+  uint32_t orientation;
+  std::string error_message;
+};
+
+// ProbeImageArgFlags wraps an optional argument to ProbeImage.
+struct ProbeImageArgFlags {
+  explicit ProbeImageArgFlags(uint64_t repr0);
+
+  // DefaultValue returns 0.
+  static ProbeImageArgFlags DefaultValue();
+
+  // Count the frames, by calling decode_frame_config until the end of the
+  // data. The frames' pixels are skipped over, not decoded, but this reads
+  // the whole input.
+  static constexpr uint64_t COUNT_FRAMES = 0x0001;
+  // Parse the EXIF metadata's Orientation tag. This is only found if the
+  // image decoder reports EXIF metadata (e.g. JPEG's APP1 segment or PNG's
+  // eXIf chunk) before the first frame or, if also counting frames, anywhere
+  // in the input. The image_config's width and height are not swapped, even
+  // if the orientation is a rotation by 90 or 270 degrees.
+  static constexpr uint64_t REPORT_ORIENTATION = 0x0002;
+
+  uint64_t repr;
+};
+
+// ProbeImage is like DecodeImage but it stops after decoding the image
+// config (the header), which includes the width, height and pixel format,
+// instead of allocating a pixel buffer and decoding the pixels. It reads as
+// little of the input as it can: unless the COUNT_FRAMES probe_flags bit is
+// set, it stops reading once the decoder's decode_image_config returns. If
+// the input does not bring its own IOBuffer, the fallback one is smaller than
+// DecodeImage's, so that probing a file reads only its first few KiB.
+//
+// Only the SelectDecoder, HandleMetadata and Done callbacks are called. The
+// flags and max_incl_metadata_length arguments have the same meaning as for
+// DecodeImage. The EXIF metadata parsed for the REPORT_ORIENTATION
+// probe_flags bit is only passed on to callbacks.HandleMetadata if the
+// REPORT_METADATA_EXIF flags bit is also set.
+ProbeImageResult  //
+ProbeImage(DecodeImageCallbacks& callbacks,
+           sync_io::Input& input,
+           DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+           DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+           ProbeImageArgFlags probe_flags = ProbeImageArgFlags::DefaultValue(),
+           DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+               DecodeImageArgMaxInclMetadataLength::DefaultValue());
+
+namespace private_impl {
+class DecodeImageState;
+}  // namespace private_impl
+
+// DecodeImageAsync is like DecodeImage but it does not block waiting for
+// input. Instead, each Resume call decodes as much as it can of the bytes that
+// have arrived so far and, if it needs more, returns a result whose
+// error_message is async_io::NeedMoreInput (and whose pixbuf is not valid).
+// Call Resume again after writing more bytes to the input (or closing it).
+// Callbacks are never called twice for the same event: decoding picks up
+// where it left off.
+//
+// Once Resume returns any other result (a final one, after which callbacks'
+// Done method has been called), subsequent Resume calls return
+// async_io::AlreadyDone.
+//
+// The callbacks and input must outlive the DecodeImageAsync. The quirks are
+// copied by the constructor and need not. Passing a DecodeImageContext as the
+// callbacks re-uses its pooled decoders and work buffer (but not its I/O
+// buffer, since an async_io::Input brings its own).
+class DecodeImageAsync {
+ public:
+  DecodeImageAsync(
+      DecodeImageCallbacks& callbacks,
+      async_io::Input& input,
+      DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+      DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+      DecodeImageArgPixelBlend pixel_blend =
+          DecodeImageArgPixelBlend::DefaultValue(),
+      DecodeImageArgBackgroundColor background_color =
+          DecodeImageArgBackgroundColor::DefaultValue(),
+      DecodeImageArgMaxInclDimension max_incl_dimension =
+          DecodeImageArgMaxInclDimension::DefaultValue(),
+      DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+          DecodeImageArgMaxInclMetadataLength::DefaultValue(),
+      DecodeImageArgResize resize = DecodeImageArgResize::DefaultValue());
+  ~DecodeImageAsync();
+
+  DecodeImageResult Resume();
+
+ private:
+  std::unique_ptr<private_impl::DecodeImageState> m_state;
+  bool m_done;
+
+  // Delete the copy and assign constructors.
+  DecodeImageAsync(const DecodeImageAsync&) = delete;
+  DecodeImageAsync& operator=(const DecodeImageAsync&) = delete;
+};
+
+// DecodeImageFramesAsync is to DecodeImageFrames as DecodeImageAsync is to
+// DecodeImage. callbacks.HandleFrame is called as each frame completes, from
+// within Resume.
+class DecodeImageFramesAsync {
+ public:
+  DecodeImageFramesAsync(
+      DecodeImageFramesCallbacks& callbacks,
+      async_io::Input& input,
+      DecodeImageArgQuirks quirks = DecodeImageArgQuirks::DefaultValue(),
+      DecodeImageArgFlags flags = DecodeImageArgFlags::DefaultValue(),
+      DecodeImageArgBackgroundColor background_color =
+          DecodeImageArgBackgroundColor::DefaultValue(),
+      DecodeImageArgMaxInclDimension max_incl_dimension =
+          DecodeImageArgMaxInclDimension::DefaultValue(),
+      DecodeImageArgMaxInclMetadataLength max_incl_metadata_length =
+          DecodeImageArgMaxInclMetadataLength::DefaultValue());
+  ~DecodeImageFramesAsync();
+
+  DecodeImageResult Resume();
+
+ private:
+  std::unique_ptr<private_impl::DecodeImageState> m_state;
+  bool m_done;
+
+  // Delete the copy and assign constructors.
+  DecodeImageFramesAsync(const DecodeImageFramesAsync&) = delete;
+  DecodeImageFramesAsync& operator=(const DecodeImageFramesAsync&) = delete;
+};
 
 }  // namespace wuffs_aux
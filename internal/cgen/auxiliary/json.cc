@@ -13,6 +13,7 @@
 #if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__JSON)
 
 #include <utility>
+#include <vector>
 
 namespace wuffs_aux {
 
@@ -50,6 +51,22 @@ DecodeJsonArgJsonPointer::DefaultValue() {
   return DecodeJsonArgJsonPointer(std::string());
 }
 
+DecodeJsonMultiCallbacks::~DecodeJsonMultiCallbacks() {}
+
+void  //
+DecodeJsonMultiCallbacks::Done(DecodeJsonResult& result,
+                               sync_io::Input& input,
+                               IOBuffer& buffer) {}
+
+DecodeJsonArgJsonPointers::DecodeJsonArgJsonPointers(const std::string* ptr0,
+                                                     const size_t len0)
+    : ptr(ptr0), len(len0) {}
+
+DecodeJsonArgJsonPointers  //
+DecodeJsonArgJsonPointers::DefaultValue() {
+  return DecodeJsonArgJsonPointers(nullptr, 0);
+}
+
 // --------
 
 #define WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN                          \
@@ -117,7 +134,7 @@ namespace {
 // The string returned is unescaped. If calling it again, this time with i=8,
 // the "b~1z" substring would be returned as "b/z".
 std::pair<std::string, size_t>  //
-DecodeJson_SplitJsonPointer(std::string& s,
+DecodeJson_SplitJsonPointer(const std::string& s,
                             size_t i,
                             bool allow_tilde_n_tilde_r_tilde_t) {
   std::string fragment;
@@ -168,47 +185,661 @@ DecodeJson_SplitJsonPointer(std::string& s,
 
 // --------
 
+// DecodeJsonMultiState holds DecodeJsonMulti's state: the compiled JSON
+// Pointer trie and the position within the JSON value being decoded.
+//
+// It is driven by HandleToken, one token at a time, and never recurses, even
+// though JSON values can nest.
+class DecodeJsonMultiState {
+ public:
+  explicit DecodeJsonMultiState(DecodeJsonMultiCallbacks& callbacks);
+
+  // Compile builds the trie. It returns an error message, or an empty string
+  // on success.
+  std::string  //
+  Compile(DecodeJsonArgJsonPointers json_pointers,
+          bool allow_tilde_n_tilde_r_tilde_t);
+
+  // HandleToken processes the next non-empty-chain token. token_ptr points to
+  // the token_len bytes of source text for that token.
+  std::string  //
+  HandleToken(wuffs_base__token token, uint8_t* token_ptr, uint64_t token_len);
+
+  // AllFinished returns whether every query has either been matched (and its
+  // sub-node completely decoded) or can no longer match.
+  bool AllFinished() const { return m_num_unfinished == 0; }
+
+ private:
+  static constexpr size_t NO_NODE = SIZE_MAX;
+
+  struct Node {
+    explicit Node(std::string&& fragment0);
+
+    // fragment is the unescaped JSON Pointer fragment that leads from this
+    // node's parent to this node.
+    std::string fragment;
+    // array_index is fragment parsed as an RFC 6901 array index, or
+    // UINT64_MAX if it isn't one.
+    uint64_t array_index;
+    // json_pointer_indexes lists the queries that end at this node.
+    std::vector<size_t> json_pointer_indexes;
+    // children are indexes into m_nodes.
+    std::vector<size_t> children;
+    // visited is whether a JSON value was matched to this node. Matching is
+    // greedy: subsequent duplicate keys do not match again.
+    bool visited;
+    // finished is whether this node's sub-tree can no longer be matched.
+    bool finished;
+  };
+
+  struct Frame {
+    Frame(size_t node0, bool is_list0);
+
+    size_t node;
+    bool is_list;
+    bool expecting_key;
+    uint64_t next_list_index;
+  };
+
+  struct Sink {
+    Sink(DecodeJsonCallbacks* callbacks0, size_t depth0);
+
+    DecodeJsonCallbacks* callbacks;
+    size_t depth;
+  };
+
+  size_t FindChild(size_t node, const std::string& key) const;
+  size_t FindChild(size_t node, uint64_t array_index) const;
+
+  void BeginValue();
+  void EndValue(size_t node);
+  void Finish(size_t node);
+
+  std::string AppendTextString();
+
+  DecodeJsonMultiCallbacks& m_callbacks;
+  std::vector<Node> m_nodes;
+  std::vector<Frame> m_frames;
+  std::vector<Sink> m_sinks;
+  std::vector<size_t> m_finish_stack;
+  size_t m_num_unfinished;
+
+  // m_value_node is the trie node for the JSON value that was most recently
+  // begun, or NO_NODE.
+  size_t m_value_node;
+  // m_dict_value_node is the trie node for the JSON object's value that
+  // follows the most recently completed key, or NO_NODE.
+  size_t m_dict_value_node;
+
+  bool m_in_chain;
+  bool m_chain_is_key;
+  bool m_chain_wants_str;
+  std::string m_str;
+};
+
+DecodeJsonMultiState::Node::Node(std::string&& fragment0)
+    : fragment(std::move(fragment0)),
+      array_index(UINT64_MAX),
+      visited(false),
+      finished(false) {
+  wuffs_base__result_u64 r = wuffs_base__parse_number_u64(
+      wuffs_base__make_slice_u8(
+          static_cast<uint8_t*>(
+              static_cast<void*>(const_cast<char*>(fragment.data()))),
+          fragment.size()),
+      WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+  if (r.status.is_ok()) {
+    array_index = r.value;
+  }
+}
+
+DecodeJsonMultiState::Frame::Frame(size_t node0, bool is_list0)
+    : node(node0),
+      is_list(is_list0),
+      expecting_key(!is_list0),
+      next_list_index(0) {}
+
+DecodeJsonMultiState::Sink::Sink(DecodeJsonCallbacks* callbacks0,
+                                 size_t depth0)
+    : callbacks(callbacks0), depth(depth0) {}
+
+DecodeJsonMultiState::DecodeJsonMultiState(DecodeJsonMultiCallbacks& callbacks)
+    : m_callbacks(callbacks),
+      m_num_unfinished(0),
+      m_value_node(NO_NODE),
+      m_dict_value_node(NO_NODE),
+      m_in_chain(false),
+      m_chain_is_key(false),
+      m_chain_wants_str(false) {}
+
 std::string  //
-DecodeJson_WalkJsonPointerFragment(wuffs_base__token_buffer& tok_buf,
-                                   wuffs_base__status& tok_status,
-                                   wuffs_json__decoder::unique_ptr& dec,
-                                   wuffs_base__io_buffer* io_buf,
-                                   std::string& io_error_message,
-                                   size_t& cursor_index,
-                                   sync_io::Input& input,
-                                   std::string& json_pointer_fragment) {
-  std::string ret_error_message;
-  while (true) {
-    WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
+DecodeJsonMultiState::Compile(DecodeJsonArgJsonPointers json_pointers,
+                              bool allow_tilde_n_tilde_r_tilde_t) {
+  m_nodes.emplace_back(std::string());
+  for (size_t j = 0; j < json_pointers.len; j++) {
+    const std::string& s = json_pointers.ptr[j];
+    size_t node = 0;
+    for (size_t i = 0; i < s.size();) {
+      if (s[i] != '/') {
+        return DecodeJson_BadJsonPointer;
+      }
+      std::pair<std::string, size_t> split =
+          DecodeJson_SplitJsonPointer(s, i + 1, allow_tilde_n_tilde_r_tilde_t);
+      i = split.second;
+      if (i == 0) {
+        return DecodeJson_BadJsonPointer;
+      }
+      size_t child = FindChild(node, split.first);
+      if (child == NO_NODE) {
+        child = m_nodes.size();
+        m_nodes.emplace_back(std::move(split.first));
+        m_nodes[node].children.push_back(child);
+      }
+      node = child;
+    }
+    m_nodes[node].json_pointer_indexes.push_back(j);
+  }
+  m_num_unfinished = json_pointers.len;
+  return "";
+}
 
-    int64_t vbc = token.value_base_category();
-    uint64_t vbd = token.value_base_detail();
-    if (vbc == WUFFS_BASE__TOKEN__VBC__FILLER) {
+size_t  //
+DecodeJsonMultiState::FindChild(size_t node, const std::string& key) const {
+  for (size_t child : m_nodes[node].children) {
+    if (!m_nodes[child].visited && (m_nodes[child].fragment == key)) {
+      return child;
+    }
+  }
+  return NO_NODE;
+}
+
+size_t  //
+DecodeJsonMultiState::FindChild(size_t node, uint64_t array_index) const {
+  for (size_t child : m_nodes[node].children) {
+    if (!m_nodes[child].visited &&
+        (m_nodes[child].array_index == array_index)) {
+      return child;
+    }
+  }
+  return NO_NODE;
+}
+
+void  //
+DecodeJsonMultiState::BeginValue() {
+  size_t node = NO_NODE;
+  if (m_frames.empty()) {
+    node = m_nodes[0].visited ? NO_NODE : 0;
+  } else {
+    Frame& f = m_frames.back();
+    if (f.is_list) {
+      if (f.node != NO_NODE) {
+        node = FindChild(f.node, f.next_list_index);
+      }
+      f.next_list_index++;
+    } else {
+      node = m_dict_value_node;
+      m_dict_value_node = NO_NODE;
+    }
+  }
+
+  m_value_node = node;
+  if (node != NO_NODE) {
+    m_nodes[node].visited = true;
+    for (size_t j : m_nodes[node].json_pointer_indexes) {
+      DecodeJsonCallbacks* c = m_callbacks.SelectCallbacks(j);
+      if (c) {
+        m_sinks.emplace_back(c, m_frames.size());
+      }
+    }
+  }
+}
+
+void  //
+DecodeJsonMultiState::EndValue(size_t node) {
+  if (node != NO_NODE) {
+    Finish(node);
+  }
+  while (!m_sinks.empty() && (m_sinks.back().depth >= m_frames.size())) {
+    m_sinks.pop_back();
+  }
+  if (!m_frames.empty() && !m_frames.back().is_list) {
+    m_frames.back().expecting_key = true;
+  }
+}
+
+void  //
+DecodeJsonMultiState::Finish(size_t node) {
+  m_finish_stack.push_back(node);
+  while (!m_finish_stack.empty()) {
+    Node& n = m_nodes[m_finish_stack.back()];
+    m_finish_stack.pop_back();
+    if (n.finished) {
       continue;
-    } else if ((vbc != WUFFS_BASE__TOKEN__VBC__STRUCTURE) ||
-               !(vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH)) {
-      return DecodeJson_NoMatch;
-    } else if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) {
-      goto do_list;
     }
-    goto do_dict;
+    n.finished = true;
+    m_num_unfinished -= n.json_pointer_indexes.size();
+    m_finish_stack.insert(m_finish_stack.end(), n.children.begin(),
+                          n.children.end());
   }
+}
 
-do_dict:
-  // Alternate between these two things:
-  //  1. Decode the next dict key (a string). If it matches the fragment, we're
-  //    done (success). If we've reached the dict's end (VBD__STRUCTURE__POP)
-  //    so that there was no next dict key, we're done (failure).
-  //  2. Otherwise, skip the next dict value.
-  while (true) {
-    for (std::string str; true;) {
-      WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
+std::string  //
+DecodeJsonMultiState::AppendTextString() {
+  for (size_t i = 0; i < m_sinks.size(); i++) {
+    std::string ret_error_message =
+        (i + 1 < m_sinks.size())
+            ? m_sinks[i].callbacks->AppendTextString(std::string(m_str))
+            : m_sinks[i].callbacks->AppendTextString(std::move(m_str));
+    if (!ret_error_message.empty()) {
+      return ret_error_message;
+    }
+  }
+  m_str.clear();
+  return "";
+}
 
-      int64_t vbc = token.value_base_category();
-      uint64_t vbd = token.value_base_detail();
+std::string  //
+DecodeJsonMultiState::HandleToken(wuffs_base__token token,
+                                  uint8_t* token_ptr,
+                                  uint64_t token_len) {
+  int64_t vbc = token.value_base_category();
+  uint64_t vbd = token.value_base_detail();
+  if (vbc == WUFFS_BASE__TOKEN__VBC__FILLER) {
+    return "";
+  }
+
+  if (!m_in_chain) {
+    if ((vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) &&
+        (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__POP)) {
+      if (m_frames.empty()) {
+        return "wuffs_aux::DecodeJson: internal error: bad depth";
+      }
+      for (auto& sink : m_sinks) {
+        std::string ret_error_message =
+            sink.callbacks->Pop(static_cast<uint32_t>(vbd));
+        if (!ret_error_message.empty()) {
+          return ret_error_message;
+        }
+      }
+      size_t node = m_frames.back().node;
+      m_frames.pop_back();
+      EndValue(node);
+      return "";
+    }
+
+    m_chain_is_key = !m_frames.empty() && !m_frames.back().is_list &&
+                     m_frames.back().expecting_key;
+    if (m_chain_is_key) {
+      size_t node = m_frames.back().node;
+      m_chain_wants_str =
+          !m_sinks.empty() ||
+          ((node != NO_NODE) && !m_nodes[node].children.empty());
+    } else {
+      BeginValue();
+      m_chain_wants_str = !m_sinks.empty();
+    }
+  }
+  m_in_chain = token.continued();
+
+  switch (vbc) {
+    case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
+      for (auto& sink : m_sinks) {
+        std::string ret_error_message =
+            sink.callbacks->Push(static_cast<uint32_t>(vbd));
+        if (!ret_error_message.empty()) {
+          return ret_error_message;
+        }
+      }
+      if (m_frames.size() >= WUFFS_JSON__DECODER_DEPTH_MAX_INCL) {
+        return "wuffs_aux::DecodeJson: internal error: bad depth";
+      }
+      bool is_list = (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) != 0;
+      m_frames.emplace_back(m_value_node, is_list);
+      return "";
+    }
+
+    case WUFFS_BASE__TOKEN__VBC__STRING: {
+      if (!m_chain_wants_str ||
+          (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP)) {
+        // No-op.
+      } else if (vbd &
+                 WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
+        const char* ptr =  // Convert from (uint8_t*).
+            static_cast<const char*>(static_cast<void*>(token_ptr));
+        m_str.append(ptr, static_cast<size_t>(token_len));
+      } else {
+        break;
+      }
+      if (token.continued()) {
+        return "";
+      }
+      if (m_chain_is_key) {
+        Frame& f = m_frames.back();
+        f.expecting_key = false;
+        m_dict_value_node =
+            (f.node != NO_NODE) ? FindChild(f.node, m_str) : NO_NODE;
+      }
+      std::string ret_error_message = AppendTextString();
+      if (!ret_error_message.empty()) {
+        return ret_error_message;
+      } else if (!m_chain_is_key) {
+        EndValue(m_value_node);
+      }
+      return "";
+    }
+
+    case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
+      if (m_chain_wants_str) {
+        uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
+        size_t n = wuffs_base__utf_8__encode(
+            wuffs_base__make_slice_u8(&u[0],
+                                      WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
+            static_cast<uint32_t>(vbd));
+        const char* ptr =  // Convert from (uint8_t*).
+            static_cast<const char*>(static_cast<void*>(&u[0]));
+        m_str.append(ptr, n);
+      }
+      if (token.continued()) {
+        return "";
+      }
+      break;
+    }
+
+    case WUFFS_BASE__TOKEN__VBC__LITERAL: {
+      for (auto& sink : m_sinks) {
+        std::string ret_error_message =
+            (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL)
+                ? sink.callbacks->AppendNull()
+                : sink.callbacks->AppendBool(
+                      vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
+        if (!ret_error_message.empty()) {
+          return ret_error_message;
+        }
+      }
+      EndValue(m_value_node);
+      return "";
+    }
+
+    case WUFFS_BASE__TOKEN__VBC__NUMBER: {
+      if (m_sinks.empty()) {
+        EndValue(m_value_node);
+        return "";
+      }
+      bool is_i64 = false;
+      int64_t i = 0;
+      double f = 0;
+      if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_TEXT) {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_INTEGER_SIGNED) {
+          wuffs_base__result_i64 r = wuffs_base__parse_number_i64(
+              wuffs_base__make_slice_u8(token_ptr,
+                                        static_cast<size_t>(token_len)),
+              WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+          is_i64 = r.status.is_ok();
+          i = r.value;
+        }
+        if (!is_i64) {
+          if (!(vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_FLOATING_POINT)) {
+            break;
+          }
+          wuffs_base__result_f64 r = wuffs_base__parse_number_f64(
+              wuffs_base__make_slice_u8(token_ptr,
+                                        static_cast<size_t>(token_len)),
+              WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+          if (!r.status.is_ok()) {
+            break;
+          }
+          f = r.value;
+        }
+      } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_INF) {
+        f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+            0xFFF0000000000000ul);
+      } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_INF) {
+        f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+            0x7FF0000000000000ul);
+      } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_NAN) {
+        f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+            0xFFFFFFFFFFFFFFFFul);
+      } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_NAN) {
+        f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+            0x7FFFFFFFFFFFFFFFul);
+      } else {
+        break;
+      }
+      for (auto& sink : m_sinks) {
+        std::string ret_error_message = is_i64
+                                            ? sink.callbacks->AppendI64(i)
+                                            : sink.callbacks->AppendF64(f);
+        if (!ret_error_message.empty()) {
+          return ret_error_message;
+        }
+      }
+      EndValue(m_value_node);
+      return "";
+    }
+  }
+
+  return "wuffs_aux::DecodeJson: internal error: unexpected token";
+}
+
+}  // namespace
+
+// --------
+
+namespace private_impl {
+
+// DecodeJsonState holds the state of DecodeJson and DecodeJsonAsync. Keeping
+// it out of local variables lets decoding be suspended, when the input needs
+// more bytes, and resumed later without re-reading or re-decoding anything.
+//
+// For the same reason, the JSON Pointer is walked one token at a time, by
+// WalkJsonPointer, instead of by nested loops that pull tokens themselves.
+class DecodeJsonState {
+ public:
+  DecodeJsonState(DecodeJsonCallbacks& callbacks,
+                  sync_io::Input& input,
+                  DecodeJsonArgQuirks quirks,
+                  DecodeJsonArgJsonPointer json_pointer);
+
+  // Resume decodes until it is finished, successfully or not, and returns
+  // true. It instead returns false if the input's CopyIn returned
+  // async_io::NeedMoreInput, in which case Resume can be called again later.
+  bool Resume();
+
+  // Finish calls the callbacks' Done method and returns the result.
+  DecodeJsonResult Finish();
+
+  uint64_t CursorPosition() const;
+
+ private:
+  enum WalkPhase {
+    // WALK_PHASE_DONE means that the JSON Pointer has been completely walked
+    // and the tokens are for the pointed-to JSON value.
+    WALK_PHASE_DONE = 0,
+    // WALK_PHASE_START expects the start of a JSON array or object.
+    WALK_PHASE_START = 1,
+    // WALK_PHASE_DICT_KEY decodes the next JSON object key. If it matches the
+    // fragment, we're done (success). If we've reached the object's end
+    // (VBD__STRUCTURE__POP) so that there was no next key, we're done
+    // (failure).
+    WALK_PHASE_DICT_KEY = 2,
+    // WALK_PHASE_DICT_VALUE skips the JSON object value after a key that did
+    // not match the fragment.
+    WALK_PHASE_DICT_VALUE = 3,
+    // WALK_PHASE_LIST skips m_walk_remaining JSON array elements.
+    WALK_PHASE_LIST = 4,
+    // WALK_PHASE_LIST_PEEK checks that a JSON array element follows, without
+    // consuming it.
+    WALK_PHASE_LIST_PEEK = 5,
+  };
+
+  // NextJsonPointerFragment moves on to the JSON Pointer's next fragment, or
+  // to WALK_PHASE_DONE if there are no more.
+  std::string NextJsonPointerFragment();
+
+  // WalkJsonPointer processes the next token, when m_walk_phase is not
+  // WALK_PHASE_DONE. It returns DecodeJson_NoMatch if the JSON Pointer does
+  // not match.
+  std::string  //
+  WalkJsonPointer(wuffs_base__token token,
+                  uint8_t* token_ptr,
+                  uint64_t token_len);
+
+  DecodeJsonCallbacks& m_callbacks;
+  sync_io::Input& m_input;
+  std::string m_json_pointer;
+
+  wuffs_base__io_buffer* m_io_buf;
+  wuffs_base__io_buffer m_fallback_io_buf;
+  std::unique_ptr<uint8_t[]> m_fallback_io_array;
+  // m_cursor_index is discussed at
+  // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
+  size_t m_cursor_index;
+  std::string m_ret_error_message;
+  std::string m_io_error_message;
+  bool m_suspended;
+
+  wuffs_json__decoder::unique_ptr m_dec;
+  bool m_allow_tilde_n_tilde_r_tilde_t;
+  // 256 tokens is 2KiB.
+  wuffs_base__token m_tok_array[256];
+  wuffs_base__token_buffer m_tok_buf;
+  wuffs_base__status m_tok_status;
+
+  int32_t m_depth;
+  std::string m_str;
+
+  // m_json_pointer_index is the position in m_json_pointer just after the
+  // fragment being walked.
+  size_t m_json_pointer_index;
+  WalkPhase m_walk_phase;
+  std::string m_walk_fragment;
+  std::string m_walk_str;
+  uint32_t m_walk_skip_depth;
+  uint64_t m_walk_remaining;
+
+  // Delete the copy and assign constructors.
+  DecodeJsonState(const DecodeJsonState&) = delete;
+  DecodeJsonState& operator=(const DecodeJsonState&) = delete;
+};
+
+DecodeJsonState::DecodeJsonState(DecodeJsonCallbacks& callbacks,
+                                 sync_io::Input& input,
+                                 DecodeJsonArgQuirks quirks,
+                                 DecodeJsonArgJsonPointer json_pointer)
+    : m_callbacks(callbacks),
+      m_input(input),
+      m_json_pointer(std::move(json_pointer.repr)),
+      m_io_buf(input.BringsItsOwnIOBuffer()),
+      m_fallback_io_buf(wuffs_base__empty_io_buffer()),
+      m_fallback_io_array(nullptr),
+      m_cursor_index(0),
+      m_suspended(false),
+      m_dec(nullptr),
+      m_allow_tilde_n_tilde_r_tilde_t(false),
+      m_tok_buf(wuffs_base__slice_token__writer(wuffs_base__make_slice_token(
+          &m_tok_array[0],
+          (sizeof(m_tok_array) / sizeof(m_tok_array[0]))))),
+      m_tok_status(wuffs_base__make_status(nullptr)),
+      m_depth(0),
+      m_json_pointer_index(0),
+      m_walk_phase(WALK_PHASE_DONE),
+      m_walk_skip_depth(0),
+      m_walk_remaining(0) {
+  // Prepare the wuffs_base__io_buffer.
+  if (!m_io_buf) {
+    m_fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    m_fallback_io_buf =
+        wuffs_base__ptr_u8__writer(m_fallback_io_array.get(), 4096);
+    m_io_buf = &m_fallback_io_buf;
+  }
+
+  // Prepare the low-level JSON decoder.
+  m_dec = wuffs_json__decoder::alloc();
+  if (!m_dec) {
+    m_ret_error_message = "wuffs_aux::DecodeJson: out of memory";
+    return;
+  } else if (WUFFS_JSON__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
+    m_ret_error_message =
+        "wuffs_aux::DecodeJson: internal error: bad WORKBUF_LEN";
+    return;
+  }
+  for (size_t i = 0; i < quirks.len; i++) {
+    m_dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
+    if (quirks.ptr[i].first ==
+        WUFFS_JSON__QUIRK_JSON_POINTER_ALLOW_TILDE_N_TILDE_R_TILDE_T) {
+      m_allow_tilde_n_tilde_r_tilde_t = (quirks.ptr[i].second != 0);
+    }
+  }
+
+  // Prepare the wuffs_base__tok_buffer.
+  m_tok_status =
+      m_dec->decode_tokens(&m_tok_buf, m_io_buf, wuffs_base__empty_slice_u8());
+
+  // Start walking the (optional) JSON Pointer.
+  m_ret_error_message = NextJsonPointerFragment();
+}
+
+std::string  //
+DecodeJsonState::NextJsonPointerFragment() {
+  size_t i = m_json_pointer_index;
+  if (i >= m_json_pointer.size()) {
+    m_walk_phase = WALK_PHASE_DONE;
+    return "";
+  } else if (m_json_pointer[i] != '/') {
+    return DecodeJson_BadJsonPointer;
+  }
+  std::pair<std::string, size_t> split = DecodeJson_SplitJsonPointer(
+      m_json_pointer, i + 1, m_allow_tilde_n_tilde_r_tilde_t);
+  m_json_pointer_index = split.second;
+  if (m_json_pointer_index == 0) {
+    return DecodeJson_BadJsonPointer;
+  }
+  m_walk_phase = WALK_PHASE_START;
+  m_walk_fragment = std::move(split.first);
+  return "";
+}
+
+std::string  //
+DecodeJsonState::WalkJsonPointer(wuffs_base__token token,
+                                 uint8_t* token_ptr,
+                                 uint64_t token_len) {
+  int64_t vbc = token.value_base_category();
+  uint64_t vbd = token.value_base_detail();
+  switch (m_walk_phase) {
+    case WALK_PHASE_DONE:
+      break;
+
+    case WALK_PHASE_START: {
+      if (vbc == WUFFS_BASE__TOKEN__VBC__FILLER) {
+        return "";
+      } else if ((vbc != WUFFS_BASE__TOKEN__VBC__STRUCTURE) ||
+                 !(vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH)) {
+        return DecodeJson_NoMatch;
+      } else if (!(vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST)) {
+        m_walk_phase = WALK_PHASE_DICT_KEY;
+        m_walk_str.clear();
+        return "";
+      }
+      wuffs_base__result_u64 result_u64 = wuffs_base__parse_number_u64(
+          wuffs_base__make_slice_u8(
+              static_cast<uint8_t*>(static_cast<void*>(
+                  const_cast<char*>(m_walk_fragment.data()))),
+              m_walk_fragment.size()),
+          WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+      if (!result_u64.status.is_ok()) {
+        return DecodeJson_NoMatch;
+      }
+      m_walk_remaining = result_u64.value;
+      m_walk_skip_depth = 0;
+      m_walk_phase = (m_walk_remaining == 0) ? WALK_PHASE_LIST_PEEK
+                                             : WALK_PHASE_LIST;
+      return "";
+    }
+
+    case WALK_PHASE_DICT_KEY: {
       switch (vbc) {
         case WUFFS_BASE__TOKEN__VBC__FILLER:
-          continue;
+          return "";
 
         case WUFFS_BASE__TOKEN__VBC__STRUCTURE:
           if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
@@ -223,7 +854,7 @@ do_dict:
                      WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
             const char* ptr =  // Convert from (uint8_t*).
                 static_cast<const char*>(static_cast<void*>(token_ptr));
-            str.append(ptr, static_cast<size_t>(token_len));
+            m_walk_str.append(ptr, static_cast<size_t>(token_len));
           } else {
             goto fail;
           }
@@ -238,7 +869,7 @@ do_dict:
               static_cast<uint32_t>(vbd));
           const char* ptr =  // Convert from (uint8_t*).
               static_cast<const char*>(static_cast<void*>(&u[0]));
-          str.append(ptr, n);
+          m_walk_str.append(ptr, n);
           break;
         }
 
@@ -247,143 +878,398 @@ do_dict:
       }
 
       if (token.continued()) {
-        continue;
-      }
-      if (str == json_pointer_fragment) {
         return "";
+      } else if (m_walk_str == m_walk_fragment) {
+        return NextJsonPointerFragment();
       }
-      goto skip_the_next_dict_value;
+      m_walk_phase = WALK_PHASE_DICT_VALUE;
+      m_walk_str.clear();
+      m_walk_skip_depth = 0;
+      return "";
     }
 
-  skip_the_next_dict_value:
-    for (uint32_t skip_depth = 0; true;) {
-      WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
-
-      int64_t vbc = token.value_base_category();
-      uint64_t vbd = token.value_base_detail();
+    case WALK_PHASE_DICT_VALUE: {
       if (token.continued() || (vbc == WUFFS_BASE__TOKEN__VBC__FILLER)) {
-        continue;
+        return "";
       } else if (vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) {
         if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
-          skip_depth++;
-          continue;
+          m_walk_skip_depth++;
+          return "";
         }
-        skip_depth--;
+        m_walk_skip_depth--;
       }
 
-      if (skip_depth == 0) {
-        break;
+      if (m_walk_skip_depth == 0) {
+        m_walk_phase = WALK_PHASE_DICT_KEY;
       }
-    }  // skip_the_next_dict_value
-  }    // do_dict
-
-do_list:
-  do {
-    wuffs_base__result_u64 result_u64 = wuffs_base__parse_number_u64(
-        wuffs_base__make_slice_u8(
-            static_cast<uint8_t*>(static_cast<void*>(
-                const_cast<char*>(json_pointer_fragment.data()))),
-            json_pointer_fragment.size()),
-        WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
-    if (!result_u64.status.is_ok()) {
-      return DecodeJson_NoMatch;
-    }
-    uint64_t remaining = result_u64.value;
-    if (remaining == 0) {
-      goto check_that_a_value_follows;
-    }
-    for (uint32_t skip_depth = 0; true;) {
-      WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
+      return "";
+    }
 
-      int64_t vbc = token.value_base_category();
-      uint64_t vbd = token.value_base_detail();
+    case WALK_PHASE_LIST: {
       if (token.continued() || (vbc == WUFFS_BASE__TOKEN__VBC__FILLER)) {
-        continue;
+        return "";
       } else if (vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) {
         if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
-          skip_depth++;
-          continue;
+          m_walk_skip_depth++;
+          return "";
         }
-        if (skip_depth == 0) {
+        if (m_walk_skip_depth == 0) {
           return DecodeJson_NoMatch;
         }
-        skip_depth--;
+        m_walk_skip_depth--;
       }
 
-      if (skip_depth > 0) {
-        continue;
+      if (m_walk_skip_depth > 0) {
+        return "";
       }
-      remaining--;
-      if (remaining == 0) {
-        goto check_that_a_value_follows;
+      m_walk_remaining--;
+      if (m_walk_remaining == 0) {
+        m_walk_phase = WALK_PHASE_LIST_PEEK;
       }
+      return "";
     }
-  } while (false);  // do_list
-
-check_that_a_value_follows:
-  while (true) {
-    WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
 
-    int64_t vbc = token.value_base_category();
-    uint64_t vbd = token.value_base_detail();
-    if (vbc == WUFFS_BASE__TOKEN__VBC__FILLER) {
-      continue;
-    }
+    case WALK_PHASE_LIST_PEEK: {
+      if (vbc == WUFFS_BASE__TOKEN__VBC__FILLER) {
+        return "";
+      }
 
-    // Undo the last part of WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN, so
-    // that we're only peeking at the next token.
-    tok_buf.meta.ri--;
-    cursor_index -= static_cast<size_t>(token_len);
+      // Undo the last part of getting the next token, so that we're only
+      // peeking at it. It will be got again, either for the next fragment or
+      // for the pointed-to JSON value.
+      m_tok_buf.meta.ri--;
+      m_cursor_index -= static_cast<size_t>(token_len);
 
-    if ((vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) &&
-        (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__POP)) {
-      return DecodeJson_NoMatch;
+      if ((vbc == WUFFS_BASE__TOKEN__VBC__STRUCTURE) &&
+          (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__POP)) {
+        return DecodeJson_NoMatch;
+      }
+      return NextJsonPointerFragment();
     }
-    return "";
-  }  // check_that_a_value_follows
+  }
 
 fail:
   return "wuffs_aux::DecodeJson: internal error: unexpected token";
-done:
-  return ret_error_message;
 }
 
-}  // namespace
+bool  //
+DecodeJsonState::Resume() {
+  if (!m_ret_error_message.empty()) {
+    // The constructor failed.
+    return true;
+  }
 
-// --------
+  // Loop, doing these two things:
+  //  1. Get the next token.
+  //  2. Process that token.
+  while (true) {
+    // 1. Get the next token.
 
-DecodeJsonResult  //
-DecodeJson(DecodeJsonCallbacks& callbacks,
-           sync_io::Input& input,
-           DecodeJsonArgQuirks quirks,
-           DecodeJsonArgJsonPointer json_pointer) {
-  // Prepare the wuffs_base__io_buffer and the resultant error_message.
-  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
-  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
-  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
-  if (!io_buf) {
-    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
-    fallback_io_buf = wuffs_base__ptr_u8__writer(fallback_io_array.get(), 4096);
-    io_buf = &fallback_io_buf;
-  }
-  // cursor_index is discussed at
-  // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
-  size_t cursor_index = 0;
-  std::string ret_error_message;
-  std::string io_error_message;
+    while (m_tok_buf.meta.ri >= m_tok_buf.meta.wi) {
+      if (m_tok_status.repr == nullptr) {
+        goto done;
+      } else if (m_tok_status.repr == wuffs_base__suspension__short_write) {
+        m_tok_buf.compact();
+      } else if (m_tok_status.repr == wuffs_base__suspension__short_read) {
+        if (m_suspended) {
+          // Retry the CopyIn that returned async_io::NeedMoreInput. In the
+          // meantime, the input may have compacted io_buf.
+          m_suspended = false;
+        } else if (!m_io_error_message.empty()) {
+          m_ret_error_message = std::move(m_io_error_message);
+          goto done;
+        } else if (m_cursor_index != m_io_buf->meta.ri) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeJson: internal error: bad cursor_index";
+          goto done;
+        } else if (m_io_buf->meta.closed) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeJson: internal error: io_buf is closed";
+          goto done;
+        } else {
+          m_io_buf->compact();
+          if (m_io_buf->meta.wi >= m_io_buf->data.len) {
+            m_ret_error_message =
+                "wuffs_aux::DecodeJson: internal error: io_buf is full";
+            goto done;
+          }
+        }
+        m_cursor_index = m_io_buf->meta.ri;
+        m_io_error_message = m_input.CopyIn(m_io_buf);
+        if (m_io_error_message == async_io::NeedMoreInput) {
+          m_suspended = true;
+          return false;
+        }
+      } else {
+        m_ret_error_message = m_tok_status.message();
+        goto done;
+      }
+      m_tok_status = m_dec->decode_tokens(&m_tok_buf, m_io_buf,
+                                          wuffs_base__empty_slice_u8());
+      if ((m_tok_buf.meta.ri > m_tok_buf.meta.wi) ||
+          (m_tok_buf.meta.wi > m_tok_buf.data.len) ||
+          (m_io_buf->meta.ri > m_io_buf->meta.wi) ||
+          (m_io_buf->meta.wi > m_io_buf->data.len)) {
+        m_ret_error_message =
+            "wuffs_aux::DecodeJson: internal error: bad buffer indexes";
+        goto done;
+      }
+    }
 
-  do {
-    // Prepare the low-level JSON decoder.
-    wuffs_json__decoder::unique_ptr dec = wuffs_json__decoder::alloc();
-    if (!dec) {
-      ret_error_message = "wuffs_aux::DecodeJson: out of memory";
-      goto done;
-    } else if (WUFFS_JSON__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
-      ret_error_message =
-          "wuffs_aux::DecodeJson: internal error: bad WORKBUF_LEN";
+    wuffs_base__token token = m_tok_buf.data.ptr[m_tok_buf.meta.ri++];
+    uint64_t token_len = token.length();
+    if ((m_io_buf->meta.ri < m_cursor_index) ||
+        ((m_io_buf->meta.ri - m_cursor_index) < token_len)) {
+      m_ret_error_message =
+          "wuffs_aux::DecodeJson: internal error: bad token indexes";
       goto done;
     }
-    bool allow_tilde_n_tilde_r_tilde_t = false;
+    uint8_t* token_ptr = m_io_buf->data.ptr + m_cursor_index;
+    m_cursor_index += static_cast<size_t>(token_len);
+
+    // 2. Process that token.
+
+    if (m_walk_phase != WALK_PHASE_DONE) {
+      m_ret_error_message = WalkJsonPointer(token, token_ptr, token_len);
+      if (!m_ret_error_message.empty()) {
+        goto done;
+      }
+      continue;
+    }
+
+    int64_t vbc = token.value_base_category();
+    uint64_t vbd = token.value_base_detail();
+    switch (vbc) {
+      case WUFFS_BASE__TOKEN__VBC__FILLER:
+        continue;
+
+      case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
+          m_ret_error_message = m_callbacks.Push(static_cast<uint32_t>(vbd));
+          if (!m_ret_error_message.empty()) {
+            goto done;
+          }
+          m_depth++;
+          if (m_depth > (int32_t)WUFFS_JSON__DECODER_DEPTH_MAX_INCL) {
+            m_ret_error_message =
+                "wuffs_aux::DecodeJson: internal error: bad depth";
+            goto done;
+          }
+          continue;
+        }
+        m_ret_error_message = m_callbacks.Pop(static_cast<uint32_t>(vbd));
+        m_depth--;
+        if (m_depth < 0) {
+          m_ret_error_message =
+              "wuffs_aux::DecodeJson: internal error: bad depth";
+          goto done;
+        }
+        goto parsed_a_value;
+      }
+
+      case WUFFS_BASE__TOKEN__VBC__STRING: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP) {
+          // No-op.
+        } else if (vbd &
+                   WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
+          const char* ptr =  // Convert from (uint8_t*).
+              static_cast<const char*>(static_cast<void*>(token_ptr));
+          m_str.append(ptr, static_cast<size_t>(token_len));
+        } else {
+          goto fail;
+        }
+        if (token.continued()) {
+          continue;
+        }
+        m_ret_error_message = m_callbacks.AppendTextString(std::move(m_str));
+        m_str.clear();
+        goto parsed_a_value;
+      }
+
+      case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
+        uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
+        size_t n = wuffs_base__utf_8__encode(
+            wuffs_base__make_slice_u8(
+                &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
+            static_cast<uint32_t>(vbd));
+        const char* ptr =  // Convert from (uint8_t*).
+            static_cast<const char*>(static_cast<void*>(&u[0]));
+        m_str.append(ptr, n);
+        if (token.continued()) {
+          continue;
+        }
+        goto fail;
+      }
+
+      case WUFFS_BASE__TOKEN__VBC__LITERAL: {
+        m_ret_error_message =
+            (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL)
+                ? m_callbacks.AppendNull()
+                : m_callbacks.AppendBool(vbd &
+                                       WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
+        goto parsed_a_value;
+      }
+
+      case WUFFS_BASE__TOKEN__VBC__NUMBER: {
+        if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_TEXT) {
+          if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_INTEGER_SIGNED) {
+            wuffs_base__result_i64 r = wuffs_base__parse_number_i64(
+                wuffs_base__make_slice_u8(token_ptr,
+                                          static_cast<size_t>(token_len)),
+                WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+            if (r.status.is_ok()) {
+              m_ret_error_message = m_callbacks.AppendI64(r.value);
+              goto parsed_a_value;
+            }
+          }
+          if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_FLOATING_POINT) {
+            wuffs_base__result_f64 r = wuffs_base__parse_number_f64(
+                wuffs_base__make_slice_u8(token_ptr,
+                                          static_cast<size_t>(token_len)),
+                WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
+            if (r.status.is_ok()) {
+              m_ret_error_message = m_callbacks.AppendF64(r.value);
+              goto parsed_a_value;
+            }
+          }
+        } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_INF) {
+          m_ret_error_message = m_callbacks.AppendF64(
+              wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                  0xFFF0000000000000ul));
+          goto parsed_a_value;
+        } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_INF) {
+          m_ret_error_message = m_callbacks.AppendF64(
+              wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                  0x7FF0000000000000ul));
+          goto parsed_a_value;
+        } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_NAN) {
+          m_ret_error_message = m_callbacks.AppendF64(
+              wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                  0xFFFFFFFFFFFFFFFFul));
+          goto parsed_a_value;
+        } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_NAN) {
+          m_ret_error_message = m_callbacks.AppendF64(
+              wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                  0x7FFFFFFFFFFFFFFFul));
+          goto parsed_a_value;
+        }
+        goto fail;
+      }
+    }
+
+  fail:
+    m_ret_error_message =
+        "wuffs_aux::DecodeJson: internal error: unexpected token";
+    goto done;
+
+  parsed_a_value:
+    // If an error was encountered, we are done. Otherwise, (depth == 0)
+    // after parsing a value is equivalent to having decoded the entire JSON
+    // value (for an empty json_pointer query) or having decoded the
+    // pointed-to JSON value (for a non-empty json_pointer query). In the
+    // latter case, we are also done.
+    //
+    // However, if quirks like WUFFS_JSON__QUIRK_ALLOW_TRAILING_FILLER or
+    // WUFFS_JSON__QUIRK_EXPECT_TRAILING_NEW_LINE_OR_EOF are passed, decoding
+    // the entire JSON value should also consume any trailing filler, in case
+    // the DecodeJson caller wants to subsequently check that the input is
+    // completely exhausted (and otherwise raise "valid JSON followed by
+    // further (unexpected) data"). We aren't done yet. Instead, keep the
+    // loop running until getting the next token's decode_tokens call returns
+    // an ok status.
+    if (!m_ret_error_message.empty() ||
+        ((m_depth == 0) && !m_json_pointer.empty())) {
+      goto done;
+    }
+  }
+
+done:
+  return true;
+}
+
+DecodeJsonResult  //
+DecodeJsonState::Finish() {
+  DecodeJsonResult result(m_suspended ? std::string(async_io::NeedMoreInput)
+                                      : std::move(m_ret_error_message),
+                          CursorPosition());
+  m_callbacks.Done(result, m_input, *m_io_buf);
+  return result;
+}
+
+uint64_t  //
+DecodeJsonState::CursorPosition() const {
+  return wuffs_base__u64__sat_add(m_io_buf->meta.pos, m_cursor_index);
+}
+
+}  // namespace private_impl
+
+DecodeJsonResult  //
+DecodeJson(DecodeJsonCallbacks& callbacks,
+           sync_io::Input& input,
+           DecodeJsonArgQuirks quirks,
+           DecodeJsonArgJsonPointer json_pointer) {
+  private_impl::DecodeJsonState state(callbacks, input, quirks,
+                                      std::move(json_pointer));
+  state.Resume();
+  return state.Finish();
+}
+
+DecodeJsonAsync::DecodeJsonAsync(DecodeJsonCallbacks& callbacks,
+                                 async_io::Input& input,
+                                 DecodeJsonArgQuirks quirks,
+                                 DecodeJsonArgJsonPointer json_pointer)
+    : m_state(new private_impl::DecodeJsonState(callbacks,
+                                                input,
+                                                quirks,
+                                                std::move(json_pointer))),
+      m_done(false) {}
+
+DecodeJsonAsync::~DecodeJsonAsync() {}
+
+DecodeJsonResult  //
+DecodeJsonAsync::Resume() {
+  if (m_done) {
+    return DecodeJsonResult(async_io::AlreadyDone, m_state->CursorPosition());
+  } else if (!m_state->Resume()) {
+    return DecodeJsonResult(async_io::NeedMoreInput,
+                            m_state->CursorPosition());
+  }
+  m_done = true;
+  return m_state->Finish();
+}
+
+DecodeJsonResult  //
+DecodeJsonMulti(DecodeJsonMultiCallbacks& callbacks,
+                sync_io::Input& input,
+                DecodeJsonArgJsonPointers json_pointers,
+                DecodeJsonArgQuirks quirks) {
+  // Prepare the wuffs_base__io_buffer and the resultant error_message.
+  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
+  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
+  if (!io_buf) {
+    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    fallback_io_buf = wuffs_base__ptr_u8__writer(fallback_io_array.get(), 4096);
+    io_buf = &fallback_io_buf;
+  }
+  // cursor_index is discussed at
+  // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
+  size_t cursor_index = 0;
+  std::string ret_error_message;
+  std::string io_error_message;
+
+  do {
+    // Prepare the low-level JSON decoder.
+    wuffs_json__decoder::unique_ptr dec = wuffs_json__decoder::alloc();
+    if (!dec) {
+      ret_error_message = "wuffs_aux::DecodeJson: out of memory";
+      goto done;
+    } else if (WUFFS_JSON__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
+      ret_error_message =
+          "wuffs_aux::DecodeJson: internal error: bad WORKBUF_LEN";
+      goto done;
+    }
+    bool allow_tilde_n_tilde_r_tilde_t = false;
     for (size_t i = 0; i < quirks.len; i++) {
       dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
       if (quirks.ptr[i].first ==
@@ -392,6 +1278,14 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
       }
     }
 
+    // Compile the JSON Pointers.
+    DecodeJsonMultiState state(callbacks);
+    ret_error_message =
+        state.Compile(json_pointers, allow_tilde_n_tilde_r_tilde_t);
+    if (!ret_error_message.empty() || state.AllFinished()) {
+      goto done;
+    }
+
     // Prepare the wuffs_base__tok_buffer. 256 tokens is 2KiB.
     wuffs_base__token tok_array[256];
     wuffs_base__token_buffer tok_buf =
@@ -400,30 +1294,181 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
     wuffs_base__status tok_status =
         dec->decode_tokens(&tok_buf, io_buf, wuffs_base__empty_slice_u8());
 
-    // Prepare other state.
-    int32_t depth = 0;
-    std::string str;
-
-    // Walk the (optional) JSON Pointer.
-    for (size_t i = 0; i < json_pointer.repr.size();) {
-      if (json_pointer.repr[i] != '/') {
-        ret_error_message = DecodeJson_BadJsonPointer;
-        goto done;
-      }
-      std::pair<std::string, size_t> split = DecodeJson_SplitJsonPointer(
-          json_pointer.repr, i + 1, allow_tilde_n_tilde_r_tilde_t);
-      i = split.second;
-      if (i == 0) {
-        ret_error_message = DecodeJson_BadJsonPointer;
-        goto done;
-      }
-      ret_error_message = DecodeJson_WalkJsonPointerFragment(
-          tok_buf, tok_status, dec, io_buf, io_error_message, cursor_index,
-          input, split.first);
-      if (!ret_error_message.empty()) {
+    // Loop, doing these two things:
+    //  1. Get the next token.
+    //  2. Process that token.
+    while (true) {
+      WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN;
+      ret_error_message = state.HandleToken(token, token_ptr, token_len);
+      if (!ret_error_message.empty() || state.AllFinished()) {
         goto done;
       }
     }
+  } while (false);
+
+done:
+  DecodeJsonResult result(
+      std::move(ret_error_message),
+      wuffs_base__u64__sat_add(io_buf->meta.pos, cursor_index));
+  callbacks.Done(result, input, *io_buf);
+  return result;
+}
+
+// --------
+
+namespace {
+
+std::string  //
+TranscodeJsonToCbor_Write(sync_io::Output& output,
+                          IOBuffer& dst,
+                          const void* ptr,
+                          size_t len) {
+  if (len <= dst.writer_length()) {
+    memcpy(dst.writer_pointer(), ptr, len);
+    dst.meta.wi += len;
+    return "";
+  }
+  return private_impl::WriteToOutput(output, dst,
+                                     static_cast<const uint8_t*>(ptr), len);
+}
+
+// TranscodeJsonToCbor_WriteHead writes a CBOR data item's head: its major
+// type (the high 3 bits of base) and its argument n.
+std::string  //
+TranscodeJsonToCbor_WriteHead(sync_io::Output& output,
+                              IOBuffer& dst,
+                              uint8_t base,
+                              uint64_t n) {
+  uint8_t c[9];
+  if (n < 0x18) {
+    c[0] = base | static_cast<uint8_t>(n);
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 1);
+  } else if (n <= 0xFF) {
+    c[0] = base | 0x18;
+    c[1] = static_cast<uint8_t>(n);
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 2);
+  } else if (n <= 0xFFFF) {
+    c[0] = base | 0x19;
+    wuffs_base__poke_u16be__no_bounds_check(&c[1], static_cast<uint16_t>(n));
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 3);
+  } else if (n <= 0xFFFFFFFF) {
+    c[0] = base | 0x1A;
+    wuffs_base__poke_u32be__no_bounds_check(&c[1], static_cast<uint32_t>(n));
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 5);
+  }
+  c[0] = base | 0x1B;
+  wuffs_base__poke_u64be__no_bounds_check(&c[1], n);
+  return TranscodeJsonToCbor_Write(output, dst, &c[0], 9);
+}
+
+std::string  //
+TranscodeJsonToCbor_WriteI64(sync_io::Output& output,
+                             IOBuffer& dst,
+                             int64_t val) {
+  return (val >= 0) ? TranscodeJsonToCbor_WriteHead(
+                          output, dst, 0x00, static_cast<uint64_t>(val))
+                    : TranscodeJsonToCbor_WriteHead(
+                          output, dst, 0x20, static_cast<uint64_t>(-(val + 1)));
+}
+
+std::string  //
+TranscodeJsonToCbor_WriteF64(sync_io::Output& output,
+                             IOBuffer& dst,
+                             double val) {
+  uint8_t c[9];
+  wuffs_base__lossy_value_u16 lv16 =
+      wuffs_base__ieee_754_bit_representation__from_f64_to_u16_truncate(val);
+  if (!lv16.lossy) {
+    c[0] = 0xF9;
+    wuffs_base__poke_u16be__no_bounds_check(&c[1], lv16.value);
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 3);
+  }
+  wuffs_base__lossy_value_u32 lv32 =
+      wuffs_base__ieee_754_bit_representation__from_f64_to_u32_truncate(val);
+  if (!lv32.lossy) {
+    c[0] = 0xFA;
+    wuffs_base__poke_u32be__no_bounds_check(&c[1], lv32.value);
+    return TranscodeJsonToCbor_Write(output, dst, &c[0], 5);
+  }
+  c[0] = 0xFB;
+  wuffs_base__poke_u64be__no_bounds_check(
+      &c[1], wuffs_base__ieee_754_bit_representation__from_f64_to_u64(val));
+  return TranscodeJsonToCbor_Write(output, dst, &c[0], 9);
+}
+
+// TranscodeJsonToCbor_StringLength returns the number of UTF-8 bytes that the
+// token contributes to a JSON string.
+uint64_t  //
+TranscodeJsonToCbor_StringLength(wuffs_base__token token) {
+  uint64_t vbd = token.value_base_detail();
+  switch (token.value_base_category()) {
+    case WUFFS_BASE__TOKEN__VBC__STRING:
+      return (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY)
+                 ? token.length()
+                 : 0;
+    case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT:
+      return (vbd < 0x80) ? 1 : (vbd < 0x800) ? 2 : (vbd < 0x10000) ? 3 : 4;
+  }
+  return 0;
+}
+
+}  // namespace
+
+DecodeJsonResult  //
+TranscodeJsonToCbor(sync_io::Output& output,
+                    sync_io::Input& input,
+                    DecodeJsonArgQuirks quirks) {
+  // Prepare the wuffs_base__io_buffers and the resultant error_message.
+  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
+  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
+  if (!io_buf) {
+    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    fallback_io_buf = wuffs_base__ptr_u8__writer(fallback_io_array.get(), 4096);
+    io_buf = &fallback_io_buf;
+  }
+  wuffs_base__io_buffer* dst = output.BringsItsOwnIOBuffer();
+  wuffs_base__io_buffer fallback_dst = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_dst_array(nullptr);
+  if (!dst) {
+    fallback_dst_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    fallback_dst = wuffs_base__ptr_u8__writer(fallback_dst_array.get(), 4096);
+    dst = &fallback_dst;
+  }
+  // cursor_index is discussed at
+  // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
+  size_t cursor_index = 0;
+  std::string ret_error_message;
+  std::string io_error_message;
+
+  do {
+    // Prepare the low-level JSON decoder.
+    wuffs_json__decoder::unique_ptr dec = wuffs_json__decoder::alloc();
+    if (!dec) {
+      ret_error_message = "wuffs_aux::TranscodeJsonToCbor: out of memory";
+      goto done;
+    } else if (WUFFS_JSON__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
+      ret_error_message =
+          "wuffs_aux::TranscodeJsonToCbor: internal error: bad WORKBUF_LEN";
+      goto done;
+    }
+    for (size_t i = 0; i < quirks.len; i++) {
+      dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
+    }
+
+    // Prepare the wuffs_base__tok_buffer. 256 tokens is 2KiB.
+    wuffs_base__token tok_array[256];
+    wuffs_base__token_buffer tok_buf =
+        wuffs_base__slice_token__writer(wuffs_base__make_slice_token(
+            &tok_array[0], (sizeof(tok_array) / sizeof(tok_array[0]))));
+    wuffs_base__status tok_status =
+        dec->decode_tokens(&tok_buf, io_buf, wuffs_base__empty_slice_u8());
+
+    // Prepare other state.
+    int32_t depth = 0;
+    bool in_string = false;
+    bool in_long_string = false;
+    std::string long_string;
 
     // Loop, doing these two things:
     //  1. Get the next token.
@@ -439,68 +1484,135 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
 
         case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
           if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
-            ret_error_message = callbacks.Push(static_cast<uint32_t>(vbd));
+            ret_error_message = TranscodeJsonToCbor_Write(
+                output, *dst,
+                (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) ? "\x9F"
+                                                                   : "\xBF",
+                1);
             if (!ret_error_message.empty()) {
               goto done;
             }
             depth++;
             if (depth > (int32_t)WUFFS_JSON__DECODER_DEPTH_MAX_INCL) {
               ret_error_message =
-                  "wuffs_aux::DecodeJson: internal error: bad depth";
+                  "wuffs_aux::TranscodeJsonToCbor: internal error: bad depth";
               goto done;
             }
             continue;
           }
-          ret_error_message = callbacks.Pop(static_cast<uint32_t>(vbd));
+          ret_error_message =
+              TranscodeJsonToCbor_Write(output, *dst, "\xFF", 1);
           depth--;
           if (depth < 0) {
             ret_error_message =
-                "wuffs_aux::DecodeJson: internal error: bad depth";
+                "wuffs_aux::TranscodeJsonToCbor: internal error: bad depth";
             goto done;
           }
           goto parsed_a_value;
         }
 
-        case WUFFS_BASE__TOKEN__VBC__STRING: {
-          if (vbd & WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP) {
-            // No-op.
+        case WUFFS_BASE__TOKEN__VBC__STRING:
+        case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
+          if (!in_string) {
+            // Look ahead for the end of this string's token chain, so that
+            // the CBOR text string's definite length can be written first.
+            // This can decode more tokens, from the input already in io_buf,
+            // but it cannot read more input without invalidating token_ptr
+            // values. If the chain extends beyond that, it is a long string:
+            // accumulate it in long_string and write it at its end. Either
+            // way, the output does not depend on the I/O buffer size.
+            in_string = true;
+            in_long_string = true;
+            uint64_t n = 0;
+            size_t i = tok_buf.meta.ri - 1;
+            while (true) {
+              if (i < tok_buf.meta.wi) {
+                wuffs_base__token t = tok_buf.data.ptr[i++];
+                n += TranscodeJsonToCbor_StringLength(t);
+                if (!t.continued()) {
+                  in_long_string = false;
+                  break;
+                }
+                continue;
+              } else if ((tok_status.repr !=
+                          wuffs_base__suspension__short_write) ||
+                         (tok_buf.meta.ri == 0)) {
+                break;
+              }
+              i -= tok_buf.meta.ri;
+              tok_buf.compact();
+              tok_status = dec->decode_tokens(&tok_buf, io_buf,
+                                              wuffs_base__empty_slice_u8());
+              if (i >= tok_buf.meta.wi) {
+                break;
+              }
+            }
+            if (in_long_string) {
+              long_string.clear();
+            } else {
+              ret_error_message =
+                  TranscodeJsonToCbor_WriteHead(output, *dst, 0x60, n);
+              if (!ret_error_message.empty()) {
+                goto done;
+              }
+            }
+          }
+
+          uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
+          const uint8_t* ptr = token_ptr;
+          size_t len = 0;
+          if (vbc == WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT) {
+            ptr = &u[0];
+            len = wuffs_base__utf_8__encode(
+                wuffs_base__make_slice_u8(
+                    &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
+                static_cast<uint32_t>(vbd));
           } else if (vbd &
                      WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
-            const char* ptr =  // Convert from (uint8_t*).
-                static_cast<const char*>(static_cast<void*>(token_ptr));
-            str.append(ptr, static_cast<size_t>(token_len));
+            len = static_cast<size_t>(token_len);
           } else {
-            goto fail;
-          }
-          if (token.continued()) {
-            continue;
+            constexpr uint64_t drop =
+                WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP;
+            if (!(vbd & drop)) {
+              goto fail;
+            }
           }
-          ret_error_message = callbacks.AppendTextString(std::move(str));
-          str.clear();
-          goto parsed_a_value;
-        }
 
-        case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
-          uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
-          size_t n = wuffs_base__utf_8__encode(
-              wuffs_base__make_slice_u8(
-                  &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
-              static_cast<uint32_t>(vbd));
-          const char* ptr =  // Convert from (uint8_t*).
-              static_cast<const char*>(static_cast<void*>(&u[0]));
-          str.append(ptr, n);
+          if (len == 0) {
+            // No-op.
+          } else if (in_long_string) {
+            long_string.append(reinterpret_cast<const char*>(ptr), len);
+          } else {
+            ret_error_message =
+                TranscodeJsonToCbor_Write(output, *dst, ptr, len);
+            if (!ret_error_message.empty()) {
+              goto done;
+            }
+          }
           if (token.continued()) {
             continue;
+          } else if (vbc == WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT) {
+            goto fail;
           }
-          goto fail;
+          in_string = false;
+          if (in_long_string) {
+            ret_error_message = TranscodeJsonToCbor_WriteHead(
+                output, *dst, 0x60, long_string.size());
+            if (ret_error_message.empty()) {
+              ret_error_message = TranscodeJsonToCbor_Write(
+                  output, *dst, long_string.data(), long_string.size());
+            }
+          }
+          goto parsed_a_value;
         }
 
         case WUFFS_BASE__TOKEN__VBC__LITERAL: {
-          ret_error_message =
-              (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL)
-                  ? callbacks.AppendNull()
-                  : callbacks.AppendBool(vbd &
-                                         WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
+          ret_error_message = TranscodeJsonToCbor_Write(
+              output, *dst,
+              (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__NULL)   ? "\xF6"
+              : (vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE) ? "\xF5"
+                                                              : "\xF4",
+              1);
           goto parsed_a_value;
         }
 
@@ -512,7 +1624,8 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
                                             static_cast<size_t>(token_len)),
                   WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
               if (r.status.is_ok()) {
-                ret_error_message = callbacks.AppendI64(r.value);
+                ret_error_message =
+                    TranscodeJsonToCbor_WriteI64(output, *dst, r.value);
                 goto parsed_a_value;
               }
             }
@@ -522,29 +1635,26 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
                                             static_cast<size_t>(token_len)),
                   WUFFS_BASE__PARSE_NUMBER_XXX__DEFAULT_OPTIONS);
               if (r.status.is_ok()) {
-                ret_error_message = callbacks.AppendF64(r.value);
+                ret_error_message =
+                    TranscodeJsonToCbor_WriteF64(output, *dst, r.value);
                 goto parsed_a_value;
               }
             }
           } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_INF) {
-            ret_error_message = callbacks.AppendF64(
-                wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
-                    0xFFF0000000000000ul));
+            ret_error_message = TranscodeJsonToCbor_Write(
+                output, *dst, "\xF9\xFC\x00", 3);
             goto parsed_a_value;
           } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_INF) {
-            ret_error_message = callbacks.AppendF64(
-                wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
-                    0x7FF0000000000000ul));
+            ret_error_message = TranscodeJsonToCbor_Write(
+                output, *dst, "\xF9\x7C\x00", 3);
             goto parsed_a_value;
           } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_NEG_NAN) {
-            ret_error_message = callbacks.AppendF64(
-                wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
-                    0xFFFFFFFFFFFFFFFFul));
+            ret_error_message = TranscodeJsonToCbor_Write(
+                output, *dst, "\xF9\xFE\x00", 3);
             goto parsed_a_value;
           } else if (vbd & WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_POS_NAN) {
-            ret_error_message = callbacks.AppendF64(
-                wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
-                    0x7FFFFFFFFFFFFFFFul));
+            ret_error_message = TranscodeJsonToCbor_Write(
+                output, *dst, "\xF9\x7E\x00", 3);
             goto parsed_a_value;
           }
           goto fail;
@@ -553,41 +1663,916 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
 
     fail:
       ret_error_message =
-          "wuffs_aux::DecodeJson: internal error: unexpected token";
+          "wuffs_aux::TranscodeJsonToCbor: internal error: unexpected token";
       goto done;
 
     parsed_a_value:
-      // If an error was encountered, we are done. Otherwise, (depth == 0)
-      // after parsing a value is equivalent to having decoded the entire JSON
-      // value (for an empty json_pointer query) or having decoded the
-      // pointed-to JSON value (for a non-empty json_pointer query). In the
-      // latter case, we are also done.
-      //
-      // However, if quirks like WUFFS_JSON__QUIRK_ALLOW_TRAILING_FILLER or
-      // WUFFS_JSON__QUIRK_EXPECT_TRAILING_NEW_LINE_OR_EOF are passed, decoding
-      // the entire JSON value should also consume any trailing filler, in case
-      // the DecodeJson caller wants to subsequently check that the input is
-      // completely exhausted (and otherwise raise "valid JSON followed by
-      // further (unexpected) data"). We aren't done yet. Instead, keep the
-      // loop running until WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN's
-      // decode_tokens returns an ok status.
-      if (!ret_error_message.empty() ||
-          ((depth == 0) && !json_pointer.repr.empty())) {
+      // As for DecodeJson, keep the loop running (even if depth == 0) until
+      // WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN's decode_tokens returns an
+      // ok status, so that any trailing filler quirks are honored.
+      if (!ret_error_message.empty()) {
         goto done;
       }
     }
   } while (false);
 
 done:
-  DecodeJsonResult result(
+  if (ret_error_message.empty()) {
+    ret_error_message = output.CopyOut(dst);
+  }
+  return DecodeJsonResult(
       std::move(ret_error_message),
       wuffs_base__u64__sat_add(io_buf->meta.pos, cursor_index));
-  callbacks.Done(result, input, *io_buf);
-  return result;
 }
 
 #undef WUFFS_AUX__DECODE_JSON__GET_THE_NEXT_TOKEN
 
+// --------
+
+JsonWriterArgBuffer::JsonWriterArgBuffer(wuffs_base__slice_u8 repr0)
+    : repr(repr0) {}
+
+JsonWriterArgBuffer  //
+JsonWriterArgBuffer::DefaultValue() {
+  return JsonWriterArgBuffer(wuffs_base__empty_slice_u8());
+}
+
+JsonWriterArgIndent::JsonWriterArgIndent(std::string repr0)
+    : repr(std::move(repr0)) {}
+
+JsonWriterArgIndent  //
+JsonWriterArgIndent::DefaultValue() {
+  return JsonWriterArgIndent(std::string());
+}
+
+namespace {
+
+// JsonWriter_CountUnescapedBytes returns the length of the longest prefix of
+// the ptr[..len] bytes that JSON does not require to be escaped within a
+// string: anything other than '"', '\\' and ASCII control characters.
+//
+// Bulk scanning uses SSE2 (on x86_64) or SWAR (SIMD Within A Register, on
+// other CPUs) to check 16 or 8 bytes at a time. The final, partial chunk or
+// the chunk containing a byte that needs escaping is re-scanned one byte at a
+// time.
+size_t  //
+JsonWriter_CountUnescapedBytes(const uint8_t* ptr, size_t len) {
+  const uint8_t* p = ptr;
+  const uint8_t* q = ptr + len;
+
+#if defined(WUFFS_PRIVATE_IMPL__CPU_ARCH__X86_64)
+  // SSE2 is part of the x86_64 baseline. It doesn't need cpuid checks.
+  const __m128i x22 = _mm_set1_epi8(0x22);  // '"'
+  const __m128i x5C = _mm_set1_epi8(0x5C);  // '\\'
+  const __m128i x1F = _mm_set1_epi8(0x1F);
+  while ((q - p) >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(const void*)p);
+    // _mm_max_epu8(v, x1F) equals x1F iff every byte is (unsigned) <= 0x1F.
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, x22), _mm_cmpeq_epi8(v, x5C)),
+        _mm_cmpeq_epi8(_mm_max_epu8(v, x1F), x1F));
+    if (_mm_movemask_epi8(m) != 0) {
+      break;
+    }
+    p += 16;
+  }
+#endif  // defined(WUFFS_PRIVATE_IMPL__CPU_ARCH__X86_64)
+
+  // The "has a zero byte" and "has a byte less than N" bit twiddling hacks are
+  // from https://graphics.stanford.edu/~seander/bithacks.html
+  const uint64_t ones = 0x0101010101010101u;
+  const uint64_t highs = 0x8080808080808080u;
+  while ((q - p) >= 8) {
+    uint64_t x = wuffs_base__peek_u64le__no_bounds_check(p);
+    uint64_t x22 = x ^ (ones * 0x22);
+    uint64_t x5C = x ^ (ones * 0x5C);
+    if ((((x22 - ones) & ~x22) |  //
+         ((x5C - ones) & ~x5C) |  //
+         ((x - (ones * 0x20)) & ~x)) &
+        highs) {
+      break;
+    }
+    p += 8;
+  }
+
+  for (; p < q; p++) {
+    uint8_t c = *p;
+    if ((c == '"') || (c == '\\') || (c < 0x20)) {
+      break;
+    }
+  }
+  return (size_t)(p - ptr);
+}
+
+}  // namespace
+
+#define WUFFS_AUX__JSON_WRITER__TRY(error_msg) \
+  do {                                         \
+    std::string z = error_msg;                 \
+    if (!z.empty()) {                          \
+      m_error_message = std::move(z);          \
+      return m_error_message;                  \
+    }                                          \
+  } while (false)
+
+JsonWriter::JsonWriter(sync_io::Output& output,
+                       JsonWriterArgBuffer buffer,
+                       JsonWriterArgIndent indent)
+    : m_stack{},
+      m_output(output),
+      m_own_io_buf(wuffs_base__empty_io_buffer()),
+      m_io_buf(output.BringsItsOwnIOBuffer()),
+      m_mem_owner(nullptr, &free),
+      m_indent_length((uint32_t)indent.repr.size()),
+      m_depth(0),
+      m_ctx(Context::None),
+      m_wrote_top_level_value(false) {
+  if (m_io_buf) {
+    // No-op.
+  } else if (buffer.repr.len > 0) {
+    m_own_io_buf = wuffs_base__ptr_u8__writer(buffer.repr.ptr, buffer.repr.len);
+    m_io_buf = &m_own_io_buf;
+  } else {
+    constexpr size_t n = 32768;
+    void* ptr = malloc(n);
+    if (!ptr) {
+      m_error_message = "wuffs_aux::JsonWriter: out of memory";
+      m_io_buf = &m_own_io_buf;
+    } else {
+      m_mem_owner.reset(ptr);
+      m_own_io_buf = wuffs_base__ptr_u8__writer((uint8_t*)ptr, n);
+      m_io_buf = &m_own_io_buf;
+    }
+  }
+
+  if (m_indent_length > 0) {
+    if (m_indent_length > 0x10000) {
+      m_error_message = "wuffs_aux::JsonWriter: indent is too long";
+    }
+    // Enough indents for 16 levels of depth. Deeper ones take multiple Writes.
+    m_new_line_then_indents.reserve(1 + (16 * indent.repr.size()));
+    m_new_line_then_indents.push_back('\n');
+    for (int i = 0; i < 16; i++) {
+      m_new_line_then_indents.append(indent.repr);
+    }
+  }
+}
+
+JsonWriter::~JsonWriter() {}
+
+std::string  //
+JsonWriter::Write(const void* ptr, size_t len) {
+  if (len <= m_io_buf->writer_length()) {
+    memcpy(m_io_buf->writer_pointer(), ptr, len);
+    m_io_buf->meta.wi += len;
+    return "";
+  }
+  return private_impl::WriteToOutput(m_output, *m_io_buf,
+                                     static_cast<const uint8_t*>(ptr), len);
+}
+
+std::string  //
+JsonWriter::WriteIndent(uint32_t depth) {
+  if (m_indent_length == 0) {
+    return "";
+  }
+  const char* s = m_new_line_then_indents.data();
+  size_t block = m_new_line_then_indents.size() - 1;
+  size_t remaining = (size_t)depth * m_indent_length;
+  size_t n = (remaining < block) ? remaining : block;
+  std::string error_message = Write(s, 1 + n);
+  remaining -= n;
+  while (error_message.empty() && (remaining > 0)) {
+    n = (remaining < block) ? remaining : block;
+    error_message = Write(s + 1, n);
+    remaining -= n;
+  }
+  return error_message;
+}
+
+std::string  //
+JsonWriter::WritePreamble(bool is_key_compatible) {
+  // Write preceding punctuation, whitespace and indentation. Update m_ctx.
+  switch (m_ctx) {
+    case Context::None:
+      if (m_wrote_top_level_value) {
+        return Write("\n", 1);
+      }
+      m_wrote_top_level_value = true;
+      return "";
+    case Context::InListAfterBracket:
+      m_ctx = Context::InListAfterValue;
+      break;
+    case Context::InListAfterValue:
+      WUFFS_AUX__JSON_WRITER__TRY(Write(",", 1));
+      break;
+    case Context::InDictAfterBrace:
+      m_ctx = Context::InDictAfterKey;
+      break;
+    case Context::InDictAfterKey:
+      m_ctx = Context::InDictAfterValue;
+      return Write(": ", (m_indent_length > 0) ? 2 : 1);
+    case Context::InDictAfterValue:
+      WUFFS_AUX__JSON_WRITER__TRY(Write(",", 1));
+      m_ctx = Context::InDictAfterKey;
+      break;
+  }
+
+  if (!is_key_compatible && (m_ctx == Context::InDictAfterKey)) {
+    return "wuffs_aux::JsonWriter: invalid dictionary key";
+  }
+  return WriteIndent(m_depth);
+}
+
+std::string  //
+JsonWriter::WriteEscaped(const uint8_t* ptr, size_t len) {
+  static const char hex[] = "0123456789ABCDEF";
+  while (true) {
+    size_t n = JsonWriter_CountUnescapedBytes(ptr, len);
+    WUFFS_AUX__JSON_WRITER__TRY(Write(ptr, n));
+    ptr += n;
+    len -= n;
+    if (len == 0) {
+      break;
+    }
+
+    uint8_t c = *ptr++;
+    len--;
+    uint8_t buf[6] = {'\\', c, '0', '0', 0, 0};
+    size_t buf_len = 2;
+    switch (c) {
+      case '"':
+      case '\\':
+        break;
+      case '\b':
+        buf[1] = 'b';
+        break;
+      case '\f':
+        buf[1] = 'f';
+        break;
+      case '\n':
+        buf[1] = 'n';
+        break;
+      case '\r':
+        buf[1] = 'r';
+        break;
+      case '\t':
+        buf[1] = 't';
+        break;
+      default:
+        buf[1] = 'u';
+        buf[4] = hex[c >> 4];
+        buf[5] = hex[c & 15];
+        buf_len = 6;
+        break;
+    }
+    WUFFS_AUX__JSON_WRITER__TRY(Write(&buf[0], buf_len));
+  }
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendNull() {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(false));
+  WUFFS_AUX__JSON_WRITER__TRY(Write("null", 4));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendBool(bool val) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(false));
+  WUFFS_AUX__JSON_WRITER__TRY(val ? Write("true", 4) : Write("false", 5));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendF64(double val) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(false));
+
+  // JSON numbers don't include Infinities or NaNs. For such numbers, their
+  // IEEE 754 bit representation's 11 exponent bits are all on.
+  uint64_t u = wuffs_base__ieee_754_bit_representation__from_f64_to_u64(val);
+  if (((u >> 52) & 0x7FF) == 0x7FF) {
+    WUFFS_AUX__JSON_WRITER__TRY(Write("null", 4));
+    return "";
+  }
+
+  uint8_t buf[64];
+  constexpr uint32_t precision = 0;
+  size_t n = wuffs_base__render_number_f64(
+      wuffs_base__make_slice_u8(&buf[0], sizeof buf), val, precision,
+      WUFFS_BASE__RENDER_NUMBER_FXX__JUST_ENOUGH_PRECISION);
+  WUFFS_AUX__JSON_WRITER__TRY(Write(&buf[0], n));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendI64(int64_t val) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(true));
+
+  // Integer dictionary keys are quoted, as JSON keys must be strings.
+  uint8_t buf[2 + WUFFS_BASE__I64__BYTE_LENGTH__MAX_INCL];
+  bool quote = m_ctx == Context::InDictAfterKey;
+  buf[0] = '"';
+  size_t n = wuffs_base__render_number_i64(
+      wuffs_base__make_slice_u8(&buf[1],
+                                WUFFS_BASE__I64__BYTE_LENGTH__MAX_INCL),
+      val, WUFFS_BASE__RENDER_NUMBER_XXX__DEFAULT_OPTIONS);
+  buf[1 + n] = '"';
+  WUFFS_AUX__JSON_WRITER__TRY(quote ? Write(&buf[0], 2 + n)
+                                    : Write(&buf[1], n));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendU64(uint64_t val) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(true));
+
+  // Integer dictionary keys are quoted, as JSON keys must be strings.
+  uint8_t buf[2 + WUFFS_BASE__U64__BYTE_LENGTH__MAX_INCL];
+  bool quote = m_ctx == Context::InDictAfterKey;
+  buf[0] = '"';
+  size_t n = wuffs_base__render_number_u64(
+      wuffs_base__make_slice_u8(&buf[1],
+                                WUFFS_BASE__U64__BYTE_LENGTH__MAX_INCL),
+      val, WUFFS_BASE__RENDER_NUMBER_XXX__DEFAULT_OPTIONS);
+  buf[1 + n] = '"';
+  WUFFS_AUX__JSON_WRITER__TRY(quote ? Write(&buf[0], 2 + n)
+                                    : Write(&buf[1], n));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendTextString(std::string&& val) {
+  return AppendTextString(val.data(), val.size());
+}
+
+std::string  //
+JsonWriter::AppendTextString(const char* ptr, size_t len) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(true));
+  WUFFS_AUX__JSON_WRITER__TRY(Write("\"", 1));
+  WUFFS_AUX__JSON_WRITER__TRY(WriteEscaped(
+      static_cast<const uint8_t*>(static_cast<const void*>(ptr)), len));
+  WUFFS_AUX__JSON_WRITER__TRY(Write("\"", 1));
+  return "";
+}
+
+std::string  //
+JsonWriter::BeginTextString() {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(true));
+  WUFFS_AUX__JSON_WRITER__TRY(Write("\"", 1));
+  return "";
+}
+
+std::string  //
+JsonWriter::AppendTextStringPiece(const char* ptr, size_t len) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WriteEscaped(
+      static_cast<const uint8_t*>(static_cast<const void*>(ptr)), len));
+  return "";
+}
+
+std::string  //
+JsonWriter::EndTextString() {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(Write("\"", 1));
+  return "";
+}
+
+std::string  //
+JsonWriter::Push(uint32_t flags) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  bool to_dict;
+  if (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST) {
+    to_dict = false;
+  } else if (flags & WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_DICT) {
+    to_dict = true;
+  } else {
+    m_error_message = "wuffs_aux::JsonWriter: invalid Push flags";
+    return m_error_message;
+  }
+  if (m_depth >= (64 * (sizeof m_stack / sizeof m_stack[0]))) {
+    m_error_message = "wuffs_aux::JsonWriter: too deep";
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(WritePreamble(false));
+
+  uint64_t bit = ((uint64_t)1) << (m_depth & 63);
+  if (to_dict) {
+    m_stack[m_depth >> 6] |= bit;
+  } else {
+    m_stack[m_depth >> 6] &= ~bit;
+  }
+  m_depth++;
+  m_ctx = to_dict ? Context::InDictAfterBrace : Context::InListAfterBracket;
+  WUFFS_AUX__JSON_WRITER__TRY(Write(to_dict ? "{" : "[", 1));
+  return "";
+}
+
+std::string  //
+JsonWriter::Pop(uint32_t flags) {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  } else if (m_depth == 0) {
+    m_error_message = "wuffs_aux::JsonWriter: unbalanced Pop";
+    return m_error_message;
+  } else if (m_ctx == Context::InDictAfterKey) {
+    m_error_message = "wuffs_aux::JsonWriter: missing dictionary value";
+    return m_error_message;
+  }
+
+  bool empty = (m_ctx == Context::InListAfterBracket) ||
+               (m_ctx == Context::InDictAfterBrace);
+  m_depth--;
+  if (!empty) {
+    WUFFS_AUX__JSON_WRITER__TRY(WriteIndent(m_depth));
+  }
+  bool from_dict = (m_stack[m_depth >> 6] >> (m_depth & 63)) & 1;
+  WUFFS_AUX__JSON_WRITER__TRY(Write(from_dict ? "}" : "]", 1));
+
+  if (m_depth == 0) {
+    m_ctx = Context::None;
+  } else if ((m_stack[(m_depth - 1) >> 6] >> ((m_depth - 1) & 63)) & 1) {
+    m_ctx = Context::InDictAfterValue;
+  } else {
+    m_ctx = Context::InListAfterValue;
+  }
+  return "";
+}
+
+std::string  //
+JsonWriter::Flush() {
+  if (!m_error_message.empty()) {
+    return m_error_message;
+  }
+  WUFFS_AUX__JSON_WRITER__TRY(m_output.CopyOut(m_io_buf));
+  return "";
+}
+
+uint32_t  //
+JsonWriter::Depth() const {
+  return m_depth;
+}
+
+#undef WUFFS_AUX__JSON_WRITER__TRY
+
+// --------
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__CBOR)
+
+namespace {
+
+// TranscodeCborToJson_Base64 writes byte strings, which have no JSON
+// equivalent, as base64url-encoded JSON text strings. A CBOR byte string can
+// span multiple tokens, whose lengths aren't necessarily multiples of 3, so
+// up to 2 bytes are carried over from one token to the next.
+class TranscodeCborToJson_Base64 {
+ public:
+  TranscodeCborToJson_Base64() : m_carry_len(0) {}
+
+  std::string Append(JsonWriter& writer,
+                     const uint8_t* ptr,
+                     size_t len,
+                     bool closed) {
+    if (m_carry_len > 0) {
+      while ((m_carry_len < 3) && (len > 0)) {
+        m_carry[m_carry_len++] = *ptr++;
+        len--;
+      }
+      if ((m_carry_len < 3) && !closed) {
+        return "";
+      }
+      std::string error_message = Encode(writer, &m_carry[0], m_carry_len,
+                                         closed && (len == 0));
+      m_carry_len = 0;
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    }
+
+    size_t n = closed ? len : (len - (len % 3));
+    std::string error_message = Encode(writer, ptr, n, closed);
+    if (!error_message.empty()) {
+      return error_message;
+    }
+    for (; n < len; n++) {
+      m_carry[m_carry_len++] = ptr[n];
+    }
+    return "";
+  }
+
+ private:
+  static std::string Encode(JsonWriter& writer,
+                            const uint8_t* ptr,
+                            size_t len,
+                            bool closed) {
+    uint8_t buf[4096];
+    while (len > 0) {
+      wuffs_base__transform__output o = wuffs_base__base_64__encode(
+          wuffs_base__make_slice_u8(&buf[0], sizeof buf),
+          wuffs_base__make_slice_u8(const_cast<uint8_t*>(ptr), len), closed,
+          WUFFS_BASE__BASE_64__URL_ALPHABET);
+      std::string error_message = writer.AppendTextStringPiece(
+          static_cast<const char*>(static_cast<void*>(&buf[0])), o.num_dst);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+      ptr += o.num_src;
+      len -= o.num_src;
+      if (o.status.repr == nullptr) {
+        break;
+      } else if ((o.status.repr != wuffs_base__suspension__short_write) &&
+                 (o.status.repr != wuffs_base__suspension__short_read)) {
+        return o.status.message();
+      } else if (o.num_src == 0) {
+        break;
+      }
+    }
+    return "";
+  }
+
+  uint8_t m_carry[3];
+  size_t m_carry_len;
+};
+
+}  // namespace
+
+DecodeCborResult  //
+TranscodeCborToJson(sync_io::Output& output,
+                    sync_io::Input& input,
+                    DecodeCborArgQuirks quirks,
+                    JsonWriterArgIndent indent) {
+  // Prepare the wuffs_base__io_buffer and the resultant error_message.
+  wuffs_base__io_buffer* io_buf = input.BringsItsOwnIOBuffer();
+  wuffs_base__io_buffer fallback_io_buf = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_io_array(nullptr);
+  if (!io_buf) {
+    fallback_io_array = std::unique_ptr<uint8_t[]>(new uint8_t[4096]);
+    fallback_io_buf = wuffs_base__ptr_u8__writer(fallback_io_array.get(), 4096);
+    io_buf = &fallback_io_buf;
+  }
+  // cursor_index is discussed at
+  // https://nigeltao.github.io/blog/2020/jsonptr.html#the-cursor-index
+  size_t cursor_index = 0;
+  std::string ret_error_message;
+  std::string io_error_message;
+  JsonWriter writer(output, JsonWriterArgBuffer::DefaultValue(),
+                    std::move(indent));
+
+  do {
+    // Prepare the low-level CBOR decoder.
+    wuffs_cbor__decoder::unique_ptr dec = wuffs_cbor__decoder::alloc();
+    if (!dec) {
+      ret_error_message = "wuffs_aux::TranscodeCborToJson: out of memory";
+      goto done;
+    }
+    for (size_t i = 0; i < quirks.len; i++) {
+      dec->set_quirk(quirks.ptr[i].first, quirks.ptr[i].second);
+    }
+
+    // Prepare the wuffs_base__tok_buffer. 256 tokens is 2KiB.
+    wuffs_base__token tok_array[256];
+    wuffs_base__token_buffer tok_buf =
+        wuffs_base__slice_token__writer(wuffs_base__make_slice_token(
+            &tok_array[0], (sizeof(tok_array) / sizeof(tok_array[0]))));
+    wuffs_base__status tok_status = wuffs_base__make_status(nullptr);
+
+    // Prepare other state.
+    int32_t depth = 0;
+    bool in_string = false;
+    bool in_byte_string = false;
+    TranscodeCborToJson_Base64 base64;
+    int64_t extension_category = 0;
+    uint64_t extension_detail = 0;
+
+    // Valid token's VBCs range in 0 ..= 15. Values over that are for tokens
+    // from outside of the base package, such as the CBOR package.
+    constexpr int64_t EXT_CAT__CBOR_TAG = 16;
+
+    // Loop, doing these two things:
+    //  1. Get the next token.
+    //  2. Process that token.
+    while (true) {
+      // 1. Get the next token.
+
+      while (tok_buf.meta.ri >= tok_buf.meta.wi) {
+        if (tok_status.repr == nullptr) {
+          // No-op.
+        } else if (tok_status.repr == wuffs_base__suspension__short_write) {
+          tok_buf.compact();
+        } else if (tok_status.repr == wuffs_base__suspension__short_read) {
+          // Read from input to io_buf.
+          if (!io_error_message.empty()) {
+            ret_error_message = std::move(io_error_message);
+            goto done;
+          } else if (cursor_index != io_buf->meta.ri) {
+            ret_error_message =
+                "wuffs_aux::TranscodeCborToJson: internal error: bad "
+                "cursor_index";
+            goto done;
+          } else if (io_buf->meta.closed) {
+            ret_error_message =
+                "wuffs_aux::TranscodeCborToJson: internal error: io_buf is "
+                "closed";
+            goto done;
+          }
+          io_buf->compact();
+          if (io_buf->meta.wi >= io_buf->data.len) {
+            ret_error_message =
+                "wuffs_aux::TranscodeCborToJson: internal error: io_buf is "
+                "full";
+            goto done;
+          }
+          cursor_index = io_buf->meta.ri;
+          io_error_message = input.CopyIn(io_buf);
+        } else {
+          ret_error_message = tok_status.message();
+          goto done;
+        }
+
+        if (WUFFS_CBOR__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE != 0) {
+          ret_error_message =
+              "wuffs_aux::TranscodeCborToJson: internal error: bad "
+              "WORKBUF_LEN";
+          goto done;
+        }
+        wuffs_base__slice_u8 work_buf = wuffs_base__empty_slice_u8();
+        tok_status = dec->decode_tokens(&tok_buf, io_buf, work_buf);
+        if ((tok_buf.meta.ri > tok_buf.meta.wi) ||
+            (tok_buf.meta.wi > tok_buf.data.len) ||
+            (io_buf->meta.ri > io_buf->meta.wi) ||
+            (io_buf->meta.wi > io_buf->data.len)) {
+          ret_error_message =
+              "wuffs_aux::TranscodeCborToJson: internal error: bad buffer "
+              "indexes";
+          goto done;
+        }
+      }
+
+      wuffs_base__token token = tok_buf.data.ptr[tok_buf.meta.ri++];
+      uint64_t token_len = token.length();
+      if ((io_buf->meta.ri < cursor_index) ||
+          ((io_buf->meta.ri - cursor_index) < token_len)) {
+        ret_error_message =
+            "wuffs_aux::TranscodeCborToJson: internal error: bad token "
+            "indexes";
+        goto done;
+      }
+      uint8_t* token_ptr = io_buf->data.ptr + cursor_index;
+      cursor_index += static_cast<size_t>(token_len);
+
+      // 2. Process that token.
+
+      uint64_t vbd = token.value_base_detail();
+
+      if (extension_category != 0) {
+        int64_t ext = token.value_extension();
+        if ((ext >= 0) && !token.continued()) {
+          extension_detail = (extension_detail
+                              << WUFFS_BASE__TOKEN__VALUE_EXTENSION__NUM_BITS) |
+                             static_cast<uint64_t>(ext);
+          switch (extension_category) {
+            case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED:
+              extension_category = 0;
+              ret_error_message =
+                  writer.AppendI64(static_cast<int64_t>(extension_detail));
+              goto parsed_a_value;
+            case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED:
+              extension_category = 0;
+              ret_error_message = writer.AppendU64(extension_detail);
+              goto parsed_a_value;
+            case EXT_CAT__CBOR_TAG:
+              // JSON has no equivalent to CBOR tags. Drop them.
+              extension_category = 0;
+              continue;
+          }
+        }
+        ret_error_message =
+            "wuffs_aux::TranscodeCborToJson: internal error: bad extended "
+            "token";
+        goto done;
+      }
+
+      switch (token.value_base_category()) {
+        case WUFFS_BASE__TOKEN__VBC__FILLER:
+          continue;
+
+        case WUFFS_BASE__TOKEN__VBC__STRUCTURE: {
+          if (vbd & WUFFS_BASE__TOKEN__VBD__STRUCTURE__PUSH) {
+            ret_error_message = writer.Push(static_cast<uint32_t>(vbd));
+            if (!ret_error_message.empty()) {
+              goto done;
+            }
+            depth++;
+            if (depth > (int32_t)WUFFS_CBOR__DECODER_DEPTH_MAX_INCL) {
+              ret_error_message =
+                  "wuffs_aux::TranscodeCborToJson: internal error: bad depth";
+              goto done;
+            }
+            continue;
+          }
+          ret_error_message = writer.Pop(static_cast<uint32_t>(vbd));
+          depth--;
+          if (depth < 0) {
+            ret_error_message =
+                "wuffs_aux::TranscodeCborToJson: internal error: bad depth";
+            goto done;
+          }
+          goto parsed_a_value;
+        }
+
+        case WUFFS_BASE__TOKEN__VBC__STRING:
+        case WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT: {
+          if (!in_string) {
+            in_string = true;
+            in_byte_string =
+                (token.value_base_category() ==
+                 WUFFS_BASE__TOKEN__VBC__STRING) &&
+                !(vbd & WUFFS_BASE__TOKEN__VBD__STRING__CHAIN_MUST_BE_UTF_8);
+            ret_error_message = writer.BeginTextString();
+            if (!ret_error_message.empty()) {
+              goto done;
+            }
+          }
+
+          uint8_t u[WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL];
+          const uint8_t* ptr = token_ptr;
+          size_t len = 0;
+          if (token.value_base_category() ==
+              WUFFS_BASE__TOKEN__VBC__UNICODE_CODE_POINT) {
+            ptr = &u[0];
+            len = wuffs_base__utf_8__encode(
+                wuffs_base__make_slice_u8(
+                    &u[0], WUFFS_BASE__UTF_8__BYTE_LENGTH__MAX_INCL),
+                static_cast<uint32_t>(vbd));
+          } else if (vbd &
+                     WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_1_DST_1_SRC_COPY) {
+            len = static_cast<size_t>(token_len);
+          } else {
+            constexpr uint64_t drop =
+                WUFFS_BASE__TOKEN__VBD__STRING__CONVERT_0_DST_1_SRC_DROP;
+            if (!(vbd & drop)) {
+              goto fail;
+            }
+          }
+
+          ret_error_message =
+              in_byte_string
+                  ? base64.Append(writer, ptr, len, !token.continued())
+                  : writer.AppendTextStringPiece(
+                        static_cast<const char*>(static_cast<const void*>(ptr)),
+                        len);
+          if (!ret_error_message.empty()) {
+            goto done;
+          } else if (token.continued()) {
+            continue;
+          }
+          in_string = false;
+          ret_error_message = writer.EndTextString();
+          goto parsed_a_value;
+        }
+
+        case WUFFS_BASE__TOKEN__VBC__LITERAL: {
+          // JSON's closest approximation to "undefined" is "null".
+          if (vbd & (WUFFS_BASE__TOKEN__VBD__LITERAL__NULL |
+                     WUFFS_BASE__TOKEN__VBD__LITERAL__UNDEFINED)) {
+            ret_error_message = writer.AppendNull();
+          } else {
+            ret_error_message =
+                writer.AppendBool(vbd & WUFFS_BASE__TOKEN__VBD__LITERAL__TRUE);
+          }
+          goto parsed_a_value;
+        }
+
+        case WUFFS_BASE__TOKEN__VBC__NUMBER: {
+          const uint64_t cfp_fbbe_fifb =
+              WUFFS_BASE__TOKEN__VBD__NUMBER__CONTENT_FLOATING_POINT |
+              WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_BINARY_BIG_ENDIAN |
+              WUFFS_BASE__TOKEN__VBD__NUMBER__FORMAT_IGNORE_FIRST_BYTE;
+          if ((vbd & cfp_fbbe_fifb) == cfp_fbbe_fifb) {
+            double f;
+            switch (token_len) {
+              case 3:
+                f = wuffs_base__ieee_754_bit_representation__from_u16_to_f64(
+                    wuffs_base__peek_u16be__no_bounds_check(token_ptr + 1));
+                break;
+              case 5:
+                f = wuffs_base__ieee_754_bit_representation__from_u32_to_f64(
+                    wuffs_base__peek_u32be__no_bounds_check(token_ptr + 1));
+                break;
+              case 9:
+                f = wuffs_base__ieee_754_bit_representation__from_u64_to_f64(
+                    wuffs_base__peek_u64be__no_bounds_check(token_ptr + 1));
+                break;
+              default:
+                goto fail;
+            }
+            ret_error_message = writer.AppendF64(f);
+            goto parsed_a_value;
+          }
+          goto fail;
+        }
+
+        case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED: {
+          if (token.continued()) {
+            extension_category = WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_SIGNED;
+            extension_detail =
+                static_cast<uint64_t>(token.value_base_detail__sign_extended());
+            continue;
+          }
+          ret_error_message =
+              writer.AppendI64(token.value_base_detail__sign_extended());
+          goto parsed_a_value;
+        }
+
+        case WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED: {
+          if (token.continued()) {
+            extension_category =
+                WUFFS_BASE__TOKEN__VBC__INLINE_INTEGER_UNSIGNED;
+            extension_detail = vbd;
+            continue;
+          }
+          ret_error_message = writer.AppendU64(vbd);
+          goto parsed_a_value;
+        }
+      }
+
+      if (token.value_major() == WUFFS_CBOR__TOKEN_VALUE_MAJOR) {
+        uint64_t value_minor = token.value_minor();
+        if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__MINUS_1_MINUS_X) {
+          if (token_len == 9) {
+            // The value is -1 - x, for an x of at least (1 << 63).
+            ret_error_message = writer.AppendF64(
+                -1.0 - static_cast<double>(
+                           wuffs_base__peek_u64be__no_bounds_check(token_ptr +
+                                                                   1)));
+            goto parsed_a_value;
+          }
+        } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__SIMPLE_VALUE) {
+          ret_error_message = writer.AppendNull();
+          goto parsed_a_value;
+        } else if (value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__TAG) {
+          // JSON has no equivalent to CBOR tags. Drop them.
+          if (token.continued()) {
+            extension_category = EXT_CAT__CBOR_TAG;
+            extension_detail =
+                value_minor & WUFFS_CBOR__TOKEN_VALUE_MINOR__DETAIL_MASK;
+          }
+          continue;
+        }
+      }
+
+    fail:
+      ret_error_message =
+          "wuffs_aux::TranscodeCborToJson: internal error: unexpected token";
+      goto done;
+
+    parsed_a_value:
+      if (!ret_error_message.empty() || (depth == 0)) {
+        goto done;
+      }
+    }
+  } while (false);
+
+done:
+  if (ret_error_message.empty()) {
+    ret_error_message = writer.Flush();
+  }
+  return DecodeCborResult(
+      std::move(ret_error_message),
+      wuffs_base__u64__sat_add(io_buf->meta.pos, cursor_index));
+}
+
+#endif  // !defined(WUFFS_CONFIG__MODULES) ||
+        // defined(WUFFS_CONFIG__MODULE__AUX__CBOR)
+
 }  // namespace wuffs_aux
 
 #endif  // !defined(WUFFS_CONFIG__MODULES) ||
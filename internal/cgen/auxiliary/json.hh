@@ -117,4 +117,268 @@ DecodeJson(DecodeJsonCallbacks& callbacks,
            DecodeJsonArgJsonPointer json_pointer =
                DecodeJsonArgJsonPointer::DefaultValue());
 
+namespace private_impl {
+class DecodeJsonState;
+}  // namespace private_impl
+
+// DecodeJsonAsync is like DecodeJson but it does not block waiting for input.
+// Instead, each Resume call decodes as much as it can of the bytes that have
+// arrived so far and, if it needs more, returns a result whose error_message
+// is async_io::NeedMoreInput. Call Resume again after writing more bytes to
+// the input (or closing it). Callbacks are never called twice for the same
+// JSON value: decoding picks up where it left off.
+//
+// Once Resume returns any other result (a final one, after which callbacks'
+// Done method has been called), subsequent Resume calls return
+// async_io::AlreadyDone.
+//
+// The callbacks and input must outlive the DecodeJsonAsync. The quirks are
+// applied by the constructor and need not.
+class DecodeJsonAsync {
+ public:
+  DecodeJsonAsync(DecodeJsonCallbacks& callbacks,
+                  async_io::Input& input,
+                  DecodeJsonArgQuirks quirks =
+                      DecodeJsonArgQuirks::DefaultValue(),
+                  DecodeJsonArgJsonPointer json_pointer =
+                      DecodeJsonArgJsonPointer::DefaultValue());
+  ~DecodeJsonAsync();
+
+  DecodeJsonResult Resume();
+
+ private:
+  std::unique_ptr<private_impl::DecodeJsonState> m_state;
+  bool m_done;
+
+  // Delete the copy and assign constructors.
+  DecodeJsonAsync(const DecodeJsonAsync&) = delete;
+  DecodeJsonAsync& operator=(const DecodeJsonAsync&) = delete;
+};
+
+// --------
+
+// DecodeJsonMultiCallbacks are the callbacks given to DecodeJsonMulti.
+class DecodeJsonMultiCallbacks {
+ public:
+  virtual ~DecodeJsonMultiCallbacks();
+
+  // SelectCallbacks is called when the json_pointers.ptr[json_pointer_index]
+  // query matches a sub-node of the input. It returns the DecodeJsonCallbacks
+  // that receive the AppendXxx, Push and Pop calls for that sub-node, or a
+  // nullptr to ignore that sub-node. The returned DecodeJsonCallbacks' Done
+  // method is not called.
+  //
+  // Sub-nodes can nest (e.g. for the "/foo" and "/foo/bar" queries), in which
+  // case multiple DecodeJsonCallbacks can be active at the same time. They
+  // each see the same sequence of AppendXxx, Push and Pop calls for the inner
+  // sub-node, in order of json_pointer_index.
+  virtual DecodeJsonCallbacks*  //
+  SelectCallbacks(size_t json_pointer_index) = 0;
+
+  // Done is always the last Callback method called by DecodeJsonMulti,
+  // whether or not parsing the input as JSON encountered an error. It has the
+  // same semantics as DecodeJsonCallbacks::Done.
+  //
+  // The default Done implementation is a no-op.
+  virtual void  //
+  Done(DecodeJsonResult& result, sync_io::Input& input, IOBuffer& buffer);
+};
+
+// DecodeJsonArgJsonPointers wraps an argument to DecodeJsonMulti.
+struct DecodeJsonArgJsonPointers {
+  explicit DecodeJsonArgJsonPointers(const std::string* ptr0,
+                                     const size_t len0);
+
+  // DefaultValue returns an empty slice.
+  static DecodeJsonArgJsonPointers DefaultValue();
+
+  const std::string* ptr;
+  const size_t len;
+};
+
+// DecodeJsonMulti is like DecodeJson but it takes a set of JSON Pointer
+// queries instead of a single one. The input is only decoded once, regardless
+// of how many queries there are: the queries are compiled into a trie and
+// each token is dispatched to the callbacks for every query whose sub-node
+// contains it.
+//
+// Matching is greedy, like DecodeJson, in that duplicate keys are not
+// rejected but only the first match for each '/'-separated fragment is
+// followed. Unlike DecodeJson, a query that does not match is not an error:
+// callbacks.SelectCallbacks is simply never called for that query's index.
+//
+// Decoding stops (successfully) once every query has either been matched
+// (and its sub-node completely decoded) or can no longer match. Like
+// DecodeJson with a non-empty json_pointer, trailing data after that point is
+// not examined, even if it isn't valid JSON.
+DecodeJsonResult  //
+DecodeJsonMulti(DecodeJsonMultiCallbacks& callbacks,
+                sync_io::Input& input,
+                DecodeJsonArgJsonPointers json_pointers,
+                DecodeJsonArgQuirks quirks =
+                    DecodeJsonArgQuirks::DefaultValue());
+
+// --------
+
+// JsonWriterArgBuffer wraps an optional argument to JsonWriter.
+struct JsonWriterArgBuffer {
+  explicit JsonWriterArgBuffer(wuffs_base__slice_u8 repr0);
+
+  // DefaultValue returns an empty slice.
+  static JsonWriterArgBuffer DefaultValue();
+
+  wuffs_base__slice_u8 repr;
+};
+
+// JsonWriterArgIndent wraps an optional argument to JsonWriter.
+struct JsonWriterArgIndent {
+  explicit JsonWriterArgIndent(std::string repr0);
+
+  // DefaultValue returns an empty string.
+  static JsonWriterArgIndent DefaultValue();
+
+  std::string repr;
+};
+
+// JsonWriter writes JSON-formatted data to output. It is a
+// DecodeJsonCallbacks, so that passing one to DecodeJson re-formats JSON, but
+// it can also be driven directly.
+//
+// Dictionary keys and values alternate: within a JSON object (dictionary),
+// every even-numbered AppendXxx or Push call is a key. Keys must be text
+// strings or integers (which are written as quoted strings). Multiple
+// top-level values are written one per line.
+//
+// Text strings are assumed to be valid UTF-8. Only '"', '\\' and ASCII
+// control characters are escaped. Finding them is vectorized (via SIMD or
+// SWAR), as most text needs no escaping.
+//
+// JSON cannot represent Infinities or NaNs. AppendF64 writes them as null.
+//
+// buffer is the intermediate buffer that is drained to output when full. If
+// empty, the JsonWriter allocates its own. buffer is ignored if output
+// BringsItsOwnIOBuffer, as JsonWriter then writes directly to output's buffer.
+//
+// indent is the per-depth indentation, e.g. "  " or "\t". If empty, the
+// output is compact: there are no new lines or spaces between tokens.
+//
+// Call Flush after the final AppendXxx or Pop call. Error messages are sticky:
+// once one call fails, all subsequent calls will fail.
+class JsonWriter : public DecodeJsonCallbacks {
+ public:
+  explicit JsonWriter(
+      sync_io::Output& output,
+      JsonWriterArgBuffer buffer = JsonWriterArgBuffer::DefaultValue(),
+      JsonWriterArgIndent indent = JsonWriterArgIndent::DefaultValue());
+  ~JsonWriter() override;
+
+  std::string AppendNull() override;
+  std::string AppendBool(bool val) override;
+  std::string AppendF64(double val) override;
+  std::string AppendI64(int64_t val) override;
+  std::string AppendU64(uint64_t val);
+  std::string AppendTextString(std::string&& val) override;
+  std::string AppendTextString(const char* ptr, size_t len);
+
+  // A text string can also be written piece by piece, for when it is not
+  // available all at once: BeginTextString, any number of
+  // AppendTextStringPiece calls and then EndTextString. No other methods may
+  // be called in between.
+  std::string BeginTextString();
+  std::string AppendTextStringPiece(const char* ptr, size_t len);
+  std::string EndTextString();
+
+  // Push's flags should contain WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST or
+  // WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_DICT.
+  //
+  // Pop's flags are ignored. JsonWriter tracks which container is innermost.
+  std::string Push(uint32_t flags) override;
+  std::string Pop(uint32_t flags) override;
+
+  // Flush copies out any buffered bytes.
+  std::string Flush();
+
+  // Depth returns the number of unclosed containers.
+  uint32_t Depth() const;
+
+ private:
+  enum class Context {
+    None,
+    InListAfterBracket,
+    InListAfterValue,
+    InDictAfterBrace,
+    InDictAfterKey,
+    InDictAfterValue,
+  };
+
+  std::string WritePreamble(bool is_key_compatible);
+  std::string WriteIndent(uint32_t depth);
+  std::string WriteEscaped(const uint8_t* ptr, size_t len);
+  std::string Write(const void* ptr, size_t len);
+
+  // m_stack holds one bit per depth: 0 for a list and 1 for a dict. Its 1024
+  // bits matches the JSON decoder's maximum depth.
+  uint64_t m_stack[1024 / 64];
+
+  sync_io::Output& m_output;
+  IOBuffer m_own_io_buf;
+  IOBuffer* m_io_buf;
+  MemOwner m_mem_owner;
+
+  std::string m_new_line_then_indents;
+  uint32_t m_indent_length;
+  uint32_t m_depth;
+  Context m_ctx;
+  bool m_wrote_top_level_value;
+  std::string m_error_message;
+
+  // Delete the copy and assign constructors.
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+};
+
+// --------
+
+// TranscodeJsonToCbor converts the JSON-formatted data in input to the
+// equivalent CBOR-formatted data in output. The returned DecodeJsonResult has
+// the same meaning as for DecodeJson.
+//
+// It works directly on the JSON decoder's token stream, without calling any
+// callbacks. CBOR arrays and maps are written with indefinite length. Text
+// strings are always written with definite length, so that the output does
+// not depend on the input's I/O buffer size. A string that fits within the
+// decoder's input and token buffers is copied straight through. A longer one
+// (with a MemoryInput, one with more than about a hundred backslash escapes)
+// is first accumulated in a std::string, so memory use is proportional to
+// the input's longest string.
+//
+// Like example/json-to-cbor, the conversion may be lossy: numbers are written
+// as CBOR integers if they fit in an int64_t and otherwise as the shortest
+// IEEE 754 floating point type that represents their float64 approximation.
+// The output is not canonicalized in the RFC 7049 Section 3.9 sense.
+DecodeJsonResult  //
+TranscodeJsonToCbor(
+    sync_io::Output& output,
+    sync_io::Input& input,
+    DecodeJsonArgQuirks quirks = DecodeJsonArgQuirks::DefaultValue());
+
+// TranscodeCborToJson converts the CBOR-formatted data in input to the
+// equivalent JSON-formatted data in output. The returned DecodeCborResult has
+// the same meaning as for DecodeCbor. It requires both the AUX__CBOR and
+// AUX__JSON modules.
+//
+// Like TranscodeJsonToCbor, it works directly on the token stream and its
+// memory use is bounded. indent is passed on to the JsonWriter.
+//
+// Some CBOR values have no JSON equivalent. Undefined and other CBOR simple
+// values become null. Byte strings become base64url-encoded text strings.
+// CBOR tags are dropped. Integers below -(1<<63) lose precision. Map keys
+// must be text strings or integers.
+DecodeCborResult  //
+TranscodeCborToJson(
+    sync_io::Output& output,
+    sync_io::Input& input,
+    DecodeCborArgQuirks quirks = DecodeCborArgQuirks::DefaultValue(),
+    JsonWriterArgIndent indent = JsonWriterArgIndent::DefaultValue());
+
 }  // namespace wuffs_aux
@@ -0,0 +1,747 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - RAC
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__RAC)
+
+#include <algorithm>
+#include <utility>
+
+namespace wuffs_aux {
+
+// The RAC format is described in doc/spec/rac-spec.md. This implementation
+// follows the Go lib/rac package's chunk_reader.go.
+
+namespace {
+
+const char RacFile_BadIndexNode[] =  //
+    "wuffs_aux::RacFile: bad index node";
+const char RacFile_NotARacFile[] =  //
+    "wuffs_aux::RacFile: not a RAC file";
+const char RacFile_OutOfMemory[] =  //
+    "wuffs_aux::RacFile: out of memory";
+const char RacFile_TooManyChunks[] =  //
+    "wuffs_aux::RacFile: too many chunks";
+
+const char RacChunkDecoder_BadDictionary[] =  //
+    "wuffs_aux::RacChunkDecoder: bad dictionary";
+const char RacChunkDecoder_OutOfMemory[] =  //
+    "wuffs_aux::RacChunkDecoder: out of memory";
+const char RacChunkDecoder_TooMuchOutput[] =  //
+    "wuffs_aux::RacChunkDecoder: too much output";
+const char RacChunkDecoder_UnsupportedCodec[] =  //
+    "wuffs_aux::RacChunkDecoder: unsupported codec";
+const char RacChunkDecoder_UnsupportedDictionary[] =  //
+    "wuffs_aux::RacChunkDecoder: unsupported dictionary";
+
+const char RacReader_OutOfMemory[] =  //
+    "wuffs_aux::RacReader: out of memory";
+
+constexpr uint8_t RacTTag_BranchNode = 0xFE;
+constexpr uint8_t RacTTag_CodecElement = 0xFD;
+constexpr uint8_t RacTTag_ReservedMin = 0xC0;
+
+constexpr uint64_t RacCodec_Invalid = 0xFFFFFFFFFFFFFFFF;
+
+uint32_t  //
+RacCrc32(const uint8_t* ptr, size_t len) {
+  wuffs_crc32__ieee_hasher hasher;
+  if (!hasher
+           .initialize(sizeof hasher, WUFFS_VERSION,
+                       WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED)
+           .is_ok()) {
+    return 0;
+  }
+  return hasher.update_u32(
+      wuffs_base__make_slice_u8(const_cast<uint8_t*>(ptr), len));
+}
+
+// RacNode is a view of a branch node's ((arity * 16) + 16) bytes, which are
+// 8-byte rows. The first (arity + 1) rows hold the DPtr values and the next
+// (arity + 1) rows hold the CPtr values.
+struct RacNode {
+  const uint8_t* p;
+  size_t arity;
+
+  uint64_t u48(size_t row) const {
+    return wuffs_base__peek_u64le__no_bounds_check(p + (8 * row)) &
+           0x0000FFFFFFFFFFFF;
+  }
+
+  uint64_t dptr(size_t i) const { return (i == 0) ? 0 : u48(i); }
+  uint64_t dptr_max() const { return u48(arity); }
+  uint64_t cptr(size_t i) const { return u48(arity + 1 + i); }
+  uint64_t cptr_max() const { return u48(arity + 1 + arity); }
+  uint8_t clen(size_t i) const { return p[(8 * (arity + 1 + i)) + 6]; }
+  uint8_t stag(size_t i) const { return p[(8 * (arity + 1 + i)) + 7]; }
+  uint8_t ttag(size_t i) const { return p[(8 * i) + 7]; }
+  uint8_t codec_byte() const { return p[(8 * arity) + 7]; }
+  uint8_t version() const { return p[(16 * arity) + 14]; }
+
+  uint64_t codec() const {
+    uint8_t c = codec_byte();
+    if ((c & 0x80) == 0) {
+      return static_cast<uint64_t>(c & 0x3F) << 56;
+    }
+    for (size_t j = 0; j < 4; j++) {
+      size_t i = (c & 0x3F) | (j << 6);
+      if ((i < arity) && (ttag(i) == RacTTag_CodecElement)) {
+        return (wuffs_base__peek_u64le__no_bounds_check(
+                    p + (8 * (arity + 1 + i))) &
+                0x00FFFFFFFFFFFFFF) |
+               0x8000000000000000;
+      }
+    }
+    return RacCodec_Invalid;
+  }
+
+  // c_range is the spec's MakeCRange(i), given the node's CBias.
+  wuffs_base__range_ie_u64 c_range(size_t i, uint64_t cbias) const {
+    uint64_t m = cbias + cptr_max();
+    if (i >= arity) {
+      return wuffs_base__make_range_ie_u64(m, m);
+    }
+    uint64_t c = cbias + cptr(i);
+    if (clen(i) != 0) {
+      m = std::min(m, c + (1024 * static_cast<uint64_t>(clen(i))));
+    }
+    return wuffs_base__make_range_ie_u64(c, m);
+  }
+
+  // valid checks everything in the spec's "Branch Node Validation" section
+  // that does not depend on the parent node.
+  bool valid() const {
+    size_t size = (16 * arity) + 16;
+    if ((p[0] != 0x72) || (p[1] != 0xC3) || (p[2] != 0x63) || (arity == 0) ||
+        (p[3] != p[size - 1])) {
+      return false;
+    }
+
+    bool has_children = false;
+    for (size_t i = 0; i < arity; i++) {
+      uint8_t t = ttag(i);
+      if ((p[(8 * i) + 6] != 0) ||
+          ((RacTTag_ReservedMin <= t) && (t < RacTTag_CodecElement))) {
+        return false;
+      } else if (t != RacTTag_CodecElement) {
+        has_children = true;
+      }
+    }
+    if (!has_children || (p[(8 * arity) + 6] != 0)) {
+      return false;
+    }
+
+    // DOffs must be sorted and codec elements' DRanges must be empty.
+    uint64_t prev = 0;
+    for (size_t i = 1; i <= arity; i++) {
+      uint64_t curr = u48(i);
+      if ((curr < prev) ||
+          ((curr != prev) && (ttag(i - 1) == RacTTag_CodecElement))) {
+        return false;
+      }
+      prev = curr;
+    }
+
+    // Other than codec elements, COffs must not exceed COffMax.
+    for (size_t i = 0; i < arity; i++) {
+      if ((cptr(i) > cptr_max()) && (ttag(i) != RacTTag_CodecElement)) {
+        return false;
+      }
+    }
+
+    if (version() == 0) {
+      return false;
+    }
+    uint32_t checksum = RacCrc32(p + 6, size - 6);
+    checksum ^= checksum >> 16;
+    if ((p[4] != static_cast<uint8_t>(checksum >> 0)) ||
+        (p[5] != static_cast<uint8_t>(checksum >> 8))) {
+      return false;
+    }
+    return codec() != RacCodec_Invalid;
+  }
+};
+
+// RacBranch is a branch node being walked by RacFile::Open.
+struct RacBranch {
+  RacNode node;
+  uint64_t coffset;
+  uint64_t cbias;
+  uint64_t dbias;
+  size_t next_child;
+};
+
+}  // namespace
+
+RacChunk::RacChunk()
+    : d_range(wuffs_base__empty_range_ie_u64()),
+      c_primary(wuffs_base__empty_range_ie_u64()),
+      c_secondary(wuffs_base__empty_range_ie_u64()),
+      c_tertiary(wuffs_base__empty_range_ie_u64()),
+      codec(0),
+      s_tag(0),
+      t_tag(0) {}
+
+RacFile::RacFile()
+    : m_owned_array(nullptr),
+      m_ptr(nullptr),
+      m_len(0),
+      m_decompressed_size(0),
+      m_chunks() {}
+
+std::string  //
+RacFile::Open(const uint8_t* ptr, size_t len) {
+  m_ptr = nullptr;
+  m_len = 0;
+  m_decompressed_size = 0;
+  m_chunks.clear();
+  if (!ptr && (len > 0)) {
+    return "wuffs_aux::RacFile: nullptr data";
+  } else if ((len < 32) || (ptr[0] != 0x72) || (ptr[1] != 0xC3) ||
+             (ptr[2] != 0x63)) {
+    return RacFile_NotARacFile;
+  }
+
+  // Find the root node: first at the start and, failing that, at the end.
+  // The root node's COffMax must equal the CFileSize.
+  RacNode root = {nullptr, 0};
+  for (int from_end = 0; from_end < 2; from_end++) {
+    size_t arity = from_end ? ptr[len - 1] : ptr[3];
+    size_t size = (16 * arity) + 16;
+    if ((arity == 0) || (size > len)) {
+      continue;
+    }
+    RacNode n = {from_end ? (ptr + len - size) : ptr, arity};
+    if (n.valid() && (n.cptr_max() == len)) {
+      root = n;
+      break;
+    }
+  }
+  if (!root.p) {
+    return RacFile_NotARacFile;
+  } else if (root.version() != 1) {
+    return "wuffs_aux::RacFile: unsupported RAC file version";
+  }
+
+  // Walk the tree (depth first, skipping empty DRanges) to list the chunks.
+  //
+  // Every chunk (or branch node) visit consumes at least 16 bytes of some
+  // branch node. A shared (CBiasing) sub-tree can be visited more than once
+  // but a well-formed file won't do that often, so limiting the number of
+  // visits rules out maliciously exponential trees.
+  std::vector<RacChunk> chunks;
+  uint64_t num_visits = 0;
+  std::vector<RacBranch> stack;
+  stack.push_back({root, static_cast<uint64_t>(root.p - ptr), 0, 0, 0});
+  while (!stack.empty()) {
+    RacBranch& b = stack.back();
+    if (b.next_child >= b.node.arity) {
+      stack.pop_back();
+      continue;
+    }
+    size_t i = b.next_child++;
+    uint64_t d_lo = b.dbias + b.node.dptr(i);
+    uint64_t d_hi = b.dbias + b.node.dptr(i + 1);
+    if (d_lo == d_hi) {
+      continue;
+    } else if (++num_visits > len) {
+      return RacFile_TooManyChunks;
+    }
+
+    uint64_t coff_max = b.cbias + b.node.cptr_max();
+    uint8_t stag = b.node.stag(i);
+    uint8_t ttag = b.node.ttag(i);
+    if (ttag != RacTTag_BranchNode) {
+      chunks.emplace_back();
+      RacChunk& c = chunks.back();
+      c.d_range = wuffs_base__make_range_ie_u64(d_lo, d_hi);
+      c.c_primary = b.node.c_range(i, b.cbias);
+      c.c_secondary = b.node.c_range(stag, b.cbias);
+      c.c_tertiary = b.node.c_range(ttag, b.cbias);
+      c.codec = b.node.codec();
+      c.s_tag = stag;
+      c.t_tag = ttag;
+      // A secondary or tertiary range could refer to a codec element, whose
+      // COff can exceed COffMax.
+      if ((c.c_secondary.min_incl > c.c_secondary.max_excl) ||
+          (c.c_tertiary.min_incl > c.c_tertiary.max_excl)) {
+        return RacFile_BadIndexNode;
+      }
+      continue;
+    }
+
+    // Load and validate the child branch node.
+    uint64_t child_coffset = b.cbias + b.node.cptr(i);
+    uint64_t child_cbias =
+        (stag < b.node.arity) ? (b.cbias + b.node.cptr(stag)) : b.cbias;
+    if ((coff_max < 4) || (child_coffset > (coff_max - 4))) {
+      return RacFile_BadIndexNode;
+    }
+    size_t child_arity = ptr[child_coffset + 3];
+    size_t child_size = (16 * child_arity) + 16;
+    if (child_size > (coff_max - child_coffset)) {
+      return RacFile_BadIndexNode;
+    }
+    RacNode child = {ptr + child_coffset, child_arity};
+    if (!child.valid() ||
+        ((b.node.codec() != child.codec()) &&
+         !(b.node.codec_byte() & 0x40)) ||
+        (b.node.version() < child.version()) ||
+        (coff_max < (child_cbias + child.cptr_max())) ||
+        (child.dptr_max() != (d_hi - d_lo))) {
+      return RacFile_BadIndexNode;
+    }
+
+    // Rule out infinite loops. A child's DPtrMax can never exceed its
+    // parent's, so (DPtrMax, COffset) strictly decreases, lexicographically.
+    if ((child_coffset >= b.coffset) &&
+        (child.dptr_max() >= b.node.dptr_max())) {
+      return RacFile_BadIndexNode;
+    }
+    stack.push_back({child, child_coffset, child_cbias, d_lo, 0});
+  }
+
+  m_ptr = ptr;
+  m_len = len;
+  m_decompressed_size = root.dptr_max();
+  m_chunks = std::move(chunks);
+  return "";
+}
+
+std::string  //
+RacFile::Open(sync_io::Input& input) {
+  m_ptr = nullptr;
+  m_len = 0;
+  m_decompressed_size = 0;
+  m_chunks.clear();
+
+  // Borrow the Input's bytes if they are all in memory.
+  IOBuffer* io = input.BringsItsOwnIOBuffer();
+  if (io && io->meta.closed) {
+    m_owned_array.reset();
+    return Open(io->reader_pointer(), io->reader_length());
+  }
+
+  // Otherwise, read the whole Input, doubling the buffer size as needed.
+  std::unique_ptr<uint8_t[]> array(nullptr);
+  wuffs_base__io_buffer buf = wuffs_base__empty_io_buffer();
+  while (true) {
+    if (buf.meta.closed) {
+      break;
+    } else if (buf.writer_length() == 0) {
+      size_t new_len = (buf.data.len > 0) ? (2 * buf.data.len) : 65536;
+      if (new_len <= buf.data.len) {
+        return RacFile_OutOfMemory;
+      }
+      std::unique_ptr<uint8_t[]> new_array(new (std::nothrow)
+                                               uint8_t[new_len]);
+      if (!new_array) {
+        return RacFile_OutOfMemory;
+      }
+      if (buf.meta.wi > 0) {
+        memcpy(new_array.get(), array.get(), buf.meta.wi);
+      }
+      array = std::move(new_array);
+      buf.data = wuffs_base__make_slice_u8(array.get(), new_len);
+    }
+    std::string error_message = input.CopyIn(&buf);
+    if (!error_message.empty()) {
+      return error_message;
+    }
+  }
+
+  m_owned_array = std::move(array);
+  return Open(m_owned_array.get(), buf.meta.wi);
+}
+
+wuffs_base__slice_u8  //
+RacFile::Data() const {
+  return wuffs_base__make_slice_u8(const_cast<uint8_t*>(m_ptr), m_len);
+}
+
+uint64_t  //
+RacFile::DecompressedSize() const {
+  return m_decompressed_size;
+}
+
+const std::vector<RacChunk>&  //
+RacFile::Chunks() const {
+  return m_chunks;
+}
+
+size_t  //
+RacFile::FindChunk(uint64_t offset) const {
+  if (offset >= m_decompressed_size) {
+    return SIZE_MAX;
+  }
+  auto iter = std::upper_bound(
+      m_chunks.begin(), m_chunks.end(), offset,
+      [](uint64_t o, const RacChunk& c) { return o < c.d_range.max_excl; });
+  return static_cast<size_t>(iter - m_chunks.begin());
+}
+
+RacChunkDecoder::RacChunkDecoder()
+    : m_zlib_decoder(nullptr),
+      m_lz4_decoder(nullptr),
+      m_zstd_decoder(nullptr),
+      m_workbuf_array(nullptr),
+      m_workbuf_len(0),
+      m_verified_dict(wuffs_base__empty_slice_u8()) {}
+
+std::string  //
+RacChunkDecoder::DecodeChunk(wuffs_base__slice_u8 dst,
+                             const RacFile& file,
+                             size_t index) {
+  if (index >= file.Chunks().size()) {
+    return "wuffs_aux::RacChunkDecoder: bad chunk index";
+  }
+  const RacChunk& chunk = file.Chunks()[index];
+  if (dst.len != (chunk.d_range.max_excl - chunk.d_range.min_incl)) {
+    return "wuffs_aux::RacChunkDecoder: bad dst length";
+  } else if (chunk.codec == RacChunk::CODEC__ZEROES) {
+    if (dst.len > 0) {
+      memset(dst.ptr, 0, dst.len);
+    }
+    return "";
+  }
+
+  wuffs_base__slice_u8 dict = wuffs_base__empty_slice_u8();
+  std::string error_message = LoadDictionary(&dict, file, chunk);
+  if (!error_message.empty()) {
+    return error_message;
+  }
+  wuffs_base__slice_u8 src = wuffs_base__make_slice_u8(
+      file.Data().ptr + chunk.c_primary.min_incl,
+      static_cast<size_t>(chunk.c_primary.max_excl -
+                          chunk.c_primary.min_incl));
+  wuffs_base__status status = wuffs_base__make_status(nullptr);
+
+  switch (chunk.codec) {
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__ZLIB)
+    case RacChunk::CODEC__ZLIB: {
+      if (!m_zlib_decoder) {
+        m_zlib_decoder = wuffs_zlib__decoder::alloc_as__wuffs_base__io_transformer();
+        if (!m_zlib_decoder) {
+          return RacChunkDecoder_OutOfMemory;
+        }
+      }
+      status = wuffs_zlib__decoder__initialize(
+          reinterpret_cast<wuffs_zlib__decoder*>(m_zlib_decoder.get()),
+          sizeof__wuffs_zlib__decoder(), WUFFS_VERSION,
+          WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+      if (!status.is_ok()) {
+        return status.message();
+      }
+      return DecodeChunkWith(m_zlib_decoder.get(), dst, src, dict);
+    }
+#endif
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__LZ4)
+    case RacChunk::CODEC__LZ4: {
+      if (dict.len > 0) {
+        return RacChunkDecoder_UnsupportedDictionary;
+      } else if (!m_lz4_decoder) {
+        m_lz4_decoder = wuffs_lz4__decoder::alloc_as__wuffs_base__io_transformer();
+        if (!m_lz4_decoder) {
+          return RacChunkDecoder_OutOfMemory;
+        }
+      }
+      wuffs_lz4__decoder* dec =
+          reinterpret_cast<wuffs_lz4__decoder*>(m_lz4_decoder.get());
+      status = wuffs_lz4__decoder__initialize(
+          dec, sizeof__wuffs_lz4__decoder(), WUFFS_VERSION,
+          WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+      if (!status.is_ok()) {
+        return status.message();
+      }
+      // A chunk's CRange can run past its frame (into the next chunk's), so
+      // stop after one frame instead of decoding concatenated ones.
+      status = wuffs_lz4__decoder__set_quirk(
+          dec, WUFFS_LZ4__QUIRK_DECODE_SINGLE_FRAME, 1);
+      if (!status.is_ok()) {
+        return status.message();
+      }
+      return DecodeChunkWith(m_lz4_decoder.get(), dst, src,
+                             wuffs_base__empty_slice_u8());
+    }
+#endif
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__ZSTD)
+    case RacChunk::CODEC__ZSTANDARD: {
+      if (!m_zstd_decoder) {
+        m_zstd_decoder = wuffs_zstd__decoder::alloc_as__wuffs_base__io_transformer();
+        if (!m_zstd_decoder) {
+          return RacChunkDecoder_OutOfMemory;
+        }
+      }
+      wuffs_zstd__decoder* dec =
+          reinterpret_cast<wuffs_zstd__decoder*>(m_zstd_decoder.get());
+      status = wuffs_zstd__decoder__initialize(
+          dec, sizeof__wuffs_zstd__decoder(), WUFFS_VERSION,
+          WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+      if (!status.is_ok()) {
+        return status.message();
+      }
+      status = wuffs_zstd__decoder__set_quirk(
+          dec, WUFFS_ZSTD__QUIRK_DECODE_SINGLE_FRAME, 1);
+      if (!status.is_ok()) {
+        return status.message();
+      } else if (dict.len > 0) {
+        status = wuffs_zstd__decoder__add_dictionary(dec, dict);
+        if (!status.is_ok()) {
+          return status.message();
+        }
+      }
+      return DecodeChunkWith(m_zstd_decoder.get(), dst, src,
+                             wuffs_base__empty_slice_u8());
+    }
+#endif
+  }
+
+  return RacChunkDecoder_UnsupportedCodec;
+}
+
+std::string  //
+RacChunkDecoder::DecodeChunkWith(wuffs_base__io_transformer* decoder,
+                                 wuffs_base__slice_u8 dst,
+                                 wuffs_base__slice_u8 src,
+                                 wuffs_base__slice_u8 zlib_dict) {
+  wuffs_base__io_buffer dst_buf = wuffs_base__ptr_u8__writer(dst.ptr, dst.len);
+  wuffs_base__io_buffer src_buf =
+      wuffs_base__ptr_u8__reader(src.ptr, src.len, true);
+  while (true) {
+    // Some decoders (such as Zstandard's) only know how much work buffer
+    // they need after reading some of their input, so re-query each time.
+    uint64_t workbuf_len = decoder->workbuf_len().max_incl;
+    if (workbuf_len > m_workbuf_len) {
+      if (workbuf_len > SIZE_MAX) {
+        return RacChunkDecoder_OutOfMemory;
+      }
+      m_workbuf_array.reset(new (std::nothrow)
+                                uint8_t[static_cast<size_t>(workbuf_len)]);
+      m_workbuf_len = m_workbuf_array ? static_cast<size_t>(workbuf_len) : 0;
+      if (!m_workbuf_array) {
+        return RacChunkDecoder_OutOfMemory;
+      }
+    }
+
+    wuffs_base__status status = decoder->transform_io(
+        &dst_buf, &src_buf,
+        wuffs_base__make_slice_u8(m_workbuf_array.get(), m_workbuf_len));
+    if (status.is_ok()) {
+      break;
+    } else if (status.repr == wuffs_base__suspension__short_workbuf) {
+      if (decoder->workbuf_len().max_incl <= m_workbuf_len) {
+        return "wuffs_aux::RacChunkDecoder: internal error: bad workbuf_len";
+      }
+      continue;
+    } else if (status.repr == wuffs_base__suspension__short_write) {
+      return RacChunkDecoder_TooMuchOutput;
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__ZLIB)
+    } else if (status.repr == wuffs_zlib__note__dictionary_required) {
+      // The zlib decoder only asks for a dictionary after reading the zlib
+      // header. It only reads the dictionary, despite taking a mutable slice.
+      if (zlib_dict.len == 0) {
+        return "wuffs_aux::RacChunkDecoder: missing dictionary";
+      }
+      wuffs_zlib__decoder__add_dictionary(
+          reinterpret_cast<wuffs_zlib__decoder*>(decoder), zlib_dict);
+      zlib_dict = wuffs_base__empty_slice_u8();
+      continue;
+#endif
+    }
+    return status.message();
+  }
+
+  // Per the RAC spec, a codec may produce fewer bytes than the DRange size.
+  // The rest are zeroes.
+  if (dst_buf.meta.wi < dst.len) {
+    memset(dst.ptr + dst_buf.meta.wi, 0, dst.len - dst_buf.meta.wi);
+  }
+  return "";
+}
+
+std::string  //
+RacChunkDecoder::LoadDictionary(wuffs_base__slice_u8* dict,
+                                const RacFile& file,
+                                const RacChunk& chunk) {
+  // This is the RAC spec's "Common Dictionary Format".
+  if (chunk.c_tertiary.min_incl != chunk.c_tertiary.max_excl) {
+    return RacChunkDecoder_BadDictionary;
+  } else if (chunk.c_secondary.min_incl == chunk.c_secondary.max_excl) {
+    return "";
+  }
+  uint64_t n = chunk.c_secondary.max_excl - chunk.c_secondary.min_incl;
+  const uint8_t* p = file.Data().ptr + chunk.c_secondary.min_incl;
+  if ((n < 8) || (chunk.t_tag != 0xFF)) {
+    return RacChunkDecoder_BadDictionary;
+  }
+  uint32_t dict_len = wuffs_base__peek_u32le__no_bounds_check(p);
+  if ((dict_len >> 30) || ((static_cast<uint64_t>(dict_len) + 8) > n)) {
+    return RacChunkDecoder_BadDictionary;
+  }
+  *dict = wuffs_base__make_slice_u8(const_cast<uint8_t*>(p + 4), dict_len);
+
+  if ((dict->ptr != m_verified_dict.ptr) ||
+      (dict->len != m_verified_dict.len)) {
+    if (RacCrc32(dict->ptr, dict->len) !=
+        wuffs_base__peek_u32le__no_bounds_check(p + 4 + dict_len)) {
+      return RacChunkDecoder_BadDictionary;
+    }
+    m_verified_dict = *dict;
+  }
+  return "";
+}
+
+RacExecutor::~RacExecutor() {}
+
+void  //
+RacExecutor::Run(size_t num_tasks, const std::function<void(size_t)>& task) {
+  for (size_t i = 0; i < num_tasks; i++) {
+    task(i);
+  }
+}
+
+RacReadAtResult::RacReadAtResult(std::string&& error_message0,
+                                 size_t num_bytes0)
+    : error_message(std::move(error_message0)), num_bytes(num_bytes0) {}
+
+RacReader::RacReader(const RacFile& file,
+                     uint64_t cache_capacity,
+                     RacExecutor* executor,
+                     size_t parallelism,
+                     size_t prefetch_length)
+    : m_file(file),
+      m_cache_capacity(cache_capacity),
+      m_executor(executor),
+      m_prefetch_length(prefetch_length),
+      m_chunk_decoders(),
+      m_lru(),
+      m_cache(),
+      m_cache_size(0) {
+  m_chunk_decoders.resize(std::max<size_t>(parallelism, 1));
+}
+
+RacReadAtResult  //
+RacReader::ReadAt(uint8_t* dst, size_t len, uint64_t offset) {
+  uint64_t d_size = m_file.DecompressedSize();
+  if ((len == 0) || (offset >= d_size)) {
+    return RacReadAtResult("", 0);
+  } else if (!dst) {
+    return RacReadAtResult("wuffs_aux::RacReader: nullptr dst", 0);
+  }
+  uint64_t end = offset + std::min<uint64_t>(len, d_size - offset);
+  const std::vector<RacChunk>& chunks = m_file.Chunks();
+  size_t ci = m_file.FindChunk(offset);
+  size_t cj = m_file.FindChunk(end - 1) + 1;
+
+  // copy_out copies the [offset .. end) part of a decompressed chunk to dst.
+  auto copy_out = [&](size_t chunk_index, const uint8_t* data) {
+    const RacChunk& c = chunks[chunk_index];
+    uint64_t lo = std::max(offset, c.d_range.min_incl);
+    uint64_t hi = std::min(end, c.d_range.max_excl);
+    if (lo < hi) {
+      memcpy(dst + (lo - offset), data + (lo - c.d_range.min_incl),
+             static_cast<size_t>(hi - lo));
+    }
+  };
+
+  // Serve what we can from the cache, before decompressing (and inserting
+  // into the cache) anything else. Collect what's missing, covering chunks
+  // first and then prefetched ones.
+  std::vector<size_t> missing;
+  size_t prefetch_end =
+      cj + std::min<size_t>(m_prefetch_length, chunks.size() - cj);
+  for (size_t c = ci; c < prefetch_end; c++) {
+    auto iter = m_cache.find(c);
+    if (iter == m_cache.end()) {
+      missing.push_back(c);
+    } else if (c < cj) {
+      copy_out(c, iter->second->data.get());
+      m_lru.splice(m_lru.begin(), m_lru, iter->second);
+    }
+  }
+
+  // Decompress the missing chunks, up to m_chunk_decoders.size() at a time.
+  size_t batch_len = m_chunk_decoders.size();
+  std::vector<CacheEntry> entries(batch_len);
+  std::vector<std::string> error_messages(batch_len);
+  for (size_t b = 0; b < missing.size(); b += batch_len) {
+    size_t n = std::min(batch_len, missing.size() - b);
+    for (size_t t = 0; t < n; t++) {
+      const RacChunk& c = chunks[missing[b + t]];
+      uint64_t length = c.d_range.max_excl - c.d_range.min_incl;
+      if (length > SIZE_MAX) {
+        return RacReadAtResult(RacReader_OutOfMemory, 0);
+      }
+      entries[t].chunk_index = missing[b + t];
+      entries[t].length = static_cast<size_t>(length);
+      entries[t].data.reset(new (std::nothrow)
+                                uint8_t[static_cast<size_t>(length)]);
+      if (!entries[t].data) {
+        return RacReadAtResult(RacReader_OutOfMemory, 0);
+      } else if (!m_chunk_decoders[t]) {
+        m_chunk_decoders[t].reset(new (std::nothrow) RacChunkDecoder());
+        if (!m_chunk_decoders[t]) {
+          return RacReadAtResult(RacReader_OutOfMemory, 0);
+        }
+      }
+    }
+
+    // Each task uses its own chunk decoder, entry and error message, so
+    // tasks can run concurrently.
+    std::function<void(size_t)> task = [&](size_t t) {
+      error_messages[t] = m_chunk_decoders[t]->DecodeChunk(
+          wuffs_base__make_slice_u8(entries[t].data.get(), entries[t].length),
+          m_file, entries[t].chunk_index);
+    };
+    if (m_executor) {
+      m_executor->Run(n, task);
+    } else {
+      for (size_t t = 0; t < n; t++) {
+        task(t);
+      }
+    }
+
+    for (size_t t = 0; t < n; t++) {
+      if (!error_messages[t].empty()) {
+        return RacReadAtResult(std::move(error_messages[t]), 0);
+      } else if (entries[t].chunk_index < cj) {
+        copy_out(entries[t].chunk_index, entries[t].data.get());
+      }
+      InsertIntoCache(std::move(entries[t]));
+    }
+  }
+
+  return RacReadAtResult("", static_cast<size_t>(end - offset));
+}
+
+void  //
+RacReader::InsertIntoCache(CacheEntry&& entry) {
+  if (entry.length > m_cache_capacity) {
+    return;
+  }
+  while (!m_lru.empty() &&
+         ((m_cache_capacity - m_cache_size) < entry.length)) {
+    m_cache_size -= m_lru.back().length;
+    m_cache.erase(m_lru.back().chunk_index);
+    m_lru.pop_back();
+  }
+  m_cache_size += entry.length;
+  size_t chunk_index = entry.chunk_index;
+  m_lru.push_front(std::move(entry));
+  m_cache[chunk_index] = m_lru.begin();
+}
+
+}  // namespace wuffs_aux
+
+#endif  // !defined(WUFFS_CONFIG__MODULES) ||
+        // defined(WUFFS_CONFIG__MODULE__AUX__RAC)
@@ -0,0 +1,211 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - RAC
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace wuffs_aux {
+
+// RacChunk is one of a RAC (Random Access Compression) file's non-empty leaf
+// nodes. Its d_range is in DSpace (the decompressed file) and its c_etc
+// ranges are in CSpace (the compressed file). See
+// https://github.com/google/wuffs/blob/main/doc/spec/rac-spec.md
+struct RacChunk {
+  RacChunk();
+
+  wuffs_base__range_ie_u64 d_range;
+  wuffs_base__range_ie_u64 c_primary;
+  wuffs_base__range_ie_u64 c_secondary;
+  wuffs_base__range_ie_u64 c_tertiary;
+
+  // codec is a Short Codec (high 2 bits and low 56 bits are zero) or a Long
+  // Codec (high 8 bits are 0x80), as per the Go lib/rac package's rac.Codec
+  // type. The Mix Bit is not part of the codec value.
+  uint64_t codec;
+
+  uint8_t s_tag;
+  uint8_t t_tag;
+
+  static constexpr uint64_t CODEC__ZEROES = 0x0000000000000000;
+  static constexpr uint64_t CODEC__ZLIB = 0x0100000000000000;
+  static constexpr uint64_t CODEC__LZ4 = 0x0200000000000000;
+  static constexpr uint64_t CODEC__ZSTANDARD = 0x0300000000000000;
+};
+
+// RacFile holds a RAC file's bytes (or a view of them) and its chunk index:
+// every non-empty leaf node, in DSpace order.
+//
+// Like ZipArchive, opening from a pointer and length, or from a
+// sync_io::Input that brings its own closed IOBuffer (such as a MemoryInput
+// or MmapFileInput), borrows the bytes instead of copying them.
+//
+// After a successful Open, a RacFile is not modified by its const methods,
+// so it can be shared (read-only) by multiple threads, each with its own
+// RacChunkDecoder or RacReader.
+class RacFile {
+ public:
+  RacFile();
+
+  // Open finds the root node and walks the whole tree of branch nodes,
+  // validating each one. It does not decompress any chunks. It returns an
+  // empty string on success.
+  std::string Open(const uint8_t* ptr, size_t len);
+  std::string Open(sync_io::Input& input);
+
+  // Data returns the RAC file's bytes.
+  wuffs_base__slice_u8 Data() const;
+
+  // DecompressedSize returns the DFileSize.
+  uint64_t DecompressedSize() const;
+
+  // Chunks returns the chunk index. The chunks' d_range values are sorted,
+  // non-empty and partition [0 .. DecompressedSize()).
+  const std::vector<RacChunk>& Chunks() const;
+
+  // FindChunk returns the index of the chunk containing the DSpace offset,
+  // or SIZE_MAX if offset >= DecompressedSize(). It is a binary search.
+  size_t FindChunk(uint64_t offset) const;
+
+ private:
+  std::unique_ptr<uint8_t[]> m_owned_array;
+  const uint8_t* m_ptr;
+  size_t m_len;
+  uint64_t m_decompressed_size;
+  std::vector<RacChunk> m_chunks;
+
+  // Delete the copy and assign constructors.
+  RacFile(const RacFile&) = delete;
+  RacFile& operator=(const RacFile&) = delete;
+};
+
+// RacChunkDecoder decompresses RAC chunks: "RAC + Zeroes", "RAC + Zlib",
+// "RAC + LZ4" (in the LZ4 frame format) or "RAC + Zstandard", with or
+// without a shared dictionary (except for LZ4). It keeps its codec-specific
+// decoders and work buffer alive between DecodeChunk calls.
+//
+// A RacChunkDecoder is not thread-safe. It can be re-used by sequential
+// calls but not by concurrent ones. Use one chunk decoder per thread.
+class RacChunkDecoder {
+ public:
+  RacChunkDecoder();
+
+  // DecodeChunk decompresses the file's index'th chunk into dst, whose
+  // length must equal the chunk's d_range size. It returns an empty string
+  // on success.
+  std::string DecodeChunk(wuffs_base__slice_u8 dst,
+                          const RacFile& file,
+                          size_t index);
+
+ private:
+  std::string DecodeChunkWith(wuffs_base__io_transformer* decoder,
+                              wuffs_base__slice_u8 dst,
+                              wuffs_base__slice_u8 src,
+                              wuffs_base__slice_u8 zlib_dict);
+  std::string LoadDictionary(wuffs_base__slice_u8* dict,
+                             const RacFile& file,
+                             const RacChunk& chunk);
+
+  wuffs_base__io_transformer::unique_ptr m_zlib_decoder;
+  wuffs_base__io_transformer::unique_ptr m_lz4_decoder;
+  wuffs_base__io_transformer::unique_ptr m_zstd_decoder;
+  std::unique_ptr<uint8_t[]> m_workbuf_array;
+  size_t m_workbuf_len;
+
+  // m_verified_dict is the most recent dictionary whose CRC-32 checksum
+  // matched, so that chunks sharing a dictionary only verify it once.
+  wuffs_base__slice_u8 m_verified_dict;
+
+  // Delete the copy and assign constructors.
+  RacChunkDecoder(const RacChunkDecoder&) = delete;
+  RacChunkDecoder& operator=(const RacChunkDecoder&) = delete;
+};
+
+// RacExecutor runs batches of independent tasks for a RacReader.
+//
+// The default implementation runs them one after another on the calling
+// thread. Wuffs itself does not create threads, but a subclass can override
+// Run to spread the tasks over a thread pool.
+class RacExecutor {
+ public:
+  virtual ~RacExecutor();
+
+  // Run calls task(0), task(1), ..., task(num_tasks - 1), in any order and
+  // possibly concurrently, and returns after they have all returned.
+  virtual void Run(size_t num_tasks, const std::function<void(size_t)>& task);
+};
+
+struct RacReadAtResult {
+  RacReadAtResult(std::string&& error_message0, size_t num_bytes0);
+
+  std::string error_message;
+  size_t num_bytes;
+};
+
+// RacReader serves random access reads of a RacFile's decompressed contents,
+// decompressing only the chunks that cover each read. It keeps a least
+// recently used cache of decompressed chunks, so that repeated or nearby
+// reads do not decompress the same chunk twice.
+//
+// It can also decompress up to parallelism chunks at a time, each with its
+// own RacChunkDecoder, via a RacExecutor. Missing chunks are gathered into
+// batches: first those that cover the read and then up to prefetch_length
+// chunks after them, which are only cached, in anticipation of a sequential
+// read pattern.
+//
+// A RacReader is not thread-safe (although its executor's tasks run
+// concurrently). Use one reader per thread. The RacFile and RacExecutor must
+// outlive the RacReader.
+class RacReader {
+ public:
+  static constexpr uint64_t DEFAULT_CACHE_CAPACITY = 16777216;
+
+  // A nullptr executor means to run every task on the calling thread.
+  RacReader(const RacFile& file,
+            uint64_t cache_capacity = DEFAULT_CACHE_CAPACITY,
+            RacExecutor* executor = nullptr,
+            size_t parallelism = 1,
+            size_t prefetch_length = 0);
+
+  // ReadAt copies up to len decompressed bytes, starting at the DSpace
+  // offset, to dst. Like pread, it returns fewer than len bytes (possibly
+  // zero) only when reaching the end of the decompressed contents.
+  RacReadAtResult ReadAt(uint8_t* dst, size_t len, uint64_t offset);
+
+ private:
+  struct CacheEntry {
+    size_t chunk_index;
+    std::unique_ptr<uint8_t[]> data;
+    size_t length;
+  };
+
+  void InsertIntoCache(CacheEntry&& entry);
+
+  const RacFile& m_file;
+  uint64_t m_cache_capacity;
+  RacExecutor* m_executor;
+  size_t m_prefetch_length;
+  std::vector<std::unique_ptr<RacChunkDecoder>> m_chunk_decoders;
+
+  // m_lru's front is the most recently used. m_cache maps chunk indexes to
+  // m_lru elements and m_cache_size is the sum of their lengths.
+  std::list<CacheEntry> m_lru;
+  std::unordered_map<size_t, std::list<CacheEntry>::iterator> m_cache;
+  uint64_t m_cache_size;
+
+  // Delete the copy and assign constructors.
+  RacReader(const RacReader&) = delete;
+  RacReader& operator=(const RacReader&) = delete;
+};
+
+}  // namespace wuffs_aux
@@ -0,0 +1,137 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Transform
+
+#if !defined(WUFFS_CONFIG__MODULES) || \
+    defined(WUFFS_CONFIG__MODULE__AUX__TRANSFORM)
+
+#include <utility>
+
+namespace wuffs_aux {
+
+namespace {
+
+const char Transform_OutOfMemory[] =  //
+    "wuffs_aux::Transform: out of memory";
+const char Transform_OutputBufferIsFull[] =  //
+    "wuffs_aux::Transform: output buffer is full";
+const char Transform_TruncatedInput[] =  //
+    "wuffs_aux::Transform: truncated input";
+const char Transform_UnsupportedHistoryRetainLength[] =  //
+    "wuffs_aux::Transform: unsupported history retain length";
+
+std::string  //
+TransformLoop(sync_io::Output& output,
+              sync_io::Input& input,
+              wuffs_base__io_transformer& transformer,
+              wuffs_base__io_transformer_budget& budget) {
+  IOBuffer* dst = output.BringsItsOwnIOBuffer();
+  IOBuffer fallback_dst = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_dst_array(nullptr);
+  if (!dst) {
+    // Output::CopyOut compacts away all of the bytes it consumes.
+    wuffs_base__optional_u63 hrl = transformer.dst_history_retain_length();
+    if (hrl.value_or(UINT64_MAX) != 0) {
+      return Transform_UnsupportedHistoryRetainLength;
+    }
+    fallback_dst_array.reset(new (std::nothrow) uint8_t[65536]);
+    if (!fallback_dst_array) {
+      return Transform_OutOfMemory;
+    }
+    fallback_dst = wuffs_base__ptr_u8__writer(fallback_dst_array.get(), 65536);
+    dst = &fallback_dst;
+  }
+
+  IOBuffer* src = input.BringsItsOwnIOBuffer();
+  IOBuffer fallback_src = wuffs_base__empty_io_buffer();
+  std::unique_ptr<uint8_t[]> fallback_src_array(nullptr);
+  if (!src) {
+    fallback_src_array.reset(new (std::nothrow) uint8_t[32768]);
+    if (!fallback_src_array) {
+      return Transform_OutOfMemory;
+    }
+    fallback_src = wuffs_base__ptr_u8__writer(fallback_src_array.get(), 32768);
+    src = &fallback_src;
+  }
+
+  std::unique_ptr<uint8_t[]> workbuf_array(nullptr);
+  size_t workbuf_len = 0;
+
+  while (true) {
+    // Some transformers (such as Zstandard's decoder) only know how much work
+    // buffer they need after reading some of their input, so re-query each
+    // time.
+    uint64_t wbl = transformer.workbuf_len().max_incl;
+    if (wbl > workbuf_len) {
+      if (wbl > SIZE_MAX) {
+        return Transform_OutOfMemory;
+      }
+      workbuf_array.reset(new (std::nothrow) uint8_t[static_cast<size_t>(wbl)]);
+      workbuf_len = workbuf_array ? static_cast<size_t>(wbl) : 0;
+      if (!workbuf_array) {
+        return Transform_OutOfMemory;
+      }
+    }
+
+    wuffs_base__status status = budget.transform_io(
+        &transformer, dst, src,
+        wuffs_base__make_slice_u8(workbuf_array.get(), workbuf_len));
+
+    std::string error_message = output.CopyOut(dst);
+    if (!error_message.empty()) {
+      return error_message;
+    } else if (status.is_ok()) {
+      return "";
+    } else if (status.repr == wuffs_base__suspension__short_workbuf) {
+      if (transformer.workbuf_len().max_incl <= workbuf_len) {
+        return "wuffs_aux::Transform: internal error: bad workbuf_len";
+      }
+    } else if (status.repr == wuffs_base__suspension__short_read) {
+      if (src->meta.closed) {
+        return Transform_TruncatedInput;
+      }
+      src->compact();
+      if (src->meta.wi >= src->data.len) {
+        return "wuffs_aux::Transform: internal error: src is full";
+      }
+      error_message = input.CopyIn(src);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    } else if (status.repr == wuffs_base__suspension__short_write) {
+      if (dst->writer_length() == 0) {
+        return Transform_OutputBufferIsFull;
+      }
+    } else {
+      return status.message();
+    }
+  }
+}
+
+}  // namespace
+
+TransformResult::TransformResult(std::string&& error_message0,
+                                 wuffs_base__io_transformer_budget budget0)
+    : error_message(std::move(error_message0)), budget(budget0) {}
+
+TransformResult  //
+Transform(sync_io::Output& output,
+          sync_io::Input& input,
+          wuffs_base__io_transformer& transformer,
+          wuffs_base__io_transformer_budget budget) {
+  std::string error_message = TransformLoop(output, input, transformer, budget);
+  return TransformResult(std::move(error_message), budget);
+}
+
+}  // namespace wuffs_aux
+
+#endif  // !defined(WUFFS_CONFIG__MODULES) ||
+        // defined(WUFFS_CONFIG__MODULE__AUX__TRANSFORM)
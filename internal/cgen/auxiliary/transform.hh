@@ -0,0 +1,57 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Transform
+
+namespace wuffs_aux {
+
+struct TransformResult {
+  TransformResult(std::string&& error_message0,
+                  wuffs_base__io_transformer_budget budget0);
+
+  std::string error_message;
+
+  // budget is the budget passed to Transform, with its num_etc fields updated
+  // to count the bytes and calls used.
+  wuffs_base__io_transformer_budget budget;
+};
+
+// Transform runs transformer (such as a freshly initialized zlib or xz
+// decoder) until it reaches the end of its stream, reading from input and
+// writing to output. It returns an empty error_message on success.
+//
+// Every transform_io call goes through budget, so that output length, output
+// to input ratio and number of calls are all capped, per
+// wuffs_base__io_transformer_budget. When exceeded, the error_message is
+// "base: budget exceeded" (wuffs_base__error__budget_exceeded without its
+// leading '#'). The default budget is unlimited.
+//
+// The LZMA-family decoders (lzip, lzma and xz) make no progress when the room
+// left in dst is shorter than their next match (and their fast path wants 289
+// bytes), so a max_dst_length equal to the true output length is reported as
+// exceeding the budget and stops short. For example, decoding
+// test/data/romeo.txt.xz (942 bytes) with a max_dst_length of 942 stops
+// after 674 bytes, and test/data/enwik5.xz (100000 bytes) with 100000 stops
+// after 99729. Allow 289 bytes of slack over the expected length when
+// using such a transformer to decode a stream of known length.
+//
+// Output that has been written before an error occurs (including exceeding
+// the budget) has already been passed to output's CopyOut method.
+//
+// The transformer's dst_history_retain_length must be zero unless output
+// brings its own IOBuffer.
+TransformResult  //
+Transform(sync_io::Output& output,
+          sync_io::Input& input,
+          wuffs_base__io_transformer& transformer,
+          wuffs_base__io_transformer_budget budget =
+              wuffs_base__make_io_transformer_budget(0, 0, 0));
+
+}  // namespace wuffs_aux
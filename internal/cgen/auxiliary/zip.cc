@@ -0,0 +1,493 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Zip
+
+#if !defined(WUFFS_CONFIG__MODULES) || defined(WUFFS_CONFIG__MODULE__AUX__ZIP)
+
+#include <algorithm>
+#include <utility>
+
+namespace wuffs_aux {
+
+// The Zip format is described in PKWARE's APPNOTE.TXT, at
+// https://support.pkware.com/display/PKZIP/APPNOTE
+
+namespace {
+
+// Signatures (also known as magic numbers), as little-endian u32 values.
+constexpr uint32_t ZipSig_LocalFileHeader = 0x04034B50;
+constexpr uint32_t ZipSig_CentralDirectoryFileHeader = 0x02014B50;
+constexpr uint32_t ZipSig_EndOfCentralDirectory = 0x06054B50;
+constexpr uint32_t ZipSig_Zip64EndOfCentralDirectory = 0x06064B50;
+constexpr uint32_t ZipSig_Zip64EndOfCentralDirectoryLocator = 0x07064B50;
+
+// These are the fixed-size parts of each record.
+constexpr size_t ZipLen_LocalFileHeader = 30;
+constexpr size_t ZipLen_CentralDirectoryFileHeader = 46;
+constexpr size_t ZipLen_EndOfCentralDirectory = 22;
+constexpr size_t ZipLen_Zip64EndOfCentralDirectory = 56;
+constexpr size_t ZipLen_Zip64EndOfCentralDirectoryLocator = 20;
+
+constexpr uint16_t ZipExtraFieldID_Zip64 = 0x0001;
+
+const char ZipArchive_BadCentralDirectory[] =  //
+    "wuffs_aux::ZipArchive: bad central directory";
+const char ZipArchive_BadEndOfCentralDirectory[] =  //
+    "wuffs_aux::ZipArchive: bad end of central directory record";
+const char ZipArchive_BadLocalHeader[] =  //
+    "wuffs_aux::ZipArchive: bad local header";
+const char ZipArchive_OutOfMemory[] =  //
+    "wuffs_aux::ZipArchive: out of memory";
+const char ZipArchive_UnsupportedMultiDiskArchive[] =  //
+    "wuffs_aux::ZipArchive: unsupported multi-disk archive";
+
+const char ZipExtractor_BadChecksum[] =  //
+    "wuffs_aux::ZipExtractor: bad CRC-32 checksum";
+const char ZipExtractor_BadUncompressedSize[] =  //
+    "wuffs_aux::ZipExtractor: bad uncompressed size";
+const char ZipExtractor_OutputBufferIsFull[] =  //
+    "wuffs_aux::ZipExtractor: output buffer is full";
+const char ZipExtractor_OutOfMemory[] =  //
+    "wuffs_aux::ZipExtractor: out of memory";
+const char ZipExtractor_TruncatedInput[] =  //
+    "wuffs_aux::ZipExtractor: truncated input";
+const char ZipExtractor_UnsupportedCompressionMethod[] =  //
+    "wuffs_aux::ZipExtractor: unsupported compression method";
+const char ZipExtractor_UnsupportedEncryption[] =  //
+    "wuffs_aux::ZipExtractor: unsupported encryption";
+
+// ZipParseZip64ExtraField updates member's 0xFFFF_FFFF placeholder fields
+// from the Zip64 extended information extra field (if any) amongst the
+// extra[0 .. n] bytes. Per the APPNOTE, that field holds only the values
+// whose 32-bit central directory counterparts are 0xFFFF_FFFF, in this order:
+// uncompressed size, compressed size, local header offset.
+bool  //
+ZipParseZip64ExtraField(ZipMember& member, const uint8_t* extra, size_t n) {
+  while (n >= 4) {
+    uint16_t id = wuffs_base__peek_u16le__no_bounds_check(extra + 0);
+    size_t size = wuffs_base__peek_u16le__no_bounds_check(extra + 2);
+    extra += 4;
+    n -= 4;
+    if (size > n) {
+      return false;
+    } else if (id != ZipExtraFieldID_Zip64) {
+      extra += size;
+      n -= size;
+      continue;
+    }
+
+    uint64_t* fields[3] = {
+        &member.uncompressed_size,
+        &member.compressed_size,
+        &member.local_header_offset,
+    };
+    for (uint64_t* f : fields) {
+      if (*f != 0xFFFFFFFF) {
+        continue;
+      } else if (size < 8) {
+        return false;
+      }
+      *f = wuffs_base__peek_u64le__no_bounds_check(extra);
+      extra += 8;
+      size -= 8;
+    }
+    return true;
+  }
+  return true;
+}
+
+}  // namespace
+
+ZipMember::ZipMember()
+    : name(),
+      compressed_size(0),
+      uncompressed_size(0),
+      local_header_offset(0),
+      crc32(0),
+      external_attributes(0),
+      compression_method(0),
+      general_purpose_flags(0),
+      last_modified_time(0),
+      last_modified_date(0) {}
+
+bool  //
+ZipMember::IsDirectory() const {
+  return !name.empty() && (name.back() == '/');
+}
+
+bool  //
+ZipMember::IsEncrypted() const {
+  return general_purpose_flags & 0x0001;
+}
+
+ZipMemberDataResult::ZipMemberDataResult(std::string&& error_message0,
+                                         wuffs_base__slice_u8 data0)
+    : error_message(std::move(error_message0)), data(data0) {}
+
+ZipArchive::ZipArchive()
+    : m_owned_array(nullptr), m_ptr(nullptr), m_len(0), m_members() {}
+
+std::string  //
+ZipArchive::Open(const uint8_t* ptr, size_t len) {
+  m_ptr = nullptr;
+  m_len = 0;
+  m_members.clear();
+  if (!ptr && (len > 0)) {
+    return "wuffs_aux::ZipArchive: nullptr data";
+  }
+
+  // Find the end of central directory record, scanning backwards over the
+  // (variable length, up to 65535 bytes) archive comment.
+  if (len < ZipLen_EndOfCentralDirectory) {
+    return "wuffs_aux::ZipArchive: not a Zip archive";
+  }
+  size_t eocd = len - ZipLen_EndOfCentralDirectory;
+  size_t eocd_min = (eocd > 0xFFFF) ? (eocd - 0xFFFF) : 0;
+  while (true) {
+    if ((wuffs_base__peek_u32le__no_bounds_check(ptr + eocd) ==
+         ZipSig_EndOfCentralDirectory) &&
+        (wuffs_base__peek_u16le__no_bounds_check(ptr + eocd + 20) <=
+         (len - eocd - ZipLen_EndOfCentralDirectory))) {
+      break;
+    } else if (eocd <= eocd_min) {
+      return "wuffs_aux::ZipArchive: not a Zip archive";
+    }
+    eocd--;
+  }
+
+  const uint8_t* p = ptr + eocd;
+  uint32_t disk_number = wuffs_base__peek_u16le__no_bounds_check(p + 4);
+  uint32_t cd_disk_number = wuffs_base__peek_u16le__no_bounds_check(p + 6);
+  uint64_t num_entries_on_disk = wuffs_base__peek_u16le__no_bounds_check(p + 8);
+  uint64_t num_entries = wuffs_base__peek_u16le__no_bounds_check(p + 10);
+  uint64_t cd_size = wuffs_base__peek_u32le__no_bounds_check(p + 12);
+  uint64_t cd_offset = wuffs_base__peek_u32le__no_bounds_check(p + 16);
+  size_t cd_end_max = eocd;
+
+  // Look for a Zip64 end of central directory locator (and record) if any of
+  // the 16-bit or 32-bit fields hold their "see Zip64" placeholder value.
+  if ((disk_number == 0xFFFF) || (cd_disk_number == 0xFFFF) ||
+      (num_entries_on_disk == 0xFFFF) || (num_entries == 0xFFFF) ||
+      (cd_size == 0xFFFFFFFF) || (cd_offset == 0xFFFFFFFF)) {
+    if ((eocd < ZipLen_Zip64EndOfCentralDirectoryLocator) ||
+        (wuffs_base__peek_u32le__no_bounds_check(
+             ptr + eocd - ZipLen_Zip64EndOfCentralDirectoryLocator) !=
+         ZipSig_Zip64EndOfCentralDirectoryLocator)) {
+      return ZipArchive_BadEndOfCentralDirectory;
+    }
+    const uint8_t* q = ptr + eocd - ZipLen_Zip64EndOfCentralDirectoryLocator;
+    uint64_t z64_eocd = wuffs_base__peek_u64le__no_bounds_check(q + 8);
+    if ((wuffs_base__peek_u32le__no_bounds_check(q + 4) != 0) ||
+        (wuffs_base__peek_u32le__no_bounds_check(q + 16) > 1)) {
+      return ZipArchive_UnsupportedMultiDiskArchive;
+    } else if ((z64_eocd > (eocd - ZipLen_Zip64EndOfCentralDirectoryLocator)) ||
+               ((eocd - ZipLen_Zip64EndOfCentralDirectoryLocator - z64_eocd) <
+                ZipLen_Zip64EndOfCentralDirectory) ||
+               (wuffs_base__peek_u32le__no_bounds_check(ptr + z64_eocd) !=
+                ZipSig_Zip64EndOfCentralDirectory)) {
+      return ZipArchive_BadEndOfCentralDirectory;
+    }
+    p = ptr + z64_eocd;
+    disk_number = wuffs_base__peek_u32le__no_bounds_check(p + 16);
+    cd_disk_number = wuffs_base__peek_u32le__no_bounds_check(p + 20);
+    num_entries_on_disk = wuffs_base__peek_u64le__no_bounds_check(p + 24);
+    num_entries = wuffs_base__peek_u64le__no_bounds_check(p + 32);
+    cd_size = wuffs_base__peek_u64le__no_bounds_check(p + 40);
+    cd_offset = wuffs_base__peek_u64le__no_bounds_check(p + 48);
+    cd_end_max = static_cast<size_t>(z64_eocd);
+  }
+
+  if ((disk_number != 0) || (cd_disk_number != 0) ||
+      (num_entries_on_disk != num_entries)) {
+    return ZipArchive_UnsupportedMultiDiskArchive;
+  } else if ((cd_offset > cd_end_max) || (cd_size > (cd_end_max - cd_offset)) ||
+             (num_entries > (cd_size / ZipLen_CentralDirectoryFileHeader))) {
+    return ZipArchive_BadEndOfCentralDirectory;
+  }
+
+  // Parse the central directory.
+  std::vector<ZipMember> members;
+  members.reserve(static_cast<size_t>(num_entries));
+  p = ptr + cd_offset;
+  size_t n = static_cast<size_t>(cd_size);
+  for (uint64_t i = 0; i < num_entries; i++) {
+    if ((n < ZipLen_CentralDirectoryFileHeader) ||
+        (wuffs_base__peek_u32le__no_bounds_check(p) !=
+         ZipSig_CentralDirectoryFileHeader)) {
+      return ZipArchive_BadCentralDirectory;
+    }
+    size_t name_len = wuffs_base__peek_u16le__no_bounds_check(p + 28);
+    size_t extra_len = wuffs_base__peek_u16le__no_bounds_check(p + 30);
+    size_t comment_len = wuffs_base__peek_u16le__no_bounds_check(p + 32);
+    size_t record_len = ZipLen_CentralDirectoryFileHeader + name_len +
+                        extra_len + comment_len;
+    if (record_len > n) {
+      return ZipArchive_BadCentralDirectory;
+    }
+
+    members.emplace_back();
+    ZipMember& m = members.back();
+    m.general_purpose_flags = wuffs_base__peek_u16le__no_bounds_check(p + 8);
+    m.compression_method = wuffs_base__peek_u16le__no_bounds_check(p + 10);
+    m.last_modified_time = wuffs_base__peek_u16le__no_bounds_check(p + 12);
+    m.last_modified_date = wuffs_base__peek_u16le__no_bounds_check(p + 14);
+    m.crc32 = wuffs_base__peek_u32le__no_bounds_check(p + 16);
+    m.compressed_size = wuffs_base__peek_u32le__no_bounds_check(p + 20);
+    m.uncompressed_size = wuffs_base__peek_u32le__no_bounds_check(p + 24);
+    m.external_attributes = wuffs_base__peek_u32le__no_bounds_check(p + 38);
+    m.local_header_offset = wuffs_base__peek_u32le__no_bounds_check(p + 42);
+    const uint8_t* name_ptr = p + ZipLen_CentralDirectoryFileHeader;
+    m.name.assign(reinterpret_cast<const char*>(name_ptr), name_len);
+    if (!ZipParseZip64ExtraField(m, name_ptr + name_len, extra_len) ||
+        (m.local_header_offset >= cd_offset)) {
+      return ZipArchive_BadCentralDirectory;
+    }
+
+    p += record_len;
+    n -= record_len;
+  }
+
+  m_ptr = ptr;
+  m_len = len;
+  m_members = std::move(members);
+  return "";
+}
+
+std::string  //
+ZipArchive::Open(sync_io::Input& input) {
+  m_ptr = nullptr;
+  m_len = 0;
+  m_members.clear();
+
+  // Borrow the Input's bytes if they are all in memory.
+  IOBuffer* io = input.BringsItsOwnIOBuffer();
+  if (io && io->meta.closed) {
+    m_owned_array.reset();
+    return Open(io->reader_pointer(), io->reader_length());
+  }
+
+  // Otherwise, read the whole Input, doubling the buffer size as needed.
+  std::unique_ptr<uint8_t[]> array(nullptr);
+  wuffs_base__io_buffer buf = wuffs_base__empty_io_buffer();
+  while (true) {
+    if (buf.meta.closed) {
+      break;
+    } else if (buf.writer_length() == 0) {
+      size_t new_len = (buf.data.len > 0) ? (2 * buf.data.len) : 65536;
+      if (new_len <= buf.data.len) {
+        return ZipArchive_OutOfMemory;
+      }
+      std::unique_ptr<uint8_t[]> new_array(new (std::nothrow)
+                                               uint8_t[new_len]);
+      if (!new_array) {
+        return ZipArchive_OutOfMemory;
+      }
+      if (buf.meta.wi > 0) {
+        memcpy(new_array.get(), array.get(), buf.meta.wi);
+      }
+      array = std::move(new_array);
+      buf.data = wuffs_base__make_slice_u8(array.get(), new_len);
+    }
+    std::string error_message = input.CopyIn(&buf);
+    if (!error_message.empty()) {
+      return error_message;
+    }
+  }
+
+  m_owned_array = std::move(array);
+  return Open(m_owned_array.get(), buf.meta.wi);
+}
+
+wuffs_base__slice_u8  //
+ZipArchive::Data() const {
+  return wuffs_base__make_slice_u8(const_cast<uint8_t*>(m_ptr), m_len);
+}
+
+const std::vector<ZipMember>&  //
+ZipArchive::Members() const {
+  return m_members;
+}
+
+size_t  //
+ZipArchive::FindMember(const std::string& name) const {
+  for (size_t i = 0; i < m_members.size(); i++) {
+    if (m_members[i].name == name) {
+      return i;
+    }
+  }
+  return SIZE_MAX;
+}
+
+ZipMemberDataResult  //
+ZipArchive::MemberData(size_t index) const {
+  if (index >= m_members.size()) {
+    return ZipMemberDataResult("wuffs_aux::ZipArchive: bad member index",
+                               wuffs_base__empty_slice_u8());
+  }
+  const ZipMember& m = m_members[index];
+
+  // The local header's sizes and CRC-32 can be zero (with the actual values
+  // in a trailing data descriptor), so only its variable length parts' sizes
+  // are used. The central directory's values are authoritative.
+  uint64_t offset = m.local_header_offset;
+  if ((offset > m_len) || ((m_len - offset) < ZipLen_LocalFileHeader) ||
+      (wuffs_base__peek_u32le__no_bounds_check(m_ptr + offset) !=
+       ZipSig_LocalFileHeader)) {
+    return ZipMemberDataResult(ZipArchive_BadLocalHeader,
+                               wuffs_base__empty_slice_u8());
+  }
+  offset += ZipLen_LocalFileHeader +
+            wuffs_base__peek_u16le__no_bounds_check(m_ptr + offset + 26) +
+            wuffs_base__peek_u16le__no_bounds_check(m_ptr + offset + 28);
+  if ((offset > m_len) || (m.compressed_size > (m_len - offset))) {
+    return ZipMemberDataResult(ZipArchive_BadLocalHeader,
+                               wuffs_base__empty_slice_u8());
+  }
+  return ZipMemberDataResult(
+      "", wuffs_base__make_slice_u8(const_cast<uint8_t*>(m_ptr + offset),
+                                    static_cast<size_t>(m.compressed_size)));
+}
+
+ZipExtractor::ZipExtractor()
+    : m_deflate_decoder(nullptr), m_io_array(nullptr) {}
+
+std::string  //
+ZipExtractor::ExtractMember(sync_io::Output& output,
+                            const ZipArchive& archive,
+                            size_t index) {
+  ZipMemberDataResult mdr = archive.MemberData(index);
+  if (!mdr.error_message.empty()) {
+    return std::move(mdr.error_message);
+  }
+  const ZipMember& m = archive.Members()[index];
+  if (m.IsEncrypted()) {
+    return ZipExtractor_UnsupportedEncryption;
+  } else if ((m.compression_method != ZipMember::COMPRESSION_METHOD__STORED) &&
+             (m.compression_method != ZipMember::COMPRESSION_METHOD__DEFLATE)) {
+    return ZipExtractor_UnsupportedCompressionMethod;
+  }
+
+  wuffs_crc32__ieee_hasher hasher;
+  wuffs_base__status status = hasher.initialize(
+      sizeof hasher, WUFFS_VERSION,
+      WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+  if (!status.is_ok()) {
+    return status.message();
+  }
+  uint32_t checksum = 0;
+  uint64_t num_written = 0;
+
+  wuffs_base__io_buffer src =
+      wuffs_base__ptr_u8__reader(mdr.data.ptr, mdr.data.len, true);
+  IOBuffer* dst = output.BringsItsOwnIOBuffer();
+
+  if (m.compression_method == ZipMember::COMPRESSION_METHOD__STORED) {
+    if (m.compressed_size != m.uncompressed_size) {
+      return ZipExtractor_BadUncompressedSize;
+    }
+    checksum = hasher.update_u32(mdr.data);
+    num_written = mdr.data.len;
+
+    if (!dst) {
+      // Pass the archive's bytes in place, without copying.
+      std::string error_message = output.CopyOut(&src);
+      if (!error_message.empty()) {
+        return error_message;
+      }
+    } else {
+      while (src.reader_length() > 0) {
+        size_t n = std::min(dst->writer_length(), src.reader_length());
+        memcpy(dst->writer_pointer(), src.reader_pointer(), n);
+        dst->meta.wi += n;
+        src.meta.ri += n;
+        std::string error_message = output.CopyOut(dst);
+        if (!error_message.empty()) {
+          return error_message;
+        } else if ((n == 0) && (dst->writer_length() == 0)) {
+          return ZipExtractor_OutputBufferIsFull;
+        }
+      }
+    }
+
+  } else {
+    if (!m_deflate_decoder) {
+      m_deflate_decoder =
+          wuffs_deflate__decoder::alloc_as__wuffs_base__io_transformer();
+      if (!m_deflate_decoder) {
+        return ZipExtractor_OutOfMemory;
+      }
+    } else {
+      // Re-initialization resets the decoder's state without zeroing its
+      // internal buffers.
+      status = wuffs_deflate__decoder__initialize(
+          reinterpret_cast<wuffs_deflate__decoder*>(m_deflate_decoder.get()),
+          sizeof__wuffs_deflate__decoder(), WUFFS_VERSION,
+          WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED);
+      if (!status.is_ok()) {
+        return status.message();
+      }
+    }
+
+    wuffs_base__io_buffer fallback_dst = wuffs_base__empty_io_buffer();
+    if (!dst) {
+      if (!m_io_array) {
+        m_io_array = std::unique_ptr<uint8_t[]>(new (std::nothrow)
+                                                    uint8_t[65536]);
+        if (!m_io_array) {
+          return ZipExtractor_OutOfMemory;
+        }
+      }
+      fallback_dst = wuffs_base__ptr_u8__writer(m_io_array.get(), 65536);
+      dst = &fallback_dst;
+    }
+
+    uint8_t workbuf_array[WUFFS_DEFLATE__DECODER_WORKBUF_LEN_MAX_INCL_WORST_CASE];
+    wuffs_base__slice_u8 workbuf =
+        wuffs_base__make_slice_u8(&workbuf_array[0], sizeof(workbuf_array));
+    while (true) {
+      size_t mark = dst->meta.wi;
+      status = m_deflate_decoder->transform_io(dst, &src, workbuf);
+      wuffs_base__slice_u8 written = wuffs_base__make_slice_u8(
+          dst->data.ptr + mark, dst->meta.wi - mark);
+      checksum = hasher.update_u32(written);
+      num_written += written.len;
+      if (num_written > m.uncompressed_size) {
+        // Don't write more than the central directory says there is.
+        return ZipExtractor_BadUncompressedSize;
+      }
+
+      std::string error_message = output.CopyOut(dst);
+      if (!error_message.empty()) {
+        return error_message;
+      } else if (status.repr == nullptr) {
+        break;
+      } else if (status.repr == wuffs_base__suspension__short_read) {
+        return ZipExtractor_TruncatedInput;
+      } else if (status.repr != wuffs_base__suspension__short_write) {
+        return status.message();
+      } else if (dst->writer_length() == 0) {
+        return ZipExtractor_OutputBufferIsFull;
+      }
+    }
+  }
+
+  if (num_written != m.uncompressed_size) {
+    return ZipExtractor_BadUncompressedSize;
+  } else if (checksum != m.crc32) {
+    return ZipExtractor_BadChecksum;
+  }
+  return "";
+}
+
+}  // namespace wuffs_aux
+
+#endif  // !defined(WUFFS_CONFIG__MODULES) ||
+        // defined(WUFFS_CONFIG__MODULE__AUX__ZIP)
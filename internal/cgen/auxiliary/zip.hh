@@ -0,0 +1,138 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- Auxiliary - Zip
+
+#include <vector>
+
+namespace wuffs_aux {
+
+// ZipMember is a Zip archive member's metadata, as recorded in the archive's
+// central directory. The 64-bit fields incorporate any Zip64 extensions.
+struct ZipMember {
+  ZipMember();
+
+  // name is the member's file name, as raw bytes. If general_purpose_flags'
+  // 0x0800 bit is set then it is UTF-8. Otherwise, it is typically (but not
+  // necessarily) ASCII or IBM Code Page 437.
+  std::string name;
+
+  uint64_t compressed_size;
+  uint64_t uncompressed_size;
+  uint64_t local_header_offset;
+  uint32_t crc32;
+  uint32_t external_attributes;
+  uint16_t compression_method;
+  uint16_t general_purpose_flags;
+  uint16_t last_modified_time;  // In MS-DOS format.
+  uint16_t last_modified_date;  // In MS-DOS format.
+
+  static constexpr uint16_t COMPRESSION_METHOD__STORED = 0;
+  static constexpr uint16_t COMPRESSION_METHOD__DEFLATE = 8;
+
+  // IsDirectory returns whether the name ends with a '/'.
+  bool IsDirectory() const;
+
+  // IsEncrypted returns whether general_purpose_flags' 0x0001 bit is set.
+  bool IsEncrypted() const;
+};
+
+struct ZipMemberDataResult {
+  ZipMemberDataResult(std::string&& error_message0, wuffs_base__slice_u8 data0);
+
+  std::string error_message;
+  wuffs_base__slice_u8 data;
+};
+
+// ZipArchive holds a Zip archive's bytes (or a view of them) and the parsed
+// central directory.
+//
+// The archive is accessed randomly, not sequentially, so all of its bytes
+// need to be addressable. When opened from a pointer and length, or from a
+// sync_io::Input that brings its own closed IOBuffer (such as a MemoryInput or
+// MmapFileInput), the bytes are borrowed, not copied, and must outlive the
+// ZipArchive. Otherwise, Open reads the whole Input into memory that the
+// ZipArchive owns.
+//
+// After a successful Open, a ZipArchive is not modified by its const methods,
+// so it can be shared (read-only) by multiple threads, each with its own
+// ZipExtractor, to extract independent members in parallel.
+class ZipArchive {
+ public:
+  ZipArchive();
+
+  // Open parses the archive's end of central directory record (and, if
+  // present, its Zip64 counterpart) and then the central directory itself.
+  // It does not read members' local headers or data. It returns an empty
+  // string on success.
+  std::string Open(const uint8_t* ptr, size_t len);
+  std::string Open(sync_io::Input& input);
+
+  // Data returns the archive's bytes.
+  wuffs_base__slice_u8 Data() const;
+
+  // Members returns the members in central directory order.
+  const std::vector<ZipMember>& Members() const;
+
+  // FindMember returns the index of the first member with the given name, or
+  // SIZE_MAX if there is no such member. It is a linear search.
+  size_t FindMember(const std::string& name) const;
+
+  // MemberData returns the index'th member's compressed data, after checking
+  // its local header. The data is a sub-slice of Data().
+  ZipMemberDataResult MemberData(size_t index) const;
+
+ private:
+  std::unique_ptr<uint8_t[]> m_owned_array;
+  const uint8_t* m_ptr;
+  size_t m_len;
+  std::vector<ZipMember> m_members;
+
+  // Delete the copy and assign constructors.
+  ZipArchive(const ZipArchive&) = delete;
+  ZipArchive& operator=(const ZipArchive&) = delete;
+};
+
+// ZipExtractor decompresses Zip archive members, verifying their
+// uncompressed size and CRC-32 checksum. It keeps a deflate decoder and an
+// I/O buffer alive between ExtractMember calls, instead of allocating and
+// freeing them for every member.
+//
+// A ZipExtractor is not thread-safe. It can be re-used by sequential calls
+// but not by concurrent ones. Use one extractor per thread.
+class ZipExtractor {
+ public:
+  ZipExtractor();
+
+  // ExtractMember writes the archive's index'th member's uncompressed bytes
+  // to output. It returns an empty string on success.
+  //
+  // Stored (uncompressed) members are passed to output.CopyOut in place, as
+  // sub-slices of archive.Data(), unless the output brings its own IOBuffer.
+  // Either way, deflate-compressed members are decoded directly from
+  // archive.Data(), so neither involves copying the compressed bytes.
+  //
+  // Output bytes may have been written (and CopyOut'ed) even if the
+  // decompressed data later turns out to be invalid, such as having the wrong
+  // checksum.
+  std::string ExtractMember(sync_io::Output& output,
+                            const ZipArchive& archive,
+                            size_t index);
+
+ private:
+  wuffs_base__io_transformer::unique_ptr m_deflate_decoder;
+  std::unique_ptr<uint8_t[]> m_io_array;
+
+  // Delete the copy and assign constructors.
+  ZipExtractor(const ZipExtractor&) = delete;
+  ZipExtractor& operator=(const ZipExtractor&) = delete;
+};
+
+}  // namespace wuffs_aux
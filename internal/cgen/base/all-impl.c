@@ -43,6 +43,8 @@ extern "C" {
 
 // ¡ INSERT InterfaceDeclarations.
 
+// ¡ INSERT base/budget-public.h.
+
 // ----------------
 
 #ifdef __cplusplus
@@ -124,6 +126,8 @@ const uint32_t wuffs_private_impl__pixel_format__bits_per_channel[16] = {
 
 // ¡ INSERT InterfaceDefinitions.
 
+// ¡ INSERT base/budget-submodule.c.
+
 #endif  // !defined(WUFFS_CONFIG__MODULES) ||
         // defined(WUFFS_CONFIG__MODULE__BASE) ||
         // defined(WUFFS_CONFIG__MODULE__BASE__INTERFACES)
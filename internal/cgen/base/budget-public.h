@@ -0,0 +1,112 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- I/O Transformer Budgets
+
+// WUFFS_BASE__IO_TRANSFORMER_BUDGET__RATIO_GRACE_LENGTH is how many dst bytes
+// a wuffs_base__io_transformer_budget allows before it enforces its max_ratio.
+// Small inputs (such as a header followed by a short run) can legitimately
+// expand by a large ratio.
+#define WUFFS_BASE__IO_TRANSFORMER_BUDGET__RATIO_GRACE_LENGTH 65536
+
+// wuffs_base__io_transformer_budget caps the work that a
+// wuffs_base__io_transformer (such as a zlib decoder) does for one stream. It
+// guards against decompression bombs: small inputs that decode to enormous
+// outputs, or that otherwise take excessive time to process.
+//
+// The max_etc fields are the limits. Zero means no limit:
+//  - max_dst_length caps the total number of bytes written to dst.
+//  - max_ratio caps the total number of bytes written to dst, relative to the
+//    number of src bytes consumed so far or already available (in src's
+//    reader side). WUFFS_BASE__IO_TRANSFORMER_BUDGET__RATIO_GRACE_LENGTH bytes
+//    are always allowed.
+//  - max_transform_io_calls caps the number of transform_io calls, each of
+//    which (other than the last) ends in a suspension.
+//
+// The num_etc fields are running totals for the stream so far. They should
+// start at zero, such as via wuffs_base__make_io_transformer_budget.
+//
+// Use one budget per stream, not per transformer: re-initializing the
+// transformer to decode another stream should also reset the budget.
+typedef struct wuffs_base__io_transformer_budget__struct {
+  uint64_t max_dst_length;
+  uint64_t max_ratio;
+  uint64_t max_transform_io_calls;
+
+  uint64_t num_dst_bytes;
+  uint64_t num_src_bytes;
+  uint64_t num_transform_io_calls;
+
+#ifdef __cplusplus
+  inline wuffs_base__status transform_io(
+      wuffs_base__io_transformer* transformer,
+      wuffs_base__io_buffer* dst,
+      wuffs_base__io_buffer* src,
+      wuffs_base__slice_u8 workbuf);
+#endif  // __cplusplus
+
+} wuffs_base__io_transformer_budget;
+
+static inline wuffs_base__io_transformer_budget  //
+wuffs_base__make_io_transformer_budget(uint64_t max_dst_length,
+                                       uint64_t max_ratio,
+                                       uint64_t max_transform_io_calls) {
+  wuffs_base__io_transformer_budget ret;
+  ret.max_dst_length = max_dst_length;
+  ret.max_ratio = max_ratio;
+  ret.max_transform_io_calls = max_transform_io_calls;
+  ret.num_dst_bytes = 0;
+  ret.num_src_bytes = 0;
+  ret.num_transform_io_calls = 0;
+  return ret;
+}
+
+// wuffs_base__io_transformer_budget__transform_io is a drop-in replacement
+// for calling wuffs_base__io_transformer__transform_io directly. It returns
+// the same statuses, plus wuffs_base__error__budget_exceeded when going
+// further would exceed the budget, after which the stream should be abandoned.
+//
+// The budget is only consulted between transform_io calls, at suspension
+// boundaries, so the transformer's per-byte loops run at full speed. Before
+// each call, dst's writable window is temporarily shortened to what's left of
+// the allowance, so that output never overshoots max_dst_length or max_ratio.
+// A transformer that makes no progress in the window that is left is reported
+// as exceeding its budget. Some transformers (such as LZMA decoders) need
+// spare room to make progress, so a stream whose output length exactly meets
+// the allowance may be reported as exceeding it, but output never overshoots.
+//
+// As dst's window can be shortened, the transformer may return a short write
+// even when dst (as the caller sees it) is not full. Callers should handle
+// that like any other short write: drain dst's reader side and call again.
+//
+// For modular builds that divide the base module into sub-modules, using this
+// function requires the WUFFS_CONFIG__MODULE__BASE__INTERFACES sub-module, not
+// just WUFFS_CONFIG__MODULE__BASE__CORE.
+WUFFS_BASE__MAYBE_STATIC wuffs_base__status  //
+wuffs_base__io_transformer_budget__transform_io(
+    wuffs_base__io_transformer_budget* budget,
+    wuffs_base__io_transformer* transformer,
+    wuffs_base__io_buffer* dst,
+    wuffs_base__io_buffer* src,
+    wuffs_base__slice_u8 workbuf);
+
+#ifdef __cplusplus
+
+inline wuffs_base__status  //
+wuffs_base__io_transformer_budget::transform_io(
+    wuffs_base__io_transformer* transformer,
+    wuffs_base__io_buffer* dst,
+    wuffs_base__io_buffer* src,
+    wuffs_base__slice_u8 workbuf) {
+  return wuffs_base__io_transformer_budget__transform_io(this, transformer,
+                                                         dst, src, workbuf);
+}
+
+#endif  // __cplusplus
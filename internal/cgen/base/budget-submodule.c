@@ -0,0 +1,89 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ---------------- I/O Transformer Budgets
+
+WUFFS_BASE__MAYBE_STATIC wuffs_base__status  //
+wuffs_base__io_transformer_budget__transform_io(
+    wuffs_base__io_transformer_budget* budget,
+    wuffs_base__io_transformer* transformer,
+    wuffs_base__io_buffer* dst,
+    wuffs_base__io_buffer* src,
+    wuffs_base__slice_u8 workbuf) {
+  if (!budget || !dst || !src) {
+    return wuffs_base__make_status(wuffs_base__error__bad_argument);
+  } else if ((budget->max_transform_io_calls > 0) &&
+             (budget->num_transform_io_calls >=
+              budget->max_transform_io_calls)) {
+    return wuffs_base__make_status(wuffs_base__error__budget_exceeded);
+  }
+
+  // Shorten dst's writable window to what's left of the budget's allowance:
+  // max_dst_length, or max_ratio times the src bytes consumed so far or
+  // already available, whichever is smaller. An invalid dst (one with wi >
+  // len) is left alone, for the transformer to reject.
+  uint64_t allowance = budget->max_dst_length ? budget->max_dst_length
+                                              : UINT64_MAX;
+  if (budget->max_ratio > 0) {
+    uint64_t n = wuffs_base__u64__sat_add(
+        budget->num_src_bytes,
+        (src->meta.ri <= src->meta.wi)
+            ? ((uint64_t)(src->meta.wi - src->meta.ri))
+            : 0);
+    n = (n <= (UINT64_MAX / budget->max_ratio)) ? (n * budget->max_ratio)
+                                                : UINT64_MAX;
+    if (n < WUFFS_BASE__IO_TRANSFORMER_BUDGET__RATIO_GRACE_LENGTH) {
+      n = WUFFS_BASE__IO_TRANSFORMER_BUDGET__RATIO_GRACE_LENGTH;
+    }
+    if (allowance > n) {
+      allowance = n;
+    }
+  }
+  size_t dst_len = dst->data.len;
+  bool dst_shortened = false;
+  if ((allowance < UINT64_MAX) && (dst->meta.wi <= dst_len)) {
+    uint64_t remaining = (allowance > budget->num_dst_bytes)
+                             ? (allowance - budget->num_dst_bytes)
+                             : 0;
+    if (remaining < ((uint64_t)(dst_len - dst->meta.wi))) {
+      dst->data.len = dst->meta.wi + ((size_t)remaining);
+      dst_shortened = true;
+    }
+  }
+
+  size_t dst_wi = dst->meta.wi;
+  size_t src_ri = src->meta.ri;
+  budget->num_transform_io_calls++;
+  wuffs_base__status status = wuffs_base__io_transformer__transform_io(
+      transformer, dst, src, workbuf);
+  if (dst_shortened) {
+    dst->data.len = dst_len;
+  }
+  if (dst->meta.wi > dst_wi) {
+    budget->num_dst_bytes = wuffs_base__u64__sat_add(
+        budget->num_dst_bytes, (uint64_t)(dst->meta.wi - dst_wi));
+  }
+  if (src->meta.ri > src_ri) {
+    budget->num_src_bytes = wuffs_base__u64__sat_add(
+        budget->num_src_bytes, (uint64_t)(src->meta.ri - src_ri));
+  }
+
+  if (dst_shortened && (dst->meta.wi == dst_wi) &&
+      (status.repr == wuffs_base__suspension__short_write)) {
+    // The transformer made no progress in the room that the budget allows.
+    // Some transformers (such as LZMA decoders, which want room for a
+    // maximal match) need more than one byte of room, so a non-empty window
+    // is not enough to conclude that the output would have fit. A
+    // transformer that did make progress is re-tried, by the caller, with
+    // whatever room is then left.
+    return wuffs_base__make_status(wuffs_base__error__budget_exceeded);
+  }
+  return status;
+}
@@ -437,6 +437,49 @@ wuffs_private_impl__io_writer__limited_copy_u32_from_history_8_byte_chunks_fast_
   return (uint32_t)wuffs_base__peek_u16le__no_bounds_check(q - 1);
 }
 
+// wuffs_private_impl__io_writer__limited_copy_u32_from_history_16_byte_chunks_fast_return_cusp
+// is like the
+// wuffs_private_impl__io_writer__limited_copy_u32_from_history_8_byte_chunks_fast_return_cusp
+// function above, but copies 16 byte chunks at a time. Compilers can typically
+// lower each 16 byte memcpy to a single SIMD load and store.
+//
+// In terms of number of bytes copied, length is rounded up to a multiple of
+// 16. As a special case, a zero length rounds up to 16 (even though 0 is
+// already a multiple of 16), since there is always at least one 16 byte chunk
+// copied.
+//
+// In terms of advancing *ptr_iop_w, length is not rounded up.
+//
+// The caller needs to prove that:
+//  - length        >= 1
+//  - (length + 16) <= (io2_w      - *ptr_iop_w)
+//  - distance      >= 16
+//  - distance      <= (*ptr_iop_w - io0_w)
+static inline uint32_t  //
+wuffs_private_impl__io_writer__limited_copy_u32_from_history_16_byte_chunks_fast_return_cusp(
+    uint8_t** ptr_iop_w,
+    uint8_t* io0_w,
+    uint8_t* io2_w,
+    uint32_t length,
+    uint32_t distance) {
+  uint8_t* p = *ptr_iop_w;
+  uint8_t* q = p - distance;
+  uint32_t n = length;
+  while (1) {
+    memcpy(p, q, 16);
+    if (n <= 16) {
+      p += n;
+      q += n;
+      break;
+    }
+    p += 16;
+    q += 16;
+    n -= 16;
+  }
+  *ptr_iop_w = p;
+  return (uint32_t)wuffs_base__peek_u16le__no_bounds_check(q - 1);
+}
+
 static inline uint32_t  //
 wuffs_private_impl__io_writer__limited_copy_u32_from_reader(
     uint8_t** ptr_iop_w,
@@ -328,6 +328,7 @@ func (g *gen) writeBuiltinIOWriter(b *buffer, recv *a.Expr, method t.ID, args []
 
 	switch method {
 	case t.IDLimitedCopyU32FromHistory,
+		t.IDLimitedCopyU32FromHistory16ByteChunksFastReturnCusp,
 		t.IDLimitedCopyU32FromHistory8ByteChunksDistance1Fast,
 		t.IDLimitedCopyU32FromHistory8ByteChunksDistance1FastReturnCusp,
 		t.IDLimitedCopyU32FromHistory8ByteChunksFast,
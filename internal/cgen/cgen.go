@@ -127,6 +127,8 @@ func Do(args []string) error {
 				"// ¡ INSERT InterfaceDefinitions.\n":              insertInterfaceDefinitions,
 				"// ¡ INSERT base/all-private.h.\n":                insertBaseAllPrivateH,
 				"// ¡ INSERT base/all-public.h.\n":                 insertBaseAllPublicH,
+				"// ¡ INSERT base/budget-public.h.\n":              insertBaseBudgetPublicH,
+				"// ¡ INSERT base/budget-submodule.c.\n":           insertBaseBudgetSubmoduleC,
 				"// ¡ INSERT base/copyright\n":                     insertBaseCopyright,
 				"// ¡ INSERT base/floatconv-submodule.c.\n":        insertBaseFloatConvSubmoduleC,
 				"// ¡ INSERT base/intconv-submodule.c.\n":          insertBaseIntConvSubmoduleC,
@@ -366,6 +368,16 @@ func insertBaseAllPublicH(buf *buffer) error {
 	return nil
 }
 
+func insertBaseBudgetPublicH(buf *buffer) error {
+	buf.writes(embedBaseBudgetPublicH.Trim())
+	return nil
+}
+
+func insertBaseBudgetSubmoduleC(buf *buffer) error {
+	buf.writes(embedBaseBudgetSubmoduleC.Trim())
+	return nil
+}
+
 func insertBaseCopyright(buf *buffer) error {
 	s := string(embedBaseAllImplC)
 	if i := strings.Index(s, "\n\n"); i >= 0 {
@@ -37,6 +37,9 @@ var embedBaseAllImplC EmbeddedString
 
 // ----
 
+//go:embed base/budget-public.h
+var embedBaseBudgetPublicH EmbeddedString
+
 //go:embed base/fundamental-private.h
 var embedBaseFundamentalPrivateH EmbeddedString
 
@@ -81,6 +84,9 @@ var embedBaseTokenPublicH EmbeddedString
 
 // ----
 
+//go:embed base/budget-submodule.c
+var embedBaseBudgetSubmoduleC EmbeddedString
+
 //go:embed base/floatconv-submodule-code.c
 var embedBaseFloatConvSubmoduleCodeC EmbeddedString
 
@@ -119,6 +125,12 @@ var embedAuxCborCc EmbeddedString
 //go:embed auxiliary/cbor.hh
 var embedAuxCborHh EmbeddedString
 
+//go:embed auxiliary/gzip.cc
+var embedAuxGzipCc EmbeddedString
+
+//go:embed auxiliary/gzip.hh
+var embedAuxGzipHh EmbeddedString
+
 //go:embed auxiliary/image.cc
 var embedAuxImageCc EmbeddedString
 
@@ -131,16 +143,42 @@ var embedAuxJsonCc EmbeddedString
 //go:embed auxiliary/json.hh
 var embedAuxJsonHh EmbeddedString
 
+//go:embed auxiliary/rac.cc
+var embedAuxRacCc EmbeddedString
+
+//go:embed auxiliary/rac.hh
+var embedAuxRacHh EmbeddedString
+
+//go:embed auxiliary/transform.cc
+var embedAuxTransformCc EmbeddedString
+
+//go:embed auxiliary/transform.hh
+var embedAuxTransformHh EmbeddedString
+
+//go:embed auxiliary/zip.cc
+var embedAuxZipCc EmbeddedString
+
+//go:embed auxiliary/zip.hh
+var embedAuxZipHh EmbeddedString
+
 var EmbeddedStrings_AuxNonBaseCcFiles = []EmbeddedString{
 	embedAuxCborCc,
+	embedAuxGzipCc,
 	embedAuxImageCc,
 	embedAuxJsonCc,
+	embedAuxRacCc,
+	embedAuxTransformCc,
+	embedAuxZipCc,
 }
 
 var EmbeddedStrings_AuxNonBaseHhFiles = []EmbeddedString{
 	embedAuxCborHh,
+	embedAuxGzipHh,
 	embedAuxImageHh,
 	embedAuxJsonHh,
+	embedAuxRacHh,
+	embedAuxTransformHh,
+	embedAuxZipHh,
 }
 
 // ----
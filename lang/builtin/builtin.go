@@ -268,6 +268,7 @@ var Statuses = [...]string{
 	`"#bad vtable"`,
 	`"#bad workbuf length"`,
 	`"#bad wuffs version"`,
+	`"#budget exceeded"`,
 	`"#cannot return a suspension"`,
 	`"#disabled by WUFFS_CONFIG__DST_PIXEL_FORMAT__ENABLE_ALLOWLIST"`,
 	`"#disabled by previous error"`,
@@ -631,6 +632,14 @@ var funcsOther = [...]string{
 	// For now, that's all implicitly checked (i.e. hard coded).
 	"io_writer.limited_copy_u32_from_history_8_byte_chunks_fast_return_cusp!(up_to: u32, distance: u32) u32[..= 0xFFFF]",
 
+	// TODO: this should have explicit pre-conditions:
+	//  - up_to >= 1
+	//  - (up_to + 16) <= this.length()
+	//  - distance >= 16
+	//  - distance <= this.history_length()
+	// For now, that's all implicitly checked (i.e. hard coded).
+	"io_writer.limited_copy_u32_from_history_16_byte_chunks_fast_return_cusp!(up_to: u32, distance: u32) u32[..= 0xFFFF]",
+
 	// TODO: this should have explicit pre-conditions:
 	//  - up_to >= 1
 	//  - (up_to + 8) <= this.length()
@@ -1217,6 +1217,11 @@ func (q *checker) bcheckExprCallSpecialCases(n *a.Expr, depth uint32) (bounds, e
 				return bounds{}, err
 			}
 
+		} else if method == t.IDLimitedCopyU32FromHistory16ByteChunksFastReturnCusp {
+			if err := q.canLimitedCopyU32FromHistoryFast(recv, n.Args(), sixteen, sixteen, nil); err != nil {
+				return bounds{}, err
+			}
+
 		} else if (method == t.IDLimitedCopyU32FromHistory8ByteChunksDistance1Fast) ||
 			(method == t.IDLimitedCopyU32FromHistory8ByteChunksDistance1FastReturnCusp) {
 			if err := q.canLimitedCopyU32FromHistoryFast(recv, n.Args(), eight, nil, one); err != nil {
@@ -523,15 +523,16 @@ const (
 
 	IDCopyFromSlice                                               = ID(0x170)
 	IDLimitedCopyU32FromHistory                                   = ID(0x171)
-	IDLimitedCopyU32FromHistory8ByteChunksDistance1Fast           = ID(0x172)
-	IDLimitedCopyU32FromHistory8ByteChunksDistance1FastReturnCusp = ID(0x173)
-	IDLimitedCopyU32FromHistory8ByteChunksFast                    = ID(0x174)
-	IDLimitedCopyU32FromHistory8ByteChunksFastReturnCusp          = ID(0x175)
-	IDLimitedCopyU32FromHistoryFast                               = ID(0x176)
-	IDLimitedCopyU32FromHistoryFastReturnCusp                     = ID(0x177)
-	IDLimitedCopyU32FromReader                                    = ID(0x178)
-	IDLimitedCopyU32FromSlice                                     = ID(0x179)
-	IDLimitedCopyU32ToSlice                                       = ID(0x17A)
+	IDLimitedCopyU32FromHistory16ByteChunksFastReturnCusp         = ID(0x172)
+	IDLimitedCopyU32FromHistory8ByteChunksDistance1Fast           = ID(0x173)
+	IDLimitedCopyU32FromHistory8ByteChunksDistance1FastReturnCusp = ID(0x174)
+	IDLimitedCopyU32FromHistory8ByteChunksFast                    = ID(0x175)
+	IDLimitedCopyU32FromHistory8ByteChunksFastReturnCusp          = ID(0x176)
+	IDLimitedCopyU32FromHistoryFast                               = ID(0x177)
+	IDLimitedCopyU32FromHistoryFastReturnCusp                     = ID(0x178)
+	IDLimitedCopyU32FromReader                                    = ID(0x179)
+	IDLimitedCopyU32FromSlice                                     = ID(0x17A)
+	IDLimitedCopyU32ToSlice                                       = ID(0x17B)
 
 	// -------- 0x180 block.
 
@@ -974,6 +975,7 @@ var builtInsByID = [nBuiltInIDs]string{
 
 	IDCopyFromSlice:             "copy_from_slice",
 	IDLimitedCopyU32FromHistory: "limited_copy_u32_from_history",
+	IDLimitedCopyU32FromHistory16ByteChunksFastReturnCusp:         "limited_copy_u32_from_history_16_byte_chunks_fast_return_cusp",
 	IDLimitedCopyU32FromHistory8ByteChunksDistance1Fast:           "limited_copy_u32_from_history_8_byte_chunks_distance_1_fast",
 	IDLimitedCopyU32FromHistory8ByteChunksDistance1FastReturnCusp: "limited_copy_u32_from_history_8_byte_chunks_distance_1_fast_return_cusp",
 	IDLimitedCopyU32FromHistory8ByteChunksFast:                    "limited_copy_u32_from_history_8_byte_chunks_fast",
@@ -0,0 +1,339 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+// manual-test-cbor-writer tests wuffs_aux::CborWriter, both driven directly
+// and as a wuffs_aux::DecodeCbor callback, against golden output. The
+// test/c/std/cbor.c program cannot do this, as it is C and wuffs_aux is C++.
+//
+// To run it, from the repository's root directory:
+//
+// g++ -O3 script/manual-test-cbor-writer.cc && ./a.out
+//
+// Passing "-bench" instead measures the throughput of:
+//  - encode:   driving a CborWriter directly.
+//  - decode:   DecodeCbor with no-op callbacks.
+//  - reencode: DecodeCbor into a CborWriter.
+// The input is generated: BENCH_NUM_RECORDS maps that each look like a small
+// JSON-ish database record. Passing "-reps=N" (default 5) sets how many times
+// each one is repeated.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__STATIC_FUNCTIONS macro is optional, but when
+// combined with WUFFS_IMPLEMENTATION, it demonstrates making all of Wuffs'
+// functions have static storage.
+//
+// This can help the compiler ignore or discard unused code, which can produce
+// faster compiles and smaller binaries. Other motivations are discussed in the
+// "ALLOW STATIC IMPLEMENTATION" section of
+// https://raw.githubusercontent.com/nothings/stb/master/docs/stb_howto.txt
+#define WUFFS_CONFIG__STATIC_FUNCTIONS
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__CBOR
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__CBOR
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C++ file.
+#include "../release/c/wuffs-unsupported-snapshot.c"
+
+// ----
+
+#ifndef DST_BUFFER_ARRAY_SIZE
+#define DST_BUFFER_ARRAY_SIZE (64 * 1024 * 1024)
+#endif
+
+#ifndef BENCH_NUM_RECORDS
+#define BENCH_NUM_RECORDS 100000
+#endif
+
+uint8_t g_dst_buffer_array[DST_BUFFER_ARRAY_SIZE] = {0};
+
+static int g_num_failures;
+
+#define CBOR(s) std::string(s, sizeof(s) - 1)
+
+static void  //
+fail(const char* name, const char* what, const std::string& have) {
+  g_num_failures++;
+  fprintf(stderr, "FAIL %s: %s", name, what);
+  for (size_t i = 0; (i < have.size()) && (i < 64); i++) {
+    fprintf(stderr, " %02X", static_cast<uint8_t>(have[i]));
+  }
+  fprintf(stderr, "%s\n", (have.size() > 64) ? " ..." : "");
+}
+
+static std::string  //
+output_contents(wuffs_aux::sync_io::MemoryOutput& output) {
+  wuffs_base__slice_u8 s = output.BringsItsOwnIOBuffer()->reader_slice();
+  return std::string(reinterpret_cast<const char*>(s.ptr), s.len);
+}
+
+// reencode passes src through DecodeCbor into a CborWriter.
+static std::string  //
+reencode(std::string* dst, const std::string& src, uint64_t flags = 0) {
+  wuffs_aux::sync_io::MemoryInput input(src.data(), src.size());
+  wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                          DST_BUFFER_ARRAY_SIZE);
+  wuffs_aux::CborWriter writer(output,
+                               wuffs_aux::CborWriterArgBuffer::DefaultValue(),
+                               wuffs_aux::CborWriterArgFlags(flags));
+  std::string error_message =
+      wuffs_aux::DecodeCbor(writer, input).error_message;
+  if (error_message.empty()) {
+    error_message = writer.Flush();
+  }
+  *dst = output_contents(output);
+  return error_message;
+}
+
+// ---------------- Tests
+
+static void  //
+test_write_directly() {
+  wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                          DST_BUFFER_ARRAY_SIZE);
+  wuffs_aux::CborWriter w(output);
+  w.PushDict(2);
+  w.AppendTextString("a", 1);
+  w.AppendI64(-1000);
+  w.AppendTextString("b", 1);
+  w.PushList(4);
+  w.AppendF64(1.5);
+  w.AppendF64(100000.0);
+  w.AppendF64(1.1);
+  w.Push(WUFFS_BASE__TOKEN__VBD__STRUCTURE__TO_LIST);
+  w.AppendBool(true);
+  w.Pop(0);
+  w.Pop(0);
+  w.Pop(0);
+  w.BeginString(wuffs_aux::DecodeCborCallbacks::STRING_FLAG_INDEFINITE_LENGTH,
+                0);
+  w.AppendStringSlice(0, reinterpret_cast<const uint8_t*>("\x01\x02"), 2);
+  w.AppendStringSlice(0, reinterpret_cast<const uint8_t*>("\x03"), 1);
+  w.EndString(wuffs_aux::DecodeCborCallbacks::STRING_FLAG_INDEFINITE_LENGTH);
+  std::string error_message = w.Flush();
+  std::string want = CBOR(
+      "\xA2\x61\x61\x39\x03\xE7\x61\x62\x84\xF9\x3E\x00\xFA\x47\xC3\x50\x00"
+      "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A\x9F\xF5\xFF"
+      "\x5F\x42\x01\x02\x41\x03\xFF");
+  if (!error_message.empty()) {
+    fail(__func__, error_message.c_str(), "");
+  } else if (output_contents(output) != want) {
+    fail(__func__, "output mismatch; have", output_contents(output));
+  }
+}
+
+// test_reencode checks the CborWriter comment's claims about re-encoding:
+// numbers are shortened, strings keep their (in)definite length and chunks,
+// and arrays and maps become indefinite-length.
+static void  //
+test_reencode() {
+  static const struct {
+    std::string src;
+    std::string want;
+  } test_cases[] = {
+      {CBOR("\x18\x05"), CBOR("\x05")},
+      {CBOR("\xFB\x3F\xF8\x00\x00\x00\x00\x00\x00"), CBOR("\xF9\x3E\x00")},
+      {CBOR("\x63\x61\x62\x63"), CBOR("\x63\x61\x62\x63")},
+      {CBOR("\x7F\x61\x61\x62\x62\x63\xFF"),
+       CBOR("\x7F\x61\x61\x62\x62\x63\xFF")},
+      {CBOR("\x5F\xFF"), CBOR("\x5F\xFF")},
+      {CBOR("\x83\x01\x02\x03"), CBOR("\x9F\x01\x02\x03\xFF")},
+      {CBOR("\xA1\x61\x6B\x80"), CBOR("\xBF\x61\x6B\x9F\xFF\xFF")},
+      {CBOR("\xC1\x1A\x51\x4B\x67\xB0"), CBOR("\xC1\x1A\x51\x4B\x67\xB0")},
+  };
+  for (const auto& tc : test_cases) {
+    std::string have;
+    std::string error_message = reencode(&have, tc.src);
+    if (!error_message.empty()) {
+      fail(__func__, error_message.c_str(), tc.src);
+    } else if (have != tc.want) {
+      fail(__func__, "output mismatch; have", have);
+    }
+  }
+
+  // With CANONICAL, scalars and definite-length strings are fine but any
+  // array or map is rejected, as DecodeCbor calls Push.
+  std::string have;
+  std::string error_message =
+      reencode(&have, CBOR("\x63\x61\x62\x63"),
+               wuffs_aux::CborWriterArgFlags::CANONICAL);
+  if (!error_message.empty()) {
+    fail(__func__, error_message.c_str(), "");
+  }
+  if (reencode(&have, CBOR("\x81\x01"),
+               wuffs_aux::CborWriterArgFlags::CANONICAL)
+          .empty()) {
+    fail(__func__, "CANONICAL with an array: have ok, want an error", have);
+  }
+}
+
+// ---------------- Benches
+
+// write_records writes BENCH_NUM_RECORDS record-like maps, as a CBOR
+// Sequence.
+static std::string  //
+write_records(wuffs_aux::sync_io::Output& output) {
+  wuffs_aux::CborWriter w(output);
+  char buf[32];
+  for (int i = 0; i < BENCH_NUM_RECORDS; i++) {
+    w.PushDict(5);
+    w.AppendTextString("id", 2);
+    w.AppendI64(1000000 + i);
+    w.AppendTextString("name", 4);
+    int n = snprintf(buf, sizeof(buf), "user-%08d", i);
+    w.AppendTextString(buf, static_cast<size_t>(n));
+    w.AppendTextString("score", 5);
+    w.AppendF64(i * 0.25);
+    w.AppendTextString("active", 6);
+    w.AppendBool((i & 1) != 0);
+    w.AppendTextString("tags", 4);
+    w.PushList(3);
+    w.AppendTextString("alpha", 5);
+    w.AppendTextString("beta", 4);
+    w.AppendU64(static_cast<uint64_t>(i) * 7919);
+    w.Pop(0);
+    w.Pop(0);
+  }
+  return w.Flush();
+}
+
+class NoOpCallbacks : public wuffs_aux::DecodeCborCallbacks {
+ public:
+  std::string AppendNull() override { return ""; }
+  std::string AppendUndefined() override { return ""; }
+  std::string AppendBool(bool) override { return ""; }
+  std::string AppendF64(double) override { return ""; }
+  std::string AppendI64(int64_t) override { return ""; }
+  std::string AppendU64(uint64_t) override { return ""; }
+  std::string AppendByteString(std::string&&) override { return ""; }
+  std::string AppendTextString(std::string&&) override { return ""; }
+  std::string AppendMinus1MinusX(uint64_t) override { return ""; }
+  std::string AppendCborSimpleValue(uint8_t) override { return ""; }
+  std::string AppendCborTag(uint64_t) override { return ""; }
+  std::string Push(uint32_t) override { return ""; }
+  std::string Pop(uint32_t) override { return ""; }
+};
+
+// bench_one runs one of the three benchmarks once. It returns the number of
+// bytes processed (the encoded CBOR's length) via n.
+static std::string  //
+bench_one(const char* name, const std::string& records, size_t* n) {
+  wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                          DST_BUFFER_ARRAY_SIZE);
+  *n = records.size();
+  if (!strcmp(name, "encode")) {
+    return write_records(output);
+  }
+  wuffs_aux::sync_io::MemoryInput input(records.data(), records.size());
+  if (!strcmp(name, "decode")) {
+    NoOpCallbacks callbacks;
+    return wuffs_aux::DecodeCbor(callbacks, input).error_message;
+  }
+  wuffs_aux::CborWriter writer(output);
+  std::string error_message =
+      wuffs_aux::DecodeCbor(writer, input).error_message;
+  return error_message.empty() ? writer.Flush() : error_message;
+}
+
+static void  //
+bench(int reps) {
+  // DecodeCbor decodes one top-level value, so wrap the records in an
+  // indefinite-length array.
+  wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                          DST_BUFFER_ARRAY_SIZE);
+  std::string error_message = write_records(output);
+  if (!error_message.empty()) {
+    fail(__func__, error_message.c_str(), "");
+    return;
+  }
+  std::string records = "\x9F" + output_contents(output) + "\xFF";
+
+  static const char* names[] = {"encode", "decode", "reencode"};
+  for (const char* name : names) {
+    double best = 1e100;
+    size_t n = 0;
+    for (int r = 0; r < reps; r++) {
+      struct timespec t0;
+      struct timespec t1;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      error_message = bench_one(name, records, &n);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      if (!error_message.empty()) {
+        fail(name, error_message.c_str(), "");
+        return;
+      }
+      double elapsed =
+          (t1.tv_sec - t0.tv_sec) + (1e-9 * (t1.tv_nsec - t0.tv_nsec));
+      best = (best < elapsed) ? best : elapsed;
+    }
+    printf("cbor_writer_%-10s %8.2f MB/s  (%zu bytes, best of %d)\n", name,
+           (1e-6 * n) / best, n, reps);
+  }
+}
+
+int  //
+main(int argc, char** argv) {
+  bool do_bench = false;
+  int reps = 5;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-bench")) {
+      do_bench = true;
+    } else if (!strncmp(argv[i], "-reps=", 6)) {
+      reps = atoi(argv[i] + 6);
+    } else {
+      fprintf(stderr, "main: unrecognized flag %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (do_bench) {
+    bench(reps);
+  } else {
+    test_write_directly();
+    test_reencode();
+  }
+
+  if (g_num_failures) {
+    fprintf(stderr, "%d failure(s)\n", g_num_failures);
+    return 1;
+  }
+  if (!do_bench) {
+    printf("PASS\n");
+  }
+  return 0;
+}
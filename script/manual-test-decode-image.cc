@@ -0,0 +1,504 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+// manual-test-decode-image tests wuffs_aux::DecodeImage features that the
+// test/c/std programs cannot reach, as they are C and wuffs_aux is C++.
+//
+// To run it, from the repository's root directory:
+//
+// g++ -O3 script/manual-test-decode-image.cc && ./a.out
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__STATIC_FUNCTIONS macro is optional, but when
+// combined with WUFFS_IMPLEMENTATION, it demonstrates making all of Wuffs'
+// functions have static storage.
+//
+// This can help the compiler ignore or discard unused code, which can produce
+// faster compiles and smaller binaries. Other motivations are discussed in the
+// "ALLOW STATIC IMPLEMENTATION" section of
+// https://raw.githubusercontent.com/nothings/stb/master/docs/stb_howto.txt
+#define WUFFS_CONFIG__STATIC_FUNCTIONS
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__ADLER32
+#define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__IMAGE
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__BMP
+#define WUFFS_CONFIG__MODULE__CRC32
+#define WUFFS_CONFIG__MODULE__DEFLATE
+#define WUFFS_CONFIG__MODULE__GIF
+#define WUFFS_CONFIG__MODULE__JPEG
+#define WUFFS_CONFIG__MODULE__LZW
+#define WUFFS_CONFIG__MODULE__PNG
+#define WUFFS_CONFIG__MODULE__ZLIB
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C++ file.
+#include "../release/c/wuffs-unsupported-snapshot.c"
+
+// ----
+
+static bool  //
+read_file(std::string* dst, const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (!f) {
+    return false;
+  }
+  dst->clear();
+  char buf[4096];
+  while (true) {
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    dst->append(buf, n);
+    if (n < sizeof(buf)) {
+      break;
+    }
+  }
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+// pixbuf_contents returns a copy of the pixel buffer's first plane.
+static std::string  //
+pixbuf_contents(const wuffs_base__pixel_buffer& pixbuf) {
+  wuffs_base__pixel_buffer p = pixbuf;
+  wuffs_base__table_u8 t = p.plane(0);
+  std::string s;
+  for (size_t y = 0; y < t.height; y++) {
+    s.append(reinterpret_cast<const char*>(t.ptr + (y * t.stride)), t.width);
+  }
+  return s;
+}
+
+// ChunkedInput is a sync_io::Input that hands out its source a few bytes at a
+// time, like a slow network connection, so that DecodeImage has to suspend
+// (and call HandleProgress) many times per frame.
+class ChunkedInput : public wuffs_aux::sync_io::Input {
+ public:
+  ChunkedInput(const std::string& src, size_t chunk_size)
+      : m_src(src), m_pos(0), m_chunk_size(chunk_size) {}
+
+  std::string CopyIn(wuffs_aux::IOBuffer* dst) override {
+    dst->compact();
+    size_t n = m_src.size() - m_pos;
+    n = (n < m_chunk_size) ? n : m_chunk_size;
+    n = (n < dst->writer_length()) ? n : dst->writer_length();
+    memcpy(dst->writer_pointer(), m_src.data() + m_pos, n);
+    dst->meta.wi += n;
+    m_pos += n;
+    dst->meta.closed = m_pos >= m_src.size();
+    return std::string();
+  }
+
+ private:
+  const std::string& m_src;
+  size_t m_pos;
+  size_t m_chunk_size;
+};
+
+// ---------------- DecodeImageContext Tests
+
+// test_decode_image_context checks that decoding a sequence of images, of
+// different formats, through one DecodeImageContext (which re-initializes
+// and re-uses each format's decoder) gives the same results as fresh
+// DecodeImage calls. The PNG file's last checksum is corrupted, so the PNG
+// decoder must keep the default IGNORE_CHECKSUM quirk when re-used.
+static const char*  //
+test_decode_image_context() {
+  static const char* filenames[] = {
+      "test/data/hippopotamus.regular.png",
+      "test/data/hippopotamus.jpeg",
+      "test/data/hippopotamus.regular.png",
+      "test/data/hippopotamus.regular.gif",
+      "test/data/hippopotamus.jpeg",
+  };
+  wuffs_aux::DecodeImageContext context;
+  for (const char* filename : filenames) {
+    std::string src;
+    if (!read_file(&src, filename)) {
+      return "could not read file";
+    }
+    // The last 12 bytes are the IEND chunk. The 4 before are a CRC-32.
+    if ((src.size() > 16) && (src.compare(1, 3, "PNG") == 0)) {
+      src[src.size() - 13] ^= 0x01;
+    }
+
+    wuffs_aux::DecodeImageCallbacks fresh_callbacks;
+    wuffs_aux::sync_io::MemoryInput fresh_input(src.data(), src.size());
+    wuffs_aux::DecodeImageResult want =
+        wuffs_aux::DecodeImage(fresh_callbacks, fresh_input);
+
+    wuffs_aux::sync_io::MemoryInput input(src.data(), src.size());
+    wuffs_aux::DecodeImageResult have = wuffs_aux::DecodeImage(context, input);
+
+    if (!want.error_message.empty() || !have.error_message.empty()) {
+      fprintf(stderr, "%s: \"%s\", \"%s\"\n", filename,
+              want.error_message.c_str(), have.error_message.c_str());
+      return "DecodeImage failed";
+    } else if (pixbuf_contents(have.pixbuf) != pixbuf_contents(want.pixbuf)) {
+      fprintf(stderr, "%s\n", filename);
+      return "the pooled and fresh decodes differ";
+    }
+  }
+  return nullptr;
+}
+
+// ---------------- HandleProgress Tests
+
+// ProgressCallbacks counts the HandleProgress calls, and how many of them saw
+// different pixels than the previous call.
+class ProgressCallbacks : public wuffs_aux::DecodeImageCallbacks {
+ public:
+  ProgressCallbacks() : m_num_calls(0), m_num_changes(0) {}
+
+  std::string HandleProgress(const wuffs_base__pixel_buffer& pixbuf,
+                             wuffs_base__rect_ie_u32) override {
+    m_num_calls++;
+    std::string contents = pixbuf_contents(pixbuf);
+    if (m_prev_contents != contents) {
+      m_num_changes++;
+      m_prev_contents.swap(contents);
+    }
+    return std::string();
+  }
+
+  int m_num_calls;
+  int m_num_changes;
+  std::string m_prev_contents;
+};
+
+// test_handle_progress checks that, for the decoders that write partially
+// decoded pixels (see the HandleProgress comment), the pixel buffer changes
+// between HandleProgress calls.
+static const char*  //
+test_handle_progress() {
+  static const char* filenames[] = {
+      "test/data/hippopotamus.interlaced.gif",
+      "test/data/hippopotamus.interlaced.png",
+      "test/data/peacock.progressive.jpeg",
+  };
+  for (const char* filename : filenames) {
+    std::string src;
+    if (!read_file(&src, filename)) {
+      return "could not read file";
+    }
+    ChunkedInput input(src, 256);
+    ProgressCallbacks callbacks;
+    wuffs_aux::DecodeImageResult res = wuffs_aux::DecodeImage(callbacks, input);
+    if (!res.error_message.empty()) {
+      fprintf(stderr, "%s: %s\n", filename, res.error_message.c_str());
+      return "DecodeImage failed";
+    }
+    // The first change is from the zeroed pixbuf to the first partial pixels.
+    // A second change means that the callbacks saw pixels being refined.
+    if (callbacks.m_num_changes < 2) {
+      fprintf(stderr, "%s: calls=%d, changes=%d\n", filename,
+              callbacks.m_num_calls, callbacks.m_num_changes);
+      return "the pixbuf did not change between HandleProgress calls";
+    }
+    // The last HandleProgress call comes before the frame is complete.
+    if (callbacks.m_prev_contents == pixbuf_contents(res.pixbuf)) {
+      fprintf(stderr, "%s\n", filename);
+      return "the final pixbuf was already reported by HandleProgress";
+    }
+  }
+  return nullptr;
+}
+
+// ---------------- CONVERT_TO_SRGB Tests
+
+// SrgbCallbacks decodes to a chosen pixel format and records any ICC profile
+// passed to HandleMetadata, concatenating the chunks.
+class SrgbCallbacks : public wuffs_aux::DecodeImageCallbacks {
+ public:
+  explicit SrgbCallbacks(uint32_t pixfmt) : m_pixfmt(pixfmt) {}
+
+  std::string HandleMetadata(const wuffs_base__more_information& minfo,
+                             wuffs_base__slice_u8 raw) override {
+    if (minfo.metadata__fourcc() == WUFFS_BASE__FOURCC__ICCP) {
+      m_iccp.append(reinterpret_cast<const char*>(raw.ptr), raw.len);
+    }
+    return std::string();
+  }
+
+  wuffs_base__pixel_format SelectPixfmt(
+      const wuffs_base__image_config& image_config) override {
+    return wuffs_base__make_pixel_format(m_pixfmt);
+  }
+
+  uint32_t m_pixfmt;
+  std::string m_iccp;
+};
+
+static const char*  //
+decode_srgb(std::string* dst_pixels,
+            std::string* dst_iccp,
+            const char* filename,
+            uint32_t pixfmt,
+            uint64_t flags) {
+  std::string src;
+  if (!read_file(&src, filename)) {
+    return "could not read file";
+  }
+  SrgbCallbacks callbacks(pixfmt);
+  wuffs_aux::sync_io::MemoryInput input(src.data(), src.size());
+  wuffs_aux::DecodeImageResult res = wuffs_aux::DecodeImage(
+      callbacks, input, wuffs_aux::DecodeImageArgQuirks::DefaultValue(),
+      wuffs_aux::DecodeImageArgFlags(flags));
+  if (!res.error_message.empty()) {
+    fprintf(stderr, "%s: %s\n", filename, res.error_message.c_str());
+    return "DecodeImage failed";
+  }
+  *dst_pixels = pixbuf_contents(res.pixbuf);
+  if (dst_iccp) {
+    dst_iccp->swap(callbacks.m_iccp);
+  }
+  return nullptr;
+}
+
+// test_convert_to_srgb_png_iccp checks a golden value. The PNG's one pixel is
+// (200, 100, 50) in the DCI-P3-D65 color space, which is (208, 74, 0) in sRGB.
+static const char*  //
+test_convert_to_srgb_png_iccp() {
+  static const char* filename = "test/data/artificial-png/dcip3d65-pixel.png";
+  std::string have;
+  const char* status =
+      decode_srgb(&have, nullptr, filename, WUFFS_BASE__PIXEL_FORMAT__RGB,
+                  wuffs_aux::DecodeImageArgFlags::CONVERT_TO_SRGB);
+  if (status) {
+    return status;
+  }
+  static const char want[3] = {'\xD0', '\x4A', '\x00'};
+  if (have != std::string(want, 3)) {
+    fprintf(stderr, "have (%d, %d, %d), want (208, 74, 0)\n",
+            (int)(uint8_t)have[0], (int)(uint8_t)have[1],
+            (int)(uint8_t)have[2]);
+    return "CONVERT_TO_SRGB produced the wrong pixel";
+  }
+
+  // Without the flag, the pixel is unchanged.
+  status = decode_srgb(&have, nullptr, filename, WUFFS_BASE__PIXEL_FORMAT__RGB,
+                       0);
+  if (status) {
+    return status;
+  } else if (have != "\xC8\x64\x32") {
+    return "the unconverted pixel was not (200, 100, 50)";
+  }
+  return nullptr;
+}
+
+// test_convert_to_srgb_jpeg_iccp checks that a JPEG's ICC profile, split over
+// two APP2 segments, is reported whole and is applied just like the same
+// profile in a PNG's iCCP chunk.
+static const char*  //
+test_convert_to_srgb_jpeg_iccp() {
+  std::string png_pixels;
+  std::string png_iccp;
+  const char* status = decode_srgb(
+      &png_pixels, &png_iccp, "test/data/artificial-png/dcip3d65-pixel.png",
+      WUFFS_BASE__PIXEL_FORMAT__RGB,
+      wuffs_aux::DecodeImageArgFlags::REPORT_METADATA_ICCP);
+  if (status) {
+    return status;
+  }
+
+  std::string plain_pixels;
+  status = decode_srgb(&plain_pixels, nullptr, "test/data/hippopotamus.jpeg",
+                       WUFFS_BASE__PIXEL_FORMAT__RGB, 0);
+  if (status) {
+    return status;
+  }
+  std::string have_pixels;
+  std::string have_iccp;
+  status = decode_srgb(
+      &have_pixels, &have_iccp,
+      "test/data/artificial-jpeg/hippopotamus-iccp.jpeg",
+      WUFFS_BASE__PIXEL_FORMAT__RGB,
+      wuffs_aux::DecodeImageArgFlags::REPORT_METADATA_ICCP |
+          wuffs_aux::DecodeImageArgFlags::CONVERT_TO_SRGB);
+  if (status) {
+    return status;
+  } else if (have_iccp.size() != 604) {
+    fprintf(stderr, "have %zu bytes, want 604\n", have_iccp.size());
+    return "the ICC profile has the wrong length";
+  } else if (have_iccp != png_iccp) {
+    return "the JPEG and PNG ICC profiles differ";
+  } else if (have_pixels.size() != plain_pixels.size()) {
+    return "the converted and unconverted pixels have different sizes";
+  } else if (have_pixels == plain_pixels) {
+    return "CONVERT_TO_SRGB did not change the pixels";
+  }
+  return nullptr;
+}
+
+// ---------------- Resize Tests
+
+// decode_resized decodes filename to pixfmt and then box-filters it down to
+// 1x1, returning the one resulting pixel's bytes.
+static const char*  //
+decode_resized(std::string* dst_pixels,
+               wuffs_aux::DecodeImageCallbacks& callbacks,
+               const char* filename) {
+  std::string src;
+  if (!read_file(&src, filename)) {
+    return "could not read file";
+  }
+  wuffs_aux::sync_io::MemoryInput input(src.data(), src.size());
+  wuffs_aux::DecodeImageResult res = wuffs_aux::DecodeImage(
+      callbacks, input, wuffs_aux::DecodeImageArgQuirks::DefaultValue(),
+      wuffs_aux::DecodeImageArgFlags::DefaultValue(),
+      wuffs_aux::DecodeImageArgPixelBlend::DefaultValue(),
+      wuffs_aux::DecodeImageArgBackgroundColor::DefaultValue(),
+      wuffs_aux::DecodeImageArgMaxInclDimension::DefaultValue(),
+      wuffs_aux::DecodeImageArgMaxInclMetadataLength::DefaultValue(),
+      wuffs_aux::DecodeImageArgResize(
+          1, 1, wuffs_aux::DecodeImageArgResize::FILTER_BOX));
+  if (!res.error_message.empty()) {
+    *dst_pixels = res.error_message;
+    return "DecodeImage failed";
+  } else if ((res.pixbuf.pixcfg.width() != 1) ||
+             (res.pixbuf.pixcfg.height() != 1)) {
+    return "the resized pixbuf was not 1x1";
+  }
+  *dst_pixels = pixbuf_contents(res.pixbuf);
+  return nullptr;
+}
+
+// test_resize_box_2x2 checks golden values for box filtering 2x2 images down
+// to 1x1, which averages the four pixels. For non-premultiplied alpha, the
+// colors are weighted by alpha, so the fully transparent (white) pixel does
+// not lighten the result.
+static const char*  //
+test_resize_box_2x2() {
+  static const struct {
+    const char* filename;
+    uint32_t pixfmt;
+    const char* want;
+    size_t want_len;
+  } test_cases[] = {
+      // (0x00 + 0x40 + 0x80 + 0xFF) / 4 = 0x6F.C0.
+      {"test/data/artificial-png/2x2-gray.png", WUFFS_BASE__PIXEL_FORMAT__Y,
+       "\x70", 1},
+      // The transparent pixel is composited over black.
+      {"test/data/artificial-png/2x2-rgba.png", WUFFS_BASE__PIXEL_FORMAT__RGB,
+       "\x0C\x3C\x6C", 3},
+      // The colors average the three opaque pixels. Alpha is 3/4 of 0xFFFF.
+      {"test/data/artificial-png/2x2-rgba.png",
+       WUFFS_BASE__PIXEL_FORMAT__BGRA_NONPREMUL_4X16LE,
+       "\x90\x90\x50\x50\x10\x10\xFF\xBF", 8},
+  };
+  for (const auto& tc : test_cases) {
+    SrgbCallbacks callbacks(tc.pixfmt);
+    std::string have;
+    const char* status = decode_resized(&have, callbacks, tc.filename);
+    if (status) {
+      fprintf(stderr, "%s: %s\n", tc.filename, have.c_str());
+      return status;
+    } else if (have != std::string(tc.want, tc.want_len)) {
+      fprintf(stderr, "%s, pixfmt 0x%08X: have", tc.filename, tc.pixfmt);
+      for (char c : have) {
+        fprintf(stderr, " %02X", (int)(uint8_t)c);
+      }
+      fprintf(stderr, "\n");
+      return "the resized pixel was wrong";
+    }
+  }
+  return nullptr;
+}
+
+// FixedPixbufCallbacks' AllocPixbuf always returns the same memory.
+class FixedPixbufCallbacks : public wuffs_aux::DecodeImageCallbacks {
+ public:
+  AllocPixbufResult AllocPixbuf(const wuffs_base__image_config& image_config,
+                                bool allow_uninitialized_memory) override {
+    wuffs_base__pixel_buffer pixbuf;
+    wuffs_base__status status = pixbuf.set_from_slice(
+        &image_config.pixcfg,
+        wuffs_base__make_slice_u8(m_memory, sizeof(m_memory)));
+    if (!status.is_ok()) {
+      return AllocPixbufResult(status.message());
+    }
+    return AllocPixbufResult(wuffs_aux::MemOwner(nullptr, &free), pixbuf);
+  }
+
+  uint8_t m_memory[1024];
+};
+
+// test_resize_aliased_pixbuf checks that resizing into the same memory that
+// holds the full size image fails cleanly.
+static const char*  //
+test_resize_aliased_pixbuf() {
+  FixedPixbufCallbacks callbacks;
+  std::string have;
+  const char* status = decode_resized(
+      &have, callbacks, "test/data/artificial-png/2x2-rgba.png");
+  if (!status) {
+    return "DecodeImage succeeded";
+  } else if (have != wuffs_aux::DecodeImage_UnsupportedPixelConfiguration) {
+    fprintf(stderr, "have \"%s\"\n", have.c_str());
+    return "DecodeImage failed with the wrong error";
+  }
+  return nullptr;
+}
+
+// ----------------
+
+static const struct {
+  const char* name;
+  const char* (*func)();
+} g_tests[] = {
+    {"test_convert_to_srgb_jpeg_iccp", test_convert_to_srgb_jpeg_iccp},
+    {"test_convert_to_srgb_png_iccp", test_convert_to_srgb_png_iccp},
+    {"test_decode_image_context", test_decode_image_context},
+    {"test_handle_progress", test_handle_progress},
+    {"test_resize_aliased_pixbuf", test_resize_aliased_pixbuf},
+    {"test_resize_box_2x2", test_resize_box_2x2},
+};
+
+int  //
+main(int argc, char** argv) {
+  int num_failures = 0;
+  for (const auto& test : g_tests) {
+    const char* error_message = test.func();
+    if (error_message) {
+      fprintf(stderr, "FAIL %s: %s\n", test.name, error_message);
+      num_failures++;
+    }
+  }
+  if (num_failures) {
+    fprintf(stderr, "%d failure(s)\n", num_failures);
+    return 1;
+  }
+  printf("PASS (%zu tests)\n", sizeof(g_tests) / sizeof(g_tests[0]));
+  return 0;
+}
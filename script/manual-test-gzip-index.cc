@@ -0,0 +1,348 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+// manual-test-gzip-index tests the wuffs_aux::GzipIndex and
+// wuffs_aux::GzipReader classes: building an index of a multi-member gzip
+// file, its Save and Load round trip and random access reads. The
+// test/c/std/deflate.c program cannot do this, as it is C and those classes
+// are C++.
+//
+// To run it, from the repository's root directory:
+//
+// g++ -O3 script/manual-test-gzip-index.cc && ./a.out
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__STATIC_FUNCTIONS macro is optional, but when
+// combined with WUFFS_IMPLEMENTATION, it demonstrates making all of Wuffs'
+// functions have static storage.
+//
+// This can help the compiler ignore or discard unused code, which can produce
+// faster compiles and smaller binaries. Other motivations are discussed in the
+// "ALLOW STATIC IMPLEMENTATION" section of
+// https://raw.githubusercontent.com/nothings/stb/master/docs/stb_howto.txt
+#define WUFFS_CONFIG__STATIC_FUNCTIONS
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__GZIP
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__CRC32
+#define WUFFS_CONFIG__MODULE__DEFLATE
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C++ file.
+#include "../release/c/wuffs-unsupported-snapshot.c"
+
+// ----
+
+static int g_num_failures;
+
+// ----
+
+static bool  //
+read_file(std::string* dst, const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (!f) {
+    return false;
+  }
+  dst->clear();
+  char buf[4096];
+  while (true) {
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    dst->append(buf, n);
+    if (n < sizeof(buf)) {
+      break;
+    }
+  }
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+static void  //
+fail(const char* name, const std::string& what) {
+  g_num_failures++;
+  fprintf(stderr, "FAIL %s: %s\n", name, what.c_str());
+}
+
+static std::string  //
+file_contents(const char* filename) {
+  std::string s;
+  if (!read_file(&s, filename)) {
+    fail(filename, "could not read file");
+  }
+  return s;
+}
+
+// ChunkedInput is a sync_io::Input that hands out its source a few bytes at a
+// time and does not bring its own IOBuffer, so that GzipIndex::Build sees
+// gzip headers, footers and padding that cross its I/O buffer's boundaries.
+class ChunkedInput : public wuffs_aux::sync_io::Input {
+ public:
+  ChunkedInput(const std::string& src, size_t chunk_size)
+      : m_src(src), m_pos(0), m_chunk_size(chunk_size) {}
+
+  std::string CopyIn(wuffs_aux::IOBuffer* dst) override {
+    dst->compact();
+    size_t n = m_src.size() - m_pos;
+    n = (n < m_chunk_size) ? n : m_chunk_size;
+    n = (n < dst->writer_length()) ? n : dst->writer_length();
+    memcpy(dst->writer_pointer(), m_src.data() + m_pos, n);
+    dst->meta.wi += n;
+    m_pos += n;
+    dst->meta.closed = m_pos >= m_src.size();
+    return std::string();
+  }
+
+ private:
+  const std::string& m_src;
+  size_t m_pos;
+  size_t m_chunk_size;
+};
+
+static const uint8_t*  //
+as_u8(const std::string& s) {
+  return reinterpret_cast<const uint8_t*>(s.data());
+}
+
+// save serializes index into *dst.
+static std::string  //
+save(std::string* dst, const wuffs_aux::GzipIndex& index) {
+  static uint8_t buf[1024 * 1024];
+  wuffs_aux::sync_io::MemoryOutput output(buf, sizeof buf);
+  std::string error_message = index.Save(output);
+  if (!error_message.empty()) {
+    return error_message;
+  }
+  wuffs_base__slice_u8 s = output.BringsItsOwnIOBuffer()->reader_slice();
+  dst->assign(reinterpret_cast<const char*>(s.ptr), s.len);
+  return "";
+}
+
+// ----
+
+// The multi-member gzip file is four test/data .gz files concatenated, the
+// same as "cat a.gz b.gz c.gz d.gz". Its decompressed contents are the four
+// original files concatenated.
+static const char* g_members[4][2] = {
+    {"test/data/midsummer.txt.gz", "test/data/midsummer.txt"},
+    {"test/data/pi.txt.gz", "test/data/pi.txt"},
+    {"test/data/romeo.txt.gz", "test/data/romeo.txt"},
+    {"test/data/256.bytes.gz", "test/data/256.bytes"},
+};
+
+// A small span gives checkpoints other than at the start, so that ReadAt
+// resumes from the middle of the file.
+static const uint64_t g_span = 4096;
+
+// check_read_at makes random access reads of the gzip file, via a GzipReader,
+// and compares them to want.
+static void  //
+check_read_at(const char* name,
+              const wuffs_aux::GzipIndex& index,
+              const std::string& gz,
+              const std::string& want) {
+  wuffs_aux::GzipReader reader(index, as_u8(gz), gz.size());
+  std::string have(want.size() + 100, '\x00');
+  uint8_t* dst = reinterpret_cast<uint8_t*>(&have[0]);
+
+  // A 32-bit LCG (the same constants as Numerical Recipes) is enough to pick
+  // offsets and lengths, some of which run past the end or read nothing.
+  uint32_t rng = 1;
+  for (int i = 0; i < 1000; i++) {
+    rng = (rng * 1664525) + 1013904223;
+    uint64_t offset = (rng >> 8) % (want.size() + 100);
+    rng = (rng * 1664525) + 1013904223;
+    size_t len = (rng >> 8) % ((i & 1) ? 100 : have.size());
+    if (i == 0) {
+      offset = 0;
+      len = want.size();
+    }
+
+    size_t want_n = 0;
+    if (offset < want.size()) {
+      want_n = want.size() - offset;
+      want_n = (want_n < len) ? want_n : len;
+    }
+    wuffs_aux::GzipReadAtResult result = reader.ReadAt(dst, len, offset);
+    if (!result.error_message.empty()) {
+      fail(name, "ReadAt: " + result.error_message);
+      return;
+    } else if (result.num_bytes != want_n) {
+      fail(name, "ReadAt(len=" + std::to_string(len) + ", offset=" +
+                     std::to_string(offset) + "): have " +
+                     std::to_string(result.num_bytes) + " bytes, want " +
+                     std::to_string(want_n));
+      return;
+    } else if (memcmp(dst, want.data() + offset, want_n)) {
+      fail(name, "ReadAt(len=" + std::to_string(len) + ", offset=" +
+                     std::to_string(offset) + "): contents mismatch");
+      return;
+    }
+  }
+}
+
+static void  //
+test_multi_member(const char* name, const std::string& suffix) {
+  std::string gz;
+  std::string want;
+  for (auto& m : g_members) {
+    gz += file_contents(m[0]);
+    want += file_contents(m[1]);
+  }
+  gz += suffix;
+
+  // Build the index twice: once from memory and once via small chunks.
+  wuffs_aux::GzipIndex index;
+  wuffs_aux::sync_io::MemoryInput input(gz.data(), gz.size());
+  std::string error_message = index.Build(input, g_span);
+  if (!error_message.empty()) {
+    fail(name, "Build: " + error_message);
+    return;
+  } else if (index.CompressedSize() != gz.size()) {
+    fail(name, "CompressedSize: have " + std::to_string(index.CompressedSize()) +
+                   ", want " + std::to_string(gz.size()));
+    return;
+  } else if (index.DecompressedSize() != want.size()) {
+    fail(name, "DecompressedSize: have " +
+                   std::to_string(index.DecompressedSize()) + ", want " +
+                   std::to_string(want.size()));
+    return;
+  } else if (index.Checkpoints().size() < 2) {
+    fail(name, "too few checkpoints: " +
+                   std::to_string(index.Checkpoints().size()));
+    return;
+  }
+
+  std::string saved;
+  error_message = save(&saved, index);
+  if (!error_message.empty()) {
+    fail(name, "Save: " + error_message);
+    return;
+  }
+
+  for (size_t chunk_size : {1, 7, 4096}) {
+    wuffs_aux::GzipIndex chunked_index;
+    ChunkedInput chunked_input(gz, chunk_size);
+    std::string chunked_saved;
+    error_message = chunked_index.Build(chunked_input, g_span);
+    if (error_message.empty()) {
+      error_message = save(&chunked_saved, chunked_index);
+    }
+    if (!error_message.empty()) {
+      fail(name, "chunked Build: " + error_message);
+      return;
+    } else if (chunked_saved != saved) {
+      fail(name, "chunked Build: index mismatch (chunk_size=" +
+                     std::to_string(chunk_size) + ")");
+      return;
+    }
+  }
+
+  // Load what was saved and check that it round-trips.
+  wuffs_aux::GzipIndex loaded;
+  std::string resaved;
+  error_message = loaded.Load(as_u8(saved), saved.size());
+  if (error_message.empty()) {
+    error_message = save(&resaved, loaded);
+  }
+  if (!error_message.empty()) {
+    fail(name, "Load: " + error_message);
+    return;
+  } else if (resaved != saved) {
+    fail(name, "Load: index mismatch");
+    return;
+  }
+
+  // Corrupting the saved index should fail its checksum.
+  std::string corrupted = saved;
+  corrupted[corrupted.size() / 2] ^= 0x01;
+  wuffs_aux::GzipIndex rejected;
+  if (rejected.Load(as_u8(corrupted), corrupted.size()).empty()) {
+    fail(name, "Load: have ok for a corrupted index, want an error");
+    return;
+  }
+
+  check_read_at(name, index, gz, want);
+  check_read_at(name, loaded, gz, want);
+}
+
+static void  //
+test_trailing_garbage() {
+  const char* name = "test_trailing_garbage";
+  std::string gz = file_contents("test/data/romeo.txt.gz") +
+                   file_contents("test/data/pi.txt.gz");
+  static const char* suffixes[3] = {
+      "junk",
+      "\x00\x00\x00junk",
+      "\x1F\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+  };
+  static const char* want_error_messages[3] = {
+      "wuffs_aux::GzipIndex: trailing garbage",
+      "wuffs_aux::GzipIndex: trailing garbage",
+      "wuffs_aux::GzipIndex: bad gzip header",
+  };
+  static const size_t suffix_lengths[3] = {4, 7, 10};
+  for (int i = 0; i < 3; i++) {
+    std::string src = gz + std::string(suffixes[i], suffix_lengths[i]);
+    for (size_t chunk_size : {1, 4096}) {
+      wuffs_aux::GzipIndex index;
+      ChunkedInput input(src, chunk_size);
+      std::string error_message = index.Build(input, g_span);
+      if (error_message != want_error_messages[i]) {
+        fail(name, "suffix #" + std::to_string(i) + ": have \"" +
+                       error_message + "\", want \"" +
+                       want_error_messages[i] + "\"");
+      }
+    }
+  }
+}
+
+// ----
+
+int  //
+main(int argc, char** argv) {
+  test_multi_member("test_multi_member", "");
+  // Zero padding, such as a tape archive's block size adds, is ignored,
+  // whether shorter or longer than a gzip header.
+  test_multi_member("test_multi_member_nul_padding_5", std::string(5, '\x00'));
+  test_multi_member("test_multi_member_nul_padding_10000",
+                    std::string(10000, '\x00'));
+  test_trailing_garbage();
+
+  if (g_num_failures) {
+    fprintf(stderr, "%d failure(s)\n", g_num_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
@@ -0,0 +1,427 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+// manual-test-transcode-json-cbor tests the wuffs_aux::TranscodeJsonToCbor and
+// wuffs_aux::TranscodeCborToJson functions against golden output, in both
+// directions. The test/c/std/json.c and test/c/std/cbor.c programs cannot do
+// this, as they are C and the transcoders are C++.
+//
+// To run it, from the repository's root directory:
+//
+// g++ -O3 script/manual-test-transcode-json-cbor.cc && ./a.out
+//
+// Passing "-bench" instead measures the transcoders' throughput, on the same
+// test/data files as the test/c/std/json.c decode benchmarks.
+// Passing "-reps=N" (default 5) sets how many times each one is repeated.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__STATIC_FUNCTIONS macro is optional, but when
+// combined with WUFFS_IMPLEMENTATION, it demonstrates making all of Wuffs'
+// functions have static storage.
+//
+// This can help the compiler ignore or discard unused code, which can produce
+// faster compiles and smaller binaries. Other motivations are discussed in the
+// "ALLOW STATIC IMPLEMENTATION" section of
+// https://raw.githubusercontent.com/nothings/stb/master/docs/stb_howto.txt
+#define WUFFS_CONFIG__STATIC_FUNCTIONS
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__AUX__BASE
+#define WUFFS_CONFIG__MODULE__AUX__CBOR
+#define WUFFS_CONFIG__MODULE__AUX__JSON
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__CBOR
+#define WUFFS_CONFIG__MODULE__JSON
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C++ file.
+#include "../release/c/wuffs-unsupported-snapshot.c"
+
+// ----
+
+#ifndef DST_BUFFER_ARRAY_SIZE
+#define DST_BUFFER_ARRAY_SIZE (64 * 1024 * 1024)
+#endif
+
+uint8_t g_dst_buffer_array[DST_BUFFER_ARRAY_SIZE] = {0};
+
+static int g_num_failures;
+
+// ----
+
+static bool  //
+read_file(std::string* dst, const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (!f) {
+    return false;
+  }
+  dst->clear();
+  char buf[4096];
+  while (true) {
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    dst->append(buf, n);
+    if (n < sizeof(buf)) {
+      break;
+    }
+  }
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+// transcode runs one of the two transcoders, from src into the global
+// g_dst_buffer_array. On success, it sets *dst to the transcoded bytes.
+static std::string  //
+transcode(std::string* dst,
+          const std::string& src,
+          bool json_to_cbor,
+          const char* indent = "") {
+  wuffs_aux::sync_io::MemoryInput input(src.data(), src.size());
+  wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                          DST_BUFFER_ARRAY_SIZE);
+  std::string error_message =
+      json_to_cbor
+          ? wuffs_aux::TranscodeJsonToCbor(output, input).error_message
+          : wuffs_aux::TranscodeCborToJson(
+                output, input, wuffs_aux::DecodeCborArgQuirks::DefaultValue(),
+                wuffs_aux::JsonWriterArgIndent(indent))
+                .error_message;
+  if (!error_message.empty()) {
+    return error_message;
+  }
+  wuffs_base__slice_u8 s = output.BringsItsOwnIOBuffer()->reader_slice();
+  dst->assign(reinterpret_cast<const char*>(s.ptr), s.len);
+  return "";
+}
+
+static void  //
+fail(const char* name, const char* what, const std::string& have) {
+  g_num_failures++;
+  fprintf(stderr, "FAIL %s: %s", name, what);
+  for (size_t i = 0; (i < have.size()) && (i < 64); i++) {
+    fprintf(stderr, " %02X", static_cast<uint8_t>(have[i]));
+  }
+  fprintf(stderr, "%s\n", (have.size() > 64) ? " ..." : "");
+}
+
+static void  //
+check(const char* name,
+      const std::string& src,
+      const std::string& want,
+      bool json_to_cbor,
+      const char* indent = "") {
+  std::string have;
+  std::string error_message = transcode(&have, src, json_to_cbor, indent);
+  if (!error_message.empty()) {
+    fail(name, error_message.c_str(), "");
+  } else if (have != want) {
+    fail(name, "output mismatch; have", have);
+  }
+}
+
+static void  //
+check_error(const char* name, const std::string& src, bool json_to_cbor) {
+  std::string have;
+  if (transcode(&have, src, json_to_cbor).empty()) {
+    fail(name, "have ok, want an error; have", have);
+  }
+}
+
+static std::string  //
+file_contents(const char* filename) {
+  std::string s;
+  if (!read_file(&s, filename)) {
+    g_num_failures++;
+    fprintf(stderr, "FAIL: could not read %s\n", filename);
+  }
+  return s;
+}
+
+// ChunkedInput is a sync_io::Input that hands out its source a few bytes at a
+// time and does not bring its own IOBuffer, so that TranscodeJsonToCbor sees
+// strings that cross its (4 KiB) I/O buffer's boundaries.
+class ChunkedInput : public wuffs_aux::sync_io::Input {
+ public:
+  ChunkedInput(const std::string& src, size_t chunk_size)
+      : m_src(src), m_pos(0), m_chunk_size(chunk_size) {}
+
+  std::string CopyIn(wuffs_aux::IOBuffer* dst) override {
+    dst->compact();
+    size_t n = m_src.size() - m_pos;
+    n = (n < m_chunk_size) ? n : m_chunk_size;
+    n = (n < dst->writer_length()) ? n : dst->writer_length();
+    memcpy(dst->writer_pointer(), m_src.data() + m_pos, n);
+    dst->meta.wi += n;
+    m_pos += n;
+    dst->meta.closed = m_pos >= m_src.size();
+    return std::string();
+  }
+
+ private:
+  const std::string& m_src;
+  size_t m_pos;
+  size_t m_chunk_size;
+};
+
+// ----
+
+// The CBOR bytes are as per RFC 8949. TranscodeJsonToCbor writes arrays (0x9F
+// ... 0xFF) and maps (0xBF ... 0xFF) with indefinite length.
+#define CBOR(s) std::string(s, sizeof(s) - 1)
+
+static void  //
+test_json_to_cbor() {
+  static const struct {
+    const char* json;
+    std::string cbor;
+  } test_cases[] = {
+      {"0", CBOR("\x00")},
+      {"23", CBOR("\x17")},
+      {"24", CBOR("\x18\x18")},
+      {"-1000", CBOR("\x39\x03\xE7")},
+      {"1000000", CBOR("\x1A\x00\x0F\x42\x40")},
+      {"1.5", CBOR("\xF9\x3E\x00")},
+      {"-4.1", CBOR("\xFB\xC0\x10\x66\x66\x66\x66\x66\x66")},
+      {"true", CBOR("\xF5")},
+      {"null", CBOR("\xF6")},
+      {"\"\"", CBOR("\x60")},
+      {"\"\\u00fc\\ud800\\udd51\"", CBOR("\x66\xC3\xBC\xF0\x90\x85\x91")},
+      {"[]", CBOR("\x9F\xFF")},
+      {"{}", CBOR("\xBF\xFF")},
+      {" {\"a\": [1, -2, true, null, \"xy\"]} ",
+       CBOR("\xBF\x61\x61\x9F\x01\x21\xF5\xF6\x62xy\xFF\xFF")},
+  };
+
+  for (size_t i = 0; i < (sizeof(test_cases) / sizeof(test_cases[0])); i++) {
+    check(test_cases[i].json, test_cases[i].json, test_cases[i].cbor, true);
+  }
+
+  // The formatted and unformatted JSON hold the same values.
+  std::string want = file_contents("test/data/json-things.cbor");
+  check("json-things.unformatted.json",
+        file_contents("test/data/json-things.unformatted.json"), want, true);
+  check("json-things.formatted.json",
+        file_contents("test/data/json-things.formatted.json"), want, true);
+
+  check_error("truncated JSON", "[1,", true);
+  check_error("invalid JSON", "{1:2}", true);
+}
+
+static void  //
+test_cbor_to_json() {
+  static const struct {
+    std::string cbor;
+    const char* json;
+  } test_cases[] = {
+      {CBOR("\x00"), "0"},
+      {CBOR("\x39\x03\xE7"), "-1000"},
+      {CBOR("\xF9\x3E\x00"), "1.5"},
+      {CBOR("\xF9\x80\x00"), "-0"},
+      {CBOR("\xF7"), "null"},
+      {CBOR("\x83\x01\x02\x03"), "[1,2,3]"},
+      {CBOR("\x9F\x01\x82\x02\x03\xFF"), "[1,[2,3]]"},
+      {CBOR("\xA2\x61\x61\x01\x61\x62\x82\x02\x03"), "{\"a\":1,\"b\":[2,3]}"},
+      {CBOR("\xA1\x01\x02"), "{\"1\":2}"},
+      {CBOR("\x44\x01\x02\x03\x04"), "\"AQIDBA\""},
+      {CBOR("\x7F\x65strea\x64ming\xFF"), "\"streaming\""},
+      {CBOR("\x62\"\\"), "\"\\\"\\\\\""},
+      {CBOR("\xC1\x1A\x51\x4B\x67\xB0"), "1363896240"},
+  };
+
+  for (size_t i = 0; i < (sizeof(test_cases) / sizeof(test_cases[0])); i++) {
+    check(test_cases[i].json, test_cases[i].cbor, test_cases[i].json, false);
+  }
+
+  std::string src = file_contents("test/data/json-things.cbor");
+  check("json-things.cbor", src,
+        "{\"k0\":[42,[false,true]],\"k1\":2.3456e+09,\"k\xE4\xBA\x8C\":null,"
+        "\"k\xC2\xB3\":\"\\t\\\\\\n\\n\"}",
+        false);
+  check("json-things.cbor (indented)", src,
+        "{\n"
+        "    \"k0\": [\n"
+        "        42,\n"
+        "        [\n"
+        "            false,\n"
+        "            true\n"
+        "        ]\n"
+        "    ],\n"
+        "    \"k1\": 2.3456e+09,\n"
+        "    \"k\xE4\xBA\x8C\": null,\n"
+        "    \"k\xC2\xB3\": \"\\t\\\\\\n\\n\"\n"
+        "}",
+        false, "    ");
+
+  check_error("truncated CBOR", CBOR("\x83\x01\x02"), false);
+  check_error("non-string map key", CBOR("\xA1\xF5\x01"), false);
+}
+
+// test_json_to_cbor_long_string checks that a JSON string longer than the I/O
+// buffer is still written as a single definite length CBOR text string, and
+// that the output does not depend on how the input arrives.
+static void  //
+test_json_to_cbor_long_string() {
+  // Each "x\u00e9" is 7 bytes of JSON and 3 bytes ('x', 0xC3, 0xA9) of UTF-8.
+  std::string json = "[\"";
+  std::string cbor = CBOR("\x9F\x79\x23\x28");  // 0x2328 = 9000 bytes.
+  for (int i = 0; i < 3000; i++) {
+    json += "x\\u00e9";
+    cbor += "x\xC3\xA9";
+  }
+  json += "\"]";
+  cbor += CBOR("\xFF");
+
+  check("long string (MemoryInput)", json, cbor, true);
+
+  for (size_t chunk_size : {1000, 4095, 4096, 5000}) {
+    ChunkedInput input(json, chunk_size);
+    wuffs_aux::sync_io::MemoryOutput output(g_dst_buffer_array,
+                                            DST_BUFFER_ARRAY_SIZE);
+    std::string error_message =
+        wuffs_aux::TranscodeJsonToCbor(output, input).error_message;
+    if (!error_message.empty()) {
+      fail("long string (ChunkedInput)", error_message.c_str(), "");
+      continue;
+    }
+    wuffs_base__slice_u8 have = output.BringsItsOwnIOBuffer()->reader_slice();
+    if (std::string(reinterpret_cast<const char*>(have.ptr), have.len) !=
+        cbor) {
+      fprintf(stderr, "chunk_size=%zu\n", chunk_size);
+      fail("long string (ChunkedInput)", "output mismatch; have",
+           std::string(reinterpret_cast<const char*>(have.ptr), have.len));
+    }
+  }
+}
+
+// test_round_trip checks that JSON to CBOR to JSON to CBOR is stable: the two
+// CBOR outputs are identical.
+static void  //
+test_round_trip(const char* filename) {
+  std::string json = file_contents(filename);
+  std::string cbor0;
+  std::string json1;
+  std::string cbor1;
+  std::string error_message = transcode(&cbor0, json, true);
+  if (error_message.empty()) {
+    error_message = transcode(&json1, cbor0, false);
+  }
+  if (error_message.empty()) {
+    error_message = transcode(&cbor1, json1, true);
+  }
+  if (!error_message.empty()) {
+    fail(filename, error_message.c_str(), "");
+  } else if (cbor0 != cbor1) {
+    fail(filename, "round trip mismatch; have", cbor1);
+  }
+}
+
+// ----
+
+static void  //
+bench(const char* filename, int reps) {
+  std::string src = file_contents(filename);
+  std::string cbor;
+  std::string dst;
+  std::string error_message = transcode(&cbor, src, true);
+  if (!error_message.empty()) {
+    fail(filename, error_message.c_str(), "");
+    return;
+  }
+
+  for (int json_to_cbor = 1; json_to_cbor >= 0; json_to_cbor--) {
+    const std::string& s = json_to_cbor ? src : cbor;
+    int64_t iters = 0;
+    double elapsed = 0;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    // Run for at least a tenth of a second, so that small files' timings
+    // aren't dominated by clock resolution.
+    for (; (iters < reps) || (elapsed < 0.1); iters++) {
+      error_message = transcode(&dst, s, json_to_cbor);
+      if (!error_message.empty()) {
+        fail(filename, error_message.c_str(), "");
+        return;
+      }
+      struct timespec t1;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      elapsed = (t1.tv_sec - t0.tv_sec) + (1e-9 * (t1.tv_nsec - t0.tv_nsec));
+    }
+    printf("%-12s %-44s %8.2f MB/s  (%" PRIi64 " x %zu bytes)\n",
+           json_to_cbor ? "json_to_cbor" : "cbor_to_json", filename,
+           (1e-6 * iters * s.size()) / elapsed, iters, s.size());
+  }
+}
+
+int  //
+main(int argc, char** argv) {
+  bool do_bench = false;
+  int reps = 5;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-bench")) {
+      do_bench = true;
+    } else if (!strncmp(argv[i], "-reps=", 6)) {
+      reps = atoi(argv[i] + 6);
+    } else {
+      fprintf(stderr, "main: unrecognized flag %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (do_bench) {
+    bench("test/data/github-tags.json", reps);
+    bench("test/data/file-sizes.json", reps);
+    bench("test/data/australian-abc-local-stations.json", reps);
+    bench("test/data/nobel-prizes.json", reps);
+  } else {
+    test_json_to_cbor();
+    test_json_to_cbor_long_string();
+    test_cbor_to_json();
+    test_round_trip("test/data/australian-abc-local-stations.json");
+    test_round_trip("test/data/file-sizes.json");
+    test_round_trip("test/data/github-tags.json");
+    test_round_trip("test/data/json-things.unformatted.json");
+    test_round_trip("test/data/nobel-prizes.json");
+    test_round_trip("test/data/rfc-6901-json-pointer.json");
+  }
+
+  if (g_num_failures) {
+    fprintf(stderr, "%d failure(s)\n", g_num_failures);
+    return 1;
+  }
+  if (!do_bench) {
+    printf("PASS\n");
+  }
+  return 0;
+}
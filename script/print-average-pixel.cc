@@ -125,7 +125,7 @@ class MyCallbacks : public wuffs_aux::DecodeImageCallbacks {
 void  //
 handle(const char* filename, FILE* f) {
   MyCallbacks callbacks;
-  wuffs_aux::sync_io::FileInput input(f);
+  wuffs_aux::sync_io::MmapFileInput input(f);
   wuffs_aux::DecodeImageResult res = wuffs_aux::DecodeImage(callbacks, input);
   if (!res.error_message.empty()) {
     printf("%-30s %s\n", filename, res.error_message.c_str());
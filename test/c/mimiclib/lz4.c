@@ -0,0 +1,50 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+#include "lz4frame.h"
+
+const char*  //
+mimic_lz4_decode(wuffs_base__io_buffer* dst,
+                 wuffs_base__io_buffer* src,
+                 uint32_t wuffs_initialize_flags,
+                 uint64_t wlimit,
+                 uint64_t rlimit) {
+  if ((wlimit < UINT64_MAX) || (rlimit < UINT64_MAX)) {
+    // It's simpler if we only assume one-shot decompression.
+    return "unsupported I/O limit";
+  }
+  LZ4F_dctx* dctx = NULL;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) {
+    return "liblz4: LZ4F_createDecompressionContext failed";
+  }
+
+  const char* ret = NULL;
+  while (true) {
+    size_t dlen = wuffs_base__io_buffer__writer_length(dst);
+    size_t slen = wuffs_base__io_buffer__reader_length(src);
+    size_t hint = LZ4F_decompress(
+        dctx, wuffs_base__io_buffer__writer_pointer(dst), &dlen,
+        wuffs_base__io_buffer__reader_pointer(src), &slen, NULL);
+    dst->meta.wi += dlen;
+    src->meta.ri += slen;
+    if (LZ4F_isError(hint)) {
+      ret = "liblz4: LZ4F_decompress failed";
+      break;
+    } else if ((hint == 0) && (wuffs_base__io_buffer__reader_length(src) == 0)) {
+      break;
+    } else if ((dlen == 0) && (slen == 0)) {
+      ret = "liblz4: LZ4F_decompress made no progress";
+      break;
+    }
+  }
+
+  LZ4F_freeDecompressionContext(dctx);
+  return ret;
+}
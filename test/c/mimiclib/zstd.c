@@ -0,0 +1,56 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+#include "zstd.h"
+
+const char*  //
+mimic_zstd_decode(wuffs_base__io_buffer* dst,
+                  wuffs_base__io_buffer* src,
+                  uint32_t wuffs_initialize_flags,
+                  uint64_t wlimit,
+                  uint64_t rlimit) {
+  if ((wlimit < UINT64_MAX) || (rlimit < UINT64_MAX)) {
+    // It's simpler if we only assume one-shot decompression.
+    return "unsupported I/O limit";
+  }
+  ZSTD_DStream* dstream = ZSTD_createDStream();
+  if (!dstream) {
+    return "libzstd: ZSTD_createDStream failed";
+  }
+
+  const char* ret = NULL;
+  while (true) {
+    ZSTD_outBuffer out = {
+        .dst = wuffs_base__io_buffer__writer_pointer(dst),
+        .size = wuffs_base__io_buffer__writer_length(dst),
+        .pos = 0,
+    };
+    ZSTD_inBuffer in = {
+        .src = wuffs_base__io_buffer__reader_pointer(src),
+        .size = wuffs_base__io_buffer__reader_length(src),
+        .pos = 0,
+    };
+    size_t hint = ZSTD_decompressStream(dstream, &out, &in);
+    dst->meta.wi += out.pos;
+    src->meta.ri += in.pos;
+    if (ZSTD_isError(hint)) {
+      ret = "libzstd: ZSTD_decompressStream failed";
+      break;
+    } else if ((hint == 0) && (wuffs_base__io_buffer__reader_length(src) == 0)) {
+      break;
+    } else if ((out.pos == 0) && (in.pos == 0)) {
+      ret = "libzstd: ZSTD_decompressStream made no progress";
+      break;
+    }
+  }
+
+  ZSTD_freeDStream(dstream);
+  return ret;
+}
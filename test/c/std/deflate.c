@@ -128,6 +128,11 @@ golden_test g_deflate_midsummer_gt = {
     .src_offset1 = 5166,
 };
 
+golden_test g_deflate_midsummer_many_blocks_gt = {
+    .want_filename = "test/data/midsummer.txt",
+    .src_filename = "test/data/midsummer.txt.many-blocks.deflate",
+};
+
 golden_test g_deflate_pi_gt = {
     .want_filename = "test/data/pi.txt",
     .src_filename = "test/data/pi.txt.gz",
@@ -473,6 +478,93 @@ do_test_wuffs_deflate_history(int i,
   return NULL;
 }
 
+const char*  //
+test_wuffs_deflate_decode_resume_from_block_boundaries() {
+  CHECK_FOCUS(__func__);
+
+  wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+      .data = g_src_slice_u8,
+  });
+  wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+      .data = g_have_slice_u8,
+  });
+  wuffs_base__io_buffer want = ((wuffs_base__io_buffer){
+      .data = g_want_slice_u8,
+  });
+
+  golden_test* gt = &g_deflate_midsummer_many_blocks_gt;
+  CHECK_STRING(read_file(&src, gt->src_filename));
+  CHECK_STRING(read_file(&want, gt->want_filename));
+
+  // Decode the whole stream, noting each block boundary's position: in bits
+  // for src and in bytes for dst.
+  uint64_t c_bit_positions[256];
+  uint64_t d_positions[256];
+  size_t num_boundaries = 0;
+  {
+    wuffs_deflate__decoder dec;
+    CHECK_STATUS("initialize",
+                 wuffs_deflate__decoder__initialize(
+                     &dec, sizeof dec, WUFFS_VERSION,
+                     WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+    CHECK_STATUS("set_quirk",
+                 wuffs_deflate__decoder__set_quirk(
+                     &dec, WUFFS_DEFLATE__QUIRK_NOTE_BLOCK_BOUNDARIES, 1));
+    while (true) {
+      wuffs_base__status status = wuffs_deflate__decoder__transform_io(
+          &dec, &have, &src, g_work_slice_u8);
+      if (wuffs_base__status__is_ok(&status)) {
+        break;
+      } else if (status.repr != wuffs_deflate__note__block_boundary) {
+        RETURN_FAIL("transform_io: \"%s\"", status.repr);
+      } else if (num_boundaries >= WUFFS_TESTLIB_ARRAY_SIZE(d_positions)) {
+        RETURN_FAIL("too many block boundaries");
+      }
+      c_bit_positions[num_boundaries] =
+          (8 * ((uint64_t)(src.meta.ri))) -
+          wuffs_deflate__decoder__num_buffered_bits(&dec);
+      d_positions[num_boundaries] = have.meta.wi;
+      num_boundaries++;
+    }
+    CHECK_STRING(check_io_buffers_equal("", &have, &want));
+  }
+  if (num_boundaries < 2) {
+    RETURN_FAIL("num_boundaries: have %zu, want >= 2", num_boundaries);
+  }
+
+  // Resume a fresh decoder from each block boundary.
+  for (size_t i = 0; i < num_boundaries; i++) {
+    wuffs_deflate__decoder dec;
+    CHECK_STATUS("initialize",
+                 wuffs_deflate__decoder__initialize(
+                     &dec, sizeof dec, WUFFS_VERSION,
+                     WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+    CHECK_STATUS("set_quirk",
+                 wuffs_deflate__decoder__set_quirk(
+                     &dec, WUFFS_DEFLATE__QUIRK_SKIP_LEADING_BITS,
+                     c_bit_positions[i] & 7));
+
+    uint64_t d = d_positions[i];
+    uint64_t n = (d < 0x8000) ? d : 0x8000;
+    wuffs_deflate__decoder__add_history(
+        &dec, wuffs_base__make_slice_u8(g_want_array_u8 + d - n, n));
+
+    src.meta.ri = c_bit_positions[i] >> 3;
+    have.meta.ri = 0;
+    have.meta.wi = 0;
+    CHECK_STATUS("transform_io", wuffs_deflate__decoder__transform_io(
+                                     &dec, &have, &src, g_work_slice_u8));
+
+    wuffs_base__io_buffer want_suffix = ((wuffs_base__io_buffer){
+        .data = wuffs_base__make_slice_u8(g_want_array_u8 + d,
+                                          want.meta.wi - d),
+    });
+    want_suffix.meta.wi = want.meta.wi - d;
+    CHECK_STRING(check_io_buffers_equal("", &have, &want_suffix));
+  }
+  return NULL;
+}
+
 const char*  //
 test_wuffs_deflate_history_full() {
   CHECK_FOCUS(__func__);
@@ -926,6 +1018,7 @@ proc g_tests[] = {
     test_wuffs_deflate_decode_pi_many_big_reads,
     test_wuffs_deflate_decode_pi_many_medium_reads,
     test_wuffs_deflate_decode_pi_many_small_writes_reads,
+    test_wuffs_deflate_decode_resume_from_block_boundaries,
     test_wuffs_deflate_decode_romeo,
     test_wuffs_deflate_decode_romeo_fixed,
     test_wuffs_deflate_decode_split_src,
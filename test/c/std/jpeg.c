@@ -137,6 +137,155 @@ test_wuffs_jpeg_decode_lower_quality() {
   return NULL;
 }
 
+const char*  //
+test_wuffs_jpeg_decode_metadata_exif() {
+  CHECK_FOCUS(__func__);
+  wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+      .data = g_src_slice_u8,
+  });
+  CHECK_STRING(
+      read_file(&src, "test/data/artificial-jpeg/hippopotamus-exif.jpeg"));
+
+  wuffs_jpeg__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_jpeg__decoder__initialize(
+                   &dec, sizeof dec, WUFFS_VERSION,
+                   WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+  wuffs_jpeg__decoder__set_report_metadata(&dec, WUFFS_BASE__FOURCC__EXIF,
+                                           true);
+
+  wuffs_base__image_config ic = ((wuffs_base__image_config){});
+  wuffs_base__io_buffer empty = wuffs_base__empty_io_buffer();
+  wuffs_base__more_information minfo = wuffs_base__empty_more_information();
+
+  wuffs_base__status status =
+      wuffs_jpeg__decoder__decode_image_config(&dec, &ic, &src);
+  if (status.repr != wuffs_base__note__metadata_reported) {
+    RETURN_FAIL("decode_image_config #0: have \"%s\", want \"%s\"", status.repr,
+                wuffs_base__note__metadata_reported);
+  }
+
+  status = wuffs_jpeg__decoder__tell_me_more(&dec, &empty, &minfo, &src);
+  if (status.repr != wuffs_base__suspension__even_more_information) {
+    RETURN_FAIL("tell_me_more #0: have \"%s\", want \"%s\"", status.repr,
+                wuffs_base__suspension__even_more_information);
+  }
+
+  // The make-hippopotamus-exif.go program says that 0x1E..0x38 holds the
+  // TIFF-formatted EXIF data, after the APP1 payload's "Exif\x00\x00" prefix.
+  wuffs_base__range_ie_u64 have =
+      wuffs_base__more_information__metadata_raw_passthrough__range(&minfo);
+  wuffs_base__range_ie_u64 want = wuffs_base__make_range_ie_u64(0x1E, 0x38);
+  if (!wuffs_base__range_ie_u64__equals(&have, want)) {
+    RETURN_FAIL("range #0: have 0x%" PRIx64 "..0x%" PRIX64 ", want 0x%" PRIx64
+                "..0x%" PRIX64,
+                have.min_incl, have.max_excl, want.min_incl, want.max_excl);
+  } else if ((src.meta.ri == 0x1E) && (src.meta.wi >= 0x38)) {
+    src.meta.ri = 0x38;
+  }
+
+  status = wuffs_jpeg__decoder__tell_me_more(&dec, &empty, &minfo, &src);
+  if (status.repr != NULL) {
+    RETURN_FAIL("tell_me_more #1: have \"%s\", want \"(null)\"", status.repr);
+  }
+  have = wuffs_base__more_information__metadata_raw_passthrough__range(&minfo);
+  if (!wuffs_base__range_ie_u64__is_empty(&have)) {
+    RETURN_FAIL("tell_me_more #1: non-empty range");
+  }
+
+  status = wuffs_jpeg__decoder__decode_image_config(&dec, &ic, &src);
+  if (status.repr != NULL) {
+    RETURN_FAIL("decode_image_config #1: have \"%s\", want \"(null)\"",
+                status.repr);
+  } else if (wuffs_base__pixel_config__width(&ic.pixcfg) != 36) {
+    RETURN_FAIL("decode_image_config #1: have %" PRIu32 ", want 36",
+                wuffs_base__pixel_config__width(&ic.pixcfg));
+  }
+
+  return NULL;
+}
+
+const char*  //
+test_wuffs_jpeg_decode_metadata_iccp() {
+  CHECK_FOCUS(__func__);
+  wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+      .data = g_src_slice_u8,
+  });
+  CHECK_STRING(
+      read_file(&src, "test/data/artificial-jpeg/hippopotamus-iccp.jpeg"));
+
+  wuffs_jpeg__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_jpeg__decoder__initialize(
+                   &dec, sizeof dec, WUFFS_VERSION,
+                   WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+  wuffs_jpeg__decoder__set_report_metadata(&dec, WUFFS_BASE__FOURCC__ICCP,
+                                           true);
+
+  wuffs_base__image_config ic = ((wuffs_base__image_config){});
+  wuffs_base__io_buffer empty = wuffs_base__empty_io_buffer();
+  wuffs_base__more_information minfo = wuffs_base__empty_more_information();
+
+  // The make-hippopotamus-iccp.go program says that the ICC profile is split
+  // over two APP2 segments, at 0x0026..0x0152 and 0x0164..0x0294, after each
+  // APP2 payload's "ICC_PROFILE\x00" prefix and 2 byte chunk numbers.
+  const uint64_t wants[2][2] = {
+      {0x0026, 0x0152},
+      {0x0164, 0x0294},
+  };
+  for (int i = 0; i < 2; i++) {
+    wuffs_base__status status =
+        wuffs_jpeg__decoder__decode_image_config(&dec, &ic, &src);
+    if (status.repr != wuffs_base__note__metadata_reported) {
+      RETURN_FAIL("decode_image_config #%d: have \"%s\", want \"%s\"", i,
+                  status.repr, wuffs_base__note__metadata_reported);
+    }
+
+    status = wuffs_jpeg__decoder__tell_me_more(&dec, &empty, &minfo, &src);
+    if (status.repr != wuffs_base__suspension__even_more_information) {
+      RETURN_FAIL("tell_me_more #%d.0: have \"%s\", want \"%s\"", i,
+                  status.repr, wuffs_base__suspension__even_more_information);
+    } else if (wuffs_base__more_information__metadata__fourcc(&minfo) !=
+               WUFFS_BASE__FOURCC__ICCP) {
+      RETURN_FAIL("tell_me_more #%d.0: have fourcc 0x%08" PRIX32
+                  ", want ICCP",
+                  i, wuffs_base__more_information__metadata__fourcc(&minfo));
+    }
+
+    wuffs_base__range_ie_u64 have =
+        wuffs_base__more_information__metadata_raw_passthrough__range(&minfo);
+    wuffs_base__range_ie_u64 want =
+        wuffs_base__make_range_ie_u64(wants[i][0], wants[i][1]);
+    if (!wuffs_base__range_ie_u64__equals(&have, want)) {
+      RETURN_FAIL("range #%d: have 0x%" PRIx64 "..0x%" PRIX64
+                  ", want 0x%" PRIx64 "..0x%" PRIX64,
+                  i, have.min_incl, have.max_excl, want.min_incl,
+                  want.max_excl);
+    } else if ((src.meta.ri == want.min_incl) &&
+               (src.meta.wi >= want.max_excl)) {
+      src.meta.ri = want.max_excl;
+    }
+
+    status = wuffs_jpeg__decoder__tell_me_more(&dec, &empty, &minfo, &src);
+    if (status.repr != NULL) {
+      RETURN_FAIL("tell_me_more #%d.1: have \"%s\", want \"(null)\"", i,
+                  status.repr);
+    }
+  }
+
+  wuffs_base__status status =
+      wuffs_jpeg__decoder__decode_image_config(&dec, &ic, &src);
+  if (status.repr != NULL) {
+    RETURN_FAIL("decode_image_config #2: have \"%s\", want \"(null)\"",
+                status.repr);
+  } else if (wuffs_base__pixel_config__width(&ic.pixcfg) != 36) {
+    RETURN_FAIL("decode_image_config #2: have %" PRIu32 ", want 36",
+                wuffs_base__pixel_config__width(&ic.pixcfg));
+  }
+
+  return NULL;
+}
+
 const char*  //
 test_wuffs_jpeg_decode_truncated_input() {
   CHECK_FOCUS(__func__);
@@ -1032,6 +1181,8 @@ proc g_tests[] = {
     test_wuffs_jpeg_decode_mcu,
     test_wuffs_jpeg_decode_interface,
     test_wuffs_jpeg_decode_lower_quality,
+    test_wuffs_jpeg_decode_metadata_exif,
+    test_wuffs_jpeg_decode_metadata_iccp,
     test_wuffs_jpeg_decode_truncated_input,
 
 #ifdef WUFFS_MIMIC
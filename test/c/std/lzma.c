@@ -194,6 +194,14 @@ test_mimic_lzma_decode_romeo_lzma1() {
 
 // ---------------- LZMA Benches
 
+const char*  //
+bench_wuffs_lzma_decode_1k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_lzma_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_lzma_romeo_gt, UINT64_MAX, UINT64_MAX, 500);
+}
+
 const char*  //
 bench_wuffs_lzma_decode_100k() {
   CHECK_FOCUS(__func__);
@@ -206,6 +214,14 @@ bench_wuffs_lzma_decode_100k() {
 
 #ifdef WUFFS_MIMIC
 
+const char*  //
+bench_mimic_lzma_decode_1k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      mimic_lzma_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_lzma_romeo_gt, UINT64_MAX, UINT64_MAX, 500);
+}
+
 const char*  //
 bench_mimic_lzma_decode_100k() {
   CHECK_FOCUS(__func__);
@@ -237,10 +253,12 @@ proc g_tests[] = {
 
 proc g_benches[] = {
 
+    bench_wuffs_lzma_decode_1k,
     bench_wuffs_lzma_decode_100k,
 
 #ifdef WUFFS_MIMIC
 
+    bench_mimic_lzma_decode_1k,
     bench_mimic_lzma_decode_100k,
 
 #endif  // WUFFS_MIMIC
@@ -74,6 +74,11 @@ golden_test g_xz_enwik5_gt = {
     .src_filename = "test/data/enwik5.xz",
 };
 
+golden_test g_xz_enwik5_block_size_32k_gt = {
+    .want_filename = "test/data/enwik5",
+    .src_filename = "test/data/enwik5.block-size-32k.xz",
+};
+
 golden_test g_xz_romeo_delta1_gt = {
     .want_filename = "test/data/romeo.txt",
     .src_filename = "test/data/romeo.txt.delta1.xz",
@@ -163,6 +168,87 @@ wuffs_xz_decode_with_history(wuffs_base__io_buffer* dst,
   }
 }
 
+// test_wuffs_xz_decode_budget pins down how the LZMA-family decoders interact
+// with wuffs_base__io_transformer_budget. They need a few hundred bytes of
+// spare dst room to make progress, so a max_dst_length equal to the true
+// output length is reported as budget_exceeded, stopping short of the end.
+// The output never overshoots and is a prefix of the true output.
+const char*  //
+test_wuffs_xz_decode_budget() {
+  CHECK_FOCUS(__func__);
+
+  struct {
+    const char* want_filename;
+    const char* src_filename;
+    uint64_t max_dst_length;
+    const char* want_status_repr;
+    uint64_t want_wi;
+  } test_cases[] = {
+      // romeo.txt is 942 bytes long. 1231 is 942 + 289, where 289 is the
+      // dst length that the LZMA decoder's fast path needs.
+      {"test/data/romeo.txt", "test/data/romeo.txt.xz", 0, NULL, 942},
+      {"test/data/romeo.txt", "test/data/romeo.txt.xz", 1231, NULL, 942},
+      {"test/data/romeo.txt", "test/data/romeo.txt.xz", 1200,
+       wuffs_base__error__budget_exceeded, 928},
+      {"test/data/romeo.txt", "test/data/romeo.txt.xz", 942,
+       wuffs_base__error__budget_exceeded, 674},
+      // enwik5 is 100000 bytes long.
+      {"test/data/enwik5", "test/data/enwik5.xz", 100289, NULL, 100000},
+      {"test/data/enwik5", "test/data/enwik5.xz", 100000,
+       wuffs_base__error__budget_exceeded, 99729},
+  };
+
+  for (size_t tc = 0; tc < WUFFS_TESTLIB_ARRAY_SIZE(test_cases); tc++) {
+    wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+        .data = g_have_slice_u8,
+    });
+    wuffs_base__io_buffer want = ((wuffs_base__io_buffer){
+        .data = g_want_slice_u8,
+    });
+    wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+        .data = g_src_slice_u8,
+    });
+    CHECK_STRING(read_file(&src, test_cases[tc].src_filename));
+    CHECK_STRING(read_file(&want, test_cases[tc].want_filename));
+
+    wuffs_xz__decoder dec;
+    CHECK_STATUS("initialize",
+                 wuffs_xz__decoder__initialize(
+                     &dec, sizeof dec, WUFFS_VERSION,
+                     WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+    wuffs_base__io_transformer_budget budget =
+        wuffs_base__make_io_transformer_budget(test_cases[tc].max_dst_length,
+                                               0, 0);
+
+    wuffs_base__status status;
+    while (true) {
+      status = wuffs_base__io_transformer_budget__transform_io(
+          &budget,
+          wuffs_xz__decoder__upcast_as__wuffs_base__io_transformer(&dec),
+          &have, &src, g_work_slice_u8);
+      if ((status.repr != wuffs_base__suspension__short_write) &&
+          (status.repr != wuffs_base__suspension__short_read)) {
+        break;
+      }
+    }
+
+    if (status.repr != test_cases[tc].want_status_repr) {
+      RETURN_FAIL("tc=%d: status: have \"%s\", want \"%s\"", (int)(tc),
+                  status.repr, test_cases[tc].want_status_repr);
+    } else if (have.meta.wi != test_cases[tc].want_wi) {
+      RETURN_FAIL("tc=%d: wi: have %zu, want %" PRIu64, (int)(tc),
+                  have.meta.wi, test_cases[tc].want_wi);
+    } else if (budget.num_dst_bytes != have.meta.wi) {
+      RETURN_FAIL("tc=%d: num_dst_bytes: have %" PRIu64 ", want %zu",
+                  (int)(tc), budget.num_dst_bytes, have.meta.wi);
+    } else if (memcmp(have.data.ptr, want.data.ptr, have.meta.wi) != 0) {
+      RETURN_FAIL("tc=%d: output is not a prefix of the true output",
+                  (int)(tc));
+    }
+  }
+  return NULL;
+}
+
 const char*  //
 test_wuffs_xz_decode_enwik5() {
   CHECK_FOCUS(__func__);
@@ -213,6 +299,14 @@ test_mimic_xz_decode_romeo() {
 
 // ---------------- LZMA Benches
 
+const char*  //
+bench_wuffs_xz_decode_1k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_xz_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_xz_romeo_gt, UINT64_MAX, UINT64_MAX, 500);
+}
+
 const char*  //
 bench_wuffs_xz_decode_100k() {
   CHECK_FOCUS(__func__);
@@ -221,10 +315,26 @@ bench_wuffs_xz_decode_100k() {
       tcounter_dst, &g_xz_enwik5_gt, UINT64_MAX, UINT64_MAX, 5);
 }
 
+const char*  //
+bench_wuffs_xz_decode_100k_block_size_32k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_xz_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_xz_enwik5_block_size_32k_gt, UINT64_MAX, UINT64_MAX, 5);
+}
+
 // ---------------- Mimic Benches
 
 #ifdef WUFFS_MIMIC
 
+const char*  //
+bench_mimic_xz_decode_1k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      mimic_lzma_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_xz_romeo_gt, UINT64_MAX, UINT64_MAX, 500);
+}
+
 const char*  //
 bench_mimic_xz_decode_100k() {
   CHECK_FOCUS(__func__);
@@ -233,12 +343,21 @@ bench_mimic_xz_decode_100k() {
       tcounter_dst, &g_xz_enwik5_gt, UINT64_MAX, UINT64_MAX, 5);
 }
 
+const char*  //
+bench_mimic_xz_decode_100k_block_size_32k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      mimic_lzma_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_xz_enwik5_block_size_32k_gt, UINT64_MAX, UINT64_MAX, 5);
+}
+
 #endif  // WUFFS_MIMIC
 
 // ---------------- Manifest
 
 proc g_tests[] = {
 
+    test_wuffs_xz_decode_budget,
     test_wuffs_xz_decode_enwik5,
     test_wuffs_xz_decode_interface,
     test_wuffs_xz_decode_one_byte_reads_sans_history,
@@ -257,11 +376,15 @@ proc g_tests[] = {
 
 proc g_benches[] = {
 
+    bench_wuffs_xz_decode_1k,
     bench_wuffs_xz_decode_100k,
+    bench_wuffs_xz_decode_100k_block_size_32k,
 
 #ifdef WUFFS_MIMIC
 
+    bench_mimic_xz_decode_1k,
     bench_mimic_xz_decode_100k,
+    bench_mimic_xz_decode_100k_block_size_32k,
 
 #endif  // WUFFS_MIMIC
 
@@ -82,6 +82,33 @@ golden_test g_zlib_pi_gt = {
     .src_filename = "test/data/pi.txt.zlib",
 };
 
+golden_test g_zlib_romeo_midsummer_dictionary_gt = {
+    .want_filename = "test/data/romeo.txt",
+    .src_filename = "test/data/romeo.txt.midsummer-dictionary.zlib",
+};
+
+// g_zlib_midsummer_dictionary holds the contents of test/data/midsummer.txt,
+// once load_zlib_midsummer_dictionary has been called. It is the preset
+// dictionary for the romeo.txt.midsummer-dictionary.zlib file.
+uint8_t g_zlib_midsummer_dictionary_array[16384];
+wuffs_base__slice_u8 g_zlib_midsummer_dictionary;
+
+const char*  //
+load_zlib_midsummer_dictionary() {
+  if (g_zlib_midsummer_dictionary.len > 0) {
+    return NULL;
+  }
+  wuffs_base__io_buffer buf = ((wuffs_base__io_buffer){
+      .data = wuffs_base__make_slice_u8(
+          g_zlib_midsummer_dictionary_array,
+          sizeof(g_zlib_midsummer_dictionary_array)),
+  });
+  CHECK_STRING(read_file(&buf, "test/data/midsummer.txt"));
+  g_zlib_midsummer_dictionary =
+      wuffs_base__make_slice_u8(g_zlib_midsummer_dictionary_array, buf.meta.wi);
+  return NULL;
+}
+
 // This dictionary-using zlib-encoded data comes from
 // https://play.golang.org/p/Jh9Wyp6PLID, also mentioned in the RAC spec.
 const char* g_zlib_sheep_src_ptr =
@@ -95,6 +122,93 @@ const size_t g_zlib_sheep_want_len = 11;
 
 // ---------------- Zlib Tests
 
+const char*  //
+test_wuffs_zlib_decode_budget() {
+  CHECK_FOCUS(__func__);
+
+  struct {
+    const char* filename;
+    uint64_t max_dst_length;
+    uint64_t max_ratio;
+    uint64_t max_transform_io_calls;
+    uint64_t wlimit;
+    uint64_t rlimit;
+    const char* want_status_repr;
+    uint64_t want_wi;
+  } test_cases[] = {
+      // romeo.txt is 942 bytes long.
+      {"test/data/romeo.txt.zlib", 942, 0, 0, UINT64_MAX, UINT64_MAX, NULL,
+       942},
+      {"test/data/romeo.txt.zlib", 942, 0, 0, 100, 10, NULL, 942},
+      {"test/data/romeo.txt.zlib", 941, 0, 0, UINT64_MAX, UINT64_MAX,
+       wuffs_base__error__budget_exceeded, 941},
+      {"test/data/romeo.txt.zlib", 941, 0, 0, 100, 10,
+       wuffs_base__error__budget_exceeded, 941},
+      {"test/data/romeo.txt.zlib", 0, 0, 3, 100, UINT64_MAX,
+       wuffs_base__error__budget_exceeded, 300},
+      // romeo.txt.zlib is under the ratio's grace length.
+      {"test/data/romeo.txt.zlib", 0, 1, 0, UINT64_MAX, UINT64_MAX, NULL, 942},
+      // pi.txt is 100003 bytes long and pi.txt.zlib is 48324 bytes long.
+      {"test/data/pi.txt.zlib", 0, 3, 0, UINT64_MAX, UINT64_MAX, NULL, 100003},
+      {"test/data/pi.txt.zlib", 0, 3, 0, 1000, 100, NULL, 100003},
+      {"test/data/pi.txt.zlib", 0, 2, 0, UINT64_MAX, UINT64_MAX,
+       wuffs_base__error__budget_exceeded, 96648},
+  };
+
+  for (size_t tc = 0; tc < WUFFS_TESTLIB_ARRAY_SIZE(test_cases); tc++) {
+    wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+        .data = g_have_slice_u8,
+    });
+    wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+        .data = g_src_slice_u8,
+    });
+    CHECK_STRING(read_file(&src, test_cases[tc].filename));
+
+    wuffs_zlib__decoder dec;
+    CHECK_STATUS("initialize",
+                 wuffs_zlib__decoder__initialize(
+                     &dec, sizeof dec, WUFFS_VERSION,
+                     WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+    wuffs_base__io_transformer_budget budget =
+        wuffs_base__make_io_transformer_budget(
+            test_cases[tc].max_dst_length, test_cases[tc].max_ratio,
+            test_cases[tc].max_transform_io_calls);
+
+    wuffs_base__status status;
+    while (true) {
+      wuffs_base__io_buffer limited_dst =
+          make_limited_writer(have, test_cases[tc].wlimit);
+      wuffs_base__io_buffer limited_src =
+          make_limited_reader(src, test_cases[tc].rlimit);
+      status = wuffs_base__io_transformer_budget__transform_io(
+          &budget,
+          wuffs_zlib__decoder__upcast_as__wuffs_base__io_transformer(&dec),
+          &limited_dst, &limited_src, g_work_slice_u8);
+      have.meta.wi += limited_dst.meta.wi;
+      src.meta.ri += limited_src.meta.ri;
+      if ((status.repr != wuffs_base__suspension__short_write) &&
+          (status.repr != wuffs_base__suspension__short_read)) {
+        break;
+      }
+    }
+
+    if (status.repr != test_cases[tc].want_status_repr) {
+      RETURN_FAIL("tc=%d: status: have \"%s\", want \"%s\"", (int)(tc),
+                  status.repr, test_cases[tc].want_status_repr);
+    } else if (have.meta.wi != test_cases[tc].want_wi) {
+      RETURN_FAIL("tc=%d: wi: have %zu, want %" PRIu64, (int)(tc),
+                  have.meta.wi, test_cases[tc].want_wi);
+    } else if (budget.num_dst_bytes != have.meta.wi) {
+      RETURN_FAIL("tc=%d: num_dst_bytes: have %" PRIu64 ", want %zu",
+                  (int)(tc), budget.num_dst_bytes, have.meta.wi);
+    } else if (budget.num_src_bytes != src.meta.ri) {
+      RETURN_FAIL("tc=%d: num_src_bytes: have %" PRIu64 ", want %zu",
+                  (int)(tc), budget.num_src_bytes, src.meta.ri);
+    }
+  }
+  return NULL;
+}
+
 const char*  //
 test_wuffs_zlib_decode_interface() {
   CHECK_FOCUS(__func__);
@@ -108,6 +222,36 @@ test_wuffs_zlib_decode_interface() {
       "test/data/romeo.txt.zlib", 0, SIZE_MAX, 942, 0x0A);
 }
 
+const char*  //
+test_wuffs_zlib_decode_sheep_incorrect_primed_dictionary() {
+  CHECK_FOCUS(__func__);
+  wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+      .data = g_have_slice_u8,
+  });
+  wuffs_base__io_buffer src =
+      make_io_buffer_from_string(g_zlib_sheep_src_ptr, g_zlib_sheep_src_len);
+
+  wuffs_zlib__decoder dec;
+  CHECK_STATUS("initialize", wuffs_zlib__decoder__initialize(
+                                 &dec, sizeof dec, WUFFS_VERSION,
+                                 WUFFS_INITIALIZE__DEFAULT_OPTIONS));
+
+  // Add a dictionary (that isn't " sheep.\n") before reading the header.
+  wuffs_zlib__decoder__add_dictionary(
+      &dec, ((wuffs_base__slice_u8){
+                .ptr = ((uint8_t*)(g_zlib_sheep_want_ptr)),
+                .len = g_zlib_sheep_want_len,
+            }));
+
+  wuffs_base__status status =
+      wuffs_zlib__decoder__transform_io(&dec, &have, &src, g_work_slice_u8);
+  if (status.repr != wuffs_zlib__error__incorrect_dictionary) {
+    RETURN_FAIL("transform_io: have \"%s\", want \"%s\"", status.repr,
+                wuffs_zlib__error__incorrect_dictionary);
+  }
+  return NULL;
+}
+
 const char*  //
 test_wuffs_zlib_decode_truncated_input() {
   CHECK_FOCUS(__func__);
@@ -204,6 +348,125 @@ wuffs_zlib_decode(wuffs_base__io_buffer* dst,
   }
 }
 
+const char*  //
+wuffs_zlib_decode_with_dictionary(wuffs_base__io_buffer* dst,
+                                  wuffs_base__io_buffer* src,
+                                  uint32_t wuffs_initialize_flags,
+                                  uint64_t wlimit,
+                                  uint64_t rlimit) {
+  CHECK_STRING(load_zlib_midsummer_dictionary());
+  wuffs_zlib__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_zlib__decoder__initialize(&dec, sizeof dec, WUFFS_VERSION,
+                                               wuffs_initialize_flags));
+
+  while (true) {
+    wuffs_base__io_buffer limited_dst = make_limited_writer(*dst, wlimit);
+    wuffs_base__io_buffer limited_src = make_limited_reader(*src, rlimit);
+
+    wuffs_base__status status = wuffs_zlib__decoder__transform_io(
+        &dec, &limited_dst, &limited_src, g_work_slice_u8);
+
+    dst->meta.wi += limited_dst.meta.wi;
+    src->meta.ri += limited_src.meta.ri;
+
+    if (status.repr == wuffs_zlib__note__dictionary_required) {
+      wuffs_zlib__decoder__add_dictionary(&dec, g_zlib_midsummer_dictionary);
+      continue;
+    } else if (((wlimit < UINT64_MAX) &&
+                (status.repr == wuffs_base__suspension__short_write)) ||
+               ((rlimit < UINT64_MAX) &&
+                (status.repr == wuffs_base__suspension__short_read))) {
+      continue;
+    }
+    return status.repr;
+  }
+}
+
+const char*  //
+wuffs_zlib_decode_with_budget(wuffs_base__io_buffer* dst,
+                              wuffs_base__io_buffer* src,
+                              uint32_t wuffs_initialize_flags,
+                              uint64_t wlimit,
+                              uint64_t rlimit) {
+  wuffs_zlib__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_zlib__decoder__initialize(&dec, sizeof dec, WUFFS_VERSION,
+                                               wuffs_initialize_flags));
+
+  // The budget is generous, so that decoding succeeds, but not unlimited, so
+  // that it is exercised (and benchmarked) on every call.
+  wuffs_base__io_transformer_budget budget =
+      wuffs_base__make_io_transformer_budget(0x40000000, 1000, 0x100000);
+
+  while (true) {
+    wuffs_base__io_buffer limited_dst = make_limited_writer(*dst, wlimit);
+    wuffs_base__io_buffer limited_src = make_limited_reader(*src, rlimit);
+
+    wuffs_base__status status =
+        wuffs_base__io_transformer_budget__transform_io(
+            &budget,
+            wuffs_zlib__decoder__upcast_as__wuffs_base__io_transformer(&dec),
+            &limited_dst, &limited_src, g_work_slice_u8);
+
+    dst->meta.wi += limited_dst.meta.wi;
+    src->meta.ri += limited_src.meta.ri;
+
+    if (((wlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_write)) ||
+        ((rlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_read))) {
+      continue;
+    }
+    return status.repr;
+  }
+}
+
+// g_zlib_primed_decoder has had the midsummer dictionary added, before
+// reading any zlib header, so that it can be copied (cloned) per message.
+wuffs_zlib__decoder g_zlib_primed_decoder;
+uint32_t g_zlib_primed_decoder_flags = 0xFFFFFFFF;
+
+const char*  //
+wuffs_zlib_decode_primed(wuffs_base__io_buffer* dst,
+                         wuffs_base__io_buffer* src,
+                         uint32_t wuffs_initialize_flags,
+                         uint64_t wlimit,
+                         uint64_t rlimit) {
+  if (g_zlib_primed_decoder_flags != wuffs_initialize_flags) {
+    CHECK_STRING(load_zlib_midsummer_dictionary());
+    CHECK_STATUS("initialize", wuffs_zlib__decoder__initialize(
+                                   &g_zlib_primed_decoder,
+                                   sizeof g_zlib_primed_decoder, WUFFS_VERSION,
+                                   wuffs_initialize_flags));
+    wuffs_zlib__decoder__add_dictionary(&g_zlib_primed_decoder,
+                                        g_zlib_midsummer_dictionary);
+    g_zlib_primed_decoder_flags = wuffs_initialize_flags;
+  }
+
+  wuffs_zlib__decoder dec;
+  memcpy(&dec, &g_zlib_primed_decoder, sizeof dec);
+
+  while (true) {
+    wuffs_base__io_buffer limited_dst = make_limited_writer(*dst, wlimit);
+    wuffs_base__io_buffer limited_src = make_limited_reader(*src, rlimit);
+
+    wuffs_base__status status = wuffs_zlib__decoder__transform_io(
+        &dec, &limited_dst, &limited_src, g_work_slice_u8);
+
+    dst->meta.wi += limited_dst.meta.wi;
+    src->meta.ri += limited_src.meta.ri;
+
+    if (((wlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_write)) ||
+        ((rlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_read))) {
+      continue;
+    }
+    return status.repr;
+  }
+}
+
 const char*  //
 do_test_wuffs_zlib_checksum(bool ignore_checksum, uint32_t bad_checksum) {
   wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
@@ -313,6 +576,28 @@ test_wuffs_zlib_decode_raw_deflate_romeo() {
                             UINT64_MAX, UINT64_MAX);
 }
 
+const char*  //
+test_wuffs_zlib_decode_romeo_primed() {
+  CHECK_FOCUS(__func__);
+  // Decode the same message multiple times, each time from a fresh copy of
+  // the same primed decoder, with and without I/O limits.
+  for (int i = 0; i < 3; i++) {
+    CHECK_STRING(do_test_io_buffers(wuffs_zlib_decode_primed,
+                                    &g_zlib_romeo_midsummer_dictionary_gt,
+                                    UINT64_MAX, UINT64_MAX));
+  }
+  return do_test_io_buffers(wuffs_zlib_decode_primed,
+                            &g_zlib_romeo_midsummer_dictionary_gt, 101, 13);
+}
+
+const char*  //
+test_wuffs_zlib_decode_romeo_with_dictionary() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(wuffs_zlib_decode_with_dictionary,
+                            &g_zlib_romeo_midsummer_dictionary_gt, UINT64_MAX,
+                            UINT64_MAX);
+}
+
 const char*  //
 test_wuffs_zlib_decode_sheep() {
   CHECK_FOCUS(__func__);
@@ -363,6 +648,17 @@ test_wuffs_zlib_decode_sheep() {
 
 #ifdef WUFFS_MIMIC
 
+const char*  //
+mimic_zlib_decode_midsummer_dictionary(wuffs_base__io_buffer* dst,
+                                       wuffs_base__io_buffer* src,
+                                       uint32_t wuffs_initialize_flags,
+                                       uint64_t wlimit,
+                                       uint64_t rlimit) {
+  CHECK_STRING(load_zlib_midsummer_dictionary());
+  return mimic_zlib_decode_with_dictionary(dst, src,
+                                           g_zlib_midsummer_dictionary);
+}
+
 const char*  //
 test_mimic_zlib_decode_midsummer() {
   CHECK_FOCUS(__func__);
@@ -402,6 +698,24 @@ test_mimic_zlib_decode_sheep() {
 
 // ---------------- Zlib Benches
 
+const char*  //
+bench_wuffs_zlib_decode_1k_dictionary() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zlib_decode_with_dictionary,
+      WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED, tcounter_dst,
+      &g_zlib_romeo_midsummer_dictionary_gt, UINT64_MAX, UINT64_MAX, 1000);
+}
+
+const char*  //
+bench_wuffs_zlib_decode_1k_primed() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zlib_decode_primed,
+      WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED, tcounter_dst,
+      &g_zlib_romeo_midsummer_dictionary_gt, UINT64_MAX, UINT64_MAX, 1000);
+}
+
 const char*  //
 bench_wuffs_zlib_decode_10k() {
   CHECK_FOCUS(__func__);
@@ -418,10 +732,36 @@ bench_wuffs_zlib_decode_100k() {
       tcounter_dst, &g_zlib_pi_gt, UINT64_MAX, UINT64_MAX, 30);
 }
 
+const char*  //
+bench_wuffs_zlib_decode_100k_budget() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zlib_decode_with_budget,
+      WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED, tcounter_dst,
+      &g_zlib_pi_gt, 4096, UINT64_MAX, 30);
+}
+
+const char*  //
+bench_wuffs_zlib_decode_100k_no_budget() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zlib_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_zlib_pi_gt, 4096, UINT64_MAX, 30);
+}
+
 // ---------------- Mimic Benches
 
 #ifdef WUFFS_MIMIC
 
+const char*  //
+bench_mimic_zlib_decode_1k_dictionary() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(mimic_zlib_decode_midsummer_dictionary, 0,
+                             tcounter_dst,
+                             &g_zlib_romeo_midsummer_dictionary_gt, UINT64_MAX,
+                             UINT64_MAX, 1000);
+}
+
 const char*  //
 bench_mimic_zlib_decode_10k() {
   CHECK_FOCUS(__func__);
@@ -446,11 +786,15 @@ proc g_tests[] = {
     test_wuffs_zlib_checksum_verify_bad0,
     test_wuffs_zlib_checksum_verify_bad3,
     test_wuffs_zlib_checksum_verify_good,
+    test_wuffs_zlib_decode_budget,
     test_wuffs_zlib_decode_interface,
     test_wuffs_zlib_decode_midsummer,
     test_wuffs_zlib_decode_pi,
     test_wuffs_zlib_decode_raw_deflate_romeo,
+    test_wuffs_zlib_decode_romeo_primed,
+    test_wuffs_zlib_decode_romeo_with_dictionary,
     test_wuffs_zlib_decode_sheep,
+    test_wuffs_zlib_decode_sheep_incorrect_primed_dictionary,
     test_wuffs_zlib_decode_truncated_input,
 
 #ifdef WUFFS_MIMIC
@@ -468,11 +812,18 @@ proc g_tests[] = {
 
 proc g_benches[] = {
 
+    bench_wuffs_zlib_decode_1k_dictionary,
+    bench_wuffs_zlib_decode_1k_primed,
     bench_wuffs_zlib_decode_10k,
     bench_wuffs_zlib_decode_100k,
+    bench_wuffs_zlib_decode_100k_budget,
+    bench_wuffs_zlib_decode_100k_no_budget,
 
 #ifdef WUFFS_MIMIC
 
+#ifndef WUFFS_MIMICLIB_ZLIB_DOES_NOT_SUPPORT_DICTIONARIES
+    bench_mimic_zlib_decode_1k_dictionary,
+#endif
     bench_mimic_zlib_decode_10k,
     bench_mimic_zlib_decode_100k,
 
@@ -0,0 +1,413 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+// ----------------
+
+/*
+This test program is typically run indirectly, by the "wuffs test" or "wuffs
+bench" commands. These commands take an optional "-mimic" flag to check that
+Wuffs' output mimics (i.e. exactly matches) other libraries' output, such as
+giflib for GIF, libpng for PNG, etc.
+
+To manually run this test:
+
+for CC in clang gcc; do
+  $CC -std=c99 -Wall -Werror zstd.c && ./a.out
+  rm -f a.out
+done
+
+Each edition should print "PASS", amongst other information, and exit(0).
+
+Add the "wuffs mimic cflags" (everything after the colon below) to the C
+compiler flags (after the .c file) to run the mimic tests.
+
+To manually run the benchmarks, replace "-Wall -Werror" with "-O3" and replace
+the first "./a.out" with "./a.out -bench". Combine these changes with the
+"wuffs mimic cflags" to run the mimic benchmarks.
+*/
+
+// ¿ wuffs mimic cflags: -DWUFFS_MIMIC -lzstd
+
+// Wuffs ships as a "single file C library" or "header file library" as per
+// https://github.com/nothings/stb/blob/master/docs/stb_howto.txt
+//
+// To use that single file as a "foo.c"-like implementation, instead of a
+// "foo.h"-like header, #define WUFFS_IMPLEMENTATION before #include'ing or
+// compiling it.
+#define WUFFS_IMPLEMENTATION
+
+// Defining the WUFFS_CONFIG__MODULE* macros are optional, but it lets users of
+// release/c/etc.c choose which parts of Wuffs to build. That file contains the
+// entire Wuffs standard library, implementing a variety of codecs and file
+// formats. Without this macro definition, an optimizing compiler or linker may
+// very well discard Wuffs code for unused codecs, but listing the Wuffs
+// modules we use makes that process explicit. Preprocessing means that such
+// code simply isn't compiled.
+#define WUFFS_CONFIG__MODULES
+#define WUFFS_CONFIG__MODULE__BASE
+#define WUFFS_CONFIG__MODULE__XXHASH64
+#define WUFFS_CONFIG__MODULE__ZSTD
+
+// If building this program in an environment that doesn't easily accommodate
+// relative includes, you can use the script/inline-c-relative-includes.go
+// program to generate a stand-alone C file.
+#include "../../../release/c/wuffs-unsupported-snapshot.c"
+#include "../testlib/testlib.c"
+#ifdef WUFFS_MIMIC
+#include "../mimiclib/zstd.c"
+#endif
+
+// ---------------- Golden Tests
+
+golden_test g_zstd_midsummer_gt = {
+    .want_filename = "test/data/midsummer.txt",
+    .src_filename = "test/data/midsummer.txt.zst",
+};
+
+golden_test g_zstd_pi_gt = {
+    .want_filename = "test/data/pi.txt",
+    .src_filename = "test/data/pi.txt.zst",
+};
+
+golden_test g_zstd_romeo_skippable_frame_gt = {
+    .want_filename = "test/data/romeo.txt",
+    .src_filename = "test/data/romeo.txt.skippable-frame.zst",
+};
+
+// ---------------- Zstd Tests
+
+const char*  //
+test_wuffs_zstd_decode_interface() {
+  CHECK_FOCUS(__func__);
+  wuffs_zstd__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_zstd__decoder__initialize(
+                   &dec, sizeof dec, WUFFS_VERSION,
+                   WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+  return do_test__wuffs_base__io_transformer(
+      wuffs_zstd__decoder__upcast_as__wuffs_base__io_transformer(&dec),
+      "test/data/romeo.txt.zst", 0, SIZE_MAX, 942, 0x0A);
+}
+
+const char*  //
+test_wuffs_zstd_decode_truncated_input() {
+  CHECK_FOCUS(__func__);
+
+  wuffs_base__io_buffer have = wuffs_base__ptr_u8__writer(g_have_array_u8, 1);
+  wuffs_base__io_buffer src =
+      wuffs_base__ptr_u8__reader(g_src_array_u8, 0, false);
+  wuffs_zstd__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_zstd__decoder__initialize(
+                   &dec, sizeof dec, WUFFS_VERSION,
+                   WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+
+  wuffs_base__status status =
+      wuffs_zstd__decoder__transform_io(&dec, &have, &src, g_work_slice_u8);
+  if (status.repr != wuffs_base__suspension__short_read) {
+    RETURN_FAIL("closed=false: have \"%s\", want \"%s\"", status.repr,
+                wuffs_base__suspension__short_read);
+  }
+
+  src.meta.closed = true;
+  status =
+      wuffs_zstd__decoder__transform_io(&dec, &have, &src, g_work_slice_u8);
+  if (status.repr != wuffs_zstd__error__truncated_input) {
+    RETURN_FAIL("closed=true: have \"%s\", want \"%s\"", status.repr,
+                wuffs_zstd__error__truncated_input);
+  }
+  return NULL;
+}
+
+const char*  //
+test_wuffs_zstd_decode_single_frame_quirk() {
+  CHECK_FOCUS(__func__);
+
+  // Concatenate two copies of the same frame.
+  wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+      .data = g_src_slice_u8,
+  });
+  CHECK_STRING(read_file(&src, "test/data/midsummer.txt.zst"));
+  size_t frame_len = src.meta.wi;
+  src.meta.closed = false;
+  CHECK_STRING(read_file(&src, "test/data/midsummer.txt.zst"));
+
+  wuffs_base__io_buffer want = ((wuffs_base__io_buffer){
+      .data = g_want_slice_u8,
+  });
+  CHECK_STRING(read_file(&want, "test/data/midsummer.txt"));
+
+  int q;
+  for (q = 0; q < 2; q++) {
+    src.meta.ri = 0;
+    wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+        .data = g_have_slice_u8,
+    });
+
+    wuffs_zstd__decoder dec;
+    CHECK_STATUS("initialize",
+                 wuffs_zstd__decoder__initialize(
+                     &dec, sizeof dec, WUFFS_VERSION,
+                     WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED));
+    CHECK_STATUS("set_quirk",
+                 wuffs_zstd__decoder__set_quirk(
+                     &dec, WUFFS_ZSTD__QUIRK_DECODE_SINGLE_FRAME, q));
+    CHECK_STATUS("transform_io", wuffs_zstd__decoder__transform_io(
+                                     &dec, &have, &src, g_work_slice_u8));
+
+    size_t want_ri = q ? frame_len : (2 * frame_len);
+    if (src.meta.ri != want_ri) {
+      RETURN_FAIL("q=%d: src.meta.ri: have %zu, want %zu", q, src.meta.ri,
+                  want_ri);
+    }
+    size_t want_wi = (q ? 1 : 2) * want.meta.wi;
+    if (have.meta.wi != want_wi) {
+      RETURN_FAIL("q=%d: have.meta.wi: have %zu, want %zu", q, have.meta.wi,
+                  want_wi);
+    }
+    wuffs_base__io_buffer first = have;
+    first.meta.wi = want.meta.wi;
+    CHECK_STRING(check_io_buffers_equal("", &first, &want));
+  }
+  return NULL;
+}
+
+const char*  //
+wuffs_zstd_decode(wuffs_base__io_buffer* dst,
+                  wuffs_base__io_buffer* src,
+                  uint32_t wuffs_initialize_flags,
+                  uint64_t wlimit,
+                  uint64_t rlimit) {
+  wuffs_zstd__decoder dec;
+  CHECK_STATUS("initialize",
+               wuffs_zstd__decoder__initialize(&dec, sizeof dec, WUFFS_VERSION,
+                                               wuffs_initialize_flags));
+
+  while (true) {
+    wuffs_base__io_buffer limited_dst = make_limited_writer(*dst, wlimit);
+    wuffs_base__io_buffer limited_src = make_limited_reader(*src, rlimit);
+
+    wuffs_base__status status = wuffs_zstd__decoder__transform_io(
+        &dec, &limited_dst, &limited_src, g_work_slice_u8);
+
+    dst->meta.wi += limited_dst.meta.wi;
+    src->meta.ri += limited_src.meta.ri;
+
+    if (((wlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_write)) ||
+        ((rlimit < UINT64_MAX) &&
+         (status.repr == wuffs_base__suspension__short_read))) {
+      continue;
+    }
+    return status.repr;
+  }
+}
+
+const char*  //
+test_wuffs_zstd_decode_midsummer() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(wuffs_zstd_decode, &g_zstd_midsummer_gt,
+                            UINT64_MAX, UINT64_MAX);
+}
+
+const char*  //
+test_wuffs_zstd_decode_pi() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(wuffs_zstd_decode, &g_zstd_pi_gt, UINT64_MAX,
+                            UINT64_MAX);
+}
+
+const char*  //
+test_wuffs_zstd_decode_pi_with_limits() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(wuffs_zstd_decode, &g_zstd_pi_gt, 4099, 1031);
+}
+
+const char*  //
+test_wuffs_zstd_decode_romeo_skippable_frame() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(wuffs_zstd_decode,
+                            &g_zstd_romeo_skippable_frame_gt, UINT64_MAX,
+                            UINT64_MAX);
+}
+
+const char*  //
+test_wuffs_zstd_decode_romeo_with_dictionary() {
+  CHECK_FOCUS(__func__);
+
+  wuffs_base__io_buffer have = ((wuffs_base__io_buffer){
+      .data = g_have_slice_u8,
+  });
+  wuffs_base__io_buffer src = ((wuffs_base__io_buffer){
+      .data = g_src_slice_u8,
+  });
+  CHECK_STRING(read_file(&src, "test/data/romeo.txt.midsummer-dictionary.zst"));
+
+  for (int i = 0; i < 2; i++) {
+    wuffs_zstd__decoder dec;
+    CHECK_STATUS("initialize", wuffs_zstd__decoder__initialize(
+                                   &dec, sizeof dec, WUFFS_VERSION,
+                                   WUFFS_INITIALIZE__DEFAULT_OPTIONS));
+
+    if (i > 0) {
+      // The decoder copies the dictionary, so it's OK to borrow the want
+      // buffer here.
+      wuffs_base__io_buffer dict = ((wuffs_base__io_buffer){
+          .data = g_want_slice_u8,
+      });
+      CHECK_STRING(read_file(&dict, "test/data/midsummer.txt.zstd-dictionary"));
+      CHECK_STATUS("add_dictionary",
+                   wuffs_zstd__decoder__add_dictionary(
+                       &dec, wuffs_base__io_buffer__reader_slice(&dict)));
+    }
+
+    have.meta.wi = 0;
+    src.meta.ri = 0;
+    wuffs_base__status status =
+        wuffs_zstd__decoder__transform_io(&dec, &have, &src, g_work_slice_u8);
+
+    uint32_t dict_id_have = wuffs_zstd__decoder__dictionary_id(&dec);
+    uint32_t dict_id_want = 0x393D6395;
+    if (dict_id_have != dict_id_want) {
+      RETURN_FAIL("i=%d: dictionary_id: have 0x%08" PRIX32
+                  ", want 0x%08" PRIX32,
+                  i, dict_id_have, dict_id_want);
+    }
+
+    if (i == 0) {
+      if (status.repr != wuffs_zstd__error__dictionary_required) {
+        RETURN_FAIL("transform_io (before dict): have \"%s\", want \"%s\"",
+                    status.repr, wuffs_zstd__error__dictionary_required);
+      }
+    } else if (status.repr != NULL) {
+      RETURN_FAIL("transform_io (after dict): have \"%s\", want NULL",
+                  status.repr);
+    }
+  }
+
+  wuffs_base__io_buffer want = ((wuffs_base__io_buffer){
+      .data = g_want_slice_u8,
+  });
+  CHECK_STRING(read_file(&want, "test/data/romeo.txt"));
+  return check_io_buffers_equal("", &have, &want);
+}
+
+// ---------------- Mimic Tests
+
+#ifdef WUFFS_MIMIC
+
+const char*  //
+test_mimic_zstd_decode_midsummer() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(mimic_zstd_decode, &g_zstd_midsummer_gt,
+                            UINT64_MAX, UINT64_MAX);
+}
+
+const char*  //
+test_mimic_zstd_decode_pi() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(mimic_zstd_decode, &g_zstd_pi_gt, UINT64_MAX,
+                            UINT64_MAX);
+}
+
+const char*  //
+test_mimic_zstd_decode_romeo_skippable_frame() {
+  CHECK_FOCUS(__func__);
+  return do_test_io_buffers(mimic_zstd_decode,
+                            &g_zstd_romeo_skippable_frame_gt, UINT64_MAX,
+                            UINT64_MAX);
+}
+
+#endif  // WUFFS_MIMIC
+
+// ---------------- Zstd Benches
+
+const char*  //
+bench_wuffs_zstd_decode_10k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zstd_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_zstd_midsummer_gt, UINT64_MAX, UINT64_MAX, 300);
+}
+
+const char*  //
+bench_wuffs_zstd_decode_100k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      wuffs_zstd_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_zstd_pi_gt, UINT64_MAX, UINT64_MAX, 30);
+}
+
+// ---------------- Mimic Benches
+
+#ifdef WUFFS_MIMIC
+
+const char*  //
+bench_mimic_zstd_decode_10k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      mimic_zstd_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_zstd_midsummer_gt, UINT64_MAX, UINT64_MAX, 300);
+}
+
+const char*  //
+bench_mimic_zstd_decode_100k() {
+  CHECK_FOCUS(__func__);
+  return do_bench_io_buffers(
+      mimic_zstd_decode, WUFFS_INITIALIZE__LEAVE_INTERNAL_BUFFERS_UNINITIALIZED,
+      tcounter_dst, &g_zstd_pi_gt, UINT64_MAX, UINT64_MAX, 30);
+}
+
+#endif  // WUFFS_MIMIC
+
+// ---------------- Manifest
+
+proc g_tests[] = {
+
+    test_wuffs_zstd_decode_interface,
+    test_wuffs_zstd_decode_midsummer,
+    test_wuffs_zstd_decode_pi,
+    test_wuffs_zstd_decode_pi_with_limits,
+    test_wuffs_zstd_decode_romeo_skippable_frame,
+    test_wuffs_zstd_decode_romeo_with_dictionary,
+    test_wuffs_zstd_decode_single_frame_quirk,
+    test_wuffs_zstd_decode_truncated_input,
+
+#ifdef WUFFS_MIMIC
+
+    test_mimic_zstd_decode_midsummer,
+    test_mimic_zstd_decode_pi,
+    test_mimic_zstd_decode_romeo_skippable_frame,
+
+#endif  // WUFFS_MIMIC
+
+    NULL,
+};
+
+proc g_benches[] = {
+
+    bench_wuffs_zstd_decode_10k,
+    bench_wuffs_zstd_decode_100k,
+
+#ifdef WUFFS_MIMIC
+
+    bench_mimic_zstd_decode_10k,
+    bench_mimic_zstd_decode_100k,
+
+#endif  // WUFFS_MIMIC
+
+    NULL,
+};
+
+int  //
+main(int argc, char** argv) {
+  g_proc_package_name = "std/zstd";
+  return test_main(argc, argv, g_tests, g_benches);
+}
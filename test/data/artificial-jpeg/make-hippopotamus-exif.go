@@ -0,0 +1,75 @@
+// Copyright 2024 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+//go:build ignore
+// +build ignore
+
+package main
+
+// Usage: go run make-hippopotamus-exif.go
+//
+// This program inserts an APP1 (Exif) marker segment, after the APP0 (JFIF)
+// one, into the test/data/hippopotamus.jpeg file. The segment's payload is
+// "Exif\x00\x00" followed by 26 bytes of TIFF: a big-endian header and a
+// one-entry IFD (Image File Directory) whose Orientation tag (0x0112) has
+// value 6, meaning that the image should be rotated 90 degrees clockwise.
+//
+// $ go run script/print-jpeg-markers.go test/data/artificial-jpeg/hippopotamus-exif.jpeg
+// pos = 0x00000000 =          0    marker = 0xFF 0xD8  SOI
+// pos = 0x00000002 =          2    marker = 0xFF 0xE0  APP0
+// pos = 0x00000014 =         20    marker = 0xFF 0xE1  APP1
+// pos = 0x00000038 =         56    marker = 0xFF 0xDB  DQT
+// pos = 0x0000007D =        125    marker = 0xFF 0xDB  DQT
+// pos = 0x000000C2 =        194    marker = 0xFF 0xC0  SOF0 (Sequential/Baseline)
+// pos = 0x000000D5 =        213    marker = 0xFF 0xC4  DHT
+// pos = 0x000000F0 =        240    marker = 0xFF 0xC4  DHT
+// pos = 0x00000120 =        288    marker = 0xFF 0xC4  DHT
+// pos = 0x0000013D =        317    marker = 0xFF 0xC4  DHT
+// pos = 0x0000016F =        367    marker = 0xFF 0xDA  SOS
+// pos = 0x000004E5 =       1253    marker = 0xFF 0xD9  EOI
+//
+// The TIFF data is at positions 0x1E ..= 0x37.
+
+import (
+	"fmt"
+	"os"
+)
+
+func main() {
+	if err := main1(); err != nil {
+		os.Stderr.WriteString(err.Error() + "\n")
+		os.Exit(1)
+	}
+}
+
+func main1() error {
+	src, err := os.ReadFile("../hippopotamus.jpeg")
+	if err != nil {
+		return err
+	} else if len(src) != 0x4C3 {
+		return fmt.Errorf("bad input length: 0x%X", len(src))
+	}
+
+	part0 := src[0x000:0x014]
+	part1 := src[0x014:0x4C3]
+
+	dst := []byte(nil)
+	dst = append(dst, part0...)
+	dst = append(dst, 0xFF, 0xE1, 0x00, 0x22)
+	dst = append(dst, "Exif\x00\x00"...)
+	dst = append(dst, "MM\x00\x2A\x00\x00\x00\x08"...)
+	dst = append(dst, 0x00, 0x01)
+	dst = append(dst, 0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01)
+	dst = append(dst, 0x00, 0x06, 0x00, 0x00)
+	dst = append(dst, 0x00, 0x00, 0x00, 0x00)
+	dst = append(dst, part1...)
+
+	return os.WriteFile("hippopotamus-exif.jpeg", dst, 0666)
+}
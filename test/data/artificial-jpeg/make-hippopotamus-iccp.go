@@ -0,0 +1,121 @@
+// Copyright 2026 The Wuffs Authors.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// https://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or https://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+
+//go:build ignore
+// +build ignore
+
+package main
+
+// Usage: go run make-hippopotamus-iccp.go
+//
+// This program inserts two APP2 (ICC_PROFILE) marker segments, after the APP0
+// (JFIF) one, into the test/data/hippopotamus.jpeg file. Each segment's
+// payload is "ICC_PROFILE\x00", a 1-based chunk number, the number of chunks
+// (2) and then part of the 604 byte DCI-P3-D65 ICC profile from the iCCP
+// chunk of test/data/red-blue-gradient.dcip3d65-no-chrm-no-gama.png. The
+// first segment holds 300 bytes of the profile and the second one holds 304.
+//
+// $ go run script/print-jpeg-markers.go test/data/artificial-jpeg/hippopotamus-iccp.jpeg
+// pos = 0x00000000 =          0    marker = 0xFF 0xD8  SOI
+// pos = 0x00000002 =          2    marker = 0xFF 0xE0  APP0
+// pos = 0x00000014 =         20    marker = 0xFF 0xE2  APP2
+// pos = 0x00000152 =        338    marker = 0xFF 0xE2  APP2
+// pos = 0x00000294 =        660    marker = 0xFF 0xDB  DQT
+// pos = 0x000002D9 =        729    marker = 0xFF 0xDB  DQT
+// pos = 0x0000031E =        798    marker = 0xFF 0xC0  SOF0 (Sequential/Baseline)
+// pos = 0x00000331 =        817    marker = 0xFF 0xC4  DHT
+// pos = 0x0000034C =        844    marker = 0xFF 0xC4  DHT
+// pos = 0x0000037C =        892    marker = 0xFF 0xC4  DHT
+// pos = 0x00000399 =        921    marker = 0xFF 0xC4  DHT
+// pos = 0x000003CB =        971    marker = 0xFF 0xDA  SOS
+// pos = 0x00000741 =       1857    marker = 0xFF 0xD9  EOI
+//
+// The ICC profile is at positions 0x0026 ..= 0x0151 and 0x0164 ..= 0x0293.
+
+import (
+	"bytes"
+	"compress/zlib"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"os"
+)
+
+func main() {
+	if err := main1(); err != nil {
+		os.Stderr.WriteString(err.Error() + "\n")
+		os.Exit(1)
+	}
+}
+
+func main1() error {
+	src, err := os.ReadFile("../hippopotamus.jpeg")
+	if err != nil {
+		return err
+	} else if len(src) != 0x4C3 {
+		return fmt.Errorf("bad input length: 0x%X", len(src))
+	}
+
+	profile, err := readIccProfile("../red-blue-gradient.dcip3d65-no-chrm-no-gama.png")
+	if err != nil {
+		return err
+	} else if len(profile) != 604 {
+		return fmt.Errorf("bad profile length: %d", len(profile))
+	}
+
+	part0 := src[0x000:0x014]
+	part1 := src[0x014:0x4C3]
+
+	dst := []byte(nil)
+	dst = append(dst, part0...)
+	dst = appendApp2(dst, profile[:300], 1, 2)
+	dst = appendApp2(dst, profile[300:], 2, 2)
+	dst = append(dst, part1...)
+
+	return os.WriteFile("hippopotamus-iccp.jpeg", dst, 0666)
+}
+
+func appendApp2(dst []byte, chunk []byte, chunkNumber byte, numChunks byte) []byte {
+	dst = append(dst, 0xFF, 0xE2)
+	dst = binary.BigEndian.AppendUint16(dst, uint16(2+14+len(chunk)))
+	dst = append(dst, "ICC_PROFILE\x00"...)
+	dst = append(dst, chunkNumber, numChunks)
+	return append(dst, chunk...)
+}
+
+// readIccProfile returns the decompressed contents of a PNG file's iCCP chunk.
+func readIccProfile(filename string) ([]byte, error) {
+	src, err := os.ReadFile(filename)
+	if err != nil {
+		return nil, err
+	} else if len(src) < 8 {
+		return nil, fmt.Errorf("bad PNG file")
+	}
+	for p := src[8:]; len(p) >= 12; {
+		n := int(binary.BigEndian.Uint32(p[0:4]))
+		if n > (len(p) - 12) {
+			break
+		}
+		if string(p[4:8]) == "iCCP" {
+			chunk := p[8 : 8+n]
+			i := bytes.IndexByte(chunk, 0)
+			if (i < 0) || ((i + 2) > len(chunk)) {
+				break
+			}
+			r, err := zlib.NewReader(bytes.NewReader(chunk[i+2:]))
+			if err != nil {
+				return nil, err
+			}
+			return io.ReadAll(r)
+		}
+		p = p[12+n:]
+	}
+	return nil, fmt.Errorf("no iCCP chunk")
+}